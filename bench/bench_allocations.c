@@ -0,0 +1,170 @@
+/*
+ * Counts the heap allocations made while answering requests once the
+ * server has warmed up, either over one keep-alive connection or with a new
+ * connection per request. malloc, calloc and realloc are interposed for the
+ * whole process, so every allocation is counted, including the ones made by
+ * libc and by the thread pool.
+ *
+ * usage: bench_allocations [epoll|io_uring] [keepalive|close] [requests]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define BENCH_PORT 8091
+#define WARMUP_REQUESTS 100
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+const char keepalive_request[] = "GET /users/42 HTTP/1.1\r\nHost: localhost\r\nUser-Agent: bench\r\nAccept: */*\r\n\r\n";
+const char close_request[] = "GET /users/42 HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+size_t requests = 10000;
+bool new_connections = false;
+struct sockaddr_in address;
+
+atomic_bool counting;
+atomic_size_t allocations;
+
+void *malloc(size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed))
+        atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed))
+        atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    if (atomic_load_explicit(&counting, memory_order_relaxed))
+        atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+void *user_handler(http_request *req, http_response *res)
+{
+    size_t length;
+    const char *id = http_request_get_param(req, "id", &length);
+    char body[64];
+    snprintf(body, sizeof(body), "{\"id\": %.*s}", (int)length, id);
+
+    http_response_add_header(res, "Content-Type", "application/json");
+    http_response_add_body(res, body);
+    return NULL;
+}
+
+void *server_thread(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
+int open_connection(void)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool exchange(int *fd, char *buffer, size_t capacity)
+{
+    if (new_connections)
+    {
+        *fd = open_connection();
+        if (*fd < 0) return false;
+
+        bool sent = send(*fd, close_request, sizeof(close_request) - 1, 0) >= 0;
+        while (sent && recv(*fd, buffer, capacity, 0) > 0)
+            ;
+        close(*fd);
+        return sent;
+    }
+
+    if (send(*fd, keepalive_request, sizeof(keepalive_request) - 1, 0) < 0)
+        return false;
+
+    /* the response is small enough to come back in one piece */
+    ssize_t bytes = recv(*fd, buffer, capacity, 0);
+    return bytes > 0;
+}
+
+int main(int argc, char **argv)
+{
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+    config.io_backend = argc > 1 && strcmp(argv[1], "io_uring") == 0 ? NETC_IO_BACKEND_IO_URING : NETC_IO_BACKEND_EPOLL;
+    new_connections = argc > 2 && strcmp(argv[2], "close") == 0;
+    if (argc > 3) requests = strtoul(argv[3], NULL, 10);
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint(GET, "/users/:id", user_handler);
+
+    pthread_t server_tid;
+    pthread_create(&server_tid, NULL, server_thread, NULL);
+    usleep(100000);
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(BENCH_PORT);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = new_connections ? -1 : open_connection();
+    if (new_connections == false && fd < 0)
+    {
+        perror("client");
+        return EXIT_FAILURE;
+    }
+
+    char buffer[1024];
+    for (size_t i = 0; i < WARMUP_REQUESTS; i++)
+    {
+        if (exchange(&fd, buffer, sizeof(buffer)) == false)
+        {
+            perror("client");
+            return EXIT_FAILURE;
+        }
+    }
+
+    atomic_store(&counting, true);
+    for (size_t i = 0; i < requests; i++)
+    {
+        if (exchange(&fd, buffer, sizeof(buffer)) == false)
+        {
+            perror("client");
+            break;
+        }
+    }
+    atomic_store(&counting, false);
+
+    size_t counted = atomic_load(&allocations);
+    printf("backend=%s connections=%s requests=%zu allocations=%zu allocations/request=%.3f\n",
+           config.io_backend == NETC_IO_BACKEND_IO_URING ? "io_uring" : "epoll",
+           new_connections ? "close" : "keepalive", requests, counted, (double)counted / requests);
+
+    if (new_connections == false)
+        close(fd);
+    kill(getpid(), SIGINT);
+    pthread_join(server_tid, NULL);
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * Measures throughput of handlers waiting on a slow backend, simulated by a
+ * fixed delay, with many concurrent keep-alive connections: blocking
+ * handlers sleep on a worker, deferred handlers hand the request to a timer
+ * thread that completes it once the delay has passed.
+ *
+ * usage: bench_async [clients] [requests_per_client] [delay_ms]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define BENCH_PORT 8092
+#define BENCH_WORKERS 4
+
+struct pending
+{
+    netc_deferred  *deferred;
+    double          deadline_us;
+    struct pending *next;
+};
+
+size_t requests_per_client = 20;
+size_t delay_ms = 10;
+const char *current_path;
+
+pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+struct pending *pending_head = NULL;
+atomic_bool timer_running = true;
+
+const char backend_body[] = "{\"backend\":\"ok\"}";
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void *blocking_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    usleep(delay_ms * 1000);
+    http_response_set_static_body(res, backend_body, sizeof(backend_body) - 1);
+    return NULL;
+}
+
+void *deferred_handler(http_request *req, http_response *res)
+{
+    (void)res;
+    struct pending *pending = malloc(sizeof(struct pending));
+    if (pending == NULL) return NULL;
+
+    pending->deferred = netc_defer(req);
+    if (pending->deferred == NULL)
+    {
+        free(pending);
+        return NULL;
+    }
+    pending->deadline_us = now_us() + delay_ms * 1000.0;
+
+    pthread_mutex_lock(&pending_mutex);
+    pending->next = pending_head;
+    pending_head = pending;
+    pthread_mutex_unlock(&pending_mutex);
+    return NULL;
+}
+
+/* plays the backend: answers every deferred request once its delay passed */
+void *timer_thread(void *arg)
+{
+    (void)arg;
+    while (atomic_load(&timer_running))
+    {
+        double now = now_us();
+        struct pending *due = NULL;
+
+        pthread_mutex_lock(&pending_mutex);
+        struct pending **link = &pending_head;
+        while (*link != NULL)
+        {
+            struct pending *pending = *link;
+            if (pending->deadline_us <= now)
+            {
+                *link = pending->next;
+                pending->next = due;
+                due = pending;
+            }
+            else
+            {
+                link = &pending->next;
+            }
+        }
+        pthread_mutex_unlock(&pending_mutex);
+
+        while (due != NULL)
+        {
+            struct pending *next = due->next;
+            http_response *res = netc_deferred_response(due->deferred);
+            http_response_set_static_body(res, backend_body, sizeof(backend_body) - 1);
+            netc_complete(due->deferred);
+            free(due);
+            due = next;
+        }
+
+        usleep(500);
+    }
+
+    return NULL;
+}
+
+void *server_thread(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
+/* connections are opened before timing */
+int open_connection(void)
+{
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+void *client_thread(void *arg)
+{
+    int fd = *(int*)arg;
+    char request[128];
+    int request_length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", current_path);
+
+    char buffer[4096];
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        /* the responses are small and fixed, one read ends with the body */
+        if (send(fd, request, request_length, 0) < 0 || recv(fd, buffer, sizeof(buffer), 0) <= 0)
+        {
+            perror("client");
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    size_t clients = argc > 1 ? strtoul(argv[1], NULL, 10) : 256;
+    if (argc > 2) requests_per_client = strtoul(argv[2], NULL, 10);
+    if (argc > 3) delay_ms = strtoul(argv[3], NULL, 10);
+
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.thread_num = BENCH_WORKERS;
+    config.max_keepalive_requests = SIZE_MAX;
+    /* opening many connections through the short backlog can take seconds,
+     * the first ones must not be closed as idle meanwhile */
+    config.keepalive_timeout_ms = 60000;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint(GET, "/blocking", blocking_handler);
+    netc_add_endpoint(GET, "/deferred", deferred_handler);
+
+    pthread_t server_tid, timer_tid;
+    pthread_create(&server_tid, NULL, server_thread, NULL);
+    pthread_create(&timer_tid, NULL, timer_thread, NULL);
+    usleep(100000);
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    int *client_fds = calloc(clients, sizeof(int));
+    const char *paths[] = { "/blocking", "/deferred" };
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+    {
+        current_path = paths[p];
+        for (size_t i = 0; i < clients; i++)
+            client_fds[i] = open_connection();
+
+        double start = now_us();
+        for (size_t i = 0; i < clients; i++)
+            pthread_create(&client_tids[i], NULL, client_thread, &client_fds[i]);
+        for (size_t i = 0; i < clients; i++)
+            pthread_join(client_tids[i], NULL);
+        double seconds = (now_us() - start) / 1e6;
+
+        for (size_t i = 0; i < clients; i++)
+            close(client_fds[i]);
+
+        size_t total = clients * requests_per_client;
+        printf("handler=%s workers=%d clients=%zu delay_ms=%zu requests=%zu req/s=%.0f\n",
+               paths[p] + 1, BENCH_WORKERS, clients, delay_ms, total, total / seconds);
+    }
+
+    atomic_store(&timer_running, false);
+    pthread_join(timer_tid, NULL);
+    kill(getpid(), SIGINT);
+    pthread_join(server_tid, NULL);
+    free(client_tids);
+    free(client_fds);
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Measures a GET endpoint whose handler waits on a slow backend, e.g. a
+ * report built by a database query, hit by many clients at once, with and
+ * without NETC_ENDPOINT_COALESCE. Without it every request occupies a
+ * worker for the whole query; with it the requests arriving while one is
+ * being answered wait for it and are sent a copy of its response. The
+ * handler calls are counted in memory shared with the server child.
+ *
+ * usage: bench_coalesce [coalesce|plain] [clients] [requests_per_client] [backend_ms]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define BENCH_PORT 8098
+#define CLIENT_BUFFER_SIZE (64 * 1024)
+
+size_t requests_per_client = 200;
+useconds_t backend_us = 20000;
+atomic_size_t *handler_calls;
+atomic_size_t failed_requests = 0;
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* the backend query dominates, the answer is the same for everyone */
+void *report_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    atomic_fetch_add(handler_calls, 1);
+    usleep(backend_us);
+
+    http_response_add_header(res, "Content-Type", "application/json");
+    http_response_add_body(res, "{\"orders\":1250,\"revenue\":48210.75}");
+    return NULL;
+}
+
+void run_server(bool coalesce)
+{
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint_ex(GET, "/report", report_handler, coalesce ? NETC_ENDPOINT_COALESCE : NETC_ENDPOINT_BLOCKING);
+    netc_run();
+}
+
+/* reads one response and returns its body length, or -1 on error */
+ssize_t read_response(int fd, char *buffer)
+{
+    size_t received = 0;
+    char *head_end = NULL;
+    while (head_end == NULL)
+    {
+        ssize_t bytes = recv(fd, buffer + received, CLIENT_BUFFER_SIZE - received - 1, 0);
+        if (bytes <= 0) return -1;
+        received += bytes;
+        buffer[received] = '\0';
+        head_end = strstr(buffer, "\r\n\r\n");
+    }
+
+    const char *length_header = strcasestr(buffer, "Content-Length:");
+    if (length_header == NULL || length_header > head_end) return -1;
+    size_t content_length = strtoul(length_header + 15, NULL, 10);
+
+    size_t body_received = received - (head_end + 4 - buffer);
+    while (body_received < content_length)
+    {
+        ssize_t bytes = recv(fd, buffer, CLIENT_BUFFER_SIZE, 0);
+        if (bytes <= 0) return -1;
+        body_received += bytes;
+    }
+    return content_length;
+}
+
+int connect_client(void)
+{
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void *client_thread(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    if (fd < 0)
+    {
+        atomic_fetch_add(&failed_requests, requests_per_client);
+        return NULL;
+    }
+
+    const char *request = "GET /report HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    size_t request_length = strlen(request);
+    char *buffer = malloc(CLIENT_BUFFER_SIZE);
+
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        if (send(fd, request, request_length, 0) < 0 || read_response(fd, buffer) <= 0)
+        {
+            atomic_fetch_add(&failed_requests, requests_per_client - i);
+            break;
+        }
+    }
+
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    bool coalesce = argc <= 1 || strcmp(argv[1], "plain") != 0;
+    size_t clients = argc > 2 ? strtoul(argv[2], NULL, 10) : 64;
+    if (argc > 3) requests_per_client = strtoul(argv[3], NULL, 10);
+    if (argc > 4) backend_us = strtoul(argv[4], NULL, 10) * 1000;
+
+    handler_calls = mmap(NULL, sizeof(atomic_size_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (handler_calls == MAP_FAILED)
+    {
+        perror("mmap");
+        return 1;
+    }
+    atomic_init(handler_calls, 0);
+
+    pid_t server_pid = fork();
+    if (server_pid == 0)
+    {
+        run_server(coalesce);
+        _exit(0);
+    }
+    usleep(200000);
+
+    /* connected one by one: the listen backlog would drop a burst of them */
+    int *client_fds = calloc(clients, sizeof(int));
+    for (size_t i = 0; i < clients; i++)
+    {
+        client_fds[i] = connect_client();
+        usleep(1000);
+    }
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, (void*)(intptr_t)client_fds[i]);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double elapsed = now_us() - start;
+
+    kill(server_pid, SIGINT);
+    waitpid(server_pid, NULL, 0);
+
+    size_t total = clients * requests_per_client;
+    printf("mode=%s clients=%zu backend_ms=%u requests=%zu failed=%zu handler_calls=%zu req/s=%.0f avg_latency_ms=%.1f\n",
+           coalesce ? "coalesce" : "plain", clients, backend_us / 1000, total, atomic_load(&failed_requests),
+           atomic_load(handler_calls), total / (elapsed / 1e6), elapsed / 1e3 / requests_per_client);
+
+    free(client_tids);
+    free(client_fds);
+    munmap(handler_calls, sizeof(atomic_size_t));
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Measures request latency of a small JSON handler run inline on the event
+ * loop and of the same handler run on a worker, over keep-alive connections
+ * sending one request at a time.
+ *
+ * usage: bench_inline [clients] [requests_per_client]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define BENCH_PORT 8091
+
+size_t requests_per_client = 20000;
+const char *current_path;
+double *latencies;
+
+void *health_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    static const char body[] = "{\"status\":\"ok\"}";
+    http_response_add_header(res, "Content-Type", "application/json");
+    http_response_set_static_body(res, body, sizeof(body) - 1);
+    return NULL;
+}
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+int compare_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void *server_thread(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
+void *client_thread(void *arg)
+{
+    double *samples = arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char request[128];
+    int request_length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", current_path);
+
+    char buffer[4096];
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        /* the responses are small and fixed, one read ends with the body */
+        double start = now_us();
+        if (send(fd, request, request_length, 0) < 0 || recv(fd, buffer, sizeof(buffer), 0) <= 0)
+        {
+            perror("client");
+            break;
+        }
+        samples[i] = now_us() - start;
+    }
+
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    size_t clients = argc > 1 ? strtoul(argv[1], NULL, 10) : 4;
+    if (argc > 2) requests_per_client = strtoul(argv[2], NULL, 10);
+
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint_ex(GET, "/inline", health_handler, NETC_ENDPOINT_INLINE);
+    netc_add_endpoint(GET, "/worker", health_handler);
+
+    pthread_t server_tid;
+    pthread_create(&server_tid, NULL, server_thread, NULL);
+    usleep(100000);
+
+    size_t total = clients * requests_per_client;
+    latencies = calloc(total, sizeof(double));
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    const char *paths[] = { "/worker", "/inline" };
+    for (size_t p = 0; p < sizeof(paths) / sizeof(paths[0]); p++)
+    {
+        current_path = paths[p];
+        double start = now_us();
+        for (size_t i = 0; i < clients; i++)
+            pthread_create(&client_tids[i], NULL, client_thread, latencies + i * requests_per_client);
+        for (size_t i = 0; i < clients; i++)
+            pthread_join(client_tids[i], NULL);
+        double seconds = (now_us() - start) / 1e6;
+
+        qsort(latencies, total, sizeof(double), compare_double);
+        printf("handler=%s requests=%zu req/s=%.0f p50_us=%.1f p99_us=%.1f\n",
+               paths[p] + 1, total, total / seconds, latencies[total / 2], latencies[total * 99 / 100]);
+    }
+
+    kill(getpid(), SIGINT);
+    pthread_join(server_tid, NULL);
+    free(client_tids);
+    free(latencies);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Compares the epoll and io_uring event loops: syscalls issued by NetC per
+ * request and client-observed latency percentiles.
+ *
+ * usage: bench_io_backend [epoll|io_uring] [clients] [requests_per_client]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define BENCH_PORT 8089
+
+extern netc server;
+
+const char request[] = "GET /ping HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+size_t requests_per_client = 2000;
+
+void *ping_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    http_response_add_body(res, "pong");
+    return NULL;
+}
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void *server_thread(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
+void *client_thread(void *arg)
+{
+    double *latencies = arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char buffer[1024];
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        double start = now_us();
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+            send(fd, request, sizeof(request) - 1, 0) < 0)
+        {
+            perror("client");
+            close(fd);
+            latencies[i] = 0;
+            continue;
+        }
+        while (recv(fd, buffer, sizeof(buffer), 0) > 0)
+            ;
+        close(fd);
+        latencies[i] = now_us() - start;
+    }
+
+    return NULL;
+}
+
+int compare_double(const void *a, const void *b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.io_backend = argc > 1 && strcmp(argv[1], "io_uring") == 0
+        ? NETC_IO_BACKEND_IO_URING : NETC_IO_BACKEND_EPOLL;
+    size_t clients = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    if (argc > 3) requests_per_client = strtoul(argv[3], NULL, 10);
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint(GET, "/ping", ping_handler);
+
+    pthread_t server_tid;
+    pthread_create(&server_tid, NULL, server_thread, NULL);
+    usleep(100000);
+
+    double *latencies = calloc(clients * requests_per_client, sizeof(double));
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, latencies + i * requests_per_client);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double elapsed = now_us() - start;
+
+    /* read the counters before netc_run tears the reactors down */
+    const char *backend = server.reactors[0].backend == NETC_IO_BACKEND_IO_URING ? "io_uring" : "epoll";
+    uint64_t requests = 0, syscalls = 0;
+    for (size_t i = 0; i < server.reactor_count; i++)
+    {
+        requests += server.reactors[i].stats.requests;
+        syscalls += atomic_load(&server.reactors[i].stats.syscalls);
+    }
+
+    size_t total = clients * requests_per_client;
+    qsort(latencies, total, sizeof(double), compare_double);
+    printf("backend=%s requests=%zu req/s=%.0f syscalls/req=%.2f p50=%.1fus p99=%.1fus\n",
+           backend, total, total / (elapsed / 1e6),
+           requests ? (double)syscalls / requests : 0.0,
+           latencies[total / 2], latencies[(size_t)(total * 0.99)]);
+
+    kill(getpid(), SIGINT);
+    pthread_join(server_tid, NULL);
+    free(latencies);
+    free(client_tids);
+    return 0;
+}
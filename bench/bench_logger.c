@@ -0,0 +1,68 @@
+/*
+ * Measures ctsl_print from several threads at once, writing through the
+ * mutex in the calling thread or through the asynchronous ring, with the
+ * line formatted by the caller, by the flusher or not at all (binary).
+ *
+ * usage: bench_logger [sync|async|deferred|binary] [threads] [lines_per_thread]
+ */
+#include "ctsl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+ctsl logger;
+size_t lines_per_thread = 200000;
+
+double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void *log_thread(void *arg)
+{
+    size_t id = (size_t)arg;
+    for (size_t i = 0; i < lines_per_thread; i++)
+        ctsl_print(&logger, CTSL_INFO, "GET /users/%zu => Status 200 OK (thread %zu)", i, id);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    const char *mode = argc > 1 ? argv[1] : "sync";
+    ctsl_config config = ctsl_default_config();
+    config.async = strcmp(mode, "async") == 0;
+    config.format = strcmp(mode, "deferred") == 0 ? CTSL_FORMAT_DEFERRED
+                  : strcmp(mode, "binary") == 0 ? CTSL_FORMAT_BINARY
+                  : CTSL_FORMAT_TEXT;
+    config.overflow_policy = CTSL_OVERFLOW_BLOCK;
+    size_t threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    if (argc > 3) lines_per_thread = strtoul(argv[3], NULL, 10);
+
+    if (ctsl_init_with_config(&logger, "/dev/null", &config) == false)
+        return EXIT_FAILURE;
+
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    double start = now_ns();
+    for (size_t i = 0; i < threads; i++)
+        pthread_create(&tids[i], NULL, log_thread, (void*)i);
+    for (size_t i = 0; i < threads; i++)
+        pthread_join(tids[i], NULL);
+    double producers = now_ns() - start;
+
+    /* async lines are only on disk once the ring is drained */
+    ctsl_destroy(&logger);
+    double total = now_ns() - start;
+
+    size_t lines = threads * lines_per_thread;
+    printf("mode=%s threads=%zu lines=%zu ns/line(caller)=%.1f lines/s=%.0f\n",
+           mode, threads, lines,
+           producers / lines_per_thread, lines / (total / 1e9));
+
+    free(tids);
+    return 0;
+}
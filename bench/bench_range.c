@@ -0,0 +1,190 @@
+/*
+ * Measures clients resuming a download of a static file cut off halfway,
+ * asking for the bytes they miss with a Range header, against clients that
+ * fetch the whole file again. Ranges are sent with sendfile from their
+ * offset, so the server only pays for the bytes that go out. The server
+ * runs in a child process and its CPU time per request comes from the
+ * rusage of that child alone.
+ *
+ * usage: bench_range [range|full] [file_kb] [clients] [requests_per_client] [received_percent]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define BENCH_PORT 8094
+#define CLIENT_BUFFER_SIZE (256 * 1024)
+
+size_t file_size = 16 * 1024 * 1024;
+size_t requests_per_client = 50;
+size_t received_size;
+bool resume = true;
+char directory[] = "/tmp/bench_range_XXXXXX";
+char file_path[64];
+int file_fd;
+atomic_size_t failed_requests = 0;
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void run_server(void)
+{
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    netc_add_static("/static", directory);
+    netc_run();
+}
+
+/* reads one response and returns its body length, or -1 on error */
+ssize_t read_response(int fd, char *buffer)
+{
+    size_t received = 0;
+    char *head_end = NULL;
+    while (head_end == NULL)
+    {
+        ssize_t bytes = recv(fd, buffer + received, CLIENT_BUFFER_SIZE - received - 1, 0);
+        if (bytes <= 0) return -1;
+        received += bytes;
+        buffer[received] = '\0';
+        head_end = strstr(buffer, "\r\n\r\n");
+    }
+
+    const char *length_header = strcasestr(buffer, "Content-Length:");
+    if (length_header == NULL || length_header > head_end) return -1;
+    size_t content_length = strtoul(length_header + 15, NULL, 10);
+
+    size_t body_received = received - (head_end + 4 - buffer);
+    while (body_received < content_length)
+    {
+        size_t wanted = content_length - body_received;
+        ssize_t bytes = recv(fd, buffer, wanted < CLIENT_BUFFER_SIZE ? wanted : CLIENT_BUFFER_SIZE, 0);
+        if (bytes <= 0) return -1;
+        body_received += bytes;
+    }
+    return content_length;
+}
+
+void *client_thread(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    /* the part already received is on the client disk, only the rest is asked for */
+    char request[128];
+    char range[48] = "";
+    if (resume)
+        snprintf(range, sizeof(range), "Range: bytes=%zu-\r\n", received_size);
+    int request_length = snprintf(request, sizeof(request), "GET /static/file.bin HTTP/1.1\r\nHost: localhost\r\n%s\r\n",
+                                  range);
+    ssize_t expected = resume ? (ssize_t)(file_size - received_size) : (ssize_t)file_size;
+
+    char *buffer = malloc(CLIENT_BUFFER_SIZE);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        free(buffer);
+        atomic_fetch_add(&failed_requests, requests_per_client);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        if (send(fd, request, request_length, 0) < 0 || read_response(fd, buffer) != expected)
+        {
+            atomic_fetch_add(&failed_requests, requests_per_client - i);
+            break;
+        }
+    }
+
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    resume = argc <= 1 || strcmp(argv[1], "full") != 0;
+    if (argc > 2) file_size = strtoul(argv[2], NULL, 10) * 1024;
+    size_t clients = argc > 3 ? strtoul(argv[3], NULL, 10) : 4;
+    if (argc > 4) requests_per_client = strtoul(argv[4], NULL, 10);
+    size_t received_percent = argc > 5 ? strtoul(argv[5], NULL, 10) : 50;
+    received_size = file_size / 100 * (received_percent < 100 ? received_percent : 99);
+
+    /* the file is in the page cache before either mode runs */
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(file_path, sizeof(file_path), "%s/file.bin", directory);
+    file_fd = open(file_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    char *content = malloc(file_size);
+    memset(content, 'x', file_size);
+    if (file_fd < 0 || write(file_fd, content, file_size) != (ssize_t)file_size)
+    {
+        perror("write");
+        return 1;
+    }
+    free(content);
+
+    pid_t server_pid = fork();
+    if (server_pid == 0)
+    {
+        run_server();
+        _exit(0);
+    }
+    usleep(200000);
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, NULL);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double seconds = (now_us() - start) / 1e6;
+
+    kill(server_pid, SIGINT);
+    waitpid(server_pid, NULL, 0);
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    double cpu_us = usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec +
+                    usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+
+    size_t total = clients * requests_per_client;
+    size_t sent = resume ? file_size - received_size : file_size;
+    printf("mode=%s file_kb=%zu received_kb=%zu clients=%zu requests=%zu failed=%zu resumes/s=%.0f "
+           "sent_kb/resume=%zu server_cpu_us/resume=%.1f\n",
+           resume ? "range" : "full", file_size / 1024, received_size / 1024, clients, total,
+           atomic_load(&failed_requests), total / seconds, sent / 1024, cpu_us / total);
+
+    free(client_tids);
+    close(file_fd);
+    unlink(file_path);
+    rmdir(directory);
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Measures response throughput for 1 KiB, 64 KiB and 1 MiB bodies over
+ * keep-alive connections, with the body either borrowed from static memory
+ * or copied into each response.
+ *
+ * usage: bench_response_body [static|copy] [clients] [requests_per_client]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#define BENCH_PORT 8090
+
+const struct { const char *path; size_t length; } sizes[] = {
+    { "/1k", 1024 },
+    { "/64k", 64 * 1024 },
+    { "/1m", 1024 * 1024 }
+};
+
+char *payload;
+bool copy_body = false;
+size_t requests_per_client = 500;
+const char *current_path;
+
+void send_payload(http_response *res, size_t length)
+{
+    if (copy_body == false)
+    {
+        http_response_set_static_body(res, payload, length);
+        return;
+    }
+
+    char *body = malloc(length);
+    if (body == NULL) return;
+    memcpy(body, payload, length);
+    http_response_set_body(res, body, length);
+}
+
+void *body_1k_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    send_payload(res, sizes[0].length);
+    return NULL;
+}
+
+void *body_64k_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    send_payload(res, sizes[1].length);
+    return NULL;
+}
+
+void *body_1m_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    send_payload(res, sizes[2].length);
+    return NULL;
+}
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void *server_thread(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
+/* reads one response and returns its body length, or -1 on error */
+ssize_t read_response(int fd, char *buffer, size_t capacity)
+{
+    size_t received = 0;
+    char *head_end = NULL;
+    while (head_end == NULL)
+    {
+        ssize_t bytes = recv(fd, buffer + received, capacity - received - 1, 0);
+        if (bytes <= 0) return -1;
+        received += bytes;
+        buffer[received] = '\0';
+        head_end = strstr(buffer, "\r\n\r\n");
+    }
+
+    const char *length_header = strcasestr(buffer, "Content-Length:");
+    if (length_header == NULL || length_header > head_end) return -1;
+    size_t body_length = strtoul(length_header + strlen("Content-Length:"), NULL, 10);
+
+    size_t remaining = body_length - (received - (head_end + 4 - buffer));
+    while (remaining > 0)
+    {
+        ssize_t bytes = recv(fd, buffer, remaining < capacity ? remaining : capacity, 0);
+        if (bytes <= 0) return -1;
+        remaining -= bytes;
+    }
+
+    return body_length;
+}
+
+void *client_thread(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char request[128];
+    int request_length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", current_path);
+
+    size_t capacity = 256 * 1024;
+    char *buffer = malloc(capacity);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        free(buffer);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        if (send(fd, request, request_length, 0) < 0 || read_response(fd, buffer, capacity) < 0)
+        {
+            perror("client");
+            break;
+        }
+    }
+
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    copy_body = argc > 1 && strcmp(argv[1], "copy") == 0;
+    size_t clients = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    if (argc > 3) requests_per_client = strtoul(argv[3], NULL, 10);
+
+    payload = malloc(sizes[2].length);
+    memset(payload, 'x', sizes[2].length);
+
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint(GET, "/1k", body_1k_handler);
+    netc_add_endpoint(GET, "/64k", body_64k_handler);
+    netc_add_endpoint(GET, "/1m", body_1m_handler);
+
+    pthread_t server_tid;
+    pthread_create(&server_tid, NULL, server_thread, NULL);
+    usleep(100000);
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        current_path = sizes[s].path;
+        double start = now_us();
+        for (size_t i = 0; i < clients; i++)
+            pthread_create(&client_tids[i], NULL, client_thread, NULL);
+        for (size_t i = 0; i < clients; i++)
+            pthread_join(client_tids[i], NULL);
+        double seconds = (now_us() - start) / 1e6;
+
+        size_t total = clients * requests_per_client;
+        printf("body=%s mode=%s requests=%zu req/s=%.0f MB/s=%.1f\n",
+               sizes[s].path + 1, copy_body ? "copy" : "static", total,
+               total / seconds, total * sizes[s].length / seconds / 1e6);
+    }
+
+    kill(getpid(), SIGINT);
+    pthread_join(server_tid, NULL);
+    free(client_tids);
+    free(payload);
+    return 0;
+}
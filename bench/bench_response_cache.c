@@ -0,0 +1,175 @@
+/*
+ * Measures a GET endpoint whose answer only changes every few seconds, e.g.
+ * a product catalog, with and without NETC_ENDPOINT_CACHE. Without the cache
+ * every request is handed to a worker, runs the handler and is serialized
+ * again; with it the event loop answers from the stored bytes. The server
+ * runs in a child process and its CPU time per request comes from the
+ * rusage of that child alone.
+ *
+ * usage: bench_response_cache [cache|nocache] [clients] [requests_per_client] [items]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define BENCH_PORT 8097
+#define CLIENT_BUFFER_SIZE (64 * 1024)
+
+size_t requests_per_client = 20000;
+size_t items = 40;
+atomic_size_t failed_requests = 0;
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* the work a real handler does: building a JSON document from records */
+void *catalog_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    size_t capacity = items * 96 + 16;
+    char *body = malloc(capacity);
+    if (body == NULL) return NULL;
+
+    size_t length = snprintf(body, capacity, "[");
+    for (size_t i = 0; i < items; i++)
+    {
+        length += snprintf(body + length, capacity - length,
+                           "%s{\"id\":%zu,\"name\":\"product-%zu\",\"price\":%zu.%02zu,\"stock\":%zu}",
+                           i > 0 ? "," : "", i, i * 31, 10 + i % 90, i % 100, (i * 7) % 500);
+    }
+    length += snprintf(body + length, capacity - length, "]");
+
+    http_response_add_header(res, "Content-Type", "application/json");
+    http_response_add_header(res, "Cache-Control", "public, max-age=5");
+    http_response_set_body(res, body, length);
+    return NULL;
+}
+
+void run_server(bool cache)
+{
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint_ex(GET, "/catalog", catalog_handler, cache ? NETC_ENDPOINT_CACHE : NETC_ENDPOINT_BLOCKING);
+    netc_run();
+}
+
+/* reads one response and returns its body length, or -1 on error */
+ssize_t read_response(int fd, char *buffer)
+{
+    size_t received = 0;
+    char *head_end = NULL;
+    while (head_end == NULL)
+    {
+        ssize_t bytes = recv(fd, buffer + received, CLIENT_BUFFER_SIZE - received - 1, 0);
+        if (bytes <= 0) return -1;
+        received += bytes;
+        buffer[received] = '\0';
+        head_end = strstr(buffer, "\r\n\r\n");
+    }
+
+    const char *length_header = strcasestr(buffer, "Content-Length:");
+    if (length_header == NULL || length_header > head_end) return -1;
+    size_t content_length = strtoul(length_header + 15, NULL, 10);
+
+    size_t body_received = received - (head_end + 4 - buffer);
+    while (body_received < content_length)
+    {
+        ssize_t bytes = recv(fd, buffer, CLIENT_BUFFER_SIZE, 0);
+        if (bytes <= 0) return -1;
+        body_received += bytes;
+    }
+    return content_length;
+}
+
+void *client_thread(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    const char *request = "GET /catalog HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    size_t request_length = strlen(request);
+
+    char *buffer = malloc(CLIENT_BUFFER_SIZE);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        free(buffer);
+        atomic_fetch_add(&failed_requests, requests_per_client);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        if (send(fd, request, request_length, 0) < 0 || read_response(fd, buffer) <= 0)
+        {
+            atomic_fetch_add(&failed_requests, requests_per_client - i);
+            break;
+        }
+    }
+
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    bool cache = argc <= 1 || strcmp(argv[1], "nocache") != 0;
+    size_t clients = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    if (argc > 3) requests_per_client = strtoul(argv[3], NULL, 10);
+    if (argc > 4) items = strtoul(argv[4], NULL, 10);
+
+    pid_t server_pid = fork();
+    if (server_pid == 0)
+    {
+        run_server(cache);
+        _exit(0);
+    }
+    usleep(200000);
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, NULL);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double seconds = (now_us() - start) / 1e6;
+
+    kill(server_pid, SIGINT);
+    waitpid(server_pid, NULL, 0);
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    double cpu_us = usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec +
+                    usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+
+    size_t total = clients * requests_per_client;
+    printf("mode=%s clients=%zu items=%zu requests=%zu failed=%zu req/s=%.0f server_cpu_us/req=%.1f\n",
+           cache ? "cache" : "nocache", clients, items, total, atomic_load(&failed_requests),
+           total / seconds, cpu_us / total);
+
+    free(client_tids);
+    return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Measures clients revalidating a cached document they already hold, e.g.
+ * a dashboard polling a report, sending the ETag of their copy in
+ * If-None-Match against clients that fetch it again. Revalidated requests
+ * are answered with a 304 head alone, the others with the whole body. The
+ * server runs in a child process and its CPU time per request comes from
+ * the rusage of that child alone.
+ *
+ * usage: bench_revalidate [etag|full] [clients] [requests_per_client] [body_kb]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define BENCH_PORT 8099
+#define CLIENT_BUFFER_SIZE (256 * 1024)
+
+size_t requests_per_client = 20000;
+size_t body_size = 64 * 1024;
+bool revalidate = true;
+char etag[64];
+atomic_size_t failed_requests = 0;
+atomic_size_t received_bytes = 0;
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void *report_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    char *body = malloc(body_size);
+    if (body == NULL) return NULL;
+    memset(body, 'r', body_size);
+
+    http_response_add_header(res, "Content-Type", "text/plain");
+    http_response_add_header(res, "Cache-Control", "public, max-age=60");
+    http_response_set_body(res, body, body_size);
+    return NULL;
+}
+
+void run_server(void)
+{
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint_ex(GET, "/report", report_handler, NETC_ENDPOINT_CACHE);
+    netc_run();
+}
+
+/* reads one response and returns the bytes it took, or -1 on error. The
+ * ETag of the first one is kept for the clients to revalidate with */
+ssize_t read_response(int fd, char *buffer)
+{
+    size_t received = 0;
+    char *head_end = NULL;
+    while (head_end == NULL)
+    {
+        ssize_t bytes = recv(fd, buffer + received, CLIENT_BUFFER_SIZE - received - 1, 0);
+        if (bytes <= 0) return -1;
+        received += bytes;
+        buffer[received] = '\0';
+        head_end = strstr(buffer, "\r\n\r\n");
+    }
+
+    const char *etag_header = strcasestr(buffer, "ETag: ");
+    if (etag[0] == '\0' && etag_header != NULL && etag_header < head_end)
+        snprintf(etag, sizeof(etag), "%.*s", (int)strcspn(etag_header + 6, "\r"), etag_header + 6);
+
+    /* a 304 has no body, whatever its Content-Length says */
+    size_t head_length = head_end + 4 - buffer;
+    if (strncmp(buffer, "HTTP/1.1 304", 12) == 0)
+        return head_length;
+
+    const char *length_header = strcasestr(buffer, "Content-Length:");
+    if (length_header == NULL || length_header > head_end) return -1;
+    size_t content_length = strtoul(length_header + 15, NULL, 10);
+
+    size_t body_received = received - head_length;
+    while (body_received < content_length)
+    {
+        ssize_t bytes = recv(fd, buffer, CLIENT_BUFFER_SIZE, 0);
+        if (bytes <= 0) return -1;
+        body_received += bytes;
+    }
+    return head_length + content_length;
+}
+
+void *client_thread(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char request[256];
+    size_t request_length = snprintf(request, sizeof(request), "GET /report HTTP/1.1\r\nHost: localhost\r\n%s%s%s\r\n",
+                                     revalidate ? "If-None-Match: " : "", revalidate ? etag : "", revalidate ? "\r\n" : "");
+
+    char *buffer = malloc(CLIENT_BUFFER_SIZE);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        free(buffer);
+        atomic_fetch_add(&failed_requests, requests_per_client);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        ssize_t bytes;
+        if (send(fd, request, request_length, 0) < 0 || (bytes = read_response(fd, buffer)) <= 0)
+        {
+            atomic_fetch_add(&failed_requests, requests_per_client - i);
+            break;
+        }
+        atomic_fetch_add(&received_bytes, bytes);
+    }
+
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    revalidate = argc <= 1 || strcmp(argv[1], "full") != 0;
+    size_t clients = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    if (argc > 3) requests_per_client = strtoul(argv[3], NULL, 10);
+    if (argc > 4) body_size = strtoul(argv[4], NULL, 10) * 1024;
+
+    pid_t server_pid = fork();
+    if (server_pid == 0)
+    {
+        run_server();
+        _exit(0);
+    }
+    usleep(200000);
+
+    /* the copy the clients hold, fetched before the clock starts */
+    size_t saved_requests = requests_per_client;
+    requests_per_client = 1;
+    client_thread(NULL);
+    requests_per_client = saved_requests;
+    atomic_store(&received_bytes, 0);
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, NULL);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double seconds = (now_us() - start) / 1e6;
+
+    kill(server_pid, SIGINT);
+    waitpid(server_pid, NULL, 0);
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    double cpu_us = usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec +
+                    usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+
+    size_t total = clients * requests_per_client;
+    printf("mode=%s clients=%zu body_kb=%zu requests=%zu failed=%zu req/s=%.0f bytes/req=%.0f server_cpu_us/req=%.1f\n",
+           revalidate ? "etag" : "full", clients, body_size / 1024, total, atomic_load(&failed_requests),
+           total / seconds, (double)atomic_load(&received_bytes) / total, cpu_us / total);
+
+    free(client_tids);
+    return 0;
+}
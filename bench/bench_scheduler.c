@@ -0,0 +1,73 @@
+/*
+ * Measures scheduler throughput with tasks spread over every worker and
+ * with every task submitted to worker 0, which the other workers have to
+ * steal. Each task spins for a fixed amount of work. When every queue is
+ * full the producer yields and retries, the way an event loop would be held
+ * back under overload.
+ *
+ * usage: bench_scheduler [workers] [tasks] [spin_iterations]
+ */
+#include "netc_scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+size_t spin_iterations = 2000;
+atomic_size_t completed;
+
+void *spin_task(void *arg)
+{
+    (void)arg;
+    for (volatile size_t i = 0; i < spin_iterations; i++)
+        ;
+    atomic_fetch_add_explicit(&completed, 1, memory_order_relaxed);
+    return NULL;
+}
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void run(const char *name, size_t workers, size_t tasks, bool skewed)
+{
+    netc_scheduler scheduler;
+    if (netc_scheduler_init(&scheduler, workers, false) == false)
+    {
+        perror("scheduler");
+        exit(EXIT_FAILURE);
+    }
+
+    atomic_store(&completed, 0);
+    netc_task task = { .function = spin_task, .argp = NULL };
+    double start = now_us();
+    for (size_t i = 0; i < tasks; i++)
+        while (netc_scheduler_submit(&scheduler, &task, skewed ? 0 : i) == false)
+            sched_yield();
+    while (atomic_load_explicit(&completed, memory_order_relaxed) < tasks)
+        usleep(100);
+    double seconds = (now_us() - start) / 1e6;
+
+    netc_scheduler_stats stats = netc_scheduler_get_stats(&scheduler, workers);
+    printf("load=%s workers=%zu tasks=%zu tasks/s=%.0f stolen=%llu overflowed=%llu\n",
+           name, workers, tasks, tasks / seconds,
+           (unsigned long long)stats.stolen, (unsigned long long)stats.overflowed);
+    netc_scheduler_destroy(&scheduler);
+}
+
+int main(int argc, char **argv)
+{
+    size_t workers = argc > 1 ? strtoul(argv[1], NULL, 10) : 4;
+    size_t tasks = argc > 2 ? strtoul(argv[2], NULL, 10) : 200000;
+    if (argc > 3) spin_iterations = strtoul(argv[3], NULL, 10);
+
+    run("spread", workers, tasks, false);
+    run("skewed", workers, tasks, true);
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * Measures static files served with netc_add_static, sent by sendfile
+ * straight from the page cache, against a handler that reads the same file
+ * into http_response.body, copying it into user space and back into the
+ * socket. The handler keeps its file open and runs inline like the static
+ * route, so only the copies differ. The server runs in a child process and
+ * its CPU time per request comes from the rusage of that child alone.
+ *
+ * usage: bench_static [sendfile|read] [file_kb] [clients] [requests_per_client]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#define BENCH_PORT 8096
+#define CLIENT_BUFFER_SIZE (256 * 1024)
+
+size_t file_size = 64 * 1024;
+size_t requests_per_client = 2000;
+const char *request_path;
+char directory[] = "/tmp/bench_static_XXXXXX";
+char file_path[64];
+int file_fd;
+atomic_size_t failed_requests = 0;
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* what a handler serving files by hand does: a copy into the body */
+void *read_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    char *body = malloc(file_size);
+    if (body == NULL || pread(file_fd, body, file_size, 0) != (ssize_t)file_size)
+    {
+        free(body);
+        http_response_set_status(res, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+        return NULL;
+    }
+
+    http_response_add_header(res, "Content-Type", "application/octet-stream");
+    http_response_set_body(res, body, file_size);
+    return NULL;
+}
+
+void run_server(bool use_sendfile)
+{
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    if (use_sendfile)
+        netc_add_static("/static", directory);
+    else
+        netc_add_endpoint_ex(GET, "/read", read_handler, NETC_ENDPOINT_INLINE);
+
+    netc_run();
+}
+
+/* reads one response and returns its body length, or -1 on error */
+ssize_t read_response(int fd, char *buffer)
+{
+    size_t received = 0;
+    char *head_end = NULL;
+    while (head_end == NULL)
+    {
+        ssize_t bytes = recv(fd, buffer + received, CLIENT_BUFFER_SIZE - received - 1, 0);
+        if (bytes <= 0) return -1;
+        received += bytes;
+        buffer[received] = '\0';
+        head_end = strstr(buffer, "\r\n\r\n");
+    }
+
+    const char *length_header = strcasestr(buffer, "Content-Length:");
+    if (length_header == NULL || length_header > head_end) return -1;
+    size_t content_length = strtoul(length_header + 15, NULL, 10);
+
+    size_t body_received = received - (head_end + 4 - buffer);
+    while (body_received < content_length)
+    {
+        size_t wanted = content_length - body_received;
+        ssize_t bytes = recv(fd, buffer, wanted < CLIENT_BUFFER_SIZE ? wanted : CLIENT_BUFFER_SIZE, 0);
+        if (bytes <= 0) return -1;
+        body_received += bytes;
+    }
+    return content_length;
+}
+
+void *client_thread(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char request[128];
+    int request_length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", request_path);
+
+    char *buffer = malloc(CLIENT_BUFFER_SIZE);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        free(buffer);
+        atomic_fetch_add(&failed_requests, requests_per_client);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < requests_per_client; i++)
+    {
+        if (send(fd, request, request_length, 0) < 0 || read_response(fd, buffer) != (ssize_t)file_size)
+        {
+            atomic_fetch_add(&failed_requests, requests_per_client - i);
+            break;
+        }
+    }
+
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    bool use_sendfile = argc <= 1 || strcmp(argv[1], "read") != 0;
+    if (argc > 2) file_size = strtoul(argv[2], NULL, 10) * 1024;
+    size_t clients = argc > 3 ? strtoul(argv[3], NULL, 10) : 4;
+    if (argc > 4) requests_per_client = strtoul(argv[4], NULL, 10);
+    request_path = use_sendfile ? "/static/file.bin" : "/read";
+
+    /* the file is in the page cache before either mode runs */
+    if (mkdtemp(directory) == NULL)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(file_path, sizeof(file_path), "%s/file.bin", directory);
+    file_fd = open(file_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    char *content = malloc(file_size);
+    memset(content, 'x', file_size);
+    if (file_fd < 0 || write(file_fd, content, file_size) != (ssize_t)file_size)
+    {
+        perror("write");
+        return 1;
+    }
+    free(content);
+
+    pid_t server_pid = fork();
+    if (server_pid == 0)
+    {
+        run_server(use_sendfile);
+        _exit(0);
+    }
+    usleep(200000);
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, NULL);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double seconds = (now_us() - start) / 1e6;
+
+    kill(server_pid, SIGINT);
+    waitpid(server_pid, NULL, 0);
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    double cpu_us = usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec +
+                    usage.ru_stime.tv_sec * 1e6 + usage.ru_stime.tv_usec;
+
+    size_t total = clients * requests_per_client;
+    printf("mode=%s file_kb=%zu clients=%zu requests=%zu failed=%zu req/s=%.0f MB/s=%.1f "
+           "server_cpu_us/req=%.1f user_space_copies_mb=%.1f\n",
+           use_sendfile ? "sendfile" : "read", file_size / 1024, clients, total, atomic_load(&failed_requests),
+           total / seconds, total * file_size / seconds / 1e6, cpu_us / total,
+           use_sendfile ? 0.0 : 2.0 * total * file_size / 1e6);
+
+    free(client_tids);
+    close(file_fd);
+    unlink(file_path);
+    rmdir(directory);
+    return 0;
+}
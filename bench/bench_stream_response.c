@@ -0,0 +1,269 @@
+/*
+ * Measures a large generated response, e.g. a report or a database export,
+ * when the handler streams it with chunked encoding as it is produced or
+ * builds it whole before answering: time to the first byte, throughput and
+ * peak memory. Each mode runs in its own process so the peak resident set
+ * size belongs to that mode alone.
+ *
+ * usage: bench_stream_response [stream|whole] [clients] [report_mb] [reports_per_client]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#define BENCH_PORT 8094
+#define ROW_SIZE 128
+#define ROWS_PER_WRITE 64
+#define CLIENT_BUFFER_SIZE (256 * 1024)
+
+size_t report_size = 64 * 1024 * 1024;
+size_t reports_per_client = 4;
+const char *report_path;
+atomic_size_t failed_reports = 0;
+
+pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+double first_byte_total_us = 0;
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* one fixed-size line of the report, as a database cursor would yield it */
+void format_row(char *row, size_t index)
+{
+    int length = snprintf(row, ROW_SIZE, "%zu,customer-%zu,order-%zu,%zu.%02zu,", index, index % 9973,
+                          index * 7, index % 1000, index % 100);
+    memset(row + length, 'x', ROW_SIZE - length - 1);
+    row[ROW_SIZE - 1] = '\n';
+}
+
+void *stream_handler(http_request *req, http_response *res)
+{
+    http_response_add_header(res, "Content-Type", "text/csv");
+    netc_stream *stream = netc_stream_begin(req);
+    if (stream == NULL) return NULL;
+
+    char batch[ROWS_PER_WRITE * ROW_SIZE];
+    size_t rows = report_size / ROW_SIZE;
+    for (size_t i = 0; i < rows; i += ROWS_PER_WRITE)
+    {
+        size_t count = rows - i < ROWS_PER_WRITE ? rows - i : ROWS_PER_WRITE;
+        for (size_t j = 0; j < count; j++)
+            format_row(batch + j * ROW_SIZE, i + j);
+        if (netc_stream_write(stream, batch, count * ROW_SIZE) == false)
+            break;
+    }
+
+    netc_stream_end(stream);
+    return NULL;
+}
+
+void *whole_handler(http_request *req, http_response *res)
+{
+    (void)req;
+    http_response_add_header(res, "Content-Type", "text/csv");
+
+    size_t rows = report_size / ROW_SIZE;
+    char *body = malloc(rows * ROW_SIZE);
+    if (body == NULL) return NULL;
+    for (size_t i = 0; i < rows; i++)
+        format_row(body + i * ROW_SIZE, i);
+
+    http_response_set_body(res, body, rows * ROW_SIZE);
+    return NULL;
+}
+
+void *server_thread(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
+/* the client side keeps at most one buffer of the report */
+struct reader
+{
+    int    fd;
+    char  *buffer;
+    size_t start;
+    size_t end;
+};
+
+bool fill(struct reader *reader)
+{
+    if (reader->start > 0)
+    {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+
+    ssize_t bytes = recv(reader->fd, reader->buffer + reader->end, CLIENT_BUFFER_SIZE - reader->end - 1, 0);
+    if (bytes <= 0) return false;
+    reader->end += bytes;
+    reader->buffer[reader->end] = '\0';
+    return true;
+}
+
+/* returns the next CRLF-terminated line, NUL-terminated in place */
+char *read_line(struct reader *reader)
+{
+    char *line_end;
+    while ((line_end = memmem(reader->buffer + reader->start, reader->end - reader->start, "\r\n", 2)) == NULL)
+    {
+        if (fill(reader) == false) return NULL;
+    }
+
+    char *line = reader->buffer + reader->start;
+    *line_end = '\0';
+    reader->start = line_end + 2 - reader->buffer;
+    return line;
+}
+
+bool skip(struct reader *reader, size_t length)
+{
+    while (length > 0)
+    {
+        if (reader->start == reader->end && fill(reader) == false)
+            return false;
+
+        size_t available = reader->end - reader->start;
+        size_t taken = available < length ? available : length;
+        reader->start += taken;
+        length -= taken;
+    }
+    return true;
+}
+
+/* reads one response and returns its body length, or -1 on error */
+ssize_t read_report(struct reader *reader, double sent_us)
+{
+    if (reader->start == reader->end && fill(reader) == false)
+        return -1;
+
+    pthread_mutex_lock(&stats_mutex);
+    first_byte_total_us += now_us() - sent_us;
+    pthread_mutex_unlock(&stats_mutex);
+
+    size_t content_length = 0;
+    bool chunked = false;
+    char *line;
+    while ((line = read_line(reader)) != NULL && line[0] != '\0')
+    {
+        if (strncasecmp(line, "Content-Length:", 15) == 0)
+            content_length = strtoul(line + 15, NULL, 10);
+        else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0)
+            chunked = true;
+    }
+    if (line == NULL) return -1;
+
+    if (chunked == false)
+        return skip(reader, content_length) ? (ssize_t)content_length : -1;
+
+    size_t body_length = 0;
+    while ((line = read_line(reader)) != NULL)
+    {
+        size_t size = strtoul(line, NULL, 16);
+        if (size == 0)
+            return read_line(reader) != NULL ? (ssize_t)body_length : -1;
+        if (skip(reader, size + 2) == false)
+            return -1;
+        body_length += size;
+    }
+    return -1;
+}
+
+void *client_thread(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char request[128];
+    int request_length = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", report_path);
+
+    struct reader reader = { .fd = socket(AF_INET, SOCK_STREAM, 0), .buffer = malloc(CLIENT_BUFFER_SIZE) };
+    if (connect(reader.fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(reader.fd);
+        free(reader.buffer);
+        atomic_fetch_add(&failed_reports, reports_per_client);
+        return NULL;
+    }
+
+    size_t expected = report_size / ROW_SIZE * ROW_SIZE;
+    for (size_t i = 0; i < reports_per_client; i++)
+    {
+        double sent = now_us();
+        if (send(reader.fd, request, request_length, 0) < 0 || read_report(&reader, sent) != (ssize_t)expected)
+        {
+            atomic_fetch_add(&failed_reports, reports_per_client - i);
+            break;
+        }
+    }
+
+    close(reader.fd);
+    free(reader.buffer);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    bool stream = argc <= 1 || strcmp(argv[1], "whole") != 0;
+    size_t clients = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    if (argc > 3) report_size = strtoul(argv[3], NULL, 10) * 1024 * 1024;
+    if (argc > 4) reports_per_client = strtoul(argv[4], NULL, 10);
+    report_path = stream ? "/stream" : "/whole";
+
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint(GET, "/stream", stream_handler);
+    netc_add_endpoint(GET, "/whole", whole_handler);
+
+    pthread_t server_tid;
+    pthread_create(&server_tid, NULL, server_thread, NULL);
+    usleep(100000);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long baseline_kb = usage.ru_maxrss;
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, NULL);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double seconds = (now_us() - start) / 1e6;
+
+    getrusage(RUSAGE_SELF, &usage);
+    size_t total = clients * reports_per_client;
+    printf("mode=%s clients=%zu report_mb=%zu reports=%zu failed=%zu first_byte_ms=%.2f MB/s=%.1f peak_rss_growth_mb=%.1f\n",
+           stream ? "stream" : "whole", clients, report_size / (1024 * 1024), total,
+           atomic_load(&failed_reports), first_byte_total_us / total / 1e3,
+           total * report_size / seconds / 1e6, (usage.ru_maxrss - baseline_kb) / 1024.0);
+
+    kill(getpid(), SIGINT);
+    pthread_join(server_tid, NULL);
+    free(client_tids);
+    return 0;
+}
@@ -0,0 +1,199 @@
+/*
+ * Measures upload throughput and peak memory of the server when request
+ * bodies are streamed to the handler piece by piece or buffered whole before
+ * it runs. Each mode runs in its own process so the peak resident set size
+ * belongs to that mode alone.
+ *
+ * usage: bench_upload [stream|buffered] [clients] [upload_mb] [uploads_per_client]
+ */
+#include "netc_server.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#define BENCH_PORT 8093
+#define SEND_CHUNK_SIZE (256 * 1024)
+
+size_t upload_size = 64 * 1024 * 1024;
+size_t uploads_per_client = 4;
+const char *upload_path;
+atomic_size_t failed_uploads = 0;
+
+char *payload;
+
+double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+void answer_received(http_response *res, size_t received)
+{
+    char body[32];
+    snprintf(body, sizeof(body), "%zu", received);
+    http_response_add_body(res, body);
+}
+
+void *stream_handler(http_request *req, http_response *res)
+{
+    size_t *received = req->user_data;
+    if (received == NULL)
+    {
+        received = calloc(1, sizeof(size_t));
+        req->user_data = received;
+        if (received == NULL) return NULL;
+    }
+    *received += req->body_length;
+
+    if (req->body_state == HTTP_BODY_PARTIAL)
+        return NULL;
+
+    if (res != NULL)
+        answer_received(res, *received);
+    free(received);
+    return NULL;
+}
+
+void *buffered_handler(http_request *req, http_response *res)
+{
+    answer_received(res, req->body_length);
+    return NULL;
+}
+
+void *server_thread(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
+bool send_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t bytes = send(fd, data, length, 0);
+        if (bytes <= 0) return false;
+        data += bytes;
+        length -= bytes;
+    }
+    return true;
+}
+
+/* reads one response and checks the server saw every byte of the upload */
+bool read_answer(int fd)
+{
+    char buffer[1024];
+    size_t received = 0;
+    char *head_end = NULL;
+    while (head_end == NULL || head_end[4] == '\0')
+    {
+        ssize_t bytes = recv(fd, buffer + received, sizeof(buffer) - received - 1, 0);
+        if (bytes <= 0) return false;
+        received += bytes;
+        buffer[received] = '\0';
+        head_end = strstr(buffer, "\r\n\r\n");
+    }
+
+    return strncmp(buffer, "HTTP/1.1 200", 12) == 0 && strtoull(head_end + 4, NULL, 10) == upload_size;
+}
+
+void *client_thread(void *arg)
+{
+    (void)arg;
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(BENCH_PORT) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    char head[128];
+    int head_length = snprintf(head, sizeof(head), "POST %s HTTP/1.1\r\nHost: localhost\r\nContent-Length: %zu\r\n\r\n",
+                               upload_path, upload_size);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        perror("client");
+        close(fd);
+        atomic_fetch_add(&failed_uploads, uploads_per_client);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < uploads_per_client; i++)
+    {
+        bool sent = send_all(fd, head, head_length);
+        for (size_t offset = 0; sent && offset < upload_size; offset += SEND_CHUNK_SIZE)
+        {
+            size_t length = upload_size - offset < SEND_CHUNK_SIZE ? upload_size - offset : SEND_CHUNK_SIZE;
+            sent = send_all(fd, payload + offset, length);
+        }
+
+        if (sent == false || read_answer(fd) == false)
+        {
+            atomic_fetch_add(&failed_uploads, uploads_per_client - i);
+            break;
+        }
+    }
+
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    bool stream = argc <= 1 || strcmp(argv[1], "buffered") != 0;
+    size_t clients = argc > 2 ? strtoul(argv[2], NULL, 10) : 4;
+    if (argc > 3) upload_size = strtoul(argv[3], NULL, 10) * 1024 * 1024;
+    if (argc > 4) uploads_per_client = strtoul(argv[4], NULL, 10);
+    upload_path = stream ? "/stream" : "/buffered";
+
+    payload = malloc(upload_size);
+    memset(payload, 'x', upload_size);
+
+    netc_config config = netc_default_config();
+    config.port = BENCH_PORT;
+    config.log_filename = "/dev/null";
+    config.max_keepalive_requests = SIZE_MAX;
+    config.max_body_size = upload_size;
+
+    netc_setup_with_config(&config);
+    netc_add_endpoint_ex(POST, "/stream", stream_handler, NETC_ENDPOINT_STREAM_BODY);
+    netc_add_endpoint(POST, "/buffered", buffered_handler);
+
+    pthread_t server_tid;
+    pthread_create(&server_tid, NULL, server_thread, NULL);
+    usleep(100000);
+
+    /* the payload of the clients is not the server's doing */
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long baseline_kb = usage.ru_maxrss;
+
+    pthread_t *client_tids = calloc(clients, sizeof(pthread_t));
+    double start = now_us();
+    for (size_t i = 0; i < clients; i++)
+        pthread_create(&client_tids[i], NULL, client_thread, NULL);
+    for (size_t i = 0; i < clients; i++)
+        pthread_join(client_tids[i], NULL);
+    double seconds = (now_us() - start) / 1e6;
+
+    getrusage(RUSAGE_SELF, &usage);
+    size_t total = clients * uploads_per_client;
+    printf("mode=%s clients=%zu upload_mb=%zu uploads=%zu failed=%zu MB/s=%.1f peak_rss_growth_mb=%.1f\n",
+           stream ? "stream" : "buffered", clients, upload_size / (1024 * 1024), total,
+           atomic_load(&failed_uploads), total * upload_size / seconds / 1e6,
+           (usage.ru_maxrss - baseline_kb) / 1024.0);
+
+    kill(getpid(), SIGINT);
+    pthread_join(server_tid, NULL);
+    free(client_tids);
+    free(payload);
+    return 0;
+}
@@ -17,12 +17,24 @@ void *user_handler(http_request *req, http_response *res)
     return NULL;
 }
 
+void *user_by_id_handler(http_request *req, http_response *res)
+{
+    size_t length;
+    const char *id = http_request_get_param(req, "id", &length);
+
+    char body[64];
+    snprintf(body, sizeof(body), "{'id': '%.*s'}", (int)length, id);
+    http_response_add_body(res, body);
+    return NULL;
+}
+
 int main(void)
 {
     netc_setup(8080, NULL, 10);
 
     netc_add_endpoint(GET, "/", index_handler);
     netc_add_endpoint(GET, "/users", user_handler);
+    netc_add_endpoint(GET, "/users/:id", user_by_id_handler);
 
     netc_run();
 
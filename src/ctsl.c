@@ -1,4 +1,5 @@
 #include "ctsl.h"
+#include "netc_clock.h"
 
 #include <stdlib.h>
 #include <unistd.h>
@@ -6,32 +7,131 @@
 #include <stdio.h>
 #include <time.h>
 #include <stdarg.h>
+#include <string.h>
 #include <strings.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#define CTSL_BATCH_SIZE 64
+#define CTSL_IDLE_WAIT_MS 100
+#define CTSL_OUTPUT_SIZE (64 * 1024)
+#define CTSL_DROPPED_FORMAT "%llu log lines dropped, ring full"
+
+typedef struct
+{
+    atomic_size_t sequence;
+    size_t        length;
+    char          line[CTSL_ENTRY_SIZE];
+} ctsl_entry;
+
+/* what DEFERRED and BINARY store at the start of a slot, followed by the
+ * captured arguments */
+typedef struct
+{
+    uint64_t    timestamp_ns;
+    const char *fmt;
+    uint8_t     level;
+    uint16_t    args_length;
+} ctsl_record;
+
+/* a bounded multi-producer ring: a slot is free for position p when its
+ * sequence equals p and ready for the flusher when it equals p + 1 */
+struct ctsl_async
+{
+    ctsl_entry               *entries;
+    size_t                    mask;
+    ctsl_overflow_policy      overflow_policy;
+    ctsl_format               format;
+    pthread_t                 flusher;
+    char                     *output;
+    size_t                    output_length;
+    const char              **format_table;
+    size_t                    format_table_capacity;
+    uint32_t                 *format_ids;
+    uint32_t                  format_count;
+    time_t                    last_second;
+    char                      last_timestamp[64];
+    _Alignas(64) atomic_size_t tail;
+    _Alignas(64) size_t        head;
+    uint64_t                  reported_dropped;
+    _Alignas(64) atomic_uint  wake;
+    atomic_bool               sleeping;
+    atomic_bool               stop;
+    atomic_uint_fast64_t      dropped;
+};
 
 const char* get_level_color(const char *level);
+int get_level_index(const char *level);
+void format_timestamp(char *timestamp, size_t size);
+bool start_async(ctsl *logger, const ctsl_config *config);
+void print_async(const ctsl *logger, const char *color, const char *level, const char *fmt, va_list args);
+void record_async(const ctsl *logger, const char *level, const char *fmt, va_list args);
+size_t capture_args(uint8_t *out, size_t capacity, const char *fmt, va_list args);
+ctsl_entry *claim_entry(ctsl_async *async, size_t *position);
+void publish_entry(ctsl_async *async, ctsl_entry *entry, size_t position);
+void wake_flusher(ctsl_async *async);
+void *flusher_thread(void *logger);
+size_t collect_ready(ctsl_async *async, struct iovec *iov);
+void write_batch(int fd, struct iovec *iov, size_t count);
+void render_batch(const ctsl *logger, struct iovec *iov, size_t count);
+void append_output(const ctsl *logger, const void *data, size_t length);
+void flush_output(const ctsl *logger);
+bool lookup_format_id(ctsl_async *async, const char *fmt, uint32_t *id);
+void report_dropped(const ctsl *logger);
+
+ctsl_config ctsl_default_config(void)
+{
+    ctsl_config config = {
+        .async = false,
+        .ring_capacity = CTSL_DEFAULT_RING_CAPACITY,
+        .overflow_policy = CTSL_OVERFLOW_DROP,
+        .format = CTSL_FORMAT_TEXT
+    };
+    return config;
+}
 
 bool ctsl_init(ctsl *logger, const char *filename)
 {
-    if (logger == NULL) return false;
+    ctsl_config config = ctsl_default_config();
+    return ctsl_init_with_config(logger, filename, &config);
+}
+
+bool ctsl_init_with_config(ctsl *logger, const char *filename, const ctsl_config *config)
+{
+    if (logger == NULL || config == NULL) return false;
 
     pthread_mutex_init(&logger->shared_resource_mutex, NULL);
+    logger->async = NULL;
 
     if (filename == NULL)
     {
         logger->fd = STDOUT_FILENO;
         logger->is_terminal = true;
-        return true;
+    }
+    else
+    {
+        int file_fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (file_fd < 0)
+        {
+            perror("Error opening log file");
+            return false;
+        }
+
+        logger->fd = file_fd;
+        logger->is_terminal = isatty(logger->fd);
     }
 
-    int file_fd = open(filename, O_WRONLY | O_CREAT | O_APPEND, 0644);
-    if (file_fd < 0)
+    if ((config->async || config->format != CTSL_FORMAT_TEXT) && start_async(logger, config) == false)
     {
-        perror("Error opening log file");
+        perror("Error starting log flusher");
+        ctsl_destroy(logger);
         return false;
     }
 
-    logger->fd = file_fd;
-    logger->is_terminal = isatty(logger->fd);
     return true;
 }
 
@@ -41,18 +141,30 @@ void ctsl_print(const ctsl *logger, const char *level, const char *fmt, ...)
     if (logger == NULL || level == NULL || fmt == NULL || color == NULL)
         return;
 
-    /* get current time */
-    time_t now = time(NULL);
-    struct tm t;
-    localtime_r(&now, &t);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &t);
-
     va_list args, args_copy;
     va_start(args, fmt);
+    if (logger->async != NULL)
+    {
+        if (logger->async->format == CTSL_FORMAT_TEXT)
+            print_async(logger, color, level, fmt, args);
+        else
+            record_async(logger, level, fmt, args);
+        va_end(args);
+        return;
+    }
+
+    char timestamp[64];
+    format_timestamp(timestamp, sizeof(timestamp));
     va_copy(args_copy, args);
 
-    int msg_len = vsnprintf(NULL, 0, fmt, args);
+    /* most lines fit on the stack, only longer ones are formatted on the heap */
+    char line[CTSL_ENTRY_SIZE];
+    int prefix_len = logger->is_terminal
+        ? snprintf(line, sizeof(line), "%s - %s%s%s - ", timestamp, color, level, COLOR_RESET)
+        : snprintf(line, sizeof(line), "%s - %s - ", timestamp, level);
+    size_t room = prefix_len > 0 && (size_t)prefix_len < sizeof(line) ? sizeof(line) - 1 - prefix_len : 0;
+
+    int msg_len = vsnprintf(room > 0 ? line + prefix_len : NULL, room, fmt, args);
     va_end(args);
     if (msg_len <= 0)
     {
@@ -60,6 +172,19 @@ void ctsl_print(const ctsl *logger, const char *level, const char *fmt, ...)
         return;
     }
 
+    if ((size_t)msg_len < room)
+    {
+        va_end(args_copy);
+        size_t length = prefix_len + msg_len;
+        line[length++] = '\n';
+
+        pthread_mutex_lock((pthread_mutex_t*)&logger->shared_resource_mutex);
+        if (write(logger->fd, line, length) < 0)
+            perror("Error writing log");
+        pthread_mutex_unlock((pthread_mutex_t*)&logger->shared_resource_mutex);
+        return;
+    }
+
     char *msg_buf = malloc(msg_len + 1);
     if (msg_buf == NULL)
     {
@@ -88,8 +213,30 @@ void ctsl_print(const ctsl *logger, const char *level, const char *fmt, ...)
     free(log_line);
 }
 
+uint64_t ctsl_dropped(const ctsl *logger)
+{
+    if (logger == NULL || logger->async == NULL)
+        return 0;
+
+    return atomic_load(&logger->async->dropped);
+}
+
 void ctsl_destroy(ctsl *logger)
 {
+    ctsl_async *async = logger->async;
+    if (async != NULL)
+    {
+        atomic_store(&async->stop, true);
+        wake_flusher(async);
+        pthread_join(async->flusher, NULL);
+        free(async->entries);
+        free(async->output);
+        free(async->format_table);
+        free(async->format_ids);
+        free(async);
+        logger->async = NULL;
+    }
+
     if (logger->fd != STDOUT_FILENO && logger->fd != STDERR_FILENO)
         close(logger->fd);
 
@@ -107,3 +254,654 @@ const char* get_level_color(const char *level)
     else
         return NULL;
 }
+
+int get_level_index(const char *level)
+{
+    if (strcasecmp(level, "ERROR") == 0)
+        return 2;
+    else if (strcasecmp(level, "WARNING") == 0)
+        return 1;
+    return 0;
+}
+
+const char *ctsl_level_name(uint8_t level)
+{
+    const char *names[] = { CTSL_INFO, CTSL_WARNING, CTSL_ERROR };
+    return level < sizeof(names) / sizeof(names[0]) ? names[level] : NULL;
+}
+
+void format_timestamp(char *timestamp, size_t size)
+{
+    /* formatted once per second by the shared clock, only copied here */
+    const netc_clock_snapshot *now = netc_clock_now();
+    size_t length = size < sizeof(now->log_timestamp) ? size : sizeof(now->log_timestamp);
+    memcpy(timestamp, now->log_timestamp, length);
+    timestamp[length - 1] = '\0';
+}
+
+bool start_async(ctsl *logger, const ctsl_config *config)
+{
+    size_t capacity = 2;
+    while (capacity < config->ring_capacity)
+        capacity *= 2;
+
+    ctsl_async *async = calloc(1, sizeof(ctsl_async));
+    if (async == NULL)
+        return false;
+
+    async->entries = malloc(capacity * sizeof(ctsl_entry));
+    if (async->entries == NULL)
+    {
+        free(async);
+        return false;
+    }
+
+    for (size_t i = 0; i < capacity; i++)
+        atomic_init(&async->entries[i].sequence, i);
+    async->mask = capacity - 1;
+    async->overflow_policy = config->overflow_policy;
+    async->format = config->format;
+
+    if (async->format != CTSL_FORMAT_TEXT)
+    {
+        async->output = malloc(CTSL_OUTPUT_SIZE);
+        if (async->output == NULL)
+        {
+            free(async->entries);
+            free(async);
+            return false;
+        }
+    }
+
+    /* a binary log is only recognized by its magic */
+    if (async->format == CTSL_FORMAT_BINARY && lseek(logger->fd, 0, SEEK_END) <= 0 &&
+        write(logger->fd, CTSL_BINARY_MAGIC, strlen(CTSL_BINARY_MAGIC)) < 0)
+        perror("Error writing log");
+
+    logger->async = async;
+    int err = pthread_create(&async->flusher, NULL, flusher_thread, logger);
+    if (err != 0)
+    {
+        logger->async = NULL;
+        free(async->entries);
+        free(async->output);
+        free(async);
+        errno = err;
+        return false;
+    }
+
+    return true;
+}
+
+void print_async(const ctsl *logger, const char *color, const char *level, const char *fmt, va_list args)
+{
+    size_t position;
+    ctsl_entry *entry = claim_entry(logger->async, &position);
+    if (entry == NULL)
+        return;
+
+    /* the line is formatted straight into the slot, leaving room for '\n' */
+    char timestamp[64];
+    format_timestamp(timestamp, sizeof(timestamp));
+    int prefix_len = logger->is_terminal
+        ? snprintf(entry->line, CTSL_ENTRY_SIZE, "%s - %s%s%s - ", timestamp, color, level, COLOR_RESET)
+        : snprintf(entry->line, CTSL_ENTRY_SIZE, "%s - %s - ", timestamp, level);
+
+    size_t length = prefix_len > 0 && prefix_len < CTSL_ENTRY_SIZE - 1 ? (size_t)prefix_len : 0;
+    int msg_len = vsnprintf(entry->line + length, CTSL_ENTRY_SIZE - 1 - length, fmt, args);
+    if (msg_len > 0)
+        length += (size_t)msg_len < CTSL_ENTRY_SIZE - 1 - length ? (size_t)msg_len : CTSL_ENTRY_SIZE - 2 - length;
+    entry->line[length++] = '\n';
+    entry->length = length;
+    publish_entry(logger->async, entry, position);
+}
+
+void record_async(const ctsl *logger, const char *level, const char *fmt, va_list args)
+{
+    size_t position;
+    ctsl_entry *entry = claim_entry(logger->async, &position);
+    if (entry == NULL)
+        return;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    ctsl_record record = {
+        .timestamp_ns = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec,
+        .fmt = fmt,
+        .level = get_level_index(level)
+    };
+    record.args_length = capture_args((uint8_t*)entry->line + sizeof(ctsl_record),
+                                      CTSL_ENTRY_SIZE - sizeof(ctsl_record), fmt, args);
+    memcpy(entry->line, &record, sizeof(ctsl_record));
+    entry->length = sizeof(ctsl_record) + record.args_length;
+    publish_entry(logger->async, entry, position);
+}
+
+size_t capture_args(uint8_t *out, size_t capacity, const char *fmt, va_list args)
+{
+    size_t length = 0;
+    for (const char *c = fmt; *c != '\0'; c++)
+    {
+        if (*c != '%')
+            continue;
+        if (*++c == '%')
+            continue;
+
+        /* flags, then a width and a precision that may come from arguments */
+        while (*c != '\0' && strchr("-+ #0'", *c) != NULL) c++;
+        int64_t precision = -1;
+        for (int field = 0; field < 2; field++)
+        {
+            if (field == 1 && *c++ != '.')
+            {
+                c--;
+                break;
+            }
+            int64_t value = 0;
+            if (*c == '*')
+            {
+                if (capacity - length < sizeof(int64_t)) return length;
+                value = va_arg(args, int);
+                memcpy(out + length, &value, sizeof(value));
+                length += sizeof(value);
+                c++;
+            }
+            while (*c >= '0' && *c <= '9')
+                value = value * 10 + (*c++ - '0');
+            if (field == 1)
+                precision = value;
+        }
+
+        bool is_long = false, is_long_long = false, is_long_double = false;
+        while (*c != '\0' && strchr("hljztL", *c) != NULL)
+        {
+            is_long_long |= is_long || *c == 'j' || *c == 'z' || *c == 't';
+            is_long |= *c == 'l';
+            is_long_double |= *c == 'L';
+            c++;
+        }
+
+        if (*c == 's')
+        {
+            const char *string = va_arg(args, const char*);
+            if (string == NULL) string = "(null)";
+            if (capacity - length < sizeof(uint16_t)) return length;
+
+            /* a precision may bound a string that is not NUL-terminated */
+            size_t limit = capacity - length - sizeof(uint16_t);
+            if (precision >= 0 && (uint64_t)precision < limit)
+                limit = precision;
+            uint16_t string_length = strnlen(string, limit);
+            memcpy(out + length, &string_length, sizeof(string_length));
+            memcpy(out + length + sizeof(string_length), string, string_length);
+            length += sizeof(string_length) + string_length;
+            continue;
+        }
+
+        if (*c == 'n')
+        {
+            (void)va_arg(args, void*);
+            continue;
+        }
+
+        if (strchr("eEfFgGaA", *c) != NULL && *c != '\0')
+        {
+            if (is_long_double)
+            {
+                if (capacity - length < sizeof(long double)) return length;
+                long double value = va_arg(args, long double);
+                memcpy(out + length, &value, sizeof(value));
+                length += sizeof(value);
+            }
+            else
+            {
+                if (capacity - length < sizeof(double)) return length;
+                double value = va_arg(args, double);
+                memcpy(out + length, &value, sizeof(value));
+                length += sizeof(value);
+            }
+            continue;
+        }
+
+        if (*c == '\0' || strchr("diouxXcp", *c) == NULL || capacity - length < sizeof(int64_t))
+            return length;
+
+        int64_t value;
+        if (*c == 'p')
+            value = (int64_t)(uintptr_t)va_arg(args, void*);
+        else if (is_long_long)
+            value = va_arg(args, long long);
+        else if (is_long)
+            value = va_arg(args, long);
+        else
+            value = va_arg(args, int);
+        memcpy(out + length, &value, sizeof(value));
+        length += sizeof(value);
+    }
+
+    return length;
+}
+
+size_t ctsl_format_record(char *buffer, size_t capacity, const char *fmt, const uint8_t *args, size_t args_length)
+{
+    if (buffer == NULL || capacity == 0 || fmt == NULL)
+        return 0;
+
+    size_t length = 0, offset = 0;
+    buffer[0] = '\0';
+    for (const char *c = fmt; *c != '\0' && length < capacity - 1; c++)
+    {
+        if (*c != '%')
+        {
+            buffer[length++] = *c;
+            continue;
+        }
+        if (c[1] == '%')
+        {
+            buffer[length++] = '%';
+            c++;
+            continue;
+        }
+
+        /* rebuild the conversion with '*' replaced by the captured values */
+        char spec[64];
+        size_t spec_length = 0;
+        bool complete = true;
+        spec[spec_length++] = *c++;
+        while (*c != '\0' && strchr("-+ #'.0123456789*hljztL", *c) != NULL && spec_length < sizeof(spec) - 24)
+        {
+            if (*c == '*')
+            {
+                int64_t value;
+                if (args_length - offset < sizeof(value))
+                {
+                    complete = false;
+                    break;
+                }
+                memcpy(&value, args + offset, sizeof(value));
+                offset += sizeof(value);
+                spec_length += snprintf(spec + spec_length, sizeof(spec) - spec_length, "%d", (int)value);
+            }
+            else
+            {
+                spec[spec_length++] = *c;
+            }
+            c++;
+        }
+        if (complete == false || *c == '\0')
+            break;
+        spec[spec_length++] = *c;
+        spec[spec_length] = '\0';
+
+        bool is_long = strchr(spec, 'l') != NULL || strchr(spec, 'j') != NULL ||
+                       strchr(spec, 'z') != NULL || strchr(spec, 't') != NULL;
+        int written = 0;
+        if (*c == 'n')
+        {
+            continue;
+        }
+        else if (*c == 's')
+        {
+            uint16_t string_length;
+            if (args_length - offset < sizeof(string_length)) break;
+            memcpy(&string_length, args + offset, sizeof(string_length));
+            offset += sizeof(string_length);
+            if (args_length - offset < string_length) break;
+
+            char string[CTSL_ENTRY_SIZE];
+            memcpy(string, args + offset, string_length);
+            string[string_length] = '\0';
+            offset += string_length;
+            written = snprintf(buffer + length, capacity - length, spec, string);
+        }
+        else if (strchr("eEfFgGaA", *c) != NULL)
+        {
+            if (strchr(spec, 'L') != NULL)
+            {
+                long double value;
+                if (args_length - offset < sizeof(value)) break;
+                memcpy(&value, args + offset, sizeof(value));
+                offset += sizeof(value);
+                written = snprintf(buffer + length, capacity - length, spec, value);
+            }
+            else
+            {
+                double value;
+                if (args_length - offset < sizeof(value)) break;
+                memcpy(&value, args + offset, sizeof(value));
+                offset += sizeof(value);
+                written = snprintf(buffer + length, capacity - length, spec, value);
+            }
+        }
+        else if (strchr("diouxXcp", *c) != NULL)
+        {
+            int64_t value;
+            if (args_length - offset < sizeof(value)) break;
+            memcpy(&value, args + offset, sizeof(value));
+            offset += sizeof(value);
+            if (*c == 'p')
+                written = snprintf(buffer + length, capacity - length, spec, (void*)(uintptr_t)value);
+            else if (is_long)
+                written = snprintf(buffer + length, capacity - length, spec, (long long)value);
+            else
+                written = snprintf(buffer + length, capacity - length, spec, (int)value);
+        }
+        else
+        {
+            break;
+        }
+
+        if (written > 0)
+            length += (size_t)written < capacity - length ? (size_t)written : capacity - 1 - length;
+    }
+
+    buffer[length] = '\0';
+    return length;
+}
+
+void publish_entry(ctsl_async *async, ctsl_entry *entry, size_t position)
+{
+    atomic_store_explicit(&entry->sequence, position + 1, memory_order_release);
+
+    /* pairs with the fence in flusher_thread, so either the flusher sees the
+     * entry before sleeping or this thread sees it asleep */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&async->sleeping, memory_order_relaxed))
+        wake_flusher(async);
+}
+
+ctsl_entry *claim_entry(ctsl_async *async, size_t *position)
+{
+    size_t tail = atomic_load_explicit(&async->tail, memory_order_relaxed);
+    for (;;)
+    {
+        ctsl_entry *entry = &async->entries[tail & async->mask];
+        size_t sequence = atomic_load_explicit(&entry->sequence, memory_order_acquire);
+        intptr_t distance = (intptr_t)sequence - (intptr_t)tail;
+
+        if (distance == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&async->tail, &tail, tail + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                *position = tail;
+                return entry;
+            }
+        }
+        else if (distance < 0)
+        {
+            /* the slot still holds a line from the previous lap: full */
+            if (async->overflow_policy == CTSL_OVERFLOW_DROP)
+            {
+                atomic_fetch_add_explicit(&async->dropped, 1, memory_order_relaxed);
+                return NULL;
+            }
+
+            wake_flusher(async);
+            sched_yield();
+            tail = atomic_load_explicit(&async->tail, memory_order_relaxed);
+        }
+        else
+        {
+            tail = atomic_load_explicit(&async->tail, memory_order_relaxed);
+        }
+    }
+}
+
+void wake_flusher(ctsl_async *async)
+{
+    atomic_fetch_add(&async->wake, 1);
+    syscall(SYS_futex, &async->wake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void *flusher_thread(void *logger)
+{
+    ctsl *log = logger;
+    ctsl_async *async = log->async;
+    struct iovec iov[CTSL_BATCH_SIZE];
+
+    for (;;)
+    {
+        size_t count = collect_ready(async, iov);
+        if (count > 0)
+        {
+            if (async->format == CTSL_FORMAT_TEXT)
+                write_batch(log->fd, iov, count);
+            else
+                render_batch(log, iov, count);
+
+            /* hand the slots back to the producers of the next lap */
+            for (size_t i = 0; i < count; i++)
+                atomic_store_explicit(&async->entries[(async->head + i) & async->mask].sequence,
+                                      async->head + i + async->mask + 1, memory_order_release);
+            async->head += count;
+            report_dropped(log);
+            continue;
+        }
+
+        if (atomic_load(&async->stop))
+            break;
+
+        unsigned wake = atomic_load(&async->wake);
+        atomic_store(&async->sleeping, true);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (collect_ready(async, iov) == 0 && atomic_load(&async->stop) == false)
+        {
+            struct timespec timeout = { .tv_sec = 0, .tv_nsec = CTSL_IDLE_WAIT_MS * 1000000L };
+            syscall(SYS_futex, &async->wake, FUTEX_WAIT_PRIVATE, wake, &timeout, NULL, 0);
+        }
+        atomic_store(&async->sleeping, false);
+    }
+
+    report_dropped(log);
+    return NULL;
+}
+
+size_t collect_ready(ctsl_async *async, struct iovec *iov)
+{
+    size_t count = 0;
+    while (count < CTSL_BATCH_SIZE)
+    {
+        ctsl_entry *entry = &async->entries[(async->head + count) & async->mask];
+        if (atomic_load_explicit(&entry->sequence, memory_order_acquire) != async->head + count + 1)
+            break;
+
+        iov[count].iov_base = entry->line;
+        iov[count].iov_len = entry->length;
+        count++;
+    }
+
+    return count;
+}
+
+void write_batch(int fd, struct iovec *iov, size_t count)
+{
+    while (count > 0)
+    {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("Error writing log");
+            return;
+        }
+
+        /* skip what went out and resume inside the first partial entry */
+        while (count > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+void report_dropped(const ctsl *logger)
+{
+    ctsl_async *async = logger->async;
+    uint64_t dropped = atomic_load_explicit(&async->dropped, memory_order_relaxed);
+    if (dropped == async->reported_dropped)
+        return;
+
+    int64_t count = dropped - async->reported_dropped;
+    async->reported_dropped = dropped;
+
+    /* the notice goes through the flusher's own path as a record, a text
+     * line in a binary log would break the stream for the decoder */
+    if (async->format != CTSL_FORMAT_TEXT)
+    {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+
+        uint8_t entry[sizeof(ctsl_record) + sizeof(count)];
+        ctsl_record record = {
+            .timestamp_ns = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec,
+            .fmt = CTSL_DROPPED_FORMAT,
+            .level = get_level_index(CTSL_WARNING),
+            .args_length = sizeof(count)
+        };
+        memcpy(entry, &record, sizeof(ctsl_record));
+        memcpy(entry + sizeof(ctsl_record), &count, sizeof(count));
+        render_batch(logger, &(struct iovec){ .iov_base = entry, .iov_len = sizeof(entry) }, 1);
+        return;
+    }
+
+    char timestamp[64];
+    format_timestamp(timestamp, sizeof(timestamp));
+
+    char line[128];
+    int length = snprintf(line, sizeof(line), "%s - %s - " CTSL_DROPPED_FORMAT "\n",
+                          timestamp, CTSL_WARNING, (unsigned long long)count);
+    if (length > 0 && write(logger->fd, line, length) < 0)
+        perror("Error writing log");
+}
+
+void render_batch(const ctsl *logger, struct iovec *iov, size_t count)
+{
+    ctsl_async *async = logger->async;
+    for (size_t i = 0; i < count; i++)
+    {
+        ctsl_record record;
+        memcpy(&record, iov[i].iov_base, sizeof(ctsl_record));
+        const uint8_t *args = (const uint8_t*)iov[i].iov_base + sizeof(ctsl_record);
+
+        if (async->format == CTSL_FORMAT_BINARY)
+        {
+            uint32_t id;
+            if (lookup_format_id(async, record.fmt, &id) == false)
+            {
+                uint16_t fmt_length = strnlen(record.fmt, UINT16_MAX);
+                append_output(logger, &(char){ CTSL_BINARY_FORMAT }, 1);
+                append_output(logger, &id, sizeof(id));
+                append_output(logger, &fmt_length, sizeof(fmt_length));
+                append_output(logger, record.fmt, fmt_length);
+            }
+            append_output(logger, &(char){ CTSL_BINARY_RECORD }, 1);
+            append_output(logger, &id, sizeof(id));
+            append_output(logger, &record.level, sizeof(record.level));
+            append_output(logger, &record.timestamp_ns, sizeof(record.timestamp_ns));
+            append_output(logger, &record.args_length, sizeof(record.args_length));
+            append_output(logger, args, record.args_length);
+            continue;
+        }
+
+        /* consecutive lines mostly share the second, so its text is reused */
+        time_t second = record.timestamp_ns / 1000000000ull;
+        if (second != async->last_second || async->last_timestamp[0] == '\0')
+        {
+            struct tm t;
+            localtime_r(&second, &t);
+            strftime(async->last_timestamp, sizeof(async->last_timestamp), "%Y-%m-%d %H:%M:%S", &t);
+            async->last_second = second;
+        }
+
+        char line[CTSL_ENTRY_SIZE * 2];
+        const char *level = ctsl_level_name(record.level);
+        int prefix_len = logger->is_terminal
+            ? snprintf(line, sizeof(line), "%s - %s%s%s - ", async->last_timestamp, get_level_color(level), level, COLOR_RESET)
+            : snprintf(line, sizeof(line), "%s - %s - ", async->last_timestamp, level);
+        size_t length = prefix_len;
+        length += ctsl_format_record(line + length, sizeof(line) - length - 1, record.fmt, args, record.args_length);
+        line[length++] = '\n';
+        append_output(logger, line, length);
+    }
+
+    flush_output(logger);
+}
+
+void append_output(const ctsl *logger, const void *data, size_t length)
+{
+    ctsl_async *async = logger->async;
+    if (async->output_length + length > CTSL_OUTPUT_SIZE)
+        flush_output(logger);
+
+    memcpy(async->output + async->output_length, data, length);
+    async->output_length += length;
+}
+
+void flush_output(const ctsl *logger)
+{
+    ctsl_async *async = logger->async;
+    struct iovec iov = { .iov_base = async->output, .iov_len = async->output_length };
+    if (iov.iov_len > 0)
+        write_batch(logger->fd, &iov, 1);
+    async->output_length = 0;
+}
+
+bool lookup_format_id(ctsl_async *async, const char *fmt, uint32_t *id)
+{
+    /* open addressing on the format pointer, kept at most half full */
+    if (async->format_count * 2 >= async->format_table_capacity)
+    {
+        size_t capacity = async->format_table_capacity ? async->format_table_capacity * 2 : 64;
+        const char **table = calloc(capacity, sizeof(const char*));
+        uint32_t *ids = calloc(capacity, sizeof(uint32_t));
+        if (table == NULL || ids == NULL)
+        {
+            free(table);
+            free(ids);
+            *id = async->format_count++;
+            return false;
+        }
+
+        for (size_t i = 0; i < async->format_table_capacity; i++)
+        {
+            if (async->format_table[i] == NULL)
+                continue;
+            size_t slot = ((uintptr_t)async->format_table[i] >> 3) & (capacity - 1);
+            while (table[slot] != NULL)
+                slot = (slot + 1) & (capacity - 1);
+            table[slot] = async->format_table[i];
+            ids[slot] = async->format_ids[i];
+        }
+
+        free(async->format_table);
+        free(async->format_ids);
+        async->format_table = table;
+        async->format_ids = ids;
+        async->format_table_capacity = capacity;
+    }
+
+    size_t slot = ((uintptr_t)fmt >> 3) & (async->format_table_capacity - 1);
+    while (async->format_table[slot] != NULL)
+    {
+        if (async->format_table[slot] == fmt)
+        {
+            *id = async->format_ids[slot];
+            return true;
+        }
+        slot = (slot + 1) & (async->format_table_capacity - 1);
+    }
+
+    async->format_table[slot] = fmt;
+    async->format_ids[slot] = async->format_count;
+    *id = async->format_count++;
+    return false;
+}
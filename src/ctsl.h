@@ -2,6 +2,8 @@
 #define CTSL_H
 
 #include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #define CTSL_INFO    "INFO"
 #define CTSL_WARNING "WARNING"
@@ -12,15 +14,136 @@
 #define COLOR_INFO    "\033[0m"
 #define COLOR_RESET   "\033[0m"
 
+/* longest line kept by the asynchronous mode, longer ones are truncated */
+#define CTSL_ENTRY_SIZE 512
+#define CTSL_DEFAULT_RING_CAPACITY 4096
+
+typedef enum
+{
+    CTSL_OVERFLOW_DROP,
+    CTSL_OVERFLOW_BLOCK
+} ctsl_overflow_policy;
+
+/* TEXT formats each line on the calling thread. DEFERRED and BINARY only
+ * copy the format pointer, a timestamp and the raw arguments into the ring:
+ * DEFERRED leaves the formatting to the flusher thread, BINARY writes the
+ * records as they are, to be turned into text by tools/ctsl_decode. Both
+ * imply async */
+typedef enum
+{
+    CTSL_FORMAT_TEXT,
+    CTSL_FORMAT_DEFERRED,
+    CTSL_FORMAT_BINARY
+} ctsl_format;
+
+/* binary log layout, integers in native byte order: the magic once at the
+ * start of the file, then
+ *   'F' u32 id, u16 length, format string       defines format id
+ *   'R' u32 id, u8 level, u64 unix time in ns,
+ *       u16 length, arguments                   one log line
+ * A format is always defined before its first use, and a process restarts
+ * its ids from 0 when it appends to an existing log, redefining them.
+ * Arguments follow the conversions of the format: integers, characters and
+ * pointers as 8 bytes, doubles as 8, long doubles as sizeof(long double),
+ * strings as u16 length and bytes, '*' widths as 8 byte integers */
+#define CTSL_BINARY_MAGIC     "CTSLBIN1"
+#define CTSL_BINARY_FORMAT    'F'
+#define CTSL_BINARY_RECORD    'R'
+
+typedef struct
+{
+    bool                 async;
+    size_t               ring_capacity;
+    ctsl_overflow_policy overflow_policy;
+    ctsl_format          format;
+} ctsl_config;
+
+typedef struct ctsl_async ctsl_async;
+
 typedef struct
 {
     int             fd;
     bool            is_terminal;
     pthread_mutex_t shared_resource_mutex;
+    ctsl_async     *async;
 } ctsl;
 
+/**
+ * @brief returns the configuration used by ctsl_init: every line is
+ * written by the calling thread
+ *
+ * @return ctsl_config the default configuration
+ */
+ctsl_config ctsl_default_config(void);
+
 bool ctsl_init(ctsl *logger, const char *filename);
+
+/**
+ * @brief initializes a logger. In async mode ctsl_print formats the line
+ * into a slot of a lock-free ring shared by all threads and returns, and a
+ * flusher thread writes the ready slots in batches with writev. When the
+ * ring is full the line is dropped and counted, or the caller waits for a
+ * free slot, depending on overflow_policy
+ *
+ * @param logger pointer to the logger to initialize
+ * @param filename file to append to, NULL for stdout
+ * @param config pointer to the configuration, ring_capacity is rounded up
+ * to a power of two
+ * @return true on success
+ * @return false if the file, the ring or the flusher thread could not be
+ * created
+ */
+bool ctsl_init_with_config(ctsl *logger, const char *filename, const ctsl_config *config);
+
+/**
+ * @brief logs a printf-style line. With the DEFERRED and BINARY formats only
+ * fmt's address is recorded, so it must be a string literal or otherwise
+ * outlive the logger; %s arguments are copied, and the conversions %ls,
+ * %lc and %m are not supported
+ *
+ * @param logger pointer to the logger
+ * @param level CTSL_INFO, CTSL_WARNING or CTSL_ERROR
+ * @param fmt printf format
+ */
 void ctsl_print(const ctsl *logger, const char *level, const char *fmt, ...);
+
+/**
+ * @brief returns how many lines the asynchronous mode dropped because the
+ * ring was full
+ *
+ * @param logger pointer to the logger
+ * @return uint64_t number of dropped lines, always 0 in synchronous mode
+ */
+uint64_t ctsl_dropped(const ctsl *logger);
+
+/**
+ * @brief formats the arguments captured by DEFERRED or BINARY logging the
+ * way printf would have formatted them
+ *
+ * @param buffer where to write the NUL-terminated message
+ * @param capacity size of buffer
+ * @param fmt the format the arguments were captured with
+ * @param args captured arguments
+ * @param args_length size of args
+ * @return size_t length of the message, truncated to capacity - 1
+ */
+size_t ctsl_format_record(char *buffer, size_t capacity, const char *fmt, const uint8_t *args, size_t args_length);
+
+/**
+ * @brief returns the name of a level as stored in binary records
+ *
+ * @param level level index, 0 for CTSL_INFO, 1 for CTSL_WARNING and 2 for
+ * CTSL_ERROR
+ * @return const char* level name, NULL if unknown
+ */
+const char *ctsl_level_name(uint8_t level);
+
+/**
+ * @brief closes a logger. In async mode the lines still in the ring are
+ * written before the flusher thread exits
+ *
+ * @param logger pointer to the logger to close
+ */
 void ctsl_destroy(ctsl *);
 
 #endif // CTSL_H
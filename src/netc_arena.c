@@ -0,0 +1,124 @@
+#include "netc_arena.h"
+
+#include <stdlib.h>
+#include <stdalign.h>
+#include <stdint.h>
+
+#define ALIGNMENT alignof(max_align_t)
+
+struct netc_arena_block
+{
+    netc_arena_block *next;
+    size_t            capacity;
+    alignas(max_align_t) unsigned char data[];
+};
+
+netc_arena_block *create_block(netc_arena *arena, size_t capacity);
+void free_blocks(netc_arena_block *block);
+
+void netc_arena_init(netc_arena *arena, size_t block_size)
+{
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->oversized = NULL;
+    arena->offset = 0;
+    arena->block_size = block_size > 0 ? block_size : NETC_ARENA_DEFAULT_BLOCK_SIZE;
+    arena->malloc_calls = 0;
+}
+
+void *netc_arena_alloc(netc_arena *arena, size_t size)
+{
+    if (arena == NULL || size > SIZE_MAX - ALIGNMENT)
+        return NULL;
+
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (arena->current != NULL && size <= arena->current->capacity - arena->offset)
+    {
+        void *memory = arena->current->data + arena->offset;
+        arena->offset += size;
+        return memory;
+    }
+
+    /* oversized blocks would pin their memory to the arena, they only live
+     * until the next reset */
+    if (size > arena->block_size)
+    {
+        netc_arena_block *block = create_block(arena, size);
+        if (block == NULL) return NULL;
+
+        block->next = arena->oversized;
+        arena->oversized = block;
+        return block->data;
+    }
+
+    netc_arena_block *next = arena->current != NULL ? arena->current->next : arena->first;
+    if (next == NULL)
+    {
+        next = create_block(arena, arena->block_size);
+        if (next == NULL) return NULL;
+
+        if (arena->current != NULL)
+            arena->current->next = next;
+        else
+            arena->first = next;
+    }
+
+    arena->current = next;
+    arena->offset = size;
+    return next->data;
+}
+
+void netc_arena_reset(netc_arena *arena)
+{
+    if (arena == NULL) return;
+
+    free_blocks(arena->oversized);
+    arena->oversized = NULL;
+    arena->current = arena->first;
+    arena->offset = 0;
+}
+
+void netc_arena_trim(netc_arena *arena)
+{
+    if (arena == NULL) return;
+
+    netc_arena_reset(arena);
+    if (arena->first != NULL)
+    {
+        free_blocks(arena->first->next);
+        arena->first->next = NULL;
+    }
+}
+
+void netc_arena_destroy(netc_arena *arena)
+{
+    if (arena == NULL) return;
+
+    free_blocks(arena->oversized);
+    free_blocks(arena->first);
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->oversized = NULL;
+    arena->offset = 0;
+}
+
+netc_arena_block *create_block(netc_arena *arena, size_t capacity)
+{
+    netc_arena_block *block = malloc(sizeof(netc_arena_block) + capacity);
+    if (block == NULL) return NULL;
+
+    block->next = NULL;
+    block->capacity = capacity;
+    arena->malloc_calls++;
+    return block;
+}
+
+void free_blocks(netc_arena_block *block)
+{
+    while (block != NULL)
+    {
+        netc_arena_block *next = block->next;
+        free(block);
+        block = next;
+    }
+}
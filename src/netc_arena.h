@@ -0,0 +1,67 @@
+#ifndef NETC_ARENA_H
+#define NETC_ARENA_H
+
+#include <stddef.h>
+
+#define NETC_ARENA_DEFAULT_BLOCK_SIZE ((size_t)8192)
+
+typedef struct netc_arena_block netc_arena_block;
+
+/* a bump-pointer allocator for memory that dies all at once, e.g. everything
+ * built while answering one request. Blocks are kept across resets, so once
+ * the arena has grown to fit a request it stops calling malloc */
+typedef struct
+{
+    netc_arena_block *first;
+    netc_arena_block *current;
+    netc_arena_block *oversized;
+    size_t            offset;
+    size_t            block_size;
+    size_t            malloc_calls;
+} netc_arena;
+
+/**
+ * @brief initializes an empty arena, no memory is taken until the first
+ * allocation
+ *
+ * @param arena pointer to the arena to initialize
+ * @param block_size size of the blocks the arena carves allocations from,
+ * 0 for NETC_ARENA_DEFAULT_BLOCK_SIZE
+ */
+void netc_arena_init(netc_arena *arena, size_t block_size);
+
+/**
+ * @brief allocates size bytes aligned for any type. The memory cannot be
+ * freed on its own, it is reclaimed by netc_arena_reset. Requests larger
+ * than a block get a block of their own, released by the next reset
+ *
+ * @param arena pointer to the arena to allocate from
+ * @param size number of bytes to allocate
+ * @return void* pointer to the memory, NULL on allocation failure
+ */
+void *netc_arena_alloc(netc_arena *arena, size_t size);
+
+/**
+ * @brief releases every allocation at once. The regular blocks are kept
+ * for reuse, only oversized allocations are returned to the heap
+ *
+ * @param arena pointer to the arena to reset
+ */
+void netc_arena_reset(netc_arena *arena);
+
+/**
+ * @brief resets the arena and frees every block but the first, giving back
+ * what a large request made the arena grow to
+ *
+ * @param arena pointer to the arena to trim
+ */
+void netc_arena_trim(netc_arena *arena);
+
+/**
+ * @brief frees every block of an arena
+ *
+ * @param arena pointer to the arena to destroy
+ */
+void netc_arena_destroy(netc_arena *arena);
+
+#endif // NETC_ARENA_H
@@ -0,0 +1,126 @@
+#include "netc_clock.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/* readers get the slot at current while the next one is written, so a
+ * snapshot is only overwritten NETC_CLOCK_SLOTS - 1 seconds after it was
+ * replaced */
+#define NETC_CLOCK_SLOTS 4
+
+void publish_snapshot(time_t seconds);
+void *clock_thread(void *arg);
+
+netc_clock_snapshot snapshots[NETC_CLOCK_SLOTS];
+atomic_uint current;
+atomic_flag refreshing = ATOMIC_FLAG_INIT;
+
+pthread_mutex_t clock_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t clock_cond = PTHREAD_COND_INITIALIZER;
+pthread_t clock_tid;
+unsigned clock_users;
+bool clock_stopping;
+
+const char *week_days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+bool netc_clock_start(void)
+{
+    pthread_mutex_lock(&clock_mutex);
+    if (clock_users++ > 0)
+    {
+        pthread_mutex_unlock(&clock_mutex);
+        return true;
+    }
+
+    clock_stopping = false;
+    publish_snapshot(time(NULL));
+    if (pthread_create(&clock_tid, NULL, clock_thread, NULL) != 0)
+    {
+        clock_users = 0;
+        pthread_mutex_unlock(&clock_mutex);
+        return false;
+    }
+
+    pthread_mutex_unlock(&clock_mutex);
+    return true;
+}
+
+void netc_clock_stop(void)
+{
+    pthread_mutex_lock(&clock_mutex);
+    if (clock_users == 0 || --clock_users > 0)
+    {
+        pthread_mutex_unlock(&clock_mutex);
+        return;
+    }
+
+    clock_stopping = true;
+    pthread_cond_signal(&clock_cond);
+    pthread_mutex_unlock(&clock_mutex);
+    pthread_join(clock_tid, NULL);
+}
+
+const netc_clock_snapshot *netc_clock_now(void)
+{
+    const netc_clock_snapshot *snapshot = &snapshots[atomic_load_explicit(&current, memory_order_acquire)];
+    if (__atomic_load_n(&clock_users, __ATOMIC_RELAXED) > 0)
+        return snapshot;
+
+    /* no clock thread: whoever first sees a new second formats it, the
+     * others keep using the previous snapshot meanwhile */
+    time_t now = time(NULL);
+    if (snapshot->seconds != now && atomic_flag_test_and_set_explicit(&refreshing, memory_order_acquire) == false)
+    {
+        publish_snapshot(now);
+        atomic_flag_clear_explicit(&refreshing, memory_order_release);
+        snapshot = &snapshots[atomic_load_explicit(&current, memory_order_acquire)];
+    }
+
+    return snapshot;
+}
+
+void publish_snapshot(time_t seconds)
+{
+    unsigned next = (atomic_load_explicit(&current, memory_order_relaxed) + 1) % NETC_CLOCK_SLOTS;
+    netc_clock_snapshot *snapshot = &snapshots[next];
+
+    struct tm local, utc;
+    localtime_r(&seconds, &local);
+    gmtime_r(&seconds, &utc);
+
+    snapshot->seconds = seconds;
+    strftime(snapshot->log_timestamp, sizeof(snapshot->log_timestamp), "%Y-%m-%d %H:%M:%S", &local);
+    /* names spelled out, strftime's %a and %b follow the locale; the
+     * modulos only bound the widths for the compiler */
+    snprintf(snapshot->http_date, sizeof(snapshot->http_date), "%s, %02u %s %04u %02u:%02u:%02u GMT",
+             week_days[utc.tm_wday], (unsigned)utc.tm_mday % 100, months[utc.tm_mon],
+             (unsigned)(utc.tm_year + 1900) % 10000, (unsigned)utc.tm_hour % 100,
+             (unsigned)utc.tm_min % 100, (unsigned)utc.tm_sec % 100);
+
+    atomic_store_explicit(&current, next, memory_order_release);
+}
+
+void *clock_thread(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&clock_mutex);
+    while (clock_stopping == false)
+    {
+        /* sleep to the next second boundary, the condition only ends it early on stop */
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        struct timespec next_second = { .tv_sec = now.tv_sec + 1, .tv_nsec = 0 };
+        if (pthread_cond_timedwait(&clock_cond, &clock_mutex, &next_second) == 0)
+            continue;
+
+        /* time() reads the coarse clock, which may still be on the previous second */
+        publish_snapshot(next_second.tv_sec);
+    }
+    pthread_mutex_unlock(&clock_mutex);
+
+    return NULL;
+}
@@ -0,0 +1,46 @@
+#ifndef NETC_CLOCK_H
+#define NETC_CLOCK_H
+
+#include <stdbool.h>
+#include <time.h>
+
+#define NETC_CLOCK_LOG_TIMESTAMP_SIZE 20
+#define NETC_CLOCK_HTTP_DATE_SIZE     30
+
+/* the current second, preformatted for log lines (local time,
+ * "2024-01-31 23:59:59") and for the HTTP Date header (RFC 7231 IMF-fixdate,
+ * "Wed, 31 Jan 2024 22:59:59 GMT") */
+typedef struct
+{
+    time_t seconds;
+    char   log_timestamp[NETC_CLOCK_LOG_TIMESTAMP_SIZE];
+    char   http_date[NETC_CLOCK_HTTP_DATE_SIZE];
+} netc_clock_snapshot;
+
+/**
+ * @brief starts the thread that publishes a new snapshot at every second
+ * boundary. Calls nest, the thread runs until the matching number of
+ * netc_clock_stop calls
+ *
+ * @return true on success
+ * @return false if the thread could not be created
+ */
+bool netc_clock_start(void);
+
+/**
+ * @brief stops the clock thread started by the matching netc_clock_start
+ */
+void netc_clock_stop(void);
+
+/**
+ * @brief returns the current snapshot without formatting anything or taking
+ * a lock. Snapshots are recycled a few seconds after being replaced, so the
+ * strings must be copied right away rather than kept. Without the clock
+ * thread the snapshot is refreshed on demand by the first caller of a new
+ * second
+ *
+ * @return const netc_clock_snapshot* the current snapshot
+ */
+const netc_clock_snapshot *netc_clock_now(void);
+
+#endif // NETC_CLOCK_H
@@ -0,0 +1,851 @@
+#include "netc_connection.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+#define CHUNK_LINE_LIMIT 256
+
+void init_connection(netc_connection *connection, int fd);
+bool resize_read_buffer(netc_connection *connection, size_t capacity);
+void release_response(netc_connection *connection);
+bool write_cached_head(netc_connection *connection, netc_cache_entry *entry, const char *status_line,
+                       const char *extra_headers, bool representation);
+const netc_write_part *write_part_at(const netc_connection *connection, size_t *offset);
+netc_frame_result frame_headers(netc_connection *connection);
+netc_frame_result decode_chunks(netc_connection *connection);
+bool parse_content_length(const char *value, size_t *length);
+bool parse_chunk_size(const char *line, size_t *size);
+
+netc_connection *netc_connection_create(int fd)
+{
+    netc_connection *connection = calloc(1, sizeof(netc_connection));
+    if (connection == NULL) return NULL;
+
+    connection->read_buffer = malloc(DEFAULT_SOCKET_BUFFER_SIZE + 1);
+    if (connection->read_buffer == NULL)
+    {
+        free(connection);
+        return NULL;
+    }
+    connection->read_capacity = DEFAULT_SOCKET_BUFFER_SIZE;
+    netc_arena_init(&connection->arena, 0);
+    init_connection(connection, fd);
+
+    return connection;
+}
+
+netc_io_result netc_connection_read(netc_connection *connection)
+{
+    /* until the headers are framed it is not known whether the body is
+     * buffered whole or streamed, so no more than a piece is read past them */
+    size_t limit = connection->max_header_size + connection->max_body_size + DEFAULT_SOCKET_BUFFER_SIZE;
+    if (connection->headers_length == 0 && connection->max_header_size + NETC_STREAM_CHUNK_SIZE < limit)
+        limit = connection->max_header_size + NETC_STREAM_CHUNK_SIZE;
+    else if (connection->streaming)
+        limit = connection->headers_length + NETC_STREAM_CHUNK_SIZE;
+
+    while (true)
+    {
+        /* a buffer grown by an earlier request is only filled up to the limit */
+        size_t end = connection->read_capacity < limit ? connection->read_capacity : limit;
+        if (connection->read_length >= end)
+        {
+            /* the rest stays in the socket until framing consumed or rejected what is buffered */
+            if (connection->read_capacity >= limit)
+                return NETC_IO_DONE;
+
+            size_t capacity = connection->read_capacity * 2;
+            if (resize_read_buffer(connection, capacity < limit ? capacity : limit) == false)
+                return NETC_IO_ERROR;
+            end = connection->read_capacity;
+        }
+
+        connection->io_calls++;
+        ssize_t bytes_read = recv(connection->fd, connection->read_buffer + connection->read_length,
+                                  end - connection->read_length, 0);
+        if (bytes_read > 0)
+        {
+            connection->read_length += bytes_read;
+            continue;
+        }
+
+        if (bytes_read == 0)
+        {
+            connection->peer_closed = true;
+            return NETC_IO_CLOSED;
+        }
+
+        if (errno == EINTR)
+            continue;
+
+        return errno == EAGAIN || errno == EWOULDBLOCK ? NETC_IO_AGAIN : NETC_IO_ERROR;
+    }
+}
+
+bool netc_connection_append(netc_connection *connection, const char *data, size_t length)
+{
+    if (connection->read_capacity - connection->read_length < length)
+    {
+        size_t capacity = connection->read_capacity * 2;
+        if (capacity < connection->read_length + length)
+            capacity = connection->read_length + length;
+        if (resize_read_buffer(connection, capacity) == false)
+            return false;
+    }
+
+    memcpy(connection->read_buffer + connection->read_length, data, length);
+    connection->read_length += length;
+    return true;
+}
+
+netc_frame_result netc_connection_frame_request(netc_connection *connection)
+{
+    connection->read_buffer[connection->read_length] = '\0';
+
+    if (connection->headers_length == 0)
+    {
+        netc_frame_result result = frame_headers(connection);
+        if (result != NETC_FRAME_COMPLETE)
+            return result;
+    }
+
+    if (connection->chunked)
+    {
+        netc_frame_result result = decode_chunks(connection);
+        if (result != NETC_FRAME_COMPLETE)
+            return result;
+    }
+    else
+    {
+        if (connection->content_length > connection->max_body_size)
+            return NETC_FRAME_BODY_TOO_LARGE;
+        if (connection->read_length - connection->headers_length < connection->content_length)
+            return NETC_FRAME_INCOMPLETE;
+        connection->body_length = connection->content_length;
+    }
+
+    connection->request_length = connection->headers_length + connection->body_length;
+    connection->next_byte = connection->read_buffer[connection->request_length];
+    connection->read_buffer[connection->request_length] = '\0';
+    return NETC_FRAME_COMPLETE;
+}
+
+netc_frame_result netc_connection_frame_headers(netc_connection *connection)
+{
+    if (connection->headers_length > 0)
+        return NETC_FRAME_COMPLETE;
+
+    connection->read_buffer[connection->read_length] = '\0';
+    return frame_headers(connection);
+}
+
+bool netc_connection_begin_stream(netc_connection *connection)
+{
+    size_t capacity = connection->headers_length + NETC_STREAM_CHUNK_SIZE;
+    if (connection->read_capacity < capacity && resize_read_buffer(connection, capacity) == false)
+        return false;
+
+    connection->streaming = true;
+    return true;
+}
+
+netc_frame_result netc_connection_frame_body(netc_connection *connection)
+{
+    connection->read_buffer[connection->read_length] = '\0';
+
+    netc_frame_result result;
+    if (connection->chunked)
+    {
+        /* decoded bytes gather right after the headers, as when buffering */
+        result = decode_chunks(connection);
+        connection->stream_length = connection->body_length;
+    }
+    else
+    {
+        size_t remaining = connection->content_length - connection->body_streamed;
+        size_t available = connection->read_length - connection->headers_length;
+        connection->stream_length = available < remaining ? available : remaining;
+        result = connection->stream_length == remaining ? NETC_FRAME_COMPLETE : NETC_FRAME_INCOMPLETE;
+    }
+
+    if (result == NETC_FRAME_INCOMPLETE)
+        return result;
+
+    connection->streaming = false;
+    if (result == NETC_FRAME_COMPLETE)
+    {
+        connection->request_length = connection->headers_length + connection->stream_length;
+        connection->next_byte = connection->read_buffer[connection->request_length];
+        connection->read_buffer[connection->request_length] = '\0';
+    }
+    return result;
+}
+
+void netc_connection_consume_body(netc_connection *connection)
+{
+    size_t end = connection->headers_length + connection->stream_length;
+    memmove(connection->read_buffer + connection->headers_length, connection->read_buffer + end,
+            connection->read_length - end);
+    connection->read_length -= connection->stream_length;
+    connection->read_buffer[connection->read_length] = '\0';
+
+    if (connection->chunked)
+    {
+        connection->scan_offset -= connection->stream_length;
+        connection->body_length = 0;
+    }
+    connection->body_streamed += connection->stream_length;
+    connection->stream_length = 0;
+}
+
+void netc_connection_reset(netc_connection *connection)
+{
+    /* pipelined requests are moved to the front of the buffer */
+    connection->read_buffer[connection->request_length] = connection->next_byte;
+    connection->read_length -= connection->request_length;
+    memmove(connection->read_buffer, connection->read_buffer + connection->request_length, connection->read_length);
+    connection->request_length = 0;
+    http_parser_init(&connection->parser);
+    connection->scan_offset = 0;
+    connection->headers_length = 0;
+    connection->body_length = 0;
+    connection->content_length = 0;
+    connection->chunked = false;
+    connection->chunk_remaining = 0;
+    connection->streaming = false;
+    connection->stream_length = 0;
+    connection->body_streamed = 0;
+    connection->request_context = NULL;
+    connection->response_streaming = false;
+    connection->response_context = NULL;
+
+    release_response(connection);
+    netc_arena_reset(&connection->arena);
+
+    connection->requests_served++;
+    connection->state = NETC_CONNECTION_READING;
+}
+
+bool netc_connection_set_response(netc_connection *connection, http_response *response)
+{
+    release_response(connection);
+
+    size_t head_length = http_response_write_head(response, connection->head_buffer, connection->head_capacity);
+    if (head_length == 0)
+        return false;
+
+    if (head_length > connection->head_capacity)
+    {
+        size_t capacity = connection->head_capacity ? connection->head_capacity * 2 : 512;
+        while (capacity < head_length) capacity *= 2;
+
+        char *temp = realloc(connection->head_buffer, capacity);
+        if (temp == NULL)
+            return false;
+        connection->head_buffer = temp;
+        connection->head_capacity = capacity;
+        http_response_write_head(response, connection->head_buffer, connection->head_capacity);
+    }
+
+    connection->head_length = head_length;
+    connection->response_body = response->body;
+    connection->response_body_length = response->body_length;
+    connection->response_body_borrowed = response->body_borrowed;
+    response->body = NULL;
+    response->body_length = 0;
+
+    connection->body_parts[0].data = connection->response_body;
+    connection->body_parts[0].length = connection->response_body_length;
+    connection->write_parts = connection->body_parts;
+    connection->write_part_count = 1;
+    connection->write_length = head_length + connection->response_body_length;
+    connection->write_offset = 0;
+    return true;
+}
+
+bool netc_connection_set_cached_response(netc_connection *connection, netc_cache_entry *entry,
+                                         const char *status_line, const char *extra_headers, bool send_body)
+{
+    release_response(connection);
+    if (write_cached_head(connection, entry, status_line, extra_headers, true) == false)
+        return false;
+
+    /* the body is borrowed from the entry, which is held until it is sent */
+    connection->response_cached = entry;
+    connection->response_body = send_body ? (char*)entry->body : NULL;
+    connection->response_body_length = send_body ? entry->body_length : 0;
+    connection->response_body_borrowed = true;
+
+    connection->body_parts[0].data = connection->response_body;
+    connection->body_parts[0].length = connection->response_body_length;
+    connection->write_parts = connection->body_parts;
+    connection->write_part_count = 1;
+    connection->write_length = connection->head_length + connection->response_body_length;
+    connection->write_offset = 0;
+    return true;
+}
+
+bool netc_connection_set_cached_parts(netc_connection *connection, netc_cache_entry *entry, const char *status_line,
+                                      const char *extra_headers, const netc_write_part *parts, size_t count)
+{
+    release_response(connection);
+    if (write_cached_head(connection, entry, status_line, extra_headers, false) == false)
+        return false;
+
+    connection->response_cached = entry;
+    connection->response_body_borrowed = true;
+    netc_connection_set_parts(connection, NULL, parts, count);
+    return true;
+}
+
+void netc_connection_set_parts(netc_connection *connection, netc_file_entry *entry, const netc_write_part *parts,
+                               size_t count)
+{
+    if (entry != NULL)
+    {
+        netc_file_cache_release(connection->response_file);
+        connection->response_file = entry;
+    }
+
+    connection->write_parts = parts;
+    connection->write_part_count = count;
+    connection->write_length = connection->head_length;
+    for (size_t i = 0; i < count; i++)
+        connection->write_length += parts[i].length;
+}
+
+void netc_connection_set_file(netc_connection *connection, netc_file_entry *entry, off_t offset, size_t length)
+{
+    /* the file follows the body set with the head */
+    connection->body_parts[1].data = NULL;
+    connection->body_parts[1].length = length;
+    connection->body_parts[1].offset = offset;
+    connection->body_parts[0].data = connection->response_body;
+    connection->body_parts[0].length = connection->response_body_length;
+    netc_connection_set_parts(connection, entry, connection->body_parts, 2);
+}
+
+struct msghdr *netc_connection_pending_write(netc_connection *connection)
+{
+    size_t offset = connection->write_offset;
+    size_t count = 0;
+    connection->write_more = false;
+
+    if (offset < connection->head_length)
+    {
+        connection->write_iov[count].iov_base = connection->head_buffer + offset;
+        connection->write_iov[count].iov_len = connection->head_length - offset;
+        count++;
+        offset = 0;
+    }
+    else
+    {
+        offset -= connection->head_length;
+    }
+
+    /* memory parts are gathered up to the next file part, sent on its own */
+    for (size_t i = 0; i < connection->write_part_count; i++)
+    {
+        const netc_write_part *part = &connection->write_parts[i];
+        if (offset >= part->length)
+        {
+            offset -= part->length;
+            continue;
+        }
+        if (part->data == NULL || count == NETC_WRITE_IOV_MAX)
+        {
+            connection->write_more = true;
+            break;
+        }
+
+        connection->write_iov[count].iov_base = (char*)part->data + offset;
+        connection->write_iov[count].iov_len = part->length - offset;
+        count++;
+        offset = 0;
+    }
+
+    memset(&connection->write_msg, 0, sizeof(struct msghdr));
+    connection->write_msg.msg_iov = connection->write_iov;
+    connection->write_msg.msg_iovlen = count;
+    return &connection->write_msg;
+}
+
+bool netc_connection_file_pending(const netc_connection *connection)
+{
+    size_t offset;
+    const netc_write_part *part = write_part_at(connection, &offset);
+    return part != NULL && part->data == NULL && connection->response_file != NULL;
+}
+
+netc_io_result netc_connection_send_file(netc_connection *connection)
+{
+    size_t part_offset;
+    const netc_write_part *part;
+    while ((part = write_part_at(connection, &part_offset)) != NULL && part->data == NULL)
+    {
+        off_t offset = part->offset + (off_t)part_offset;
+        connection->io_calls++;
+        ssize_t bytes_sent = sendfile(connection->fd, connection->response_file->fd, &offset,
+                                      part->length - part_offset);
+        if (bytes_sent > 0)
+        {
+            connection->write_offset += bytes_sent;
+            continue;
+        }
+
+        /* the file was truncated after its size went out in the head */
+        if (bytes_sent == 0)
+        {
+            errno = EIO;
+            return NETC_IO_ERROR;
+        }
+
+        if (errno == EINTR)
+            continue;
+
+        return errno == EAGAIN || errno == EWOULDBLOCK ? NETC_IO_AGAIN : NETC_IO_ERROR;
+    }
+
+    return NETC_IO_DONE;
+}
+
+netc_io_result netc_connection_flush(netc_connection *connection)
+{
+    while (connection->write_offset < connection->write_length)
+    {
+        if (netc_connection_file_pending(connection))
+        {
+            netc_io_result result = netc_connection_send_file(connection);
+            if (result != NETC_IO_DONE)
+                return result;
+            continue;
+        }
+
+        /* bytes in memory are held back until the file bytes can join them */
+        connection->io_calls++;
+        struct msghdr *message = netc_connection_pending_write(connection);
+        ssize_t bytes_sent = sendmsg(connection->fd, message, MSG_NOSIGNAL | (connection->write_more ? MSG_MORE : 0));
+        if (bytes_sent >= 0)
+        {
+            connection->write_offset += bytes_sent;
+            continue;
+        }
+
+        if (errno == EINTR)
+            continue;
+
+        return errno == EAGAIN || errno == EWOULDBLOCK ? NETC_IO_AGAIN : NETC_IO_ERROR;
+    }
+
+    return NETC_IO_DONE;
+}
+
+void netc_connection_free(netc_connection *connection)
+{
+    if (connection == NULL) return;
+
+    close(connection->fd);
+    release_response(connection);
+    free(connection->read_buffer);
+    free(connection->head_buffer);
+    netc_arena_destroy(&connection->arena);
+    free(connection);
+}
+
+void netc_connection_pool_init(netc_connection_pool *pool, size_t capacity)
+{
+    pool->free_head = NULL;
+    pool->free_count = 0;
+    pool->live_count = 0;
+    pool->capacity = capacity;
+    pool->allocations = 0;
+}
+
+netc_connection *netc_connection_pool_get(netc_connection_pool *pool, int fd)
+{
+    if (pool->capacity > 0 && pool->live_count >= pool->capacity)
+        return NULL;
+
+    netc_connection *connection = pool->free_head;
+    if (connection != NULL)
+    {
+        pool->free_head = connection->next;
+        pool->free_count--;
+        init_connection(connection, fd);
+    }
+    else
+    {
+        connection = netc_connection_create(fd);
+        if (connection == NULL) return NULL;
+        pool->allocations++;
+    }
+
+    pool->live_count++;
+    return connection;
+}
+
+void netc_connection_pool_put(netc_connection_pool *pool, netc_connection *connection)
+{
+    if (connection == NULL) return;
+
+    if (connection->fd >= 0)
+        close(connection->fd);
+    /* an idle connection keeps no more than it needs for a small request */
+    release_response(connection);
+    netc_arena_trim(&connection->arena);
+    if (connection->read_capacity > DEFAULT_SOCKET_BUFFER_SIZE)
+        resize_read_buffer(connection, DEFAULT_SOCKET_BUFFER_SIZE);
+
+    connection->next = pool->free_head;
+    pool->free_head = connection;
+    pool->free_count++;
+    pool->live_count--;
+}
+
+void netc_connection_pool_destroy(netc_connection_pool *pool)
+{
+    netc_connection *connection = pool->free_head;
+    while (connection != NULL)
+    {
+        netc_connection *next = connection->next;
+        free(connection->read_buffer);
+        free(connection->head_buffer);
+        netc_arena_destroy(&connection->arena);
+        free(connection);
+        connection = next;
+    }
+
+    pool->free_head = NULL;
+    pool->free_count = 0;
+}
+
+void init_connection(netc_connection *connection, int fd)
+{
+    /* everything but the buffers and the arena starts over */
+    char *read_buffer = connection->read_buffer;
+    size_t read_capacity = connection->read_capacity;
+    char *head_buffer = connection->head_buffer;
+    size_t head_capacity = connection->head_capacity;
+    netc_arena arena = connection->arena;
+
+    memset(connection, 0, sizeof(netc_connection));
+    connection->read_buffer = read_buffer;
+    connection->read_capacity = read_capacity;
+    connection->head_buffer = head_buffer;
+    connection->head_capacity = head_capacity;
+    connection->arena = arena;
+
+    connection->fd = fd;
+    connection->state = NETC_CONNECTION_READING;
+    connection->max_header_size = NETC_DEFAULT_MAX_HEADER_SIZE;
+    connection->max_body_size = NETC_DEFAULT_MAX_BODY_SIZE;
+    http_parser_init(&connection->parser);
+}
+
+bool resize_read_buffer(netc_connection *connection, size_t capacity)
+{
+    char *temp = realloc(connection->read_buffer, capacity + 1);
+    if (temp == NULL)
+        return false;
+
+    connection->read_buffer = temp;
+    connection->read_capacity = capacity;
+    return true;
+}
+
+void release_response(netc_connection *connection)
+{
+    /* the head buffer is kept for the next response */
+    if (connection->response_body_borrowed == false)
+        free(connection->response_body);
+    connection->response_body = NULL;
+    connection->response_body_length = 0;
+    connection->response_body_borrowed = false;
+    netc_file_cache_release(connection->response_file);
+    connection->response_file = NULL;
+    netc_response_cache_release(connection->response_cached);
+    connection->response_cached = NULL;
+    connection->write_parts = NULL;
+    connection->write_part_count = 0;
+    connection->head_length = 0;
+    connection->write_length = 0;
+    connection->write_offset = 0;
+}
+
+bool write_cached_head(netc_connection *connection, netc_cache_entry *entry, const char *status_line,
+                       const char *extra_headers, bool representation)
+{
+    const char *stored = entry->head;
+    size_t stored_length = entry->head_length;
+    size_t status_length = 0;
+    if (status_line != NULL)
+    {
+        stored += entry->status_length;
+        stored_length -= entry->status_length;
+        status_length = strlen(status_line);
+    }
+
+    size_t extra_length = strlen(extra_headers);
+    size_t head_length = status_length + stored_length + extra_length;
+    if (head_length > connection->head_capacity)
+    {
+        size_t capacity = connection->head_capacity ? connection->head_capacity * 2 : 512;
+        while (capacity < head_length) capacity *= 2;
+
+        char *temp = realloc(connection->head_buffer, capacity);
+        if (temp == NULL)
+            return false;
+        connection->head_buffer = temp;
+        connection->head_capacity = capacity;
+    }
+
+    char *cursor = connection->head_buffer;
+    if (status_line != NULL)
+    {
+        memcpy(cursor, status_line, status_length);
+        cursor += status_length;
+    }
+    if (representation)
+    {
+        memcpy(cursor, stored, stored_length);
+        cursor += stored_length;
+    }
+    else
+    {
+        /* a part of the body has a length and maybe a type of its own */
+        const char *end = stored + stored_length;
+        while (stored < end)
+        {
+            const char *line_end = memchr(stored, '\n', end - stored);
+            size_t line_length = line_end != NULL ? (size_t)(line_end + 1 - stored) : (size_t)(end - stored);
+            if (strncasecmp(stored, "Content-Length:", 15) != 0 && strncasecmp(stored, "Content-Type:", 13) != 0)
+            {
+                memcpy(cursor, stored, line_length);
+                cursor += line_length;
+            }
+            stored += line_length;
+        }
+    }
+    memcpy(cursor, extra_headers, extra_length);
+    connection->head_length = cursor + extra_length - connection->head_buffer;
+    return true;
+}
+
+const netc_write_part *write_part_at(const netc_connection *connection, size_t *offset)
+{
+    /* the part the next byte to send belongs to, NULL while in the head */
+    if (connection->write_offset < connection->head_length)
+        return NULL;
+
+    size_t remaining = connection->write_offset - connection->head_length;
+    for (size_t i = 0; i < connection->write_part_count; i++)
+    {
+        const netc_write_part *part = &connection->write_parts[i];
+        if (remaining < part->length)
+        {
+            *offset = remaining;
+            return part;
+        }
+        remaining -= part->length;
+    }
+    return NULL;
+}
+
+netc_frame_result frame_headers(netc_connection *connection)
+{
+    http_parse_result parsed = http_parser_execute(&connection->parser, connection->read_buffer,
+                                                   connection->read_length);
+    if (parsed == HTTP_PARSE_INCOMPLETE)
+        return connection->read_length > connection->max_header_size ? NETC_FRAME_HEADERS_TOO_LARGE
+                                                                      : NETC_FRAME_INCOMPLETE;
+    if (parsed == HTTP_PARSE_TOO_MANY_HEADERS)
+        return NETC_FRAME_HEADERS_TOO_LARGE;
+    if (parsed == HTTP_PARSE_ERROR)
+        return NETC_FRAME_BAD_REQUEST;
+
+    size_t headers_length = connection->parser.headers_length;
+    if (headers_length > connection->max_header_size)
+        return NETC_FRAME_HEADERS_TOO_LARGE;
+
+    const char *transfer_encoding = http_parser_find_header(&connection->parser, connection->read_buffer, "Transfer-Encoding");
+    const char *content_length = http_parser_find_header(&connection->parser, connection->read_buffer, "Content-Length");
+    if (transfer_encoding != NULL)
+    {
+        /* a request carrying both is ambiguous and a classic smuggling vector */
+        if (content_length != NULL || strcasecmp(transfer_encoding, "chunked") != 0)
+            return NETC_FRAME_BAD_REQUEST;
+
+        connection->chunked = true;
+        connection->chunk_state = NETC_CHUNK_SIZE;
+    }
+    else if (content_length != NULL)
+    {
+        /* the size limit is checked when framing the body, streamed bodies have none */
+        if (parse_content_length(content_length, &connection->content_length) == false)
+            return NETC_FRAME_BAD_REQUEST;
+
+        /* lengths that disagree would frame the body differently behind a proxy */
+        const char *buffer = connection->read_buffer;
+        for (size_t i = 0; i < connection->parser.header_count; i++)
+        {
+            const http_header_view *header = &connection->parser.headers[i];
+            size_t length;
+            if (strcasecmp(buffer + header->name.offset, "Content-Length") == 0 &&
+                (parse_content_length(buffer + header->value.offset, &length) == false ||
+                 length != connection->content_length))
+                return NETC_FRAME_BAD_REQUEST;
+        }
+    }
+
+    connection->headers_length = headers_length;
+    connection->scan_offset = headers_length;
+    return NETC_FRAME_COMPLETE;
+}
+
+netc_frame_result decode_chunks(netc_connection *connection)
+{
+    char *buffer = connection->read_buffer;
+    size_t offset = connection->scan_offset;
+    size_t decoded = connection->headers_length + connection->body_length;
+    netc_frame_result result = NETC_FRAME_INCOMPLETE;
+    bool waiting = false;
+
+    while (result == NETC_FRAME_INCOMPLETE && waiting == false && offset < connection->read_length)
+    {
+        size_t available = connection->read_length - offset;
+        const char *line_end = NULL;
+
+        switch (connection->chunk_state)
+        {
+        case NETC_CHUNK_SIZE:
+            line_end = memmem(buffer + offset, available, "\r\n", 2);
+            if (line_end == NULL)
+            {
+                waiting = available <= CHUNK_LINE_LIMIT;
+                if (waiting == false)
+                    result = NETC_FRAME_BAD_REQUEST;
+                break;
+            }
+
+            size_t size;
+            if (parse_chunk_size(buffer + offset, &size) == false)
+            {
+                result = NETC_FRAME_BAD_REQUEST;
+                break;
+            }
+            if (connection->streaming == false && size > connection->max_body_size - connection->body_length)
+            {
+                result = NETC_FRAME_BODY_TOO_LARGE;
+                break;
+            }
+
+            offset = line_end - buffer + 2;
+            connection->chunk_remaining = size;
+            connection->chunk_state = size == 0 ? NETC_CHUNK_TRAILER : NETC_CHUNK_DATA;
+            break;
+
+        case NETC_CHUNK_DATA:
+        {
+            size_t length = available < connection->chunk_remaining ? available : connection->chunk_remaining;
+            memmove(buffer + decoded, buffer + offset, length);
+            decoded += length;
+            offset += length;
+            connection->body_length += length;
+            connection->chunk_remaining -= length;
+            if (connection->chunk_remaining == 0)
+                connection->chunk_state = NETC_CHUNK_DATA_END;
+            break;
+        }
+
+        case NETC_CHUNK_DATA_END:
+            if (available < 2)
+            {
+                waiting = true;
+                break;
+            }
+            if (buffer[offset] != '\r' || buffer[offset + 1] != '\n')
+            {
+                result = NETC_FRAME_BAD_REQUEST;
+                break;
+            }
+
+            offset += 2;
+            connection->chunk_state = NETC_CHUNK_SIZE;
+            break;
+
+        case NETC_CHUNK_TRAILER:
+            /* trailer fields are skipped, they count against the header limit */
+            line_end = memmem(buffer + offset, available, "\r\n", 2);
+            if (line_end == NULL)
+            {
+                waiting = connection->headers_length + available <= connection->max_header_size;
+                if (waiting == false)
+                    result = NETC_FRAME_HEADERS_TOO_LARGE;
+                break;
+            }
+
+            if (line_end == buffer + offset)
+                result = NETC_FRAME_COMPLETE;
+            offset = line_end - buffer + 2;
+            break;
+        }
+    }
+
+    /* the decoded body grows in place, bytes not decoded yet slide right behind it */
+    memmove(buffer + decoded, buffer + offset, connection->read_length - offset);
+    connection->read_length = decoded + connection->read_length - offset;
+    connection->scan_offset = decoded;
+    buffer[connection->read_length] = '\0';
+
+    return result;
+}
+
+bool parse_content_length(const char *value, size_t *length)
+{
+    if (*value < '0' || *value > '9')
+        return false;
+
+    size_t result = 0;
+    for (; *value >= '0' && *value <= '9'; value++)
+    {
+        if (result > (SIZE_MAX - 9) / 10)
+            return false;
+        result = result * 10 + (*value - '0');
+    }
+
+    if (*value != '\0')
+        return false;
+
+    *length = result;
+    return true;
+}
+
+bool parse_chunk_size(const char *line, size_t *size)
+{
+    size_t result = 0;
+    const char *digit = line;
+    for (;; digit++)
+    {
+        unsigned value;
+        if (*digit >= '0' && *digit <= '9')      value = *digit - '0';
+        else if (*digit >= 'a' && *digit <= 'f') value = *digit - 'a' + 10;
+        else if (*digit >= 'A' && *digit <= 'F') value = *digit - 'A' + 10;
+        else break;
+
+        if (result > SIZE_MAX >> 4)
+            return false;
+        result = (result << 4) | value;
+    }
+
+    /* chunk extensions after ';' are ignored */
+    if (digit == line || (*digit != '\r' && *digit != ';' && *digit != ' ' && *digit != '\t'))
+        return false;
+
+    *size = result;
+    return true;
+}
@@ -0,0 +1,423 @@
+#ifndef NETC_CONNECTION_H
+#define NETC_CONNECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "netc_http.h"
+#include "netc_arena.h"
+#include "netc_file_cache.h"
+#include "netc_response_cache.h"
+
+#define DEFAULT_SOCKET_BUFFER_SIZE   ((size_t)4096)
+#define NETC_DEFAULT_MAX_HEADER_SIZE ((size_t)8192)
+#define NETC_DEFAULT_MAX_BODY_SIZE   ((size_t)1024 * 1024)
+#define NETC_DEFAULT_MAX_CONNECTIONS ((size_t)10000)
+#define NETC_STREAM_CHUNK_SIZE       ((size_t)64 * 1024)
+#define NETC_WRITE_IOV_MAX           8
+
+typedef enum
+{
+    NETC_CONNECTION_READING,
+    NETC_CONNECTION_PROCESSING,
+    NETC_CONNECTION_WRITING,
+    NETC_CONNECTION_RESUMING
+} netc_connection_state;
+
+typedef enum
+{
+    NETC_IO_DONE,
+    NETC_IO_AGAIN,
+    NETC_IO_CLOSED,
+    NETC_IO_ERROR
+} netc_io_result;
+
+typedef enum
+{
+    NETC_FRAME_INCOMPLETE,
+    NETC_FRAME_COMPLETE,
+    NETC_FRAME_BAD_REQUEST,
+    NETC_FRAME_HEADERS_TOO_LARGE,
+    NETC_FRAME_BODY_TOO_LARGE
+} netc_frame_result;
+
+typedef enum
+{
+    NETC_CHUNK_SIZE,
+    NETC_CHUNK_DATA,
+    NETC_CHUNK_DATA_END,
+    NETC_CHUNK_TRAILER
+} netc_chunk_state;
+
+/* a piece of a response sent after its head: length bytes at data or,
+ * when data is NULL, length bytes of the response file from offset */
+typedef struct
+{
+    const char              *data;
+    size_t                   length;
+    off_t                    offset;
+} netc_write_part;
+
+typedef struct netc_connection
+{
+    int                      fd;
+    netc_connection_state    state;
+    bool                     peer_closed;
+    bool                     keep_alive;
+    size_t                   requests_served;
+    uint64_t                 last_active_ms;
+
+    char                    *read_buffer;
+    size_t                   read_length;
+    size_t                   read_capacity;
+    size_t                   request_length;
+    char                     next_byte;
+
+    size_t                   max_header_size;
+    size_t                   max_body_size;
+    http_parser              parser;
+    size_t                   scan_offset;
+    size_t                   headers_length;
+    size_t                   body_length;
+    size_t                   content_length;
+    bool                     chunked;
+    netc_chunk_state         chunk_state;
+    size_t                   chunk_remaining;
+    netc_frame_result        frame_result;
+
+    bool                     streaming;
+    size_t                   stream_length;
+    size_t                   body_streamed;
+    void                    *request_context;
+
+    char                    *head_buffer;
+    size_t                   head_capacity;
+    size_t                   head_length;
+    char                    *response_body;
+    size_t                   response_body_length;
+    bool                     response_body_borrowed;
+    netc_file_entry         *response_file;
+    netc_cache_entry        *response_cached;
+    const netc_write_part   *write_parts;
+    size_t                   write_part_count;
+    netc_write_part          body_parts[2];
+    size_t                   write_length;
+    size_t                   write_offset;
+    bool                     write_more;
+    bool                     response_streaming;
+    void                    *response_context;
+    struct iovec             write_iov[NETC_WRITE_IOV_MAX];
+    struct msghdr            write_msg;
+
+    netc_arena               arena;
+
+    size_t                   io_calls;
+    struct netc_connection  *next_completed;
+    struct netc_connection  *next_ready;
+    struct netc_connection  *prev;
+    struct netc_connection  *next;
+} netc_connection;
+
+/* connections released to a pool keep their buffers and arena, so a
+ * recycled connection serves its first request without allocating. The
+ * pool is owned by one thread, like the event loop that accepts and closes
+ * its connections */
+typedef struct
+{
+    netc_connection *free_head;
+    size_t           free_count;
+    size_t           live_count;
+    size_t           capacity;
+    size_t           allocations;
+} netc_connection_pool;
+
+/**
+ * @brief allocates the state for a freshly accepted, non-blocking socket.
+ * If not NULL, the returned pointer must be freed with netc_connection_free
+ *
+ * @param fd the client socket file descriptor
+ * @return netc_connection* pointer to the new connection, NULL on error
+ */
+netc_connection *netc_connection_create(int fd);
+
+/**
+ * @brief reads from the socket until the kernel buffer is drained or the read
+ * buffer reached max_header_size + max_body_size plus one socket buffer of
+ * slack. Before the headers are framed the limit is max_header_size +
+ * NETC_STREAM_CHUNK_SIZE, and the headers plus NETC_STREAM_CHUNK_SIZE while
+ * streaming the body. The buffer grows geometrically up to that limit
+ *
+ * @param connection pointer to the connection to read from
+ * @return netc_io_result NETC_IO_AGAIN when the socket would block,
+ * NETC_IO_DONE when the buffer is full and must be framed before reading
+ * more, NETC_IO_CLOSED when the peer closed its side, NETC_IO_ERROR on failure
+ */
+netc_io_result netc_connection_read(netc_connection *connection);
+
+/**
+ * @brief appends bytes received by other means (e.g. an io_uring provided
+ * buffer) to the read buffer
+ *
+ * @param connection pointer to the connection to append to
+ * @param data pointer to the received bytes
+ * @param length number of bytes received
+ * @return true on success
+ * @return false on allocation failure
+ */
+bool netc_connection_append(netc_connection *connection, const char *data, size_t length);
+
+/**
+ * @brief frames the next request of the read buffer, resuming where the
+ * previous call stopped. The request line and headers are parsed in place
+ * by the connection parser; once they are complete the body is read
+ * according to Content-Length, or decoded in place when the request uses
+ * Transfer-Encoding: chunked, so the body always directly follows the
+ * headers. On success request_length covers headers and body, which are
+ * NUL-terminated in place so they can be handed to the parser as a string;
+ * the byte replaced by the terminator is restored by netc_connection_reset
+ *
+ * @param connection pointer to the connection to inspect
+ * @return netc_frame_result NETC_FRAME_COMPLETE if a full request is
+ * buffered, NETC_FRAME_INCOMPLETE if more bytes are needed, otherwise the
+ * reason the request must be rejected
+ */
+netc_frame_result netc_connection_frame_request(netc_connection *connection);
+
+/**
+ * @brief parses the request line and headers of the next request only,
+ * so the request can be routed before its body arrives. Resumes where the
+ * previous call stopped and returns NETC_FRAME_COMPLETE again once done
+ *
+ * @param connection pointer to the connection to inspect
+ * @return netc_frame_result NETC_FRAME_COMPLETE once the headers are
+ * buffered, NETC_FRAME_INCOMPLETE if more bytes are needed, otherwise the
+ * reason the request must be rejected
+ */
+netc_frame_result netc_connection_frame_headers(netc_connection *connection);
+
+/**
+ * @brief switches a connection whose headers are framed to streaming its
+ * body. The read buffer is grown to hold the headers plus one
+ * NETC_STREAM_CHUNK_SIZE piece right away, so it does not move again until
+ * the body ends and views into the headers stay valid
+ *
+ * @param connection pointer to the connection to stream
+ * @return true on success
+ * @return false if the buffer could not be grown
+ */
+bool netc_connection_begin_stream(netc_connection *connection);
+
+/**
+ * @brief frames the next piece of a body that is streamed rather than
+ * buffered whole, for connections with streaming set once the headers are
+ * framed. The body bytes available so far, decoded when chunked, are left
+ * right after the headers and counted by stream_length; they are dropped
+ * with netc_connection_consume_body once handled. max_body_size does not
+ * apply. On NETC_FRAME_COMPLETE the last piece is NUL-terminated and
+ * request_length is set like netc_connection_frame_request does; streaming
+ * is cleared once the body ends or is rejected
+ *
+ * @param connection pointer to the connection to inspect
+ * @return netc_frame_result NETC_FRAME_COMPLETE when the body ends with the
+ * bytes available, NETC_FRAME_INCOMPLETE when more are to come, otherwise
+ * the reason the body was rejected
+ */
+netc_frame_result netc_connection_frame_body(netc_connection *connection);
+
+/**
+ * @brief drops the stream_length body bytes just handled, keeping what
+ * follows them, so a streamed body never holds more than one piece
+ *
+ * @param connection pointer to the connection being streamed
+ */
+void netc_connection_consume_body(netc_connection *connection);
+
+/**
+ * @brief drops the request that was just answered from the read buffer,
+ * keeping any pipelined bytes that follow it, and gets the connection ready
+ * to read the next request. Everything allocated from the connection arena
+ * while handling the request is released
+ *
+ * @param connection pointer to the connection to reset
+ */
+void netc_connection_reset(netc_connection *connection);
+
+/**
+ * @brief queues a response for writing. The status line and headers are
+ * serialized into a head buffer the connection reuses across requests; the
+ * body is not copied, the connection takes it over from the response and
+ * sends it as a separate iovec
+ *
+ * @param connection pointer to the connection to write to
+ * @param response pointer to the response to send, its body is moved out
+ * @return true on success
+ * @return false on allocation failure, nothing is queued
+ */
+bool netc_connection_set_response(netc_connection *connection, http_response *response);
+
+/**
+ * @brief queues a response stored in a netc_response_cache. Its head is
+ * copied into the head buffer followed by extra_headers, which must end the
+ * head with a blank line; the body is sent straight from the entry, without
+ * a copy. The connection takes over the reference to entry and releases it
+ * with the response
+ *
+ * @param connection pointer to the connection to write to
+ * @param entry the stored response, returned by netc_response_cache_lookup
+ * @param status_line replaces the stored status line, e.g. for a 304, NULL
+ * to keep it
+ * @param extra_headers header lines added to the stored ones, e.g. the
+ * Connection header, followed by the empty line
+ * @param send_body false to send the head alone, e.g. for HEAD requests
+ * @return true on success
+ * @return false on allocation failure, nothing is queued and entry is
+ * still owned by the caller
+ */
+bool netc_connection_set_cached_response(netc_connection *connection, netc_cache_entry *entry,
+                                         const char *status_line, const char *extra_headers, bool send_body);
+
+/**
+ * @brief queues ranges of a response stored in a netc_response_cache, for a
+ * 206 or a 416. The stored head is copied without its status line and its
+ * Content-Type and Content-Length headers, which status_line and
+ * extra_headers replace, and parts are sent after it. The connection takes
+ * over the reference to entry and releases it with the response
+ *
+ * @param connection pointer to the connection to write to
+ * @param entry the stored response, returned by netc_response_cache_lookup
+ * @param status_line the status line of the answer
+ * @param extra_headers header lines added to the stored ones, followed by
+ * the empty line
+ * @param parts what follows the head, slices of the body of entry and the
+ * lines between them. They must stay valid until the response is released,
+ * e.g. allocated from the connection arena
+ * @param count number of parts
+ * @return true on success
+ * @return false on allocation failure, nothing is queued and entry is
+ * still owned by the caller
+ */
+bool netc_connection_set_cached_parts(netc_connection *connection, netc_cache_entry *entry, const char *status_line,
+                                      const char *extra_headers, const netc_write_part *parts, size_t count);
+
+/**
+ * @brief replaces what follows the head of the response queued by
+ * netc_connection_set_response with parts, e.g. slices of its body and the
+ * lines between them for a 206. The body stays held until the response is
+ * released, so parts may point into it. Parts whose data is NULL are sent
+ * with sendfile from entry; the connection takes over the reference to it
+ * and releases it with the response
+ *
+ * @param connection pointer to the connection to write to
+ * @param entry the file parts are read from, NULL if they are all in memory
+ * @param parts the parts, they must stay valid until the response is
+ * released, e.g. allocated from the connection arena
+ * @param count number of parts
+ */
+void netc_connection_set_parts(netc_connection *connection, netc_file_entry *entry, const netc_write_part *parts,
+                               size_t count);
+
+/**
+ * @brief appends length bytes of a cached file, starting at offset, to the
+ * response queued by netc_connection_set_response. They are sent after the
+ * head and body with sendfile, straight from the page cache. The connection
+ * takes over the reference to entry and releases it with the response
+ *
+ * @param connection pointer to the connection to write to
+ * @param entry the file to send, acquired from a netc_file_cache
+ * @param offset offset of the first byte to send
+ * @param length number of bytes to send
+ */
+void netc_connection_set_file(netc_connection *connection, netc_file_entry *entry, off_t offset, size_t length);
+
+/**
+ * @brief points write_msg at the bytes in memory not sent yet, from the
+ * head up to the next file part, at most NETC_WRITE_IOV_MAX pieces of them.
+ * write_more tells whether more follows them
+ *
+ * @param connection pointer to the connection being written
+ * @return struct msghdr* message to hand to sendmsg, valid until the next
+ * call or until the response is released
+ */
+struct msghdr *netc_connection_pending_write(netc_connection *connection);
+
+/**
+ * @brief tells whether the next bytes to send are file content, set with
+ * netc_connection_set_file or netc_connection_set_parts
+ *
+ * @param connection pointer to the connection being written
+ * @return true if the next bytes are read from the file
+ */
+bool netc_connection_file_pending(const netc_connection *connection);
+
+/**
+ * @brief sends as much of the file content at hand as the socket accepts
+ * with sendfile, once netc_connection_file_pending is true
+ *
+ * @param connection pointer to the connection being written
+ * @return netc_io_result NETC_IO_DONE once the response is sent or bytes
+ * in memory come next, NETC_IO_AGAIN when the socket would block,
+ * NETC_IO_ERROR on failure or if the file shrank meanwhile
+ */
+netc_io_result netc_connection_send_file(netc_connection *connection);
+
+/**
+ * @brief writes as much of the pending response as the socket accepts,
+ * the bytes in memory with one sendmsg call per attempt and the file parts
+ * with sendfile
+ *
+ * @param connection pointer to the connection to flush
+ * @return netc_io_result NETC_IO_DONE once everything is sent,
+ * NETC_IO_AGAIN when the socket would block, NETC_IO_ERROR on failure
+ */
+netc_io_result netc_connection_flush(netc_connection *connection);
+
+/**
+ * @brief closes the socket and frees memory taken by a connection
+ *
+ * @param connection pointer to the connection to free
+ */
+void netc_connection_free(netc_connection *connection);
+
+/**
+ * @brief initializes an empty pool. Connections are allocated on demand and
+ * recycled once released, so at most capacity connections are ever
+ * allocated
+ *
+ * @param pool pointer to the pool to initialize
+ * @param capacity maximum number of connections alive at once, 0 for no limit
+ */
+void netc_connection_pool_init(netc_connection_pool *pool, size_t capacity);
+
+/**
+ * @brief returns a connection for a freshly accepted socket, recycling a
+ * released one when available. Must be released with
+ * netc_connection_pool_put
+ *
+ * @param pool pointer to the pool
+ * @param fd the client socket file descriptor
+ * @return netc_connection* pointer to the connection, NULL when capacity
+ * connections are already alive or on allocation failure
+ */
+netc_connection *netc_connection_pool_get(netc_connection_pool *pool, int fd);
+
+/**
+ * @brief closes the socket of a connection and keeps its memory for the
+ * next netc_connection_pool_get. A read buffer grown past the default size
+ * is shrunk back, so idle connections never hold large buffers
+ *
+ * @param pool pointer to the pool the connection was taken from
+ * @param connection pointer to the connection to release
+ */
+void netc_connection_pool_put(netc_connection_pool *pool, netc_connection *connection);
+
+/**
+ * @brief frees every connection released to the pool. Connections still
+ * alive must have been released first
+ *
+ * @param pool pointer to the pool to destroy
+ */
+void netc_connection_pool_destroy(netc_connection_pool *pool);
+
+#endif // NETC_CONNECTION_H
@@ -0,0 +1,314 @@
+#include "netc_file_cache.h"
+#include "netc_http.h"
+#include "netc_hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/openat2.h>
+
+bool normalize_path(const char *path, size_t length, char *normalized);
+int hex_digit(char c);
+int open_beneath(int directory_fd, const char *path);
+bool stat_entry(netc_file_entry *entry, const struct stat *st);
+netc_file_entry *find_entry(const netc_file_cache *cache, const char *path, size_t length, uint64_t hash);
+void insert_entry(netc_file_cache *cache, netc_file_entry *entry);
+void unlink_entry(netc_file_cache *cache, netc_file_entry *entry);
+void free_entry(netc_file_entry *entry);
+
+bool netc_file_cache_init(netc_file_cache *cache, const char *directory, size_t capacity)
+{
+    if (cache == NULL || directory == NULL || capacity == 0)
+        return false;
+
+    memset(cache, 0, sizeof(netc_file_cache));
+    cache->directory_fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (cache->directory_fd < 0)
+        return false;
+
+    /* twice as many buckets as files keeps the chains short */
+    cache->bucket_count = 16;
+    while (cache->bucket_count < capacity * 2)
+        cache->bucket_count *= 2;
+    cache->buckets = calloc(cache->bucket_count, sizeof(netc_file_entry*));
+    if (cache->buckets == NULL)
+    {
+        close(cache->directory_fd);
+        return false;
+    }
+
+    cache->capacity = capacity;
+    pthread_mutex_init(&cache->mutex, NULL);
+    return true;
+}
+
+netc_file_entry *netc_file_cache_acquire(netc_file_cache *cache, const char *path, size_t length)
+{
+    if (cache == NULL || path == NULL)
+        return NULL;
+
+    char relative[NETC_FILE_CACHE_MAX_PATH];
+    if (normalize_path(path, length, relative) == false)
+        return NULL;
+    size_t relative_length = strlen(relative);
+    uint64_t hash = netc_hash_fnv1a(relative, relative_length);
+    time_t now = netc_clock_now()->seconds;
+
+    pthread_mutex_lock(&cache->mutex);
+    netc_file_entry *entry = find_entry(cache, relative, relative_length, hash);
+    if (entry != NULL && entry->validated != now)
+    {
+        /* a file replaced or rewritten on disk is opened again */
+        struct stat st;
+        if (fstatat(cache->directory_fd, relative, &st, 0) != 0 || st.st_ino != entry->inode ||
+            st.st_dev != entry->device || st.st_mtime != entry->modified || st.st_mtim.tv_nsec != entry->modified_nsec ||
+            (size_t)st.st_size != entry->size)
+        {
+            unlink_entry(cache, entry);
+            entry = NULL;
+        }
+        else
+        {
+            entry->validated = now;
+        }
+    }
+
+    if (entry != NULL)
+    {
+        entry->references++;
+        netc_lru_remove(&cache->lru, &entry->lru);
+        netc_lru_push_front(&cache->lru, &entry->lru);
+        cache->hits++;
+        pthread_mutex_unlock(&cache->mutex);
+        return entry;
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->mutex);
+
+    /* the file is opened without the lock, other event loops keep serving */
+    int fd = open_beneath(cache->directory_fd, relative);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    entry = calloc(1, sizeof(netc_file_entry));
+    if (entry == NULL || fstat(fd, &st) != 0 || stat_entry(entry, &st) == false ||
+        (entry->path = strdup(relative)) == NULL)
+    {
+        close(fd);
+        free(entry);
+        return NULL;
+    }
+
+    entry->cache = cache;
+    entry->path_length = relative_length;
+    entry->hash = hash;
+    entry->fd = fd;
+    entry->content_type = http_content_type(relative);
+    entry->validated = now;
+    entry->references = 1;
+
+    pthread_mutex_lock(&cache->mutex);
+    netc_file_entry *raced = find_entry(cache, relative, relative_length, hash);
+    if (raced != NULL)
+    {
+        /* another event loop opened it meanwhile, its entry is kept */
+        raced->references++;
+        pthread_mutex_unlock(&cache->mutex);
+        free_entry(entry);
+        return raced;
+    }
+
+    insert_entry(cache, entry);
+    while (cache->count > cache->capacity)
+        unlink_entry(cache, NETC_LRU_ENTRY(cache->lru.tail, netc_file_entry, lru));
+    pthread_mutex_unlock(&cache->mutex);
+
+    return entry;
+}
+
+void netc_file_cache_release(netc_file_entry *entry)
+{
+    if (entry == NULL) return;
+
+    netc_file_cache *cache = entry->cache;
+    pthread_mutex_lock(&cache->mutex);
+    entry->references--;
+    bool unused = entry->evicted && entry->references == 0;
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (unused)
+        free_entry(entry);
+}
+
+void netc_file_cache_destroy(netc_file_cache *cache)
+{
+    if (cache == NULL || cache->buckets == NULL) return;
+
+    netc_file_entry *entry = NETC_LRU_ENTRY(cache->lru.head, netc_file_entry, lru);
+    while (entry != NULL)
+    {
+        netc_file_entry *next = NETC_LRU_ENTRY(entry->lru.next, netc_file_entry, lru);
+        free_entry(entry);
+        entry = next;
+    }
+
+    free(cache->buckets);
+    cache->buckets = NULL;
+    close(cache->directory_fd);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+bool normalize_path(const char *path, size_t length, char *normalized)
+{
+    size_t written = 0;
+    size_t segment_start = 0;
+
+    /* the end of the path closes the last segment like a separator */
+    for (size_t i = 0; i <= length; i++)
+    {
+        char c = '/';
+        if (i < length)
+        {
+            c = path[i];
+            if (c == '%')
+            {
+                int high = i + 2 < length ? hex_digit(path[i + 1]) : -1;
+                int low = i + 2 < length ? hex_digit(path[i + 2]) : -1;
+                if (high < 0 || low < 0)
+                    return false;
+                c = (char)(high << 4 | low);
+                i += 2;
+            }
+            if (c == '\0')
+                return false;
+        }
+
+        if (c != '/')
+        {
+            if (written + 1 >= NETC_FILE_CACHE_MAX_PATH)
+                return false;
+            normalized[written++] = c;
+            continue;
+        }
+
+        /* empty segments are dropped, dot segments refused */
+        size_t segment_length = written - segment_start;
+        if (segment_length == 0)
+            continue;
+        if (normalized[segment_start] == '.' &&
+            (segment_length == 1 || (segment_length == 2 && normalized[segment_start + 1] == '.')))
+            return false;
+
+        if (written + 1 >= NETC_FILE_CACHE_MAX_PATH)
+            return false;
+        normalized[written++] = '/';
+        segment_start = written;
+    }
+
+    /* a directory is served through its index */
+    if (length == 0 || path[length - 1] == '/')
+    {
+        const char index[] = "index.html";
+        if (written + sizeof(index) > NETC_FILE_CACHE_MAX_PATH)
+            return false;
+        memcpy(normalized + written, index, sizeof(index));
+        return true;
+    }
+
+    if (written == 0)
+        return false;
+    normalized[written - 1] = '\0';
+    return true;
+}
+
+int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int open_beneath(int directory_fd, const char *path)
+{
+    struct open_how how = {
+        .flags = O_RDONLY | O_CLOEXEC | O_NONBLOCK,
+        .resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS
+    };
+    int fd = syscall(SYS_openat2, directory_fd, path, &how, sizeof(how));
+    if (fd >= 0 || errno != ENOSYS)
+        return fd;
+
+    /* without openat2 only the last component is kept from being a link */
+    return openat(directory_fd, path, O_RDONLY | O_CLOEXEC | O_NONBLOCK | O_NOFOLLOW);
+}
+
+bool stat_entry(netc_file_entry *entry, const struct stat *st)
+{
+    if (S_ISREG(st->st_mode) == false)
+        return false;
+
+    entry->size = st->st_size;
+    entry->modified = st->st_mtime;
+    entry->modified_nsec = st->st_mtim.tv_nsec;
+    entry->device = st->st_dev;
+    entry->inode = st->st_ino;
+
+    /* hashing the identity and version of the file rather than its content
+     * keeps opening a large file cheap, a rewrite changes the mtime */
+    uint64_t identity[] = { entry->device, entry->inode, entry->size, (uint64_t)entry->modified, entry->modified_nsec };
+    http_format_etag(netc_hash64(identity, sizeof(identity), 0), entry->etag);
+
+    struct tm tm;
+    gmtime_r(&entry->modified, &tm);
+    return strftime(entry->last_modified, sizeof(entry->last_modified), "%a, %d %b %Y %H:%M:%S GMT", &tm) > 0;
+}
+
+netc_file_entry *find_entry(const netc_file_cache *cache, const char *path, size_t length, uint64_t hash)
+{
+    netc_file_entry *entry = cache->buckets[hash & (cache->bucket_count - 1)];
+    while (entry != NULL)
+    {
+        if (entry->hash == hash && entry->path_length == length && memcmp(entry->path, path, length) == 0)
+            return entry;
+        entry = entry->bucket_next;
+    }
+    return NULL;
+}
+
+void insert_entry(netc_file_cache *cache, netc_file_entry *entry)
+{
+    netc_file_entry **bucket = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    entry->bucket_next = *bucket;
+    *bucket = entry;
+    netc_lru_push_front(&cache->lru, &entry->lru);
+    cache->count++;
+}
+
+void unlink_entry(netc_file_cache *cache, netc_file_entry *entry)
+{
+    netc_file_entry **link = &cache->buckets[entry->hash & (cache->bucket_count - 1)];
+    while (*link != entry)
+        link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+    netc_lru_remove(&cache->lru, &entry->lru);
+    cache->count--;
+
+    /* a file still being sent is closed by its last release */
+    if (entry->references > 0)
+        entry->evicted = true;
+    else
+        free_entry(entry);
+}
+
+void free_entry(netc_file_entry *entry)
+{
+    close(entry->fd);
+    free(entry->path);
+    free(entry);
+}
@@ -0,0 +1,103 @@
+#ifndef NETC_FILE_CACHE_H
+#define NETC_FILE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "netc_clock.h"
+#include "netc_http.h"
+#include "netc_lru.h"
+
+#define NETC_FILE_CACHE_CAPACITY 256
+#define NETC_FILE_CACHE_MAX_PATH 1024
+
+/* an open file of a served directory with the metadata of its last stat
+ * and the validators derived from it.
+ * Entries are shared: each netc_file_cache_acquire must be matched by one
+ * netc_file_cache_release, an entry evicted while in use is closed by the
+ * last release */
+typedef struct netc_file_entry
+{
+    struct netc_file_cache *cache;
+    char                   *path;
+    size_t                  path_length;
+    uint64_t                hash;
+    int                     fd;
+    size_t                  size;
+    time_t                  modified;
+    long                    modified_nsec;
+    dev_t                   device;
+    ino_t                   inode;
+    char                    last_modified[NETC_CLOCK_HTTP_DATE_SIZE];
+    char                    etag[HTTP_ETAG_SIZE];
+    const char             *content_type;
+    time_t                  validated;
+    size_t                  references;
+    bool                    evicted;
+    struct netc_file_entry *bucket_next;
+    netc_lru_node           lru;
+} netc_file_entry;
+
+/* the files of one directory, the most recently used capacity of them kept
+ * open. Shared by every event loop, one mutex guards the table */
+typedef struct netc_file_cache
+{
+    int                     directory_fd;
+    pthread_mutex_t         mutex;
+    netc_file_entry       **buckets;
+    size_t                  bucket_count;
+    size_t                  count;
+    size_t                  capacity;
+    netc_lru_list           lru;
+    uint64_t                hits;
+    uint64_t                misses;
+    struct netc_file_cache *next;
+} netc_file_cache;
+
+/**
+ * @brief opens the directory files are served from and prepares an empty
+ * cache
+ *
+ * @param cache pointer to the cache to initialize
+ * @param directory path of the directory to serve
+ * @param capacity most files kept open at once, at least 1
+ * @return true on success
+ * @return false if the directory cannot be opened or on allocation failure
+ */
+bool netc_file_cache_init(netc_file_cache *cache, const char *directory, size_t capacity);
+
+/**
+ * @brief returns the regular file at path, relative to the served
+ * directory, opening and stating it only when it is not cached yet. A cached
+ * file is stated again at most once a second, so a file replaced on disk is
+ * picked up. path is percent-decoded first; empty segments are skipped, an
+ * empty path or one ending with '/' names the index.html of that directory,
+ * and "." or ".." segments are refused. Symbolic links leading out of the
+ * directory are refused where the kernel supports openat2
+ *
+ * @param cache pointer to the cache
+ * @param path path relative to the directory, not NUL-terminated
+ * @param length length of path
+ * @return netc_file_entry* the file, NULL if it is missing, not a regular
+ * file, refused or on failure
+ */
+netc_file_entry *netc_file_cache_acquire(netc_file_cache *cache, const char *path, size_t length);
+
+/**
+ * @brief gives back a file returned by netc_file_cache_acquire
+ *
+ * @param entry the file to release, may be NULL
+ */
+void netc_file_cache_release(netc_file_entry *entry);
+
+/**
+ * @brief closes every cached file and the directory. No entry may still be
+ * in use
+ *
+ * @param cache pointer to the cache to destroy
+ */
+void netc_file_cache_destroy(netc_file_cache *cache);
+
+#endif // NETC_FILE_CACHE_H
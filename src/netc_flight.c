@@ -0,0 +1,98 @@
+#include "netc_flight.h"
+#include "netc_hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void netc_flight_table_init(netc_flight_table *table)
+{
+    memset(table, 0, sizeof(netc_flight_table));
+    for (size_t i = 0; i < NETC_FLIGHT_SHARDS; i++)
+        pthread_mutex_init(&table->shards[i].mutex, NULL);
+}
+
+bool netc_flight_join(netc_flight_table *table, const char *key, size_t length, netc_flight_waiter *waiter,
+                      netc_flight **leading)
+{
+    *leading = NULL;
+    if (table == NULL || key == NULL || waiter == NULL)
+        return false;
+
+    uint64_t hash = netc_hash_fnv1a(key, length);
+    netc_flight_shard *shard = &table->shards[(hash >> 32) % NETC_FLIGHT_SHARDS];
+    netc_flight **bucket = &shard->buckets[hash & (NETC_FLIGHT_BUCKETS - 1)];
+
+    pthread_mutex_lock(&shard->mutex);
+    for (netc_flight *flight = *bucket; flight != NULL; flight = flight->bucket_next)
+    {
+        if (flight->hash == hash && flight->key_length == length && memcmp(flight->key, key, length) == 0)
+        {
+            waiter->next = NULL;
+            if (flight->waiters_tail != NULL)
+                flight->waiters_tail->next = waiter;
+            else
+                flight->waiters_head = waiter;
+            flight->waiters_tail = waiter;
+            flight->waiter_count++;
+            pthread_mutex_unlock(&shard->mutex);
+            return true;
+        }
+    }
+
+    /* without memory the request is simply answered on its own */
+    netc_flight *flight = malloc(sizeof(netc_flight) + length);
+    if (flight != NULL)
+    {
+        flight->shard = shard;
+        flight->hash = hash;
+        flight->key_length = length;
+        flight->waiters_head = NULL;
+        flight->waiters_tail = NULL;
+        flight->waiter_count = 0;
+        memcpy(flight->key, key, length);
+        flight->bucket_next = *bucket;
+        *bucket = flight;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    *leading = flight;
+    return false;
+}
+
+netc_flight_waiter *netc_flight_land(netc_flight *flight)
+{
+    if (flight == NULL) return NULL;
+
+    netc_flight_shard *shard = flight->shard;
+    pthread_mutex_lock(&shard->mutex);
+    netc_flight **link = &shard->buckets[flight->hash & (NETC_FLIGHT_BUCKETS - 1)];
+    while (*link != flight)
+        link = &(*link)->bucket_next;
+    *link = flight->bucket_next;
+    netc_flight_waiter *waiters = flight->waiters_head;
+    pthread_mutex_unlock(&shard->mutex);
+
+    free(flight);
+    return waiters;
+}
+
+void netc_flight_table_destroy(netc_flight_table *table)
+{
+    if (table == NULL) return;
+
+    for (size_t i = 0; i < NETC_FLIGHT_SHARDS; i++)
+    {
+        for (size_t j = 0; j < NETC_FLIGHT_BUCKETS; j++)
+        {
+            netc_flight *flight = table->shards[i].buckets[j];
+            while (flight != NULL)
+            {
+                netc_flight *next = flight->bucket_next;
+                free(flight);
+                flight = next;
+            }
+            table->shards[i].buckets[j] = NULL;
+        }
+        pthread_mutex_destroy(&table->shards[i].mutex);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef NETC_FLIGHT_H
+#define NETC_FLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#define NETC_FLIGHT_SHARDS  16
+#define NETC_FLIGHT_BUCKETS 256
+
+/* a request parked behind an identical one, allocated by its owner */
+typedef struct netc_flight_waiter
+{
+    void                      *data;
+    struct netc_flight_waiter *next;
+} netc_flight_waiter;
+
+/* a request being answered, with the identical ones waiting for it */
+typedef struct netc_flight
+{
+    struct netc_flight_shard  *shard;
+    struct netc_flight        *bucket_next;
+    uint64_t                   hash;
+    size_t                     key_length;
+    netc_flight_waiter        *waiters_head;
+    netc_flight_waiter        *waiters_tail;
+    size_t                     waiter_count;
+    char                       key[];
+} netc_flight;
+
+typedef struct netc_flight_shard
+{
+    pthread_mutex_t            mutex;
+    netc_flight               *buckets[NETC_FLIGHT_BUCKETS];
+} netc_flight_shard;
+
+typedef struct
+{
+    netc_flight_shard          shards[NETC_FLIGHT_SHARDS];
+} netc_flight_table;
+
+/**
+ * @brief prepares an empty table
+ *
+ * @param table pointer to the table to initialize
+ */
+void netc_flight_table_init(netc_flight_table *table);
+
+/**
+ * @brief parks waiter behind the request in flight for key, or starts a
+ * new flight led by the caller when there is none
+ *
+ * @param table pointer to the table
+ * @param key bytes identifying identical requests
+ * @param length length of key
+ * @param waiter queued when a flight exists, must live until it lands
+ * @param leading set to the new flight, NULL when waiter was queued or
+ * on allocation failure
+ * @return true if waiter was queued behind another request
+ * @return false if the caller answers the request itself
+ */
+bool netc_flight_join(netc_flight_table *table, const char *key, size_t length, netc_flight_waiter *waiter,
+                      netc_flight **leading);
+
+/**
+ * @brief ends a flight once its response is known. Requests arriving from
+ * now on start a new flight
+ *
+ * @param flight the flight returned by netc_flight_join, freed here
+ * @return netc_flight_waiter* the waiters in arrival order, NULL if none
+ */
+netc_flight_waiter *netc_flight_land(netc_flight *flight);
+
+/**
+ * @brief frees the flights still in the table, their waiters are dropped
+ *
+ * @param table pointer to the table to destroy
+ */
+void netc_flight_table_destroy(netc_flight_table *table);
+
+#endif // NETC_FLIGHT_H
@@ -0,0 +1,134 @@
+#include "netc_hash.h"
+
+#include <string.h>
+
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+#define FNV1A_OFFSET 14695981039346656037ULL
+#define FNV1A_PRIME  1099511628211ULL
+
+uint64_t hash_rotl(uint64_t value, int bits);
+uint64_t hash_read64(const unsigned char *p);
+uint32_t hash_read32(const unsigned char *p);
+uint64_t hash_round(uint64_t accumulator, uint64_t input);
+uint64_t hash_merge(uint64_t hash, uint64_t accumulator);
+
+uint64_t netc_hash64(const void *data, size_t length, uint64_t seed)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = p + length;
+    uint64_t hash;
+
+    if (length >= 32)
+    {
+        /* four lanes consumed in parallel, 8 bytes each per round */
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        const unsigned char *limit = end - 32;
+        do
+        {
+            v1 = hash_round(v1, hash_read64(p));
+            v2 = hash_round(v2, hash_read64(p + 8));
+            v3 = hash_round(v3, hash_read64(p + 16));
+            v4 = hash_round(v4, hash_read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        hash = hash_rotl(v1, 1) + hash_rotl(v2, 7) + hash_rotl(v3, 12) + hash_rotl(v4, 18);
+        hash = hash_merge(hash, v1);
+        hash = hash_merge(hash, v2);
+        hash = hash_merge(hash, v3);
+        hash = hash_merge(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += (uint64_t)length;
+
+    /* the tail: 8, then 4, then single bytes */
+    while (p + 8 <= end)
+    {
+        hash ^= hash_round(0, hash_read64(p));
+        hash = hash_rotl(hash, 27) * PRIME64_1 + PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end)
+    {
+        hash ^= (uint64_t)hash_read32(p) * PRIME64_1;
+        hash = hash_rotl(hash, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    while (p < end)
+    {
+        hash ^= (*p) * PRIME64_5;
+        hash = hash_rotl(hash, 11) * PRIME64_1;
+        p++;
+    }
+
+    /* avalanche */
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t netc_hash_fnv1a(const void *data, size_t length)
+{
+    const unsigned char *p = data;
+    uint64_t hash = FNV1A_OFFSET;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= p[i];
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+uint64_t hash_rotl(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t hash_read64(const unsigned char *p)
+{
+    /* memcpy keeps unaligned reads legal, the hash is defined little endian */
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+uint32_t hash_read32(const unsigned char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+uint64_t hash_round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * PRIME64_2;
+    accumulator = hash_rotl(accumulator, 31);
+    return accumulator * PRIME64_1;
+}
+
+uint64_t hash_merge(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= hash_round(0, accumulator);
+    return hash * PRIME64_1 + PRIME64_4;
+}
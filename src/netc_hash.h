@@ -0,0 +1,29 @@
+#ifndef NETC_HASH_H
+#define NETC_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief hashes length bytes with XXH64, a fast non-cryptographic hash
+ * reading 32 bytes per round, fit for telling contents apart but not for
+ * resisting someone crafting collisions
+ *
+ * @param data bytes to hash, may be NULL when length is 0
+ * @param length number of bytes
+ * @param seed changes every hash, 0 for the reference values
+ * @return uint64_t the hash
+ */
+uint64_t netc_hash64(const void *data, size_t length, uint64_t seed);
+
+/**
+ * @brief hashes length bytes with 64-bit FNV-1a, one multiply per byte and
+ * no setup, cheaper than netc_hash64 for the short keys of lookup tables
+ *
+ * @param data bytes to hash, may be NULL when length is 0
+ * @param length number of bytes
+ * @return uint64_t the hash
+ */
+uint64_t netc_hash_fnv1a(const void *data, size_t length);
+
+#endif // NETC_HASH_H
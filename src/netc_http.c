@@ -1,30 +1,22 @@
 #include "netc_http.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-
-hashtable *http_hashtable;
-
-void init_http_hashtable()
-{
-    http_hashtable = hashtable_create(hash_int, compare_uint8_t);
-    if (http_hashtable == NULL) exit(EXIT_FAILURE);
-
-    uint16_t key = HTTP_STATUS_OK;
-    hashtable_put(http_hashtable, &key, sizeof(key), "OK", strlen("OK") + 1);
-
-    key = HTTP_STATUS_NOT_FOUND;
-    hashtable_put(http_hashtable, &key, sizeof(key), "Not found", strlen("Not found") + 1);
-
-    key = HTTP_STATUS_INTERNAL_SERVER_ERROR;
-    hashtable_put(http_hashtable, &key, sizeof(key), "Internal server error", strlen("Internal server error") + 1);
-}
-
-void destroy_http_hashtable()
-{
-    hashtable_destroy(http_hashtable);
-}
+#include <strings.h>
+#include <time.h>
+
+int known_header_index(const char *name, size_t length);
+bool etag_list_matches(const char *list, const char *etag);
+bool parse_http_date(const char *value, time_t *time);
+bool if_range_matches(const char *if_range, const char *etag, const char *last_modified);
+bool parse_range_spec(const char **cursor, size_t *first, size_t *last);
+bool parse_range_position(const char **cursor, size_t *position);
+bool set_content_length(http_response *response, size_t length);
+void *response_alloc(http_response *response, size_t size);
+bool grow_headers(http_response *response);
 
 const char *http_methods[] = {
     GET, POST, PUT, DELETE, HEAD, OPTIONS, PATCH, CONNECT, TRACE
@@ -36,113 +28,213 @@ http_request *http_request_parse(const char *raw_request)
 {
     if (raw_request == NULL) return NULL;
 
-    http_request *request = malloc(sizeof(http_request));
-    if (request == NULL) return NULL;
+    /* the parser terminates tokens in place, so it runs on a private copy
+     * that the request keeps pointing into */
+    size_t length = strlen(raw_request);
+    char *buffer = strdup(raw_request);
+    if (buffer == NULL) return NULL;
 
-    uint16_t offset = 0;
-    if (sscanf(raw_request, "%7s %255s %15s\r\n%hn",
-        request->method, request->path, request->version, &offset) != 3)
+    http_parser parser;
+    http_parser_init(&parser);
+    if (http_parser_execute(&parser, buffer, length) != HTTP_PARSE_DONE)
     {
-        free(request);
+        free(buffer);
         return NULL;
     }
 
-    request->headers = hashtable_create(hash_string, compare_string);
-    if (request->headers == NULL)
+    http_request *request = http_request_from_parser(&parser, buffer, length - parser.headers_length, NULL);
+    if (request == NULL)
     {
-        free(request);
+        free(buffer);
         return NULL;
     }
 
-    /* parse headers */
-    const char *headers_start = raw_request + offset;
-    const char *headers_end = strstr(headers_start, "\r\n\r\n");
-    if (headers_end == NULL)
-    {
-        hashtable_destroy(request->headers);
-        free(request);
+    request->owned_buffer = buffer;
+    return request;
+}
+
+http_request *http_request_from_parser(const http_parser *parser, char *buffer, size_t body_length,
+                                       netc_arena *arena)
+{
+    if (parser == NULL || buffer == NULL || parser->state != HTTP_PARSER_DONE)
         return NULL;
-    }
 
-    const char *line_start = headers_start;
-    while (line_start < headers_end)
-    {
-        const char *line_end = strstr(line_start, "\r\n");
-        if (line_end == NULL || line_end > headers_end)
-        {
-            hashtable_destroy(request->headers);
-            free(request);
-            return NULL;
-        }
+    http_request *request = arena != NULL ? netc_arena_alloc(arena, sizeof(http_request))
+                                          : malloc(sizeof(http_request));
+    if (request == NULL) return NULL;
 
-        char key[256] = { 0 }, value[256] = { 0 };
-        if (sscanf(line_start, "%255[^:]: %255[^\r\n]", key, value) != 2)
-        {
-            hashtable_destroy(request->headers);
-            free(request);
-            return NULL;
-        }
+    request->method = buffer + parser->method.offset;
+    request->path = buffer + parser->path.offset;
+    request->version = buffer + parser->version.offset;
+    request->owned_buffer = NULL;
+    request->arena = arena;
+    request->param_count = 0;
+
+    /* names and values are already NUL-terminated in the buffer */
+    memset(request->known_headers, 0, sizeof(request->known_headers));
+    request->header_count = parser->header_count;
+    for (size_t i = 0; i < parser->header_count; i++)
+    {
+        const http_header_view *header = &parser->headers[i];
+        request->headers[i].name = buffer + header->name.offset;
+        request->headers[i].value = buffer + header->value.offset;
 
-        if (hashtable_put(request->headers, key, strlen(key) + 1, value, strlen(value) + 1) == false)
-        {
-            hashtable_destroy(request->headers);
-            free(request);
-            return NULL;
-        }
-        line_start = line_end + 2;
+        int known = known_header_index(request->headers[i].name, header->name.length);
+        if (known >= 0 && request->known_headers[known] == NULL)
+            request->known_headers[known] = request->headers[i].value;
     }
 
-    /* parse body */
-    const char *body_start = headers_end + 4;
-    if (*body_start == '\0')
+    request->body_length = body_length;
+    request->body = body_length > 0 ? buffer + parser->headers_length : NULL;
+    request->body_state = HTTP_BODY_COMPLETE;
+    request->user_data = NULL;
+
+    return request;
+}
+
+const char *http_request_get_header(const http_request *request, const char *header_name)
+{
+    if (request == NULL || header_name == NULL)
+        return NULL;
+
+    int known = known_header_index(header_name, strlen(header_name));
+    if (known >= 0)
+        return request->known_headers[known];
+
+    for (size_t i = 0; i < request->header_count; i++)
     {
-        request->body = NULL;
+        if (strcasecmp(request->headers[i].name, header_name) == 0)
+            return request->headers[i].value;
     }
-    else
+
+    return NULL;
+}
+
+const char *http_request_get_known_header(const http_request *request, http_known_header header)
+{
+    if (request == NULL || header < 0 || header >= HTTP_KNOWN_HEADER_COUNT)
+        return NULL;
+
+    return request->known_headers[header];
+}
+
+const char *http_request_get_param(const http_request *request, const char *name, size_t *length)
+{
+    if (request == NULL || name == NULL || length == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < request->param_count; i++)
     {
-        request->body = strdup(body_start);
-        if (request->body == NULL)
+        if (strcmp(request->params[i].name, name) == 0)
         {
-            hashtable_destroy(request->headers);
-            free(request);
-            return NULL;
+            *length = request->params[i].length;
+            return request->params[i].value;
         }
     }
 
-    return request;
+    return NULL;
 }
 
-void *http_request_get_header(const http_request *request, const char *header_name)
+void http_request_free(http_request *request)
 {
-    if (request == NULL || header_name == NULL)
-        return NULL;
+    if (request == NULL) return;
 
-    return hashtable_get(request->headers, header_name);
+    free(request->owned_buffer);
+    if (request->arena == NULL)
+        free(request);
 }
 
-void http_request_free(http_request *request)
+const char *http_status_text(const uint16_t status_code)
 {
-    if (request == NULL) return;
+    switch (status_code)
+    {
+    case HTTP_STATUS_OK:                    return "OK";
+    case HTTP_STATUS_PARTIAL_CONTENT:       return "Partial content";
+    case HTTP_STATUS_NOT_MODIFIED:          return "Not modified";
+    case HTTP_STATUS_BAD_REQUEST:           return "Bad request";
+    case HTTP_STATUS_NOT_FOUND:             return "Not found";
+    case HTTP_STATUS_METHOD_NOT_ALLOWED:    return "Method not allowed";
+    case HTTP_STATUS_PAYLOAD_TOO_LARGE:     return "Payload too large";
+    case HTTP_STATUS_RANGE_NOT_SATISFIABLE: return "Range not satisfiable";
+    case HTTP_STATUS_HEADERS_TOO_LARGE:     return "Request header fields too large";
+    case HTTP_STATUS_INTERNAL_SERVER_ERROR: return "Internal server error";
+    default:                                return NULL;
+    }
+}
+
+void http_format_etag(uint64_t hash, char *etag)
+{
+    snprintf(etag, HTTP_ETAG_SIZE, "\"%016llx\"", (unsigned long long)hash);
+}
 
-    hashtable_destroy(request->headers);
-    free(request->body);
-    free(request);
+const char *http_content_type(const char *path)
+{
+    static const struct { const char *extension; const char *type; } types[] = {
+        { "html",  "text/html; charset=utf-8" },
+        { "htm",   "text/html; charset=utf-8" },
+        { "css",   "text/css; charset=utf-8" },
+        { "js",    "text/javascript; charset=utf-8" },
+        { "mjs",   "text/javascript; charset=utf-8" },
+        { "json",  "application/json" },
+        { "txt",   "text/plain; charset=utf-8" },
+        { "csv",   "text/csv; charset=utf-8" },
+        { "xml",   "application/xml" },
+        { "svg",   "image/svg+xml" },
+        { "png",   "image/png" },
+        { "jpg",   "image/jpeg" },
+        { "jpeg",  "image/jpeg" },
+        { "gif",   "image/gif" },
+        { "webp",  "image/webp" },
+        { "avif",  "image/avif" },
+        { "ico",   "image/x-icon" },
+        { "wasm",  "application/wasm" },
+        { "pdf",   "application/pdf" },
+        { "zip",   "application/zip" },
+        { "gz",    "application/gzip" },
+        { "woff",  "font/woff" },
+        { "woff2", "font/woff2" },
+        { "ttf",   "font/ttf" },
+        { "mp3",   "audio/mpeg" },
+        { "mp4",   "video/mp4" },
+        { "webm",  "video/webm" },
+    };
+
+    const char *fallback = "application/octet-stream";
+    if (path == NULL) return fallback;
+
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL || strchr(dot, '/') != NULL)
+        return fallback;
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        if (strcasecmp(dot + 1, types[i].extension) == 0)
+            return types[i].type;
+    }
+    return fallback;
 }
 
 bool http_response_default(http_response *response)
+{
+    return http_response_default_with_arena(response, NULL);
+}
+
+bool http_response_default_with_arena(http_response *response, netc_arena *arena)
 {
     if (response == NULL) return false;
 
     response->status_code = HTTP_STATUS_OK;
-    response->status_text = hashtable_get(http_hashtable, &response->status_code);
-
-    response->headers = hashtable_create(hash_string, compare_string);
-    if (response->headers == NULL) return false;
-
-    hashtable_put(response->headers, "Server", strlen("Server") + 1, "NetC", strlen("NetC") + 1);
-
+    response->status_text = http_status_text(HTTP_STATUS_OK);
+    response->headers = NULL;
+    response->header_count = 0;
+    response->header_capacity = 0;
     response->body = NULL;
-    return true;
+    response->body_length = 0;
+    response->body_borrowed = false;
+    response->arena = arena;
+
+    return http_response_add_header(response, "Server", "NetC") &&
+           http_response_add_header(response, "Date", netc_clock_now()->http_date);
 }
 
 bool http_response_set_status(http_response *response, const uint16_t status_code)
@@ -151,8 +243,7 @@ bool http_response_set_status(http_response *response, const uint16_t status_cod
         return false;
 
     response->status_code = status_code;
-    free(response->status_text);
-    response->status_text = hashtable_get(http_hashtable, &response->status_code);
+    response->status_text = http_status_text(status_code);
 
     return response->status_text != NULL ? true : false;
 }
@@ -163,7 +254,51 @@ bool http_response_add_header(http_response *response,
     if (response == NULL || key == NULL || value == NULL)
         return false;
 
-    return hashtable_put(response->headers, key, strlen(key) + 1, value, strlen(value) + 1);
+    /* name and value share one allocation, the name comes first */
+    size_t key_length = strlen(key), value_length = strlen(value);
+    char *field = response_alloc(response, key_length + value_length + 2);
+    if (field == NULL) return false;
+
+    memcpy(field, key, key_length + 1);
+    memcpy(field + key_length + 1, value, value_length + 1);
+
+    for (size_t i = 0; i < response->header_count; i++)
+    {
+        if (strcasecmp(response->headers[i].name, key) == 0)
+        {
+            if (response->arena == NULL)
+                free((char*)response->headers[i].name);
+            response->headers[i].name = field;
+            response->headers[i].value = field + key_length + 1;
+            return true;
+        }
+    }
+
+    if (response->header_count == response->header_capacity && grow_headers(response) == false)
+    {
+        if (response->arena == NULL)
+            free(field);
+        return false;
+    }
+
+    response->headers[response->header_count].name = field;
+    response->headers[response->header_count].value = field + key_length + 1;
+    response->header_count++;
+    return true;
+}
+
+const char *http_response_get_header(const http_response *response, const char *key)
+{
+    if (response == NULL || key == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < response->header_count; i++)
+    {
+        if (strcasecmp(response->headers[i].name, key) == 0)
+            return response->headers[i].value;
+    }
+
+    return NULL;
 }
 
 bool http_response_add_body(http_response *response, const char *body)
@@ -172,46 +307,203 @@ bool http_response_add_body(http_response *response, const char *body)
         return false;
 
     size_t content_length = strlen(body);
-    response->body = malloc(content_length + 1);
-    if (response->body == NULL) return false;
+    char *copy = response_alloc(response, content_length + 1);
+    if (copy == NULL) return false;
 
-    strcpy(response->body, body);
+    memcpy(copy, body, content_length + 1);
+    /* an arena copy is reclaimed with the arena, the response only borrows it */
+    if (response->arena != NULL)
+        return http_response_set_static_body(response, copy, content_length);
 
-    char content_length_str[20];
-    snprintf(content_length_str, sizeof(content_length_str), "%zu", content_length);
-    return hashtable_put(response->headers, "Content-Length", strlen("Content-Length") + 1, content_length_str, strlen(content_length_str) + 1);
+    if (http_response_set_body(response, copy, content_length) == false)
+    {
+        free(copy);
+        return false;
+    }
+    return true;
 }
 
-char *http_response_to_string(const http_response *response)
+bool http_response_set_body(http_response *response, char *body, size_t length)
 {
-    if (response == NULL) return NULL;
+    if (response == NULL || body == NULL || set_content_length(response, length) == false)
+        return false;
 
-    char *response_string = malloc(1024);
-    if (response_string == NULL) return NULL;
+    if (response->body_borrowed == false)
+        free(response->body);
+    response->body = body;
+    response->body_length = length;
+    response->body_borrowed = false;
+    return true;
+}
 
-    int offset = snprintf(response_string, 1024, "HTTP/1.1 %d %s\r\n",
-                          response->status_code, response->status_text);
-    if (offset < 0) return NULL;
+bool http_response_set_static_body(http_response *response, const char *body, size_t length)
+{
+    if (response == NULL || body == NULL || set_content_length(response, length) == false)
+        return false;
+
+    if (response->body_borrowed == false)
+        free(response->body);
+    response->body = (char*)body;
+    response->body_length = length;
+    response->body_borrowed = true;
+    return true;
+}
+
+bool http_request_not_modified(const http_request *request, const char *etag, const char *last_modified)
+{
+    if (request == NULL || (strcmp(request->method, GET) != 0 && strcmp(request->method, HEAD) != 0))
+        return false;
+
+    const char *if_none_match = http_request_get_header(request, "If-None-Match");
+    if (if_none_match != NULL)
+        return etag != NULL && etag_list_matches(if_none_match, etag);
+
+    const char *if_modified_since = http_request_get_header(request, "If-Modified-Since");
+    time_t since, modified;
+    if (if_modified_since == NULL || last_modified == NULL ||
+        parse_http_date(if_modified_since, &since) == false || parse_http_date(last_modified, &modified) == false)
+        return false;
+    return modified <= since;
+}
+
+http_range_result http_request_ranges(const http_request *request, size_t size, const char *etag,
+                                      const char *last_modified, http_range *ranges, size_t *count)
+{
+    *count = 0;
+    if (request == NULL || strcmp(request->method, GET) != 0)
+        return HTTP_RANGE_NONE;
+
+    const char *range = http_request_get_header(request, "Range");
+    if (range == NULL || strncasecmp(range, "bytes=", 6) != 0)
+        return HTTP_RANGE_NONE;
+
+    /* the client copy the missing bytes would complete is out of date */
+    const char *if_range = http_request_get_header(request, "If-Range");
+    if (if_range != NULL && if_range_matches(if_range, etag, last_modified) == false)
+        return HTTP_RANGE_NONE;
+
+    /* any malformed range makes the whole header invalid, it is ignored */
+    const char *cursor = range + 6;
+    size_t asked = 0, total = 0;
+    while (*cursor != '\0')
+    {
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == ',')
+            cursor++;
+        if (*cursor == '\0')
+            break;
+
+        size_t first = 0, last = SIZE_MAX;
+        bool suffix = *cursor == '-';
+        if (++asked > HTTP_MAX_RANGES || parse_range_spec(&cursor, &first, &last) == false)
+        {
+            *count = 0;
+            return HTTP_RANGE_NONE;
+        }
 
-    /* add headers */
-    char **keys = (char**)hashtable_keyset(response->headers);
-    for (size_t i = 0; keys[i] != NULL; i++)
+        /* a suffix asks for the last bytes, a range past the end for none */
+        if (suffix)
+        {
+            if (last == 0 || size == 0)
+                continue;
+            first = last < size ? size - last : 0;
+            last = size - 1;
+        }
+        if (first >= size)
+            continue;
+        if (last >= size)
+            last = size - 1;
+        ranges[*count].offset = first;
+        ranges[*count].length = last - first + 1;
+        total += ranges[*count].length;
+        (*count)++;
+    }
+
+    /* overlapping ranges adding up to more than the whole are not worth it */
+    if (asked == 0 || total > size)
     {
-        char *value = hashtable_get(response->headers, keys[i]);
-        int written = snprintf(response_string + offset, 1024 - offset, "%s: %s\r\n", keys[i], value);
-        if (written < 0) return NULL;
-        offset += written;
-        free(value);
+        *count = 0;
+        return HTTP_RANGE_NONE;
     }
-    free(keys);
+    return *count > 0 ? HTTP_RANGE_SATISFIABLE : HTTP_RANGE_NOT_SATISFIABLE;
+}
+
+bool http_response_add_etag(http_response *response)
+{
+    if (response == NULL)
+        return false;
+    if (http_response_get_header(response, "ETag") != NULL)
+        return true;
+
+    char etag[HTTP_ETAG_SIZE];
+    http_format_etag(netc_hash64(response->body, response->body_length, 0), etag);
+    return http_response_add_header(response, "ETag", etag);
+}
+
+void http_response_set_not_modified(http_response *response)
+{
+    if (response == NULL) return;
+
+    http_response_set_status(response, HTTP_STATUS_NOT_MODIFIED);
+    if (response->body_borrowed == false)
+        free(response->body);
+    response->body = NULL;
+    response->body_length = 0;
+    response->body_borrowed = false;
+}
 
-    /* add body */
-    if (response->body != NULL)
+size_t http_response_write_head(const http_response *response, char *buffer, size_t capacity)
+{
+    if (response == NULL) return 0;
+
+    char status_line[64];
+    int status_length = snprintf(status_line, sizeof(status_line), "HTTP/1.1 %d %s\r\n", response->status_code,
+                                 response->status_text != NULL ? response->status_text : "");
+    if (status_length < 0 || (size_t)status_length >= sizeof(status_line))
+        return 0;
+
+    size_t length = status_length + 2;
+    for (size_t i = 0; i < response->header_count; i++)
+        length += strlen(response->headers[i].name) + strlen(response->headers[i].value) + 4;
+
+    if (buffer == NULL || capacity < length)
+        return length;
+
+    char *cursor = buffer;
+    memcpy(cursor, status_line, status_length);
+    cursor += status_length;
+    for (size_t i = 0; i < response->header_count; i++)
     {
-        int written = snprintf(response_string + offset, 1024 - offset, "\r\n%s", response->body);
-        if (written < 0) return NULL;
-        offset += written;
+        size_t name_length = strlen(response->headers[i].name);
+        size_t value_length = strlen(response->headers[i].value);
+        memcpy(cursor, response->headers[i].name, name_length);
+        cursor += name_length;
+        *cursor++ = ':';
+        *cursor++ = ' ';
+        memcpy(cursor, response->headers[i].value, value_length);
+        cursor += value_length;
+        *cursor++ = '\r';
+        *cursor++ = '\n';
     }
+    *cursor++ = '\r';
+    *cursor++ = '\n';
+
+    return length;
+}
+
+char *http_response_to_string(const http_response *response)
+{
+    if (response == NULL) return NULL;
+
+    size_t head_length = http_response_write_head(response, NULL, 0);
+    if (head_length == 0) return NULL;
+
+    char *response_string = malloc(head_length + response->body_length + 1);
+    if (response_string == NULL) return NULL;
+
+    http_response_write_head(response, response_string, head_length);
+    if (response->body_length > 0)
+        memcpy(response_string + head_length, response->body, response->body_length);
+    response_string[head_length + response->body_length] = '\0';
 
     return response_string;
 }
@@ -220,7 +512,164 @@ void http_response_free(http_response *response)
 {
     if (response == NULL) return;
 
-    free(response->status_text);
-    hashtable_destroy(response->headers);
-    free(response->body);
+    if (response->arena == NULL)
+    {
+        for (size_t i = 0; i < response->header_count; i++)
+            free((char*)response->headers[i].name);
+        free(response->headers);
+    }
+    if (response->body_borrowed == false)
+        free(response->body);
+
+    response->headers = NULL;
+    response->header_count = 0;
+    response->header_capacity = 0;
+    response->body = NULL;
+    response->body_length = 0;
+}
+
+int known_header_index(const char *name, size_t length)
+{
+    /* the length alone tells the well-known names apart */
+    switch (length)
+    {
+    case 4:
+        return strcasecmp(name, "Host") == 0 ? HTTP_HEADER_HOST : -1;
+    case 10:
+        return strcasecmp(name, "Connection") == 0 ? HTTP_HEADER_CONNECTION : -1;
+    case 12:
+        return strcasecmp(name, "Content-Type") == 0 ? HTTP_HEADER_CONTENT_TYPE : -1;
+    case 14:
+        return strcasecmp(name, "Content-Length") == 0 ? HTTP_HEADER_CONTENT_LENGTH : -1;
+    default:
+        return -1;
+    }
+}
+
+bool set_content_length(http_response *response, size_t length)
+{
+    char content_length_str[24];
+    snprintf(content_length_str, sizeof(content_length_str), "%zu", length);
+    return http_response_add_header(response, "Content-Length", content_length_str);
+}
+
+void *response_alloc(http_response *response, size_t size)
+{
+    return response->arena != NULL ? netc_arena_alloc(response->arena, size) : malloc(size);
+}
+
+bool grow_headers(http_response *response)
+{
+    size_t capacity = response->header_capacity ? response->header_capacity * 2 : 8;
+    if (response->arena == NULL)
+    {
+        http_header *temp = realloc(response->headers, capacity * sizeof(http_header));
+        if (temp == NULL) return false;
+        response->headers = temp;
+        response->header_capacity = capacity;
+        return true;
+    }
+
+    /* the old array is left behind in the arena */
+    http_header *headers = netc_arena_alloc(response->arena, capacity * sizeof(http_header));
+    if (headers == NULL) return false;
+    if (response->header_count > 0)
+        memcpy(headers, response->headers, response->header_count * sizeof(http_header));
+    response->headers = headers;
+    response->header_capacity = capacity;
+    return true;
+}
+
+bool etag_list_matches(const char *list, const char *etag)
+{
+    /* If-None-Match compares weakly: a W/ prefix is ignored on both sides */
+    if (strncmp(etag, "W/", 2) == 0)
+        etag += 2;
+    size_t etag_length = strlen(etag);
+
+    while (*list != '\0')
+    {
+        while (*list == ' ' || *list == ',')
+            list++;
+        size_t length = strcspn(list, ",");
+        while (length > 0 && list[length - 1] == ' ')
+            length--;
+        if (length == 0)
+            break;
+
+        const char *tag = list;
+        list += length;
+        if (length == 1 && tag[0] == '*')
+            return true;
+        if (length > 2 && strncmp(tag, "W/", 2) == 0)
+        {
+            tag += 2;
+            length -= 2;
+        }
+        if (length == etag_length && memcmp(tag, etag, length) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool if_range_matches(const char *if_range, const char *etag, const char *last_modified)
+{
+    /* If-Range compares strongly: a weak tag never matches */
+    if (if_range[0] == '"')
+        return etag != NULL && strncmp(etag, "W/", 2) != 0 && strcmp(if_range, etag) == 0;
+
+    time_t since, modified;
+    return last_modified != NULL && parse_http_date(if_range, &since) && parse_http_date(last_modified, &modified) &&
+           since == modified;
+}
+
+bool parse_range_spec(const char **cursor, size_t *first, size_t *last)
+{
+    /* first-last, first- up to the end, or -length for a suffix, whose
+     * length is returned in last */
+    const char *p = *cursor;
+    bool suffix = *p == '-';
+    if (suffix == false && parse_range_position(&p, first) == false)
+        return false;
+    if (*p++ != '-')
+        return false;
+    if (*p >= '0' && *p <= '9' && parse_range_position(&p, last) == false)
+        return false;
+    if ((suffix && *last == SIZE_MAX) || (suffix == false && *last < *first))
+        return false;
+
+    while (*p == ' ' || *p == '\t')
+        p++;
+    if (*p != ',' && *p != '\0')
+        return false;
+    *cursor = p;
+    return true;
+}
+
+bool parse_range_position(const char **cursor, size_t *position)
+{
+    const char *p = *cursor;
+    if (*p < '0' || *p > '9')
+        return false;
+
+    size_t value = 0;
+    for (; *p >= '0' && *p <= '9'; p++)
+    {
+        if (value > (SIZE_MAX - 9) / 10)
+            return false;
+        value = value * 10 + (*p - '0');
+    }
+    *position = value;
+    *cursor = p;
+    return true;
+}
+
+bool parse_http_date(const char *value, time_t *time)
+{
+    struct tm tm = { 0 };
+    const char *end = strptime(value, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == NULL)
+        return false;
+    *time = timegm(&tm);
+    return *time != (time_t)-1;
 }
@@ -2,7 +2,9 @@
 #define NETC_HTTP_H
 
 #include <stdint.h>
-#include <hashtable.h>
+#include <stdbool.h>
+#include "netc_http_parser.h"
+#include "netc_arena.h"
 
 #define GET     "GET"
 #define POST    "POST"
@@ -15,32 +17,136 @@
 #define TRACE   "TRACE"
 
 #define HTTP_STATUS_OK                    (uint16_t) 200
+#define HTTP_STATUS_PARTIAL_CONTENT       (uint16_t) 206
+#define HTTP_STATUS_NOT_MODIFIED          (uint16_t) 304
+#define HTTP_STATUS_BAD_REQUEST           (uint16_t) 400
 #define HTTP_STATUS_NOT_FOUND             (uint16_t) 404
+#define HTTP_STATUS_METHOD_NOT_ALLOWED    (uint16_t) 405
+#define HTTP_STATUS_PAYLOAD_TOO_LARGE     (uint16_t) 413
+#define HTTP_STATUS_RANGE_NOT_SATISFIABLE (uint16_t) 416
+#define HTTP_STATUS_HEADERS_TOO_LARGE     (uint16_t) 431
 #define HTTP_STATUS_INTERNAL_SERVER_ERROR (uint16_t) 500
 
+/* a quoted 16 digit hex hash and the terminator */
+#define HTTP_ETAG_SIZE 19
+
+/* a Range header asking for more ranges is answered with the whole
+ * representation */
+#define HTTP_MAX_RANGES 16
+
 extern const char *http_methods[];
 extern const uint8_t http_methods_count;
-extern hashtable *http_hashtable;
 
+typedef enum
+{
+    HTTP_HEADER_HOST,
+    HTTP_HEADER_CONTENT_LENGTH,
+    HTTP_HEADER_CONNECTION,
+    HTTP_HEADER_CONTENT_TYPE,
+    HTTP_KNOWN_HEADER_COUNT
+} http_known_header;
+
+typedef struct
+{
+    const char *name;
+    const char *value;
+} http_header;
+
+#define HTTP_MAX_PATH_PARAMS 8
+
+/* a parameter captured from the path by the router: name is NUL-terminated,
+ * value is a view of length bytes into the request path */
 typedef struct
 {
-    char       method[8];
-    char       path[256];
-    char       version[16];
-    hashtable *headers;
-    char      *body;
+    const char *name;
+    const char *value;
+    size_t      length;
+} http_path_param;
+
+/* how much of the body a request carries: all of it, or for endpoints
+ * streaming their body the piece that just arrived, with more to come or
+ * not coming because the body was rejected */
+typedef enum
+{
+    HTTP_BODY_COMPLETE,
+    HTTP_BODY_PARTIAL,
+    HTTP_BODY_ABORTED
+} http_body_state;
+
+/* bytes of a representation asked for by a Range header */
+typedef struct
+{
+    size_t offset;
+    size_t length;
+} http_range;
+
+/* how a request with a Range header is answered: with the whole
+ * representation when it has none, an invalid one or one that If-Range
+ * discards, with the ranges in a 206, or with a 416 */
+typedef enum
+{
+    HTTP_RANGE_NONE,
+    HTTP_RANGE_SATISFIABLE,
+    HTTP_RANGE_NOT_SATISFIABLE
+} http_range_result;
+
+/* every string of a request borrows from the buffer it was parsed from */
+typedef struct
+{
+    const char  *method;
+    const char  *path;
+    const char  *version;
+    http_header  headers[HTTP_PARSER_MAX_HEADERS];
+    size_t       header_count;
+    const char  *known_headers[HTTP_KNOWN_HEADER_COUNT];
+    http_path_param params[HTTP_MAX_PATH_PARAMS];
+    size_t       param_count;
+    char        *body;
+    size_t       body_length;
+    http_body_state body_state;
+    void        *user_data;
+    char        *owned_buffer;
+    netc_arena  *arena;
 } http_request;
 
 typedef struct
 {
-    uint16_t   status_code;
-    char      *status_text;
-    hashtable *headers;
-    char      *body;
+    uint16_t     status_code;
+    const char  *status_text;
+    http_header *headers;
+    size_t       header_count;
+    size_t       header_capacity;
+    char        *body;
+    size_t       body_length;
+    bool         body_borrowed;
+    netc_arena  *arena;
 } http_response;
 
-__attribute__((constructor)) void init_http_hashtable();
-__attribute__((destructor))  void destroy_http_hashtable();
+/**
+ * @brief returns the reason phrase of a status code
+ *
+ * @param status_code status code to describe
+ * @return const char* static string, NULL for unknown codes
+ */
+const char *http_status_text(const uint16_t status_code);
+
+/**
+ * @brief guesses the media type of a file from the extension of its path,
+ * text types carry a utf-8 charset
+ *
+ * @param path path or file name, NUL-terminated
+ * @return const char* static string, application/octet-stream when the
+ * extension is unknown
+ */
+const char *http_content_type(const char *path);
+
+/**
+ * @brief formats a hash as a strong entity tag, quotes included
+ *
+ * @param hash hash of the representation
+ * @param etag destination of HTTP_ETAG_SIZE bytes
+ */
+void http_format_etag(uint64_t hash, char *etag);
 
 /**
  * @brief reads an http request from a raw string and returns a structured
@@ -54,14 +160,86 @@ __attribute__((destructor))  void destroy_http_hashtable();
 http_request *http_request_parse(const char *raw_request);
 
 /**
- * @brief get a copy of the header value. If not NULL, the returned pointer
- * must be freed by the caller
+ * @brief builds a request from the views recorded by a parser that has
+ * parsed the whole head of a request. Nothing is copied: the request points
+ * into buffer, which must outlive it. The body, if any, must directly follow
+ * the headers in buffer and be NUL-terminated. If not NULL, the returned
+ * pointer must be freed by the caller; when taken from an arena it is
+ * reclaimed with the arena instead
+ *
+ * @param parser pointer to a parser that returned HTTP_PARSE_DONE
+ * @param buffer the buffer the parser ran on
+ * @param body_length number of body bytes following the headers
+ * @param arena arena to allocate the request from, NULL for the heap
+ * @return http_request* a pointer to a http_request object, or NULL on
+ * invalid arguments or allocation failure
+ */
+http_request *http_request_from_parser(const http_parser *parser, char *buffer, size_t body_length,
+                                       netc_arena *arena);
+
+/**
+ * @brief finds a header value, ignoring the case of the name. The returned
+ * pointer is borrowed from the request and must not be freed
  *
  * @param request pointer to the request where to find the header
  * @param header_name string containing the header name
- * @return void* pointer to the copy of the value, NULL on error
+ * @return const char* the header value, NULL if missing or on error
+ */
+const char *http_request_get_header(const http_request *request, const char *header_name);
+
+/**
+ * @brief returns one of the headers indexed while building the request,
+ * without searching. The returned pointer is borrowed from the request and
+ * must not be freed
+ *
+ * @param request pointer to the request where to find the header
+ * @param header which well-known header to return
+ * @return const char* the header value, NULL if missing or on error
+ */
+const char *http_request_get_known_header(const http_request *request, http_known_header header);
+
+/**
+ * @brief finds a parameter the router captured from the path, e.g. "id"
+ * for a route registered as /users/:id or the name following '*' for a
+ * wildcard ("*" when unnamed). The value is not NUL-terminated
+ *
+ * @param request pointer to the routed request
+ * @param name name of the parameter
+ * @param length set to the length of the value
+ * @return const char* start of the value inside the path, NULL if missing
+ */
+const char *http_request_get_param(const http_request *request, const char *name, size_t *length);
+
+/**
+ * @brief evaluates the If-None-Match and If-Modified-Since headers of a GET
+ * or HEAD request against the validators of the current representation.
+ * If-Modified-Since is ignored when If-None-Match is present
+ *
+ * @param request pointer to the request
+ * @param etag entity tag of the representation, NULL if it has none
+ * @param last_modified its Last-Modified date, NULL if unknown
+ * @return true if the client copy is current and 304 can be answered
+ */
+bool http_request_not_modified(const http_request *request, const char *etag, const char *last_modified);
+
+/**
+ * @brief reads the Range header of a GET request for a representation of
+ * size bytes. Ranges past the end are dropped and those reaching past it
+ * are shortened. The header is ignored when malformed, when it asks for
+ * more than HTTP_MAX_RANGES ranges or for more bytes than size in total, and
+ * when an If-Range header matches neither etag nor last_modified
+ *
+ * @param request pointer to the request
+ * @param size length of the representation
+ * @param etag entity tag of the representation, NULL if it has none
+ * @param last_modified its Last-Modified date, NULL if unknown
+ * @param ranges destination of HTTP_MAX_RANGES ranges, in the order asked
+ * @param count set to the number of ranges kept
+ * @return http_range_result HTTP_RANGE_SATISFIABLE when ranges hold at
+ * least one range
  */
-void *http_request_get_header(const http_request *request, const char *header_name);
+http_range_result http_request_ranges(const http_request *request, size_t size, const char *etag,
+                                      const char *last_modified, http_range *ranges, size_t *count);
 
 /**
  * @brief frees memory taken by a request
@@ -79,6 +257,18 @@ void http_request_free(http_request *request);
  */
 bool http_response_default(http_response *response);
 
+/**
+ * @brief like http_response_default, but the headers and the bodies copied
+ * by http_response_add_body are allocated from arena. They stay valid until
+ * the arena is reset, which must not happen before the response is sent
+ *
+ * @param response pointer to the response to edit
+ * @param arena arena to allocate from, NULL for the heap
+ * @return true on success
+ * @return false on failure
+ */
+bool http_response_default_with_arena(http_response *response, netc_arena *arena);
+
 /**
  * @brief edit the status code and sets the relative status
  * text based on the status_code argument
@@ -91,7 +281,8 @@ bool http_response_default(http_response *response);
 bool http_response_set_status(http_response *response, const uint16_t status_code);
 
 /**
- * @brief add a key-value pair for the headers hashtable
+ * @brief add a header to the response, replacing the value of a header
+ * with the same name. Headers are sent in the order they were first added
  *
  * @param resonse pointer to the response to edit
  * @param key name of the header
@@ -102,6 +293,16 @@ bool http_response_set_status(http_response *response, const uint16_t status_cod
 bool http_response_add_header(http_response *resonse,
                               const char *key, const char *value);
 
+/**
+ * @brief finds a response header, ignoring the case of the name
+ *
+ * @param response pointer to the response to search
+ * @param key name of the header
+ * @return const char* the header value owned by the response, NULL if
+ * missing or on error
+ */
+const char *http_response_get_header(const http_response *response, const char *key);
+
 /**
  * @brief add a body to the response
  *
@@ -112,10 +313,67 @@ bool http_response_add_header(http_response *resonse,
  */
 bool http_response_add_body(http_response *response, const char *body);
 
+/**
+ * @brief sets the body of the response without copying it and sets the
+ * Content-Length header. The response takes ownership of body, which must
+ * be heap allocated
+ *
+ * @param response pointer to the response to edit
+ * @param body heap allocated body, may contain any byte
+ * @param length number of bytes in body
+ * @return true on success
+ * @return false on failure
+ */
+bool http_response_set_body(http_response *response, char *body, size_t length);
+
+/**
+ * @brief like http_response_set_body, but the body is only borrowed: it is
+ * never freed and must stay valid until the response has been sent, e.g. a
+ * static or long-lived buffer
+ *
+ * @param response pointer to the response to edit
+ * @param body body bytes, may contain any byte
+ * @param length number of bytes in body
+ * @return true on success
+ * @return false on failure
+ */
+bool http_response_set_static_body(http_response *response, const char *body, size_t length);
+
+/**
+ * @brief adds a strong ETag header hashing the body with netc_hash64,
+ * unless the response already has one
+ *
+ * @param response pointer to the response to edit
+ * @return true if the response has an ETag header
+ * @return false on invalid arguments or allocation failure
+ */
+bool http_response_add_etag(http_response *response);
+
+/**
+ * @brief turns the response into a 304 Not modified: the body is dropped,
+ * the headers are kept, Content-Length still telling the length of the
+ * representation
+ *
+ * @param response pointer to the response to edit
+ */
+void http_response_set_not_modified(http_response *response);
+
+/**
+ * @brief writes the status line, the headers and the blank line ending them
+ * into buffer. Like snprintf nothing is written when the buffer is too
+ * small, so the caller can grow it and retry
+ *
+ * @param response pointer to the response to serialize
+ * @param buffer destination buffer
+ * @param capacity size of buffer in bytes
+ * @return size_t number of bytes the head takes, 0 on invalid arguments
+ */
+size_t http_response_write_head(const http_response *response, char *buffer, size_t capacity);
+
 /**
  * @brief return a string in the correct http format based on the
- * response data. If not NULL, the returned pointer must be freed
- * by the caller
+ * response data, head and body copied together. If not NULL, the returned
+ * pointer must be freed by the caller
  *
  * @param response pointer to the response to get the data from
  * @return char* pointer to the allocated string response
@@ -0,0 +1,439 @@
+#include "netc_http_parser.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTTP_PARSER_X86
+#endif
+
+typedef size_t (*scan_function)(const char *buffer, size_t offset, size_t length);
+
+bool is_token_char(unsigned char c);
+size_t scan_token_scalar(const char *buffer, size_t offset, size_t length);
+size_t scan_path_scalar(const char *buffer, size_t offset, size_t length);
+size_t scan_header_value_scalar(const char *buffer, size_t offset, size_t length);
+#ifdef HTTP_PARSER_X86
+size_t scan_token_sse42(const char *buffer, size_t offset, size_t length);
+size_t scan_path_sse42(const char *buffer, size_t offset, size_t length);
+size_t scan_header_value_sse42(const char *buffer, size_t offset, size_t length);
+size_t scan_token_avx2(const char *buffer, size_t offset, size_t length);
+size_t scan_path_avx2(const char *buffer, size_t offset, size_t length);
+size_t scan_header_value_avx2(const char *buffer, size_t offset, size_t length);
+#endif
+http_view make_view(size_t start, size_t end);
+bool is_valid_version(const char *version, size_t length);
+
+/* tchar from RFC 9110: the bytes allowed in methods and header names */
+const bool http_token_chars[256] = {
+    ['!'] = true, ['#'] = true, ['$'] = true, ['%'] = true, ['&'] = true,
+    ['\''] = true, ['*'] = true, ['+'] = true, ['-'] = true, ['.'] = true,
+    ['^'] = true, ['_'] = true, ['`'] = true, ['|'] = true, ['~'] = true,
+    ['0' ... '9'] = true, ['A' ... 'Z'] = true, ['a' ... 'z'] = true
+};
+
+/* the same set split by nibble for pshufb lookups: bit h of
+ * token_low_nibbles[l] is set when byte (h << 4 | l) is a token char */
+uint8_t token_low_nibbles[16];
+uint8_t token_high_nibbles[16];
+
+scan_function scan_token = scan_token_scalar;
+scan_function scan_path = scan_path_scalar;
+scan_function scan_header_value = scan_header_value_scalar;
+
+void init_http_parser_simd()
+{
+    for (unsigned c = 0; c < 128; c++)
+    {
+        if (http_token_chars[c])
+            token_low_nibbles[c & 0x0f] |= 1 << (c >> 4);
+    }
+    for (unsigned high = 0; high < 8; high++)
+        token_high_nibbles[high] = 1 << high;
+
+    http_parser_select_simd(HTTP_PARSER_SIMD_AVX2);
+}
+
+http_parser_simd http_parser_select_simd(http_parser_simd level)
+{
+#ifdef HTTP_PARSER_X86
+    __builtin_cpu_init();
+    if (level >= HTTP_PARSER_SIMD_AVX2 && __builtin_cpu_supports("avx2"))
+    {
+        scan_token = scan_token_avx2;
+        scan_path = scan_path_avx2;
+        scan_header_value = scan_header_value_avx2;
+        return HTTP_PARSER_SIMD_AVX2;
+    }
+    if (level >= HTTP_PARSER_SIMD_SSE42 && __builtin_cpu_supports("sse4.2"))
+    {
+        scan_token = scan_token_sse42;
+        scan_path = scan_path_sse42;
+        scan_header_value = scan_header_value_sse42;
+        return HTTP_PARSER_SIMD_SSE42;
+    }
+#else
+    (void)level;
+#endif
+
+    scan_token = scan_token_scalar;
+    scan_path = scan_path_scalar;
+    scan_header_value = scan_header_value_scalar;
+    return HTTP_PARSER_SIMD_NONE;
+}
+
+void http_parser_init(http_parser *parser)
+{
+    if (parser == NULL) return;
+
+    parser->state = HTTP_PARSER_METHOD;
+    parser->offset = 0;
+    parser->token_start = 0;
+    parser->header_count = 0;
+    parser->headers_length = 0;
+}
+
+http_parse_result http_parser_execute(http_parser *parser, char *buffer, size_t length)
+{
+    size_t i = parser->offset;
+
+    while (i < length)
+    {
+        unsigned char c = buffer[i];
+
+        switch (parser->state)
+        {
+        case HTTP_PARSER_METHOD:
+            i = scan_token(buffer, i, length);
+            if (i == length)
+                break;
+
+            if (buffer[i] != ' ' || i == parser->token_start)
+                return HTTP_PARSE_ERROR;
+
+            parser->method = make_view(parser->token_start, i);
+            buffer[i] = '\0';
+            parser->token_start = i + 1;
+            parser->state = HTTP_PARSER_PATH;
+            i++;
+            break;
+
+        case HTTP_PARSER_PATH:
+            i = scan_path(buffer, i, length);
+            if (i == length)
+                break;
+
+            if (buffer[i] != ' ' || i == parser->token_start)
+                return HTTP_PARSE_ERROR;
+
+            parser->path = make_view(parser->token_start, i);
+            buffer[i] = '\0';
+            parser->token_start = i + 1;
+            parser->state = HTTP_PARSER_VERSION;
+            i++;
+            break;
+
+        case HTTP_PARSER_VERSION:
+            if (c == '\r')
+            {
+                if (is_valid_version(buffer + parser->token_start, i - parser->token_start) == false)
+                    return HTTP_PARSE_ERROR;
+
+                parser->version = make_view(parser->token_start, i);
+                buffer[i] = '\0';
+                parser->state = HTTP_PARSER_REQUEST_LINE_END;
+            }
+            else if (c <= ' ' || c >= 0x7f)
+            {
+                return HTTP_PARSE_ERROR;
+            }
+            i++;
+            break;
+
+        case HTTP_PARSER_REQUEST_LINE_END:
+        case HTTP_PARSER_HEADER_LINE_END:
+            if (c != '\n')
+                return HTTP_PARSE_ERROR;
+            parser->state = HTTP_PARSER_HEADER_START;
+            i++;
+            break;
+
+        case HTTP_PARSER_HEADER_START:
+            if (c == '\r')
+            {
+                parser->state = HTTP_PARSER_HEADERS_END;
+                i++;
+                break;
+            }
+
+            if (parser->header_count == HTTP_PARSER_MAX_HEADERS)
+                return HTTP_PARSE_TOO_MANY_HEADERS;
+
+            parser->token_start = i;
+            parser->state = HTTP_PARSER_HEADER_NAME;
+            break;
+
+        case HTTP_PARSER_HEADER_NAME:
+            i = scan_token(buffer, i, length);
+            if (i == length)
+                break;
+
+            /* also rejects whitespace before the colon and obsolete line folding */
+            if (buffer[i] != ':' || i == parser->token_start)
+                return HTTP_PARSE_ERROR;
+
+            parser->headers[parser->header_count].name = make_view(parser->token_start, i);
+            buffer[i] = '\0';
+            parser->state = HTTP_PARSER_HEADER_VALUE_START;
+            i++;
+            break;
+
+        case HTTP_PARSER_HEADER_VALUE_START:
+            if (c == ' ' || c == '\t')
+            {
+                i++;
+                break;
+            }
+
+            parser->token_start = i;
+            parser->state = HTTP_PARSER_HEADER_VALUE;
+            break;
+
+        case HTTP_PARSER_HEADER_VALUE:
+        {
+            i = scan_header_value(buffer, i, length);
+            if (i == length)
+                break;
+
+            if (buffer[i] != '\r')
+                return HTTP_PARSE_ERROR;
+
+            size_t end = i;
+            while (end > parser->token_start && (buffer[end - 1] == ' ' || buffer[end - 1] == '\t'))
+                end--;
+
+            parser->headers[parser->header_count++].value = make_view(parser->token_start, end);
+            buffer[end] = '\0';
+            parser->state = HTTP_PARSER_HEADER_LINE_END;
+            i++;
+            break;
+        }
+
+        case HTTP_PARSER_HEADERS_END:
+            if (c != '\n')
+                return HTTP_PARSE_ERROR;
+
+            i++;
+            parser->offset = i;
+            parser->headers_length = i;
+            parser->state = HTTP_PARSER_DONE;
+            return HTTP_PARSE_DONE;
+
+        case HTTP_PARSER_DONE:
+            return HTTP_PARSE_DONE;
+        }
+    }
+
+    parser->offset = i;
+    return parser->state == HTTP_PARSER_DONE ? HTTP_PARSE_DONE : HTTP_PARSE_INCOMPLETE;
+}
+
+const char *http_parser_find_header(const http_parser *parser, const char *buffer, const char *name)
+{
+    if (parser == NULL || buffer == NULL || name == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < parser->header_count; i++)
+    {
+        if (strcasecmp(buffer + parser->headers[i].name.offset, name) == 0)
+            return buffer + parser->headers[i].value.offset;
+    }
+
+    return NULL;
+}
+
+bool is_token_char(unsigned char c)
+{
+    return http_token_chars[c];
+}
+
+size_t scan_token_scalar(const char *buffer, size_t offset, size_t length)
+{
+    while (offset < length && is_token_char(buffer[offset]))
+        offset++;
+    return offset;
+}
+
+size_t scan_path_scalar(const char *buffer, size_t offset, size_t length)
+{
+    /* the request target runs up to the next space, any control byte ends it */
+    while (offset < length && (unsigned char)buffer[offset] > ' ' && buffer[offset] != 0x7f)
+        offset++;
+    return offset;
+}
+
+size_t scan_header_value_scalar(const char *buffer, size_t offset, size_t length)
+{
+    /* field values may carry tabs and obs-text, any other control byte ends them */
+    while (offset < length)
+    {
+        unsigned char c = buffer[offset];
+        if ((c < ' ' && c != '\t') || c == 0x7f)
+            break;
+        offset++;
+    }
+    return offset;
+}
+
+#ifdef HTTP_PARSER_X86
+
+/* SSE4.2 kernels look at 16 bytes per step. pcmpestri finds the first byte
+ * inside a set of ranges; token chars do not fit its 8 ranges, so they are
+ * classified with two pshufb nibble lookups instead. The tail shorter than
+ * a vector is left to the scalar loop */
+
+__attribute__((target("sse4.2")))
+size_t scan_token_sse42(const char *buffer, size_t offset, size_t length)
+{
+    const __m128i low_table = _mm_loadu_si128((const __m128i*)token_low_nibbles);
+    const __m128i high_table = _mm_loadu_si128((const __m128i*)token_high_nibbles);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+
+    while (offset + 16 <= length)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(buffer + offset));
+        __m128i low = _mm_shuffle_epi8(low_table, _mm_and_si128(block, nibble_mask));
+        __m128i high = _mm_shuffle_epi8(high_table, _mm_and_si128(_mm_srli_epi16(block, 4), nibble_mask));
+        __m128i invalid = _mm_cmpeq_epi8(_mm_and_si128(low, high), _mm_setzero_si128());
+
+        unsigned mask = _mm_movemask_epi8(invalid);
+        if (mask != 0)
+            return offset + __builtin_ctz(mask);
+        offset += 16;
+    }
+
+    return scan_token_scalar(buffer, offset, length);
+}
+
+__attribute__((target("sse4.2")))
+size_t scan_path_sse42(const char *buffer, size_t offset, size_t length)
+{
+    const __m128i ranges = _mm_setr_epi8(0x00, ' ', 0x7f, 0x7f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    while (offset + 16 <= length)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(buffer + offset));
+        int index = _mm_cmpestri(ranges, 4, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16)
+            return offset + index;
+        offset += 16;
+    }
+
+    return scan_path_scalar(buffer, offset, length);
+}
+
+__attribute__((target("sse4.2")))
+size_t scan_header_value_sse42(const char *buffer, size_t offset, size_t length)
+{
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+
+    while (offset + 16 <= length)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(buffer + offset));
+        int index = _mm_cmpestri(ranges, 6, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if (index != 16)
+            return offset + index;
+        offset += 16;
+    }
+
+    return scan_header_value_scalar(buffer, offset, length);
+}
+
+/* AVX2 kernels look at 32 bytes per step with plain compares. Unsigned
+ * "c <= n" is computed as max(c, n) == n */
+
+__attribute__((target("avx2")))
+size_t scan_token_avx2(const char *buffer, size_t offset, size_t length)
+{
+    const __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)token_low_nibbles));
+    const __m256i high_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)token_high_nibbles));
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+
+    while (offset + 32 <= length)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(buffer + offset));
+        __m256i low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(block, nibble_mask));
+        __m256i high = _mm256_shuffle_epi8(high_table, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble_mask));
+        __m256i invalid = _mm256_cmpeq_epi8(_mm256_and_si256(low, high), _mm256_setzero_si256());
+
+        unsigned mask = _mm256_movemask_epi8(invalid);
+        if (mask != 0)
+            return offset + __builtin_ctz(mask);
+        offset += 32;
+    }
+
+    return scan_token_sse42(buffer, offset, length);
+}
+
+__attribute__((target("avx2")))
+size_t scan_path_avx2(const char *buffer, size_t offset, size_t length)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+
+    while (offset + 32 <= length)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(buffer + offset));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(block, space), space);
+        __m256i stop = _mm256_or_si256(control, _mm256_cmpeq_epi8(block, del));
+
+        unsigned mask = _mm256_movemask_epi8(stop);
+        if (mask != 0)
+            return offset + __builtin_ctz(mask);
+        offset += 32;
+    }
+
+    return scan_path_sse42(buffer, offset, length);
+}
+
+__attribute__((target("avx2")))
+size_t scan_header_value_avx2(const char *buffer, size_t offset, size_t length)
+{
+    const __m256i unit_separator = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+
+    while (offset + 32 <= length)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(buffer + offset));
+        __m256i control = _mm256_cmpeq_epi8(_mm256_max_epu8(block, unit_separator), unit_separator);
+        control = _mm256_andnot_si256(_mm256_cmpeq_epi8(block, tab), control);
+        __m256i stop = _mm256_or_si256(control, _mm256_cmpeq_epi8(block, del));
+
+        unsigned mask = _mm256_movemask_epi8(stop);
+        if (mask != 0)
+            return offset + __builtin_ctz(mask);
+        offset += 32;
+    }
+
+    return scan_header_value_sse42(buffer, offset, length);
+}
+
+#endif // HTTP_PARSER_X86
+
+http_view make_view(size_t start, size_t end)
+{
+    http_view view = {
+        .offset = (uint32_t)start,
+        .length = (uint32_t)(end - start)
+    };
+    return view;
+}
+
+bool is_valid_version(const char *version, size_t length)
+{
+    return length == 8 && memcmp(version, "HTTP/", 5) == 0 &&
+           version[5] >= '0' && version[5] <= '9' && version[6] == '.' &&
+           version[7] >= '0' && version[7] <= '9';
+}
@@ -0,0 +1,116 @@
+#ifndef NETC_HTTP_PARSER_H
+#define NETC_HTTP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_PARSER_MAX_HEADERS 64
+
+typedef enum
+{
+    HTTP_PARSER_SIMD_NONE,
+    HTTP_PARSER_SIMD_SSE42,
+    HTTP_PARSER_SIMD_AVX2
+} http_parser_simd;
+
+typedef enum
+{
+    HTTP_PARSE_DONE,
+    HTTP_PARSE_INCOMPLETE,
+    HTTP_PARSE_ERROR,
+    HTTP_PARSE_TOO_MANY_HEADERS
+} http_parse_result;
+
+typedef enum
+{
+    HTTP_PARSER_METHOD,
+    HTTP_PARSER_PATH,
+    HTTP_PARSER_VERSION,
+    HTTP_PARSER_REQUEST_LINE_END,
+    HTTP_PARSER_HEADER_START,
+    HTTP_PARSER_HEADER_NAME,
+    HTTP_PARSER_HEADER_VALUE_START,
+    HTTP_PARSER_HEADER_VALUE,
+    HTTP_PARSER_HEADER_LINE_END,
+    HTTP_PARSER_HEADERS_END,
+    HTTP_PARSER_DONE
+} http_parser_state;
+
+/* a token of the request as a position in the receive buffer, so it stays
+ * valid when the buffer is reallocated */
+typedef struct
+{
+    uint32_t offset;
+    uint32_t length;
+} http_view;
+
+typedef struct
+{
+    http_view name;
+    http_view value;
+} http_header_view;
+
+typedef struct
+{
+    http_parser_state state;
+    size_t            offset;
+    size_t            token_start;
+    http_view         method;
+    http_view         path;
+    http_view         version;
+    http_header_view  headers[HTTP_PARSER_MAX_HEADERS];
+    size_t            header_count;
+    size_t            headers_length;
+} http_parser;
+
+__attribute__((constructor)) void init_http_parser_simd();
+
+/**
+ * @brief selects the delimiter scanning kernels used by every parser: the
+ * best one supported by the CPU, but not above level. The constructor picks
+ * the best available at load time, so this is only needed to compare or
+ * rule out kernels
+ *
+ * @param level highest instruction set to use
+ * @return http_parser_simd the instruction set actually selected
+ */
+http_parser_simd http_parser_select_simd(http_parser_simd level);
+
+/**
+ * @brief resets a parser so it is ready for a new request
+ *
+ * @param parser pointer to the parser to reset
+ */
+void http_parser_init(http_parser *parser);
+
+/**
+ * @brief parses the request line and headers held by buffer, resuming where
+ * the previous call stopped, so buffer must hold every byte passed before
+ * plus the new ones. Nothing is copied: each token is recorded as a view
+ * into buffer and NUL-terminated in place by overwriting its delimiter, so
+ * buffer + view.offset can be used as a string once the token is complete
+ *
+ * @param parser pointer to the parser
+ * @param buffer the bytes received so far
+ * @param length number of bytes in buffer
+ * @return http_parse_result HTTP_PARSE_DONE once the blank line ending the
+ * headers was parsed, with headers_length set to the offset right after it,
+ * HTTP_PARSE_INCOMPLETE if more bytes are needed, HTTP_PARSE_ERROR on a
+ * malformed request and HTTP_PARSE_TOO_MANY_HEADERS past
+ * HTTP_PARSER_MAX_HEADERS headers
+ */
+http_parse_result http_parser_execute(http_parser *parser, char *buffer, size_t length);
+
+/**
+ * @brief finds a header by name, ignoring case. Only valid once
+ * http_parser_execute returned HTTP_PARSE_DONE
+ *
+ * @param parser pointer to the parser that parsed buffer
+ * @param buffer the buffer that was parsed
+ * @param name name of the header to find
+ * @return const char* the NUL-terminated value in buffer, NULL if the
+ * header is missing
+ */
+const char *http_parser_find_header(const http_parser *parser, const char *buffer, const char *name);
+
+#endif // NETC_HTTP_PARSER_H
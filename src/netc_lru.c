@@ -0,0 +1,28 @@
+#include "netc_lru.h"
+
+void netc_lru_push_front(netc_lru_list *list, netc_lru_node *node)
+{
+    node->prev = NULL;
+    node->next = list->head;
+    if (list->head != NULL)
+        list->head->prev = node;
+    else
+        list->tail = node;
+    list->head = node;
+}
+
+void netc_lru_remove(netc_lru_list *list, netc_lru_node *node)
+{
+    if (node->prev != NULL)
+        node->prev->next = node->next;
+    else
+        list->head = node->next;
+
+    if (node->next != NULL)
+        node->next->prev = node->prev;
+    else
+        list->tail = node->prev;
+
+    node->prev = NULL;
+    node->next = NULL;
+}
@@ -0,0 +1,41 @@
+#ifndef NETC_LRU_H
+#define NETC_LRU_H
+
+#include <stddef.h>
+
+/* links embedded in an entry, so moving it in the list never allocates */
+typedef struct netc_lru_node
+{
+    struct netc_lru_node *prev;
+    struct netc_lru_node *next;
+} netc_lru_node;
+
+/* entries ordered from most recently used at the head to the next one to
+ * evict at the tail */
+typedef struct
+{
+    netc_lru_node *head;
+    netc_lru_node *tail;
+} netc_lru_list;
+
+/* the entry of type embedding node as member, NULL for a NULL node */
+#define NETC_LRU_ENTRY(node, type, member) \
+    ((node) != NULL ? (type *)((char *)(node) - offsetof(type, member)) : NULL)
+
+/**
+ * @brief links node at the head of the list, as the most recently used
+ *
+ * @param list pointer to the list
+ * @param node pointer to a node not in any list
+ */
+void netc_lru_push_front(netc_lru_list *list, netc_lru_node *node);
+
+/**
+ * @brief unlinks node from the list and clears its links
+ *
+ * @param list pointer to the list holding node
+ * @param node pointer to the node to unlink
+ */
+void netc_lru_remove(netc_lru_list *list, netc_lru_node *node);
+
+#endif // NETC_LRU_H
@@ -0,0 +1,536 @@
+#include "netc_reactor.h"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+
+uint64_t now_ms(void);
+void untrack(netc_reactor *reactor, netc_connection *connection);
+void accept_connections(netc_reactor *reactor);
+void handle_connection_event(netc_reactor *reactor, netc_connection *connection, uint32_t events);
+void read_connection(netc_reactor *reactor, netc_connection *connection);
+void drain_completed(netc_reactor *reactor);
+bool init_epoll(netc_reactor *reactor);
+
+bool netc_reactor_init(netc_reactor *reactor, int listening_socket_fd,
+                       netc_io_backend backend, const ctsl *logger,
+                       void (*on_request)(netc_reactor*, netc_connection*))
+{
+    if (reactor == NULL || on_request == NULL) return false;
+
+    int flags = fcntl(listening_socket_fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(listening_socket_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return false;
+
+    reactor->listening_socket_fd = listening_socket_fd;
+    reactor->logger = logger;
+    reactor->completed_head = NULL;
+    reactor->on_headers = NULL;
+    reactor->on_body = NULL;
+    reactor->on_written = NULL;
+    reactor->running = false;
+    reactor->epoll_fd = -1;
+    reactor->connections_head = NULL;
+    reactor->connections_tail = NULL;
+    reactor->ready_head = NULL;
+    reactor->ready_tail = NULL;
+    reactor->last_sweep_ms = now_ms();
+    reactor->max_header_size = NETC_DEFAULT_MAX_HEADER_SIZE;
+    reactor->max_body_size = NETC_DEFAULT_MAX_BODY_SIZE;
+    reactor->stats.accepted = 0;
+    reactor->stats.refused = 0;
+    reactor->stats.requests = 0;
+    netc_connection_pool_init(&reactor->connection_pool, 0);
+    atomic_init(&reactor->stats.syscalls, 0);
+
+    reactor->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (reactor->wakeup_fd < 0)
+        return false;
+
+    reactor->backend = backend;
+    if (backend == NETC_IO_BACKEND_IO_URING && netc_uring_init(&reactor->uring) == false)
+    {
+        char *err_msg = strerror(errno);
+        ctsl_print(logger, CTSL_WARNING, "io_uring unavailable (%s), falling back to epoll", err_msg);
+        reactor->backend = NETC_IO_BACKEND_EPOLL;
+    }
+
+    if (reactor->backend == NETC_IO_BACKEND_EPOLL && init_epoll(reactor) == false)
+    {
+        close(reactor->wakeup_fd);
+        return false;
+    }
+
+    pthread_mutex_init(&reactor->completed_mutex, NULL);
+    reactor->on_request = on_request;
+    return true;
+}
+
+void netc_reactor_run(netc_reactor *reactor)
+{
+    if (reactor->backend == NETC_IO_BACKEND_IO_URING)
+    {
+        netc_uring_reactor_run(reactor);
+        return;
+    }
+
+    struct epoll_event events[NETC_REACTOR_MAX_EVENTS];
+
+    int timeout = reactor->idle_timeout_ms > 0 ? NETC_REACTOR_SWEEP_INTERVAL_MS : -1;
+
+    reactor->running = true;
+    while (reactor->running)
+    {
+        int ready = epoll_wait(reactor->epoll_fd, events, NETC_REACTOR_MAX_EVENTS, timeout);
+        atomic_fetch_add_explicit(&reactor->stats.syscalls, 1, memory_order_relaxed);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+
+            char *err_msg = strerror(errno);
+            ctsl_print(reactor->logger, CTSL_ERROR, "Error waiting for socket events: %s", err_msg);
+            break;
+        }
+
+        for (int i = 0; i < ready; i++)
+        {
+            void *source = events[i].data.ptr;
+            if (source == &reactor->listening_socket_fd)
+                accept_connections(reactor);
+            else if (source == &reactor->wakeup_fd)
+                drain_completed(reactor);
+            else
+                handle_connection_event(reactor, source, events[i].events);
+        }
+        netc_reactor_run_ready(reactor);
+
+        if (reactor->idle_timeout_ms > 0 && now_ms() - reactor->last_sweep_ms >= NETC_REACTOR_SWEEP_INTERVAL_MS)
+            netc_reactor_sweep_idle(reactor);
+    }
+}
+
+void netc_reactor_stop(netc_reactor *reactor)
+{
+    const uint64_t value = 1;
+    reactor->running = false;
+    if (write(reactor->wakeup_fd, &value, sizeof(value)) < 0)
+        return;
+}
+
+void netc_reactor_complete(netc_reactor *reactor, netc_connection *connection)
+{
+    pthread_mutex_lock(&reactor->completed_mutex);
+    connection->next_completed = reactor->completed_head;
+    reactor->completed_head = connection;
+    pthread_mutex_unlock(&reactor->completed_mutex);
+
+    const uint64_t value = 1;
+    atomic_fetch_add_explicit(&reactor->stats.syscalls, 1, memory_order_relaxed);
+    if (write(reactor->wakeup_fd, &value, sizeof(value)) < 0)
+    {
+        char *err_msg = strerror(errno);
+        ctsl_print(reactor->logger, CTSL_ERROR, "Error waking up event loop: %s", err_msg);
+    }
+}
+
+netc_connection *netc_reactor_take_completed(netc_reactor *reactor)
+{
+    pthread_mutex_lock(&reactor->completed_mutex);
+    netc_connection *connection = reactor->completed_head;
+    reactor->completed_head = NULL;
+    pthread_mutex_unlock(&reactor->completed_mutex);
+
+    return connection;
+}
+
+void netc_reactor_send(netc_reactor *reactor, netc_connection *connection)
+{
+    connection->state = NETC_CONNECTION_WRITING;
+
+    if (reactor->backend == NETC_IO_BACKEND_IO_URING)
+    {
+        netc_uring_reactor_send(reactor, connection);
+        return;
+    }
+
+    netc_io_result result = netc_connection_flush(connection);
+    /* a response produced piece by piece goes on with the next piece */
+    while (result == NETC_IO_DONE && connection->response_streaming)
+    {
+        if (reactor->on_written(reactor, connection, false) == false)
+            return;
+        result = netc_connection_flush(connection);
+    }
+
+    if (result == NETC_IO_AGAIN)
+        return;
+
+    if (result == NETC_IO_ERROR)
+    {
+        char *err_msg = strerror(errno);
+        ctsl_print(reactor->logger, CTSL_ERROR, "Error sending data to client: %s", err_msg);
+        connection->write_offset = connection->write_length;
+        if (connection->response_streaming && reactor->on_written(reactor, connection, true) == false)
+            return;
+        netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    netc_reactor_finish(reactor, connection);
+}
+
+void netc_reactor_finish(netc_reactor *reactor, netc_connection *connection)
+{
+    if (connection->keep_alive == false || connection->peer_closed)
+    {
+        netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    netc_connection_reset(connection);
+    netc_reactor_touch(reactor, connection);
+    connection->state = NETC_CONNECTION_RESUMING;
+
+    /* resumed from the loop rather than here, so pipelined requests answered
+     * inline cannot recurse without bound */
+    connection->next_ready = NULL;
+    if (reactor->ready_tail != NULL)
+        reactor->ready_tail->next_ready = connection;
+    else
+        reactor->ready_head = connection;
+    reactor->ready_tail = connection;
+}
+
+void netc_reactor_run_ready(netc_reactor *reactor)
+{
+    while (reactor->ready_head != NULL)
+    {
+        netc_connection *connection = reactor->ready_head;
+        reactor->ready_head = connection->next_ready;
+        if (reactor->ready_head == NULL)
+            reactor->ready_tail = NULL;
+
+        connection->state = NETC_CONNECTION_READING;
+        if (netc_reactor_dispatch_buffered(reactor, connection))
+            continue;
+
+        /* bytes that arrived while the request was processed raised no new edge */
+        if (reactor->backend == NETC_IO_BACKEND_IO_URING)
+            netc_uring_reactor_resume(reactor, connection);
+        else
+            read_connection(reactor, connection);
+    }
+}
+
+bool netc_reactor_dispatch_buffered(netc_reactor *reactor, netc_connection *connection)
+{
+    netc_frame_result result = NETC_FRAME_COMPLETE;
+    if (connection->streaming == false && connection->headers_length == 0 && reactor->on_headers != NULL)
+    {
+        result = netc_connection_frame_headers(connection);
+        if (result == NETC_FRAME_INCOMPLETE)
+            return false;
+
+        if (result == NETC_FRAME_COMPLETE && reactor->on_headers(reactor, connection))
+            reactor->stats.requests++;
+    }
+
+    if (connection->streaming)
+    {
+        /* an empty piece is only worth handing over when it ends the body */
+        result = netc_connection_frame_body(connection);
+        if (result == NETC_FRAME_INCOMPLETE && connection->stream_length == 0)
+            return false;
+
+        connection->frame_result = result;
+        connection->state = NETC_CONNECTION_PROCESSING;
+        reactor->on_body(reactor, connection);
+        return true;
+    }
+
+    /* headers rejected above are not framed again */
+    if (result == NETC_FRAME_COMPLETE)
+        result = netc_connection_frame_request(connection);
+    if (result == NETC_FRAME_INCOMPLETE)
+        return false;
+
+    connection->frame_result = result;
+    reactor->stats.requests++;
+    connection->state = NETC_CONNECTION_PROCESSING;
+    reactor->on_request(reactor, connection);
+    return true;
+}
+
+void netc_reactor_resume(netc_reactor *reactor, netc_connection *connection)
+{
+    netc_connection_consume_body(connection);
+    netc_reactor_touch(reactor, connection);
+    connection->state = NETC_CONNECTION_RESUMING;
+
+    connection->next_ready = NULL;
+    if (reactor->ready_tail != NULL)
+        reactor->ready_tail->next_ready = connection;
+    else
+        reactor->ready_head = connection;
+    reactor->ready_tail = connection;
+}
+
+void netc_reactor_track(netc_reactor *reactor, netc_connection *connection)
+{
+    connection->prev = reactor->connections_tail;
+    connection->next = NULL;
+    if (reactor->connections_tail != NULL)
+        reactor->connections_tail->next = connection;
+    else
+        reactor->connections_head = connection;
+    reactor->connections_tail = connection;
+
+    connection->last_active_ms = now_ms();
+}
+
+void netc_reactor_touch(netc_reactor *reactor, netc_connection *connection)
+{
+    /* the list stays ordered by activity, idle connections gather at the head */
+    untrack(reactor, connection);
+    netc_reactor_track(reactor, connection);
+}
+
+void netc_reactor_sweep_idle(netc_reactor *reactor)
+{
+    uint64_t now = now_ms();
+    reactor->last_sweep_ms = now;
+
+    netc_connection *connection = reactor->connections_head;
+    while (connection != NULL && now - connection->last_active_ms >= reactor->idle_timeout_ms)
+    {
+        netc_connection *next = connection->next;
+        if (connection->state != NETC_CONNECTION_READING)
+        {
+            netc_reactor_touch(reactor, connection);
+        }
+        else if (reactor->backend == NETC_IO_BACKEND_IO_URING)
+        {
+            /* the pending recv completes with 0 and closes the connection */
+            shutdown(connection->fd, SHUT_RDWR);
+            netc_reactor_touch(reactor, connection);
+        }
+        else
+        {
+            netc_reactor_close(reactor, connection);
+        }
+        connection = next;
+    }
+}
+
+void netc_reactor_close(netc_reactor *reactor, netc_connection *connection)
+{
+    /* the io_uring backend counts ring submissions instead of single calls */
+    if (reactor->backend == NETC_IO_BACKEND_EPOLL)
+        atomic_fetch_add_explicit(&reactor->stats.syscalls, connection->io_calls + 1, memory_order_relaxed);
+
+    untrack(reactor, connection);
+    netc_connection_pool_put(&reactor->connection_pool, connection);
+}
+
+netc_connection *netc_reactor_adopt(netc_reactor *reactor, int fd)
+{
+    netc_connection *connection = netc_connection_pool_get(&reactor->connection_pool, fd);
+    if (connection == NULL)
+    {
+        /* a flood is turned away without a log line per socket, the
+         * refused counter tells it apart from allocation failures */
+        if (reactor->connection_pool.capacity > 0 &&
+            reactor->connection_pool.live_count >= reactor->connection_pool.capacity)
+        {
+            reactor->stats.refused++;
+        }
+        else
+        {
+            char *err_msg = strerror(errno);
+            ctsl_print(reactor->logger, CTSL_ERROR, "Error allocating memory for connection: %s", err_msg);
+        }
+        close(fd);
+        return NULL;
+    }
+
+    connection->max_header_size = reactor->max_header_size;
+    connection->max_body_size = reactor->max_body_size;
+    reactor->stats.accepted++;
+    netc_reactor_track(reactor, connection);
+    return connection;
+}
+
+void netc_reactor_destroy(netc_reactor *reactor)
+{
+    if (reactor == NULL || reactor->on_request == NULL) return;
+
+    while (reactor->connections_head != NULL)
+        netc_reactor_close(reactor, reactor->connections_head);
+
+    if (reactor->backend == NETC_IO_BACKEND_IO_URING)
+        netc_uring_destroy(&reactor->uring);
+    else
+        close(reactor->epoll_fd);
+
+    close(reactor->wakeup_fd);
+    netc_connection_pool_destroy(&reactor->connection_pool);
+    pthread_mutex_destroy(&reactor->completed_mutex);
+    reactor->on_request = NULL;
+}
+
+uint64_t now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void untrack(netc_reactor *reactor, netc_connection *connection)
+{
+    if (connection->prev != NULL)
+        connection->prev->next = connection->next;
+    else if (reactor->connections_head == connection)
+        reactor->connections_head = connection->next;
+    else
+        return;
+
+    if (connection->next != NULL)
+        connection->next->prev = connection->prev;
+    else
+        reactor->connections_tail = connection->prev;
+
+    connection->prev = NULL;
+    connection->next = NULL;
+}
+
+bool init_epoll(netc_reactor *reactor)
+{
+    reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (reactor->epoll_fd < 0)
+        return false;
+
+    struct epoll_event event = { .events = EPOLLIN | EPOLLET, .data.ptr = &reactor->listening_socket_fd };
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->listening_socket_fd, &event) < 0)
+    {
+        close(reactor->epoll_fd);
+        return false;
+    }
+
+    event.data.ptr = &reactor->wakeup_fd;
+    if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wakeup_fd, &event) < 0)
+    {
+        close(reactor->epoll_fd);
+        return false;
+    }
+
+    return true;
+}
+
+void accept_connections(netc_reactor *reactor)
+{
+    while (true)
+    {
+        atomic_fetch_add_explicit(&reactor->stats.syscalls, 1, memory_order_relaxed);
+        int client_sfd = accept4(reactor->listening_socket_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_sfd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+
+            char *err_msg = strerror(errno);
+            ctsl_print(reactor->logger, CTSL_ERROR, "Error accepting new connection: %s", err_msg);
+            return;
+        }
+
+        netc_connection *connection = netc_reactor_adopt(reactor, client_sfd);
+        if (connection == NULL)
+            continue;
+
+        struct epoll_event event = {
+            .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+            .data.ptr = connection
+        };
+        atomic_fetch_add_explicit(&reactor->stats.syscalls, 1, memory_order_relaxed);
+        if (epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, client_sfd, &event) < 0)
+        {
+            char *err_msg = strerror(errno);
+            ctsl_print(reactor->logger, CTSL_ERROR, "Error registering new connection: %s", err_msg);
+            netc_reactor_close(reactor, connection);
+        }
+    }
+}
+
+void handle_connection_event(netc_reactor *reactor, netc_connection *connection, uint32_t events)
+{
+    switch (connection->state)
+    {
+        case NETC_CONNECTION_READING:
+            if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+                read_connection(reactor, connection);
+            break;
+
+        case NETC_CONNECTION_WRITING:
+            if (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+                netc_reactor_send(reactor, connection);
+            break;
+
+        case NETC_CONNECTION_PROCESSING:
+            /* a worker owns the connection, errors surface when sending */
+            break;
+
+        case NETC_CONNECTION_RESUMING:
+            /* queued in the ready list, which reads the socket anyway */
+            break;
+    }
+}
+
+void read_connection(netc_reactor *reactor, netc_connection *connection)
+{
+    netc_io_result result;
+    do
+    {
+        size_t buffered = connection->read_length;
+        result = netc_connection_read(connection);
+        if (result == NETC_IO_ERROR)
+        {
+            netc_reactor_close(reactor, connection);
+            return;
+        }
+
+        if (connection->read_length > buffered)
+            netc_reactor_touch(reactor, connection);
+
+        if (netc_reactor_dispatch_buffered(reactor, connection))
+            return;
+    } while (result == NETC_IO_DONE);
+
+    if (result == NETC_IO_CLOSED)
+        netc_reactor_close(reactor, connection);
+}
+
+void drain_completed(netc_reactor *reactor)
+{
+    uint64_t value;
+    atomic_fetch_add_explicit(&reactor->stats.syscalls, 1, memory_order_relaxed);
+    if (read(reactor->wakeup_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        return;
+
+    netc_connection *connection = netc_reactor_take_completed(reactor);
+    while (connection != NULL)
+    {
+        netc_connection *next = connection->next_completed;
+        if (connection->streaming)
+            netc_reactor_resume(reactor, connection);
+        else
+            netc_reactor_send(reactor, connection);
+        connection = next;
+    }
+}
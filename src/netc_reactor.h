@@ -0,0 +1,221 @@
+#ifndef NETC_REACTOR_H
+#define NETC_REACTOR_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "ctsl.h"
+#include "netc_connection.h"
+#include "netc_uring.h"
+
+#define NETC_REACTOR_MAX_EVENTS       256
+#define NETC_REACTOR_SWEEP_INTERVAL_MS 1000
+
+typedef enum
+{
+    NETC_IO_BACKEND_EPOLL,
+    NETC_IO_BACKEND_IO_URING
+} netc_io_backend;
+
+typedef struct
+{
+    uint64_t          accepted;
+    uint64_t          refused;
+    uint64_t          requests;
+    _Atomic uint64_t  syscalls;
+} netc_reactor_stats;
+
+typedef struct netc_reactor
+{
+    netc_io_backend     backend;
+    int                 epoll_fd;
+    int                 listening_socket_fd;
+    int                 wakeup_fd;
+    volatile bool       running;
+    const ctsl         *logger;
+    pthread_mutex_t     completed_mutex;
+    netc_connection    *completed_head;
+    void              (*on_request)(struct netc_reactor*, netc_connection*);
+    bool              (*on_headers)(struct netc_reactor*, netc_connection*);
+    void              (*on_body)(struct netc_reactor*, netc_connection*);
+    bool              (*on_written)(struct netc_reactor*, netc_connection*, bool);
+    netc_uring          uring;
+    netc_reactor_stats  stats;
+    uint32_t            idle_timeout_ms;
+    size_t              max_header_size;
+    size_t              max_body_size;
+    uint64_t            last_sweep_ms;
+    netc_connection    *connections_head;
+    netc_connection    *connections_tail;
+    netc_connection    *ready_head;
+    netc_connection    *ready_tail;
+    netc_connection_pool connection_pool;
+} netc_reactor;
+
+/**
+ * @brief creates the epoll instance, or the io_uring ring when requested,
+ * and registers the listening socket, which is switched to non-blocking
+ * mode. If io_uring is not available the reactor falls back to epoll
+ *
+ * @param reactor pointer to the reactor to initialize
+ * @param listening_socket_fd socket already bound and listening
+ * @param backend preferred I/O backend
+ * @param logger logger used to report I/O errors
+ * @param on_request called on the reactor thread for every fully framed
+ * request, or for a request rejected by framing as told by frame_result;
+ * the connection is in NETC_CONNECTION_PROCESSING state until it is handed
+ * back with netc_reactor_complete
+ * @return true on success
+ * @return false on failure
+ */
+bool netc_reactor_init(netc_reactor *reactor, int listening_socket_fd,
+                       netc_io_backend backend, const ctsl *logger,
+                       void (*on_request)(netc_reactor*, netc_connection*));
+
+/**
+ * @brief runs the event loop on the calling thread until netc_reactor_stop
+ * is called
+ *
+ * @param reactor pointer to the reactor to run
+ */
+void netc_reactor_run(netc_reactor *reactor);
+
+/**
+ * @brief asks the event loop to return. Safe to call from a signal handler
+ *
+ * @param reactor pointer to the reactor to stop
+ */
+void netc_reactor_stop(netc_reactor *reactor);
+
+/**
+ * @brief hands a connection with a queued response back to the event loop,
+ * or a connection streaming its body once the piece passed to on_body has
+ * been handled, or one streaming its response once more of it is queued.
+ * Can be called from any thread
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the connection to send
+ */
+void netc_reactor_complete(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief detaches the list of connections handed back by workers. Must be
+ * called on the reactor thread
+ *
+ * @param reactor pointer to the reactor
+ * @return netc_connection* head of the list linked through next_completed
+ */
+netc_connection *netc_reactor_take_completed(netc_reactor *reactor);
+
+/**
+ * @brief sends the queued response of a connection right away. Must be called
+ * on the reactor thread. When response_streaming is set on the connection,
+ * on_written is called each time the queued bytes are all written, or
+ * failed to be, and returns true once it queued the next piece or cleared
+ * response_streaming, false when it keeps the connection waiting for more
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the connection to send
+ */
+void netc_reactor_send(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief called once the whole response of a connection has been sent.
+ * Keep-alive connections are queued to go back to reading, the others are
+ * closed. Must be called on the reactor thread
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the connection that was answered
+ */
+void netc_reactor_finish(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief resumes the connections queued by netc_reactor_finish: a pipelined
+ * request already buffered is dispatched right away, otherwise the socket
+ * is read again. Called by the event loop after each batch of events
+ *
+ * @param reactor pointer to the reactor
+ */
+void netc_reactor_run_ready(netc_reactor *reactor);
+
+/**
+ * @brief drops the body piece a streaming connection just handled and
+ * queues the connection to frame or read the next one. Must be called on
+ * the reactor thread
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the streaming connection
+ */
+void netc_reactor_resume(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief hands the buffered request to on_request if it is complete or if
+ * framing rejected it. When on_headers is set it is called once the headers
+ * are buffered; if it sets streaming on the connection, the body is handed
+ * to on_body piece by piece instead, and the connection is not read again
+ * until each piece is handed back with netc_reactor_complete or
+ * netc_reactor_resume
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the connection to check
+ * @return true if a request was dispatched
+ * @return false if more bytes are needed
+ */
+bool netc_reactor_dispatch_buffered(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief starts tracking a new connection for idle timeouts and cleanup
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the new connection
+ */
+void netc_reactor_track(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief marks a connection as active, postponing its idle timeout
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the active connection
+ */
+void netc_reactor_touch(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief closes every connection that has been waiting for a request for
+ * longer than idle_timeout_ms
+ *
+ * @param reactor pointer to the reactor to sweep
+ */
+void netc_reactor_sweep_idle(netc_reactor *reactor);
+
+/**
+ * @brief takes a connection from the pool for a freshly accepted socket.
+ * When connection_pool.capacity connections are already open the socket is
+ * closed right away and counted as refused. Must be called on the reactor
+ * thread
+ *
+ * @param reactor pointer to the reactor accepting the socket
+ * @param fd the client socket file descriptor
+ * @return netc_connection* the tracked connection, NULL if the socket was
+ * closed
+ */
+netc_connection *netc_reactor_adopt(netc_reactor *reactor, int fd);
+
+/**
+ * @brief closes a connection and returns its memory to the pool. Must be
+ * called on the reactor thread
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the connection to close
+ */
+void netc_reactor_close(netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief closes the epoll instance or the ring, the wakeup descriptor and
+ * every connection still open, and frees the connection pool. Does nothing if the reactor was never
+ * initialized. Workers must not hold any connection of this reactor
+ *
+ * @param reactor pointer to the reactor to destroy
+ */
+void netc_reactor_destroy(netc_reactor *reactor);
+
+#endif // NETC_REACTOR_H
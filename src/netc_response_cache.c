@@ -0,0 +1,418 @@
+#include "netc_response_cache.h"
+#include "netc_hash.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+uint64_t cache_now_ms(void);
+bool cache_ttl(const http_response *response, uint32_t default_ttl_ms, uint64_t *ttl_ms);
+bool cache_vary(const http_request *request, const http_response *response, char *vary, size_t *length);
+bool cache_vary_matches(const netc_cache_entry *entry, const http_request *request);
+size_t cache_head_length(const http_response *response);
+netc_cache_entry *cache_serialize(const http_request *request, const http_response *response,
+                                  const char *vary, size_t vary_length);
+netc_cache_shard *cache_shard(netc_response_cache *cache, uint64_t hash);
+void cache_unlink(netc_cache_shard *shard, netc_cache_entry *entry);
+
+bool netc_response_cache_init(netc_response_cache *cache, size_t budget, uint32_t default_ttl_ms)
+{
+    if (cache == NULL || budget == 0)
+        return false;
+
+    cache->shards = calloc(NETC_RESPONSE_CACHE_SHARDS, sizeof(netc_cache_shard));
+    if (cache->shards == NULL)
+        return false;
+
+    for (size_t i = 0; i < NETC_RESPONSE_CACHE_SHARDS; i++)
+    {
+        pthread_mutex_init(&cache->shards[i].mutex, NULL);
+        cache->shards[i].budget = budget / NETC_RESPONSE_CACHE_SHARDS;
+    }
+    cache->default_ttl_ms = default_ttl_ms;
+    return true;
+}
+
+netc_cache_entry *netc_response_cache_lookup(netc_response_cache *cache, const http_request *request)
+{
+    if (cache == NULL || cache->shards == NULL || request == NULL ||
+        (strcmp(request->method, GET) != 0 && strcmp(request->method, HEAD) != 0))
+        return NULL;
+
+    size_t key_length = strlen(request->path);
+    uint64_t hash = netc_hash_fnv1a(request->path, key_length);
+    netc_cache_shard *shard = cache_shard(cache, hash);
+    uint64_t now = cache_now_ms();
+
+    pthread_mutex_lock(&shard->mutex);
+    netc_cache_entry *entry = shard->buckets[hash & (NETC_RESPONSE_CACHE_BUCKETS - 1)];
+    while (entry != NULL)
+    {
+        if (entry->hash == hash && entry->key_length == key_length &&
+            memcmp(entry->key, request->path, key_length) == 0 && cache_vary_matches(entry, request))
+            break;
+        entry = entry->bucket_next;
+    }
+
+    /* a stale response is dropped, the handler produces the next one */
+    if (entry != NULL && entry->expires_ms <= now)
+    {
+        cache_unlink(shard, entry);
+        entry = NULL;
+    }
+
+    if (entry == NULL)
+    {
+        shard->misses++;
+        pthread_mutex_unlock(&shard->mutex);
+        return NULL;
+    }
+
+    entry->references++;
+    netc_lru_remove(&shard->lru, &entry->lru);
+    netc_lru_push_front(&shard->lru, &entry->lru);
+    shard->hits++;
+    pthread_mutex_unlock(&shard->mutex);
+    return entry;
+}
+
+bool netc_response_cache_store(netc_response_cache *cache, const http_request *request,
+                               const http_response *response)
+{
+    if (cache == NULL || cache->shards == NULL || request == NULL || response == NULL ||
+        strcmp(request->method, GET) != 0 || response->status_code != HTTP_STATUS_OK ||
+        http_response_get_header(response, "Set-Cookie") != NULL)
+        return false;
+
+    uint64_t ttl_ms;
+    char vary[NETC_RESPONSE_CACHE_MAX_VARY];
+    size_t vary_length;
+    if (cache_ttl(response, cache->default_ttl_ms, &ttl_ms) == false ||
+        cache_vary(request, response, vary, &vary_length) == false)
+        return false;
+
+    netc_cache_entry *entry = cache_serialize(request, response, vary, vary_length);
+    if (entry == NULL)
+        return false;
+
+    size_t key_length = entry->key_length;
+    size_t charge = entry->charge;
+    entry->hash = netc_hash_fnv1a(entry->key, key_length);
+    entry->expires_ms = cache_now_ms() + ttl_ms;
+    entry->references = 0;
+    entry->evicted = false;
+
+    netc_cache_shard *shard = cache_shard(cache, entry->hash);
+    entry->shard = shard;
+
+    pthread_mutex_lock(&shard->mutex);
+    if (charge > shard->budget)
+    {
+        pthread_mutex_unlock(&shard->mutex);
+        free(entry);
+        return false;
+    }
+
+    netc_cache_entry **bucket = &shard->buckets[entry->hash & (NETC_RESPONSE_CACHE_BUCKETS - 1)];
+    for (netc_cache_entry *old = *bucket; old != NULL; old = old->bucket_next)
+    {
+        if (old->hash == entry->hash && old->key_length == key_length && memcmp(old->key, entry->key, key_length) == 0 &&
+            old->vary_length == vary_length && memcmp(old->vary, vary, vary_length) == 0)
+        {
+            cache_unlink(shard, old);
+            break;
+        }
+    }
+
+    entry->bucket_next = *bucket;
+    *bucket = entry;
+    netc_lru_push_front(&shard->lru, &entry->lru);
+    shard->size += charge;
+    while (shard->size > shard->budget)
+        cache_unlink(shard, NETC_LRU_ENTRY(shard->lru.tail, netc_cache_entry, lru));
+    pthread_mutex_unlock(&shard->mutex);
+
+    return true;
+}
+
+netc_cache_entry *netc_response_cache_share(const http_request *request, const http_response *response)
+{
+    if (request == NULL || response == NULL || http_response_get_header(response, "Set-Cookie") != NULL)
+        return NULL;
+
+    const char *cache_control = http_response_get_header(response, "Cache-Control");
+    if (cache_control != NULL &&
+        (strcasestr(cache_control, "no-store") != NULL || strcasestr(cache_control, "private") != NULL))
+        return NULL;
+
+    char vary[NETC_RESPONSE_CACHE_MAX_VARY];
+    size_t vary_length;
+    if (cache_vary(request, response, vary, &vary_length) == false)
+        return NULL;
+
+    netc_cache_entry *entry = cache_serialize(request, response, vary, vary_length);
+    if (entry == NULL)
+        return NULL;
+
+    entry->shard = NULL;
+    entry->hash = 0;
+    entry->expires_ms = 0;
+    entry->references = 1;
+    entry->evicted = true;
+    entry->bucket_next = NULL;
+    entry->lru.prev = NULL;
+    entry->lru.next = NULL;
+    return entry;
+}
+
+void netc_response_cache_retain(netc_cache_entry *entry)
+{
+    /* the caller holds a reference, so the entry cannot be freed meanwhile */
+    atomic_fetch_add(&entry->references, 1);
+}
+
+bool netc_response_cache_matches(const netc_cache_entry *entry, const http_request *request)
+{
+    return entry != NULL && request != NULL && cache_vary_matches(entry, request);
+}
+
+void netc_response_cache_release(netc_cache_entry *entry)
+{
+    if (entry == NULL) return;
+
+    netc_cache_shard *shard = entry->shard;
+    if (shard == NULL)
+    {
+        if (atomic_fetch_sub(&entry->references, 1) == 1)
+            free(entry);
+        return;
+    }
+
+    pthread_mutex_lock(&shard->mutex);
+    entry->references--;
+    bool unused = entry->evicted && entry->references == 0;
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (unused)
+        free(entry);
+}
+
+void netc_response_cache_destroy(netc_response_cache *cache)
+{
+    if (cache == NULL || cache->shards == NULL) return;
+
+    for (size_t i = 0; i < NETC_RESPONSE_CACHE_SHARDS; i++)
+    {
+        netc_cache_entry *entry = NETC_LRU_ENTRY(cache->shards[i].lru.head, netc_cache_entry, lru);
+        while (entry != NULL)
+        {
+            netc_cache_entry *next = NETC_LRU_ENTRY(entry->lru.next, netc_cache_entry, lru);
+            free(entry);
+            entry = next;
+        }
+        pthread_mutex_destroy(&cache->shards[i].mutex);
+    }
+
+    free(cache->shards);
+    cache->shards = NULL;
+}
+
+uint64_t cache_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+bool cache_ttl(const http_response *response, uint32_t default_ttl_ms, uint64_t *ttl_ms)
+{
+    *ttl_ms = default_ttl_ms;
+    const char *cache_control = http_response_get_header(response, "Cache-Control");
+    if (cache_control == NULL)
+        return default_ttl_ms > 0;
+
+    if (strcasestr(cache_control, "no-store") != NULL || strcasestr(cache_control, "no-cache") != NULL ||
+        strcasestr(cache_control, "private") != NULL)
+        return false;
+
+    /* the shared-cache lifetime wins over the one meant for browsers */
+    const char *max_age = strcasestr(cache_control, "s-maxage=");
+    if (max_age != NULL)
+        max_age += 9;
+    else if ((max_age = strcasestr(cache_control, "max-age=")) != NULL)
+        max_age += 8;
+
+    if (max_age != NULL)
+        *ttl_ms = strtoull(max_age, NULL, 10) * 1000;
+    return *ttl_ms > 0;
+}
+
+bool cache_vary(const http_request *request, const http_response *response, char *vary, size_t *length)
+{
+    /* the request headers the response depends on, as name\0value\0 pairs */
+    *length = 0;
+    const char *names = http_response_get_header(response, "Vary");
+    if (names == NULL)
+        return true;
+
+    while (*names != '\0')
+    {
+        while (*names == ' ' || *names == ',')
+            names++;
+        size_t name_length = strcspn(names, ", ");
+        if (name_length == 0)
+            continue;
+        if (name_length == 1 && names[0] == '*')
+            return false;
+        if (*length + name_length + 1 > NETC_RESPONSE_CACHE_MAX_VARY)
+            return false;
+
+        char *name = vary + *length;
+        memcpy(name, names, name_length);
+        name[name_length] = '\0';
+        *length += name_length + 1;
+        names += name_length;
+
+        const char *value = http_request_get_header(request, name);
+        size_t value_length = value != NULL ? strlen(value) : 0;
+        if (*length + value_length + 1 > NETC_RESPONSE_CACHE_MAX_VARY)
+            return false;
+        memcpy(vary + *length, value != NULL ? value : "", value_length + 1);
+        *length += value_length + 1;
+    }
+
+    return true;
+}
+
+bool cache_vary_matches(const netc_cache_entry *entry, const http_request *request)
+{
+    const char *cursor = entry->vary;
+    const char *end = entry->vary + entry->vary_length;
+    while (cursor < end)
+    {
+        const char *name = cursor;
+        const char *value = name + strlen(name) + 1;
+        cursor = value + strlen(value) + 1;
+
+        const char *current = http_request_get_header(request, name);
+        if (strcmp(current != NULL ? current : "", value) != 0)
+            return false;
+    }
+    return true;
+}
+
+size_t cache_head_length(const http_response *response)
+{
+    char status_line[64];
+    int length = snprintf(status_line, sizeof(status_line), "HTTP/1.1 %d %s\r\n", response->status_code,
+                          response->status_text != NULL ? response->status_text : "");
+    if (length < 0 || (size_t)length >= sizeof(status_line))
+        return 0;
+
+    size_t head_length = length;
+    for (size_t i = 0; i < response->header_count; i++)
+    {
+        if (strcasecmp(response->headers[i].name, "Connection") != 0)
+            head_length += strlen(response->headers[i].name) + strlen(response->headers[i].value) + 4;
+    }
+    return head_length;
+}
+
+netc_cache_entry *cache_serialize(const http_request *request, const http_response *response,
+                                  const char *vary, size_t vary_length)
+{
+    size_t key_length = strlen(request->path);
+    size_t head_length = cache_head_length(response);
+    if (head_length == 0)
+        return NULL;
+
+    const char *etag = http_response_get_header(response, "ETag");
+    const char *last_modified = http_response_get_header(response, "Last-Modified");
+    const char *content_type = http_response_get_header(response, "Content-Type");
+    size_t etag_length = etag != NULL ? strlen(etag) + 1 : 0;
+    size_t last_modified_length = last_modified != NULL ? strlen(last_modified) + 1 : 0;
+    size_t content_type_length = content_type != NULL ? strlen(content_type) + 1 : 0;
+
+    /* the entry, its key and the serialized response share one allocation */
+    size_t charge = sizeof(netc_cache_entry) + key_length + vary_length + head_length + response->body_length +
+                    etag_length + last_modified_length + content_type_length;
+    netc_cache_entry *entry = malloc(charge);
+    if (entry == NULL)
+        return NULL;
+
+    char *cursor = (char*)(entry + 1);
+    memcpy(cursor, request->path, key_length);
+    entry->key = cursor;
+    entry->key_length = key_length;
+    cursor += key_length;
+
+    memcpy(cursor, vary, vary_length);
+    entry->vary = cursor;
+    entry->vary_length = vary_length;
+    cursor += vary_length;
+
+    entry->head = cursor;
+    entry->head_length = head_length;
+    char status_line[64];
+    int status_length = snprintf(status_line, sizeof(status_line), "HTTP/1.1 %d %s\r\n", response->status_code,
+                                 response->status_text != NULL ? response->status_text : "");
+    memcpy(cursor, status_line, status_length);
+    entry->status_length = status_length;
+    cursor += status_length;
+    for (size_t i = 0; i < response->header_count; i++)
+    {
+        /* the connection state of the first client is no one else's */
+        if (strcasecmp(response->headers[i].name, "Connection") == 0)
+            continue;
+
+        size_t name_length = strlen(response->headers[i].name);
+        size_t value_length = strlen(response->headers[i].value);
+        memcpy(cursor, response->headers[i].name, name_length);
+        cursor += name_length;
+        *cursor++ = ':';
+        *cursor++ = ' ';
+        memcpy(cursor, response->headers[i].value, value_length);
+        cursor += value_length;
+        *cursor++ = '\r';
+        *cursor++ = '\n';
+    }
+
+    entry->body = cursor;
+    entry->body_length = response->body_length;
+    if (response->body_length > 0)
+        memcpy(cursor, response->body, response->body_length);
+    cursor += response->body_length;
+
+    entry->etag = etag != NULL ? memcpy(cursor, etag, etag_length) : NULL;
+    cursor += etag_length;
+    entry->last_modified = last_modified != NULL ? memcpy(cursor, last_modified, last_modified_length) : NULL;
+    cursor += last_modified_length;
+    entry->content_type = content_type != NULL ? memcpy(cursor, content_type, content_type_length) : NULL;
+
+    entry->charge = charge;
+    return entry;
+}
+
+netc_cache_shard *cache_shard(netc_response_cache *cache, uint64_t hash)
+{
+    /* the high bits pick the shard, the low bits the bucket inside it */
+    return &cache->shards[(hash >> 32) % NETC_RESPONSE_CACHE_SHARDS];
+}
+
+void cache_unlink(netc_cache_shard *shard, netc_cache_entry *entry)
+{
+    netc_cache_entry **link = &shard->buckets[entry->hash & (NETC_RESPONSE_CACHE_BUCKETS - 1)];
+    while (*link != entry)
+        link = &(*link)->bucket_next;
+    *link = entry->bucket_next;
+    netc_lru_remove(&shard->lru, &entry->lru);
+    shard->size -= entry->charge;
+
+    /* a response still being sent is freed by its last release */
+    if (entry->references > 0)
+        entry->evicted = true;
+    else
+        free(entry);
+}
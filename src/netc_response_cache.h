@@ -0,0 +1,153 @@
+#ifndef NETC_RESPONSE_CACHE_H
+#define NETC_RESPONSE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "netc_http.h"
+#include "netc_lru.h"
+
+#define NETC_RESPONSE_CACHE_SHARDS       16
+#define NETC_RESPONSE_CACHE_BUCKETS      1024
+#define NETC_RESPONSE_CACHE_DEFAULT_SIZE ((size_t)64 * 1024 * 1024)
+#define NETC_RESPONSE_CACHE_DEFAULT_TTL  1000
+#define NETC_RESPONSE_CACHE_MAX_VARY     512
+
+/* a serialized response: the status line and headers, without the
+ * Connection header and the blank line ending the head, followed by the
+ * body, and its ETag, Last-Modified and Content-Type values for conditional
+ * and range requests. Entries are shared: each netc_response_cache_lookup,
+ * netc_response_cache_share or netc_response_cache_retain must be matched
+ * by one netc_response_cache_release, an entry evicted or replaced while in
+ * use is freed by the last release. Shared entries outside the cache have
+ * no shard */
+typedef struct netc_cache_entry
+{
+    struct netc_cache_shard *shard;
+    uint64_t                 hash;
+    const char              *key;
+    size_t                   key_length;
+    const char              *vary;
+    size_t                   vary_length;
+    const char              *head;
+    size_t                   head_length;
+    size_t                   status_length;
+    const char              *body;
+    size_t                   body_length;
+    const char              *etag;
+    const char              *last_modified;
+    const char              *content_type;
+    uint64_t                 expires_ms;
+    size_t                   charge;
+    atomic_size_t            references;
+    bool                     evicted;
+    struct netc_cache_entry *bucket_next;
+    netc_lru_node            lru;
+} netc_cache_entry;
+
+/* one lock, one hash table and one LRU list per shard, so event loops and
+ * workers touching different keys rarely wait for each other */
+typedef struct netc_cache_shard
+{
+    pthread_mutex_t          mutex;
+    netc_cache_entry        *buckets[NETC_RESPONSE_CACHE_BUCKETS];
+    size_t                   size;
+    size_t                   budget;
+    netc_lru_list            lru;
+    uint64_t                 hits;
+    uint64_t                 misses;
+} netc_cache_shard;
+
+typedef struct
+{
+    netc_cache_shard        *shards;
+    uint32_t                 default_ttl_ms;
+} netc_response_cache;
+
+/**
+ * @brief prepares an empty cache. The budget is split evenly between the
+ * shards, a response larger than the share of one shard is never stored
+ *
+ * @param cache pointer to the cache to initialize
+ * @param budget most bytes the entries may take, bookkeeping included
+ * @param default_ttl_ms lifetime of responses without a Cache-Control max-age
+ * @return true on success
+ * @return false on invalid arguments or allocation failure
+ */
+bool netc_response_cache_init(netc_response_cache *cache, size_t budget, uint32_t default_ttl_ms);
+
+/**
+ * @brief finds the fresh response stored for the method and path of
+ * request, whose Vary headers match those of request. HEAD requests are
+ * answered from the GET response
+ *
+ * @param cache pointer to the cache
+ * @param request the request to answer
+ * @return netc_cache_entry* the response, NULL on a miss
+ */
+netc_cache_entry *netc_response_cache_lookup(netc_response_cache *cache, const http_request *request);
+
+/**
+ * @brief stores a copy of the response to a GET request, replacing the
+ * previous one for the same key. Only 200 responses are stored, and neither
+ * those setting cookies, marked no-store, no-cache or private, nor those
+ * varying on every header. A Cache-Control s-maxage or max-age overrides
+ * the default lifetime. Least recently used entries are evicted to stay
+ * within budget
+ *
+ * @param cache pointer to the cache
+ * @param request the request the response answers
+ * @param response the complete response, its Connection header is skipped
+ * @return true if the response was stored
+ * @return false if it may not be cached or on allocation failure
+ */
+bool netc_response_cache_store(netc_response_cache *cache, const http_request *request,
+                               const http_response *response);
+
+/**
+ * @brief serializes a response to be sent to other clients that made the
+ * same request, without storing it. Responses setting cookies, marked
+ * no-store or private, or varying on every header are not shared
+ *
+ * @param request the request the response answers
+ * @param response the complete response, its Connection header is skipped
+ * @return netc_cache_entry* the entry, held once by the caller, NULL if the
+ * response may not be shared or on allocation failure
+ */
+netc_cache_entry *netc_response_cache_share(const http_request *request, const http_response *response);
+
+/**
+ * @brief takes one more reference to an entry the caller already holds
+ *
+ * @param entry the entry to retain
+ */
+void netc_response_cache_retain(netc_cache_entry *entry);
+
+/**
+ * @brief tells whether the headers a response varies on have the same
+ * values in request as in the request it answered
+ *
+ * @param entry the serialized response
+ * @param request the request to answer with it
+ * @return true if entry answers request
+ */
+bool netc_response_cache_matches(const netc_cache_entry *entry, const http_request *request);
+
+/**
+ * @brief gives back an entry returned by netc_response_cache_lookup,
+ * netc_response_cache_share or held through netc_response_cache_retain
+ *
+ * @param entry the entry to release, may be NULL
+ */
+void netc_response_cache_release(netc_cache_entry *entry);
+
+/**
+ * @brief frees every entry. No entry may still be in use
+ *
+ * @param cache pointer to the cache to destroy
+ */
+void netc_response_cache_destroy(netc_response_cache *cache);
+
+#endif // NETC_RESPONSE_CACHE_H
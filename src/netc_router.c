@@ -0,0 +1,362 @@
+#include "netc_router.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* static nodes hold a run of bytes shared by every route below them,
+ * parameter and wildcard nodes hold the name they capture under */
+struct netc_route_node
+{
+    char             *prefix;
+    size_t            prefix_length;
+    char             *indices;
+    netc_route_node **children;
+    size_t            child_count;
+    netc_route_node  *param_child;
+    netc_route_node  *wildcard_child;
+    void             *value;
+};
+
+int method_index(const char *method);
+bool valid_pattern(const char *path);
+netc_route_node *create_node(const char *prefix, size_t length);
+bool add_child(netc_route_node *parent, netc_route_node *child);
+bool split_node(netc_route_node *node, size_t at);
+netc_route_node *insert_route(netc_route_node *node, const char *path);
+bool match_node(const netc_route_node *node, const char *path, size_t length, netc_route_match *match);
+void free_node(netc_route_node *node);
+
+_Static_assert(NETC_ROUTER_METHOD_COUNT <= 16, "allowed_methods is a 16 bit mask");
+
+void netc_router_init(netc_router *router)
+{
+    memset(router, 0, sizeof(netc_router));
+}
+
+bool netc_router_add(netc_router *router, const char *method, const char *path,
+                     const void *value, size_t value_size)
+{
+    if (router == NULL || method == NULL || path == NULL || value == NULL || value_size == 0)
+        return false;
+
+    int index = method_index(method);
+    if (index < 0 || valid_pattern(path) == false)
+        return false;
+
+    if (router->trees[index] == NULL)
+    {
+        router->trees[index] = create_node("", 0);
+        if (router->trees[index] == NULL)
+            return false;
+    }
+
+    netc_route_node *node = insert_route(router->trees[index], path);
+    if (node == NULL)
+        return false;
+
+    void *copy = malloc(value_size);
+    if (copy == NULL)
+        return false;
+    memcpy(copy, value, value_size);
+
+    free(node->value);
+    node->value = copy;
+    return true;
+}
+
+netc_route_result netc_router_match(const netc_router *router, const char *method, const char *path,
+                                    netc_route_match *match)
+{
+    match->value = NULL;
+    match->param_count = 0;
+    match->allowed_methods = 0;
+    if (router == NULL || method == NULL || path == NULL)
+        return NETC_ROUTE_NOT_FOUND;
+
+    size_t length = strcspn(path, "?");
+    int index = method_index(method);
+    if (index >= 0 && router->trees[index] != NULL && match_node(router->trees[index], path, length, match))
+        return NETC_ROUTE_FOUND;
+
+    /* the other trees are only searched on a miss, to tell 405 from 404 */
+    for (int i = 0; i < NETC_ROUTER_METHOD_COUNT; i++)
+    {
+        match->param_count = 0;
+        if (i != index && router->trees[i] != NULL && match_node(router->trees[i], path, length, match))
+            match->allowed_methods |= 1 << i;
+    }
+    match->value = NULL;
+    match->param_count = 0;
+
+    return match->allowed_methods != 0 ? NETC_ROUTE_METHOD_NOT_ALLOWED : NETC_ROUTE_NOT_FOUND;
+}
+
+size_t netc_router_format_allowed(uint16_t allowed_methods, char *buffer, size_t capacity)
+{
+    if (buffer == NULL || capacity == 0)
+        return 0;
+
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (int i = 0; i < NETC_ROUTER_METHOD_COUNT; i++)
+    {
+        if ((allowed_methods & (1 << i)) == 0)
+            continue;
+
+        size_t method_length = strlen(http_methods[i]);
+        size_t separator = length > 0 ? 2 : 0;
+        if (length + separator + method_length + 1 > capacity)
+            return 0;
+
+        memcpy(buffer + length, ", ", separator);
+        memcpy(buffer + length + separator, http_methods[i], method_length + 1);
+        length += separator + method_length;
+    }
+
+    return length;
+}
+
+void netc_router_destroy(netc_router *router)
+{
+    if (router == NULL) return;
+
+    for (int i = 0; i < NETC_ROUTER_METHOD_COUNT; i++)
+    {
+        free_node(router->trees[i]);
+        router->trees[i] = NULL;
+    }
+}
+
+int method_index(const char *method)
+{
+    for (int i = 0; i < http_methods_count; i++)
+    {
+        if (strcmp(http_methods[i], method) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+bool valid_pattern(const char *path)
+{
+    if (path[0] != '/')
+        return false;
+
+    size_t params = 0;
+    for (const char *c = path; *c != '\0'; c++)
+    {
+        if (*c != ':' && *c != '*')
+            continue;
+
+        /* captures span whole segments, and a wildcard ends the pattern */
+        if (c[-1] != '/' || (*c == ':' && (c[1] == '/' || c[1] == '\0')))
+            return false;
+        if (*c == '*' && strchr(c, '/') != NULL)
+            return false;
+        if (++params > HTTP_MAX_PATH_PARAMS)
+            return false;
+    }
+
+    return true;
+}
+
+netc_route_node *create_node(const char *prefix, size_t length)
+{
+    netc_route_node *node = calloc(1, sizeof(netc_route_node));
+    if (node == NULL) return NULL;
+
+    node->prefix = strndup(prefix, length);
+    if (node->prefix == NULL)
+    {
+        free(node);
+        return NULL;
+    }
+
+    node->prefix_length = length;
+    return node;
+}
+
+bool add_child(netc_route_node *parent, netc_route_node *child)
+{
+    char *indices = realloc(parent->indices, parent->child_count + 1);
+    if (indices == NULL) return false;
+    parent->indices = indices;
+
+    netc_route_node **children = realloc(parent->children, (parent->child_count + 1) * sizeof(netc_route_node*));
+    if (children == NULL) return false;
+    parent->children = children;
+
+    parent->indices[parent->child_count] = child->prefix[0];
+    parent->children[parent->child_count] = child;
+    parent->child_count++;
+    return true;
+}
+
+bool split_node(netc_route_node *node, size_t at)
+{
+    /* the tail moves to a new child that takes over everything below node,
+     * so the parent keeps pointing at the same node */
+    netc_route_node *tail = create_node(node->prefix + at, node->prefix_length - at);
+    if (tail == NULL) return false;
+
+    char *indices = malloc(1);
+    netc_route_node **children = malloc(sizeof(netc_route_node*));
+    if (indices == NULL || children == NULL)
+    {
+        free(indices);
+        free(children);
+        free_node(tail);
+        return false;
+    }
+
+    tail->indices = node->indices;
+    tail->children = node->children;
+    tail->child_count = node->child_count;
+    tail->param_child = node->param_child;
+    tail->wildcard_child = node->wildcard_child;
+    tail->value = node->value;
+
+    indices[0] = tail->prefix[0];
+    children[0] = tail;
+    node->indices = indices;
+    node->children = children;
+    node->child_count = 1;
+    node->param_child = NULL;
+    node->wildcard_child = NULL;
+    node->value = NULL;
+    node->prefix[at] = '\0';
+    node->prefix_length = at;
+    return true;
+}
+
+netc_route_node *insert_route(netc_route_node *node, const char *path)
+{
+    while (*path != '\0')
+    {
+        if (*path == ':' || *path == '*')
+        {
+            bool wildcard = *path == '*';
+            size_t length = strcspn(path + 1, "/");
+            const char *name = path + 1;
+            if (wildcard && length == 0)
+            {
+                name = "*";
+                length = 1;
+            }
+
+            netc_route_node **slot = wildcard ? &node->wildcard_child : &node->param_child;
+            if (*slot == NULL)
+            {
+                *slot = create_node(name, length);
+                if (*slot == NULL) return NULL;
+            }
+            /* one position captured under two names would be ambiguous */
+            else if ((*slot)->prefix_length != length || memcmp((*slot)->prefix, name, length) != 0)
+            {
+                return NULL;
+            }
+
+            node = *slot;
+            path += strcspn(path, "/");
+            continue;
+        }
+
+        size_t length = strcspn(path, ":*");
+        const char *index = node->indices != NULL ? memchr(node->indices, path[0], node->child_count) : NULL;
+        if (index == NULL)
+        {
+            netc_route_node *child = create_node(path, length);
+            if (child == NULL) return NULL;
+            if (add_child(node, child) == false)
+            {
+                free_node(child);
+                return NULL;
+            }
+
+            node = child;
+            path += length;
+            continue;
+        }
+
+        netc_route_node *child = node->children[index - node->indices];
+        size_t common = 0;
+        while (common < length && common < child->prefix_length && child->prefix[common] == path[common])
+            common++;
+
+        if (common < child->prefix_length && split_node(child, common) == false)
+            return NULL;
+
+        node = child;
+        path += common;
+    }
+
+    return node;
+}
+
+bool match_node(const netc_route_node *node, const char *path, size_t length, netc_route_match *match)
+{
+    if (length == 0 && node->value != NULL)
+    {
+        match->value = node->value;
+        return true;
+    }
+
+    if (length > 0 && node->indices != NULL)
+    {
+        const char *index = memchr(node->indices, path[0], node->child_count);
+        if (index != NULL)
+        {
+            const netc_route_node *child = node->children[index - node->indices];
+            if (child->prefix_length <= length && memcmp(child->prefix, path, child->prefix_length) == 0 &&
+                match_node(child, path + child->prefix_length, length - child->prefix_length, match))
+                return true;
+        }
+    }
+
+    /* a static miss backtracks into the parameter, then the wildcard */
+    if (node->param_child != NULL)
+    {
+        size_t segment = 0;
+        while (segment < length && path[segment] != '/')
+            segment++;
+
+        if (segment > 0)
+        {
+            http_path_param *param = &match->params[match->param_count++];
+            param->name = node->param_child->prefix;
+            param->value = path;
+            param->length = segment;
+            if (match_node(node->param_child, path + segment, length - segment, match))
+                return true;
+            match->param_count--;
+        }
+    }
+
+    if (node->wildcard_child != NULL && node->wildcard_child->value != NULL)
+    {
+        http_path_param *param = &match->params[match->param_count++];
+        param->name = node->wildcard_child->prefix;
+        param->value = path;
+        param->length = length;
+        match->value = node->wildcard_child->value;
+        return true;
+    }
+
+    return false;
+}
+
+void free_node(netc_route_node *node)
+{
+    if (node == NULL) return;
+
+    for (size_t i = 0; i < node->child_count; i++)
+        free_node(node->children[i]);
+    free_node(node->param_child);
+    free_node(node->wildcard_child);
+    free(node->children);
+    free(node->indices);
+    free(node->prefix);
+    free(node->value);
+    free(node);
+}
@@ -0,0 +1,94 @@
+#ifndef NETC_ROUTER_H
+#define NETC_ROUTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "netc_http.h"
+
+#define NETC_ROUTER_METHOD_COUNT 9
+
+typedef enum
+{
+    NETC_ROUTE_FOUND,
+    NETC_ROUTE_NOT_FOUND,
+    NETC_ROUTE_METHOD_NOT_ALLOWED
+} netc_route_result;
+
+typedef struct netc_route_node netc_route_node;
+
+/* one compressed radix tree per method, in the order of http_methods */
+typedef struct
+{
+    netc_route_node *trees[NETC_ROUTER_METHOD_COUNT];
+} netc_router;
+
+typedef struct
+{
+    void            *value;
+    http_path_param  params[HTTP_MAX_PATH_PARAMS];
+    size_t           param_count;
+    uint16_t         allowed_methods;
+} netc_route_match;
+
+/**
+ * @brief initializes an empty router
+ *
+ * @param router pointer to the router to initialize
+ */
+void netc_router_init(netc_router *router);
+
+/**
+ * @brief registers a route. Path segments starting with ':' capture one
+ * segment under the name that follows, a final segment starting with '*'
+ * captures the rest of the path. A static segment wins over a parameter,
+ * which wins over a wildcard. Registering the same route again replaces
+ * its value
+ *
+ * @param router pointer to the router
+ * @param method http method of the route
+ * @param path route pattern, e.g. /users/:id or /static/ followed by *path
+ * @param value bytes stored with the route, copied
+ * @param value_size size of value
+ * @return true on success
+ * @return false on an invalid pattern, a parameter name conflicting with
+ * an existing route, more than HTTP_MAX_PATH_PARAMS parameters or
+ * allocation failure
+ */
+bool netc_router_add(netc_router *router, const char *method, const char *path,
+                     const void *value, size_t value_size);
+
+/**
+ * @brief finds the route of a request without allocating. The query string
+ * is ignored. Captured parameters are views into path, so they are valid as
+ * long as path is
+ *
+ * @param router pointer to the router
+ * @param method http method of the request
+ * @param path request target
+ * @param match filled with the stored value and the captured parameters on
+ * NETC_ROUTE_FOUND, with the bitmask of the methods that do match path (bit
+ * i for http_methods[i]) on NETC_ROUTE_METHOD_NOT_ALLOWED
+ * @return netc_route_result NETC_ROUTE_FOUND, NETC_ROUTE_METHOD_NOT_ALLOWED
+ * when path only matches routes of other methods, NETC_ROUTE_NOT_FOUND
+ */
+netc_route_result netc_router_match(const netc_router *router, const char *method, const char *path,
+                                    netc_route_match *match);
+
+/**
+ * @brief formats a bitmask of methods as the value of an Allow header
+ *
+ * @param allowed_methods bitmask set by netc_router_match
+ * @param buffer where to write the NUL-terminated list
+ * @param capacity size of buffer
+ * @return size_t length of the list, 0 if it did not fit
+ */
+size_t netc_router_format_allowed(uint16_t allowed_methods, char *buffer, size_t capacity);
+
+/**
+ * @brief frees every route of a router
+ *
+ * @param router pointer to the router to destroy
+ */
+void netc_router_destroy(netc_router *router);
+
+#endif // NETC_ROUTER_H
@@ -0,0 +1,338 @@
+#include "netc_scheduler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+_Static_assert((NETC_SCHEDULER_QUEUE_CAPACITY & (NETC_SCHEDULER_QUEUE_CAPACITY - 1)) == 0,
+               "the queue capacity must be a power of two");
+
+#define QUEUE_MASK (NETC_SCHEDULER_QUEUE_CAPACITY - 1)
+
+typedef struct
+{
+    atomic_size_t sequence;
+    netc_task     task;
+} queue_slot;
+
+/* a bounded multi-producer multi-consumer queue: the event loops push, the
+ * owner and thieves pop. A slot is free for position p when its sequence
+ * equals p and holds a task when it equals p + 1 */
+struct netc_worker
+{
+    _Alignas(64) atomic_size_t tail;
+    _Alignas(64) atomic_size_t head;
+    _Alignas(64) atomic_uint   wake;
+    atomic_bool                parked;
+    _Atomic uint64_t           executed;
+    _Atomic uint64_t           stolen;
+    _Atomic uint64_t           overflowed;
+    uint32_t                   random_state;
+    size_t                     index;
+    pthread_t                  thread;
+    netc_scheduler            *scheduler;
+    queue_slot                 slots[NETC_SCHEDULER_QUEUE_CAPACITY];
+};
+
+bool enqueue(netc_worker *worker, const netc_task *task);
+bool dequeue(netc_worker *worker, netc_task *task);
+bool steal(netc_worker *thief, netc_task *task);
+bool has_work(const netc_scheduler *scheduler);
+void park(netc_worker *worker);
+void wake_worker(netc_worker *worker);
+void wake_idle_worker(netc_scheduler *scheduler, size_t start);
+void *worker_thread(void *arg);
+
+bool netc_scheduler_init(netc_scheduler *scheduler, size_t worker_count, bool pin_workers)
+{
+    if (scheduler == NULL || worker_count == 0)
+        return false;
+
+    memset(scheduler, 0, sizeof(netc_scheduler));
+    scheduler->workers = aligned_alloc(_Alignof(netc_worker), worker_count * sizeof(netc_worker));
+    if (scheduler->workers == NULL)
+        return false;
+
+    atomic_init(&scheduler->idle_count, 0);
+    atomic_init(&scheduler->stopping, false);
+
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        netc_worker *worker = &scheduler->workers[i];
+        memset(worker, 0, sizeof(netc_worker));
+        for (size_t slot = 0; slot < NETC_SCHEDULER_QUEUE_CAPACITY; slot++)
+            atomic_init(&worker->slots[slot].sequence, slot);
+        worker->index = i;
+        worker->random_state = (uint32_t)(i * 2654435761u) | 1;
+        worker->scheduler = scheduler;
+    }
+
+    /* running workers read the count to pick victims, so it never changes
+     * once the first thread is up */
+    scheduler->worker_count = worker_count;
+
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (size_t i = 0; i < worker_count; i++)
+    {
+        if (pthread_create(&scheduler->workers[i].thread, NULL, worker_thread, &scheduler->workers[i]) != 0)
+        {
+            netc_scheduler_destroy(scheduler);
+            return false;
+        }
+        scheduler->started++;
+
+        if (pin_workers && online_cpus > 0)
+        {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(i % online_cpus, &cpu_set);
+            pthread_setaffinity_np(scheduler->workers[i].thread, sizeof(cpu_set), &cpu_set);
+        }
+    }
+
+    return true;
+}
+
+bool netc_scheduler_submit(netc_scheduler *scheduler, const netc_task *task, size_t affinity)
+{
+    if (scheduler == NULL || task == NULL || task->function == NULL || scheduler->worker_count == 0)
+        return false;
+
+    /* a full queue spills into the next one with room rather than into a
+     * shared queue, so overload never funnels the workers through one lock
+     * and the memory held by waiting tasks stays bounded */
+    netc_worker *home = &scheduler->workers[affinity % scheduler->worker_count];
+    netc_worker *target = home;
+    for (size_t i = 1; enqueue(target, task) == false; i++)
+    {
+        if (i == scheduler->worker_count)
+            return false;
+        target = &scheduler->workers[(home->index + i) % scheduler->worker_count];
+    }
+    if (target != home)
+        atomic_fetch_add_explicit(&home->overflowed, 1, memory_order_relaxed);
+
+    /* pairs with the fence in park: either the worker sees the task or we
+     * see it parked */
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&target->parked, memory_order_relaxed))
+    {
+        wake_worker(target);
+        return true;
+    }
+
+    /* the worker is busy, so the task would wait behind a running handler
+     * while another core sleeps */
+    if (atomic_load_explicit(&scheduler->idle_count, memory_order_relaxed) > 0)
+        wake_idle_worker(scheduler, target->index + 1);
+
+    return true;
+}
+
+size_t netc_scheduler_queue_depth(const netc_scheduler *scheduler, size_t worker)
+{
+    if (scheduler == NULL || worker >= scheduler->worker_count)
+        return 0;
+
+    netc_worker *queue = &scheduler->workers[worker];
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
+
+netc_scheduler_stats netc_scheduler_get_stats(const netc_scheduler *scheduler, size_t worker)
+{
+    netc_scheduler_stats stats = { 0 };
+    if (scheduler == NULL || worker > scheduler->worker_count)
+        return stats;
+
+    size_t first = worker == scheduler->worker_count ? 0 : worker;
+    size_t last = worker == scheduler->worker_count ? scheduler->worker_count : worker + 1;
+    for (size_t i = first; i < last; i++)
+    {
+        netc_worker *current = &scheduler->workers[i];
+        stats.executed += atomic_load_explicit(&current->executed, memory_order_relaxed);
+        stats.stolen += atomic_load_explicit(&current->stolen, memory_order_relaxed);
+        stats.overflowed += atomic_load_explicit(&current->overflowed, memory_order_relaxed);
+        stats.queue_depth += netc_scheduler_queue_depth(scheduler, i);
+    }
+
+    return stats;
+}
+
+void netc_scheduler_destroy(netc_scheduler *scheduler)
+{
+    if (scheduler == NULL || scheduler->workers == NULL) return;
+
+    /* workers only exit once they find nothing left to run */
+    atomic_store(&scheduler->stopping, true);
+    for (size_t i = 0; i < scheduler->started; i++)
+        wake_worker(&scheduler->workers[i]);
+    for (size_t i = 0; i < scheduler->started; i++)
+        pthread_join(scheduler->workers[i].thread, NULL);
+
+    free(scheduler->workers);
+    scheduler->workers = NULL;
+    scheduler->worker_count = 0;
+    scheduler->started = 0;
+}
+
+bool enqueue(netc_worker *worker, const netc_task *task)
+{
+    size_t position = atomic_load_explicit(&worker->tail, memory_order_relaxed);
+    while (true)
+    {
+        queue_slot *slot = &worker->slots[position & QUEUE_MASK];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&worker->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                slot->task = *task;
+                atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = atomic_load_explicit(&worker->tail, memory_order_relaxed);
+        }
+    }
+}
+
+bool dequeue(netc_worker *worker, netc_task *task)
+{
+    size_t position = atomic_load_explicit(&worker->head, memory_order_relaxed);
+    while (true)
+    {
+        queue_slot *slot = &worker->slots[position & QUEUE_MASK];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&worker->head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                *task = slot->task;
+                atomic_store_explicit(&slot->sequence, position + QUEUE_MASK + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (difference < 0)
+        {
+            return false;
+        }
+        else
+        {
+            position = atomic_load_explicit(&worker->head, memory_order_relaxed);
+        }
+    }
+}
+
+bool steal(netc_worker *thief, netc_task *task)
+{
+    netc_scheduler *scheduler = thief->scheduler;
+    if (scheduler->worker_count < 2)
+        return false;
+
+    /* xorshift32: a random first victim keeps thieves from ganging up on
+     * the same queue */
+    uint32_t random = thief->random_state;
+    random ^= random << 13;
+    random ^= random >> 17;
+    random ^= random << 5;
+    thief->random_state = random;
+
+    size_t start = random % scheduler->worker_count;
+    for (size_t i = 0; i < scheduler->worker_count; i++)
+    {
+        netc_worker *victim = &scheduler->workers[(start + i) % scheduler->worker_count];
+        if (victim != thief && dequeue(victim, task))
+        {
+            atomic_fetch_add_explicit(&thief->stolen, 1, memory_order_relaxed);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool has_work(const netc_scheduler *scheduler)
+{
+    for (size_t i = 0; i < scheduler->worker_count; i++)
+    {
+        if (netc_scheduler_queue_depth(scheduler, i) > 0)
+            return true;
+    }
+
+    return false;
+}
+
+void park(netc_worker *worker)
+{
+    netc_scheduler *scheduler = worker->scheduler;
+
+    unsigned wake = atomic_load(&worker->wake);
+    atomic_store(&worker->parked, true);
+    atomic_fetch_add(&scheduler->idle_count, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (has_work(scheduler) == false && atomic_load(&scheduler->stopping) == false)
+        syscall(SYS_futex, &worker->wake, FUTEX_WAIT_PRIVATE, wake, NULL, NULL, 0);
+    atomic_fetch_sub(&scheduler->idle_count, 1);
+    atomic_store(&worker->parked, false);
+}
+
+void wake_worker(netc_worker *worker)
+{
+    atomic_fetch_add(&worker->wake, 1);
+    syscall(SYS_futex, &worker->wake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void wake_idle_worker(netc_scheduler *scheduler, size_t start)
+{
+    for (size_t i = 0; i < scheduler->worker_count; i++)
+    {
+        netc_worker *worker = &scheduler->workers[(start + i) % scheduler->worker_count];
+        if (atomic_load_explicit(&worker->parked, memory_order_relaxed))
+        {
+            wake_worker(worker);
+            return;
+        }
+    }
+}
+
+void *worker_thread(void *arg)
+{
+    netc_worker *worker = arg;
+    netc_scheduler *scheduler = worker->scheduler;
+    netc_task task;
+
+    while (true)
+    {
+        if (dequeue(worker, &task) || steal(worker, &task))
+        {
+            task.function(task.argp);
+            atomic_fetch_add_explicit(&worker->executed, 1, memory_order_relaxed);
+            continue;
+        }
+
+        if (atomic_load(&scheduler->stopping))
+            break;
+
+        park(worker);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,95 @@
+#ifndef NETC_SCHEDULER_H
+#define NETC_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#define NETC_SCHEDULER_QUEUE_CAPACITY 1024
+
+typedef struct
+{
+    void *(*function)(void*);
+    void  *argp;
+} netc_task;
+
+typedef struct netc_worker netc_worker;
+
+/* every worker runs the tasks of its own queue first and only steals from
+ * a random other queue when it runs dry, so work submitted with the same
+ * affinity stays on one worker until that worker falls behind. There is no
+ * shared queue: a full queue spills into the next one with room */
+typedef struct
+{
+    netc_worker        *workers;
+    size_t              worker_count;
+    size_t              started;
+    _Alignas(64) atomic_size_t idle_count;
+    atomic_bool         stopping;
+} netc_scheduler;
+
+typedef struct
+{
+    uint64_t executed;
+    uint64_t stolen;
+    uint64_t overflowed;
+    size_t   queue_depth;
+} netc_scheduler_stats;
+
+/**
+ * @brief starts worker_count workers, each with a bounded queue of
+ * NETC_SCHEDULER_QUEUE_CAPACITY tasks
+ *
+ * @param scheduler pointer to the scheduler to initialize
+ * @param worker_count number of worker threads, at least 1
+ * @param pin_workers pins worker i to core i
+ * @return true on success
+ * @return false on invalid arguments, allocation or thread creation failure
+ */
+bool netc_scheduler_init(netc_scheduler *scheduler, size_t worker_count, bool pin_workers);
+
+/**
+ * @brief queues a task on the worker chosen by affinity, waking it if it
+ * sleeps. When that worker is busy an idle worker is woken to steal the
+ * task. A full queue spills into the queue of the next worker with room.
+ * Can be called from any thread
+ *
+ * @param scheduler pointer to the scheduler
+ * @param task task to run, copied
+ * @param affinity tasks with the same affinity go to the same worker
+ * @return true on success
+ * @return false if every queue is full, the task was not queued
+ */
+bool netc_scheduler_submit(netc_scheduler *scheduler, const netc_task *task, size_t affinity);
+
+/**
+ * @brief returns how many tasks wait in the queue of a worker
+ *
+ * @param scheduler pointer to the scheduler
+ * @param worker index of the worker
+ * @return size_t tasks queued and not taken yet
+ */
+size_t netc_scheduler_queue_depth(const netc_scheduler *scheduler, size_t worker);
+
+/**
+ * @brief reads the counters of one worker, or of the whole scheduler when
+ * worker is worker_count. overflowed counts the tasks that spilled from
+ * the queue of a worker into another one. The counters are read without
+ * stopping the workers
+ *
+ * @param scheduler pointer to the scheduler
+ * @param worker index of the worker, worker_count for the totals
+ * @return netc_scheduler_stats the counters
+ */
+netc_scheduler_stats netc_scheduler_get_stats(const netc_scheduler *scheduler, size_t worker);
+
+/**
+ * @brief runs every task still queued, then stops and joins the workers
+ *
+ * @param scheduler pointer to the scheduler to destroy
+ */
+void netc_scheduler_destroy(netc_scheduler *scheduler);
+
+#endif // NETC_SCHEDULER_H
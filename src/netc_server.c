@@ -1,296 +1,1476 @@
 #include "netc_server.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
 
 #include <stdio.h>
 #include <sys/socket.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define NOT_MODIFIED_STATUS_LINE          "HTTP/1.1 304 Not modified\r\n"
+#define PARTIAL_CONTENT_STATUS_LINE       "HTTP/1.1 206 Partial content\r\n"
+#define RANGE_NOT_SATISFIABLE_STATUS_LINE "HTTP/1.1 416 Range not satisfiable\r\n"
+
+/* the value stored in the router for every route */
+struct endpoint
+{
+    void*           (*handler_function)(http_request*, http_response*);
+    uint32_t          flags;
+    netc_file_cache  *files;
+};
 
 struct context
 {
-    int            client_sfd;
-    http_request  *request;
-    void*        (**handler_function)(http_request*, http_response*);
+    netc_reactor     *reactor;
+    netc_connection  *connection;
+    http_request     *request;
+    void*           (*handler_function)(http_request*, http_response*);
+    uint32_t          flags;
+    netc_flight      *flight;
+    netc_flight_waiter waiter;
+    const char       *flight_key;
+    size_t            flight_key_length;
+};
+
+/* a request whose handler returned without answering it, it owns the
+ * connection until netc_complete hands it back to the event loop */
+struct netc_deferred
+{
+    netc_reactor     *reactor;
+    netc_connection  *connection;
+    http_request     *request;
+    http_response     response;
+    bool              cacheable;
+    netc_flight      *flight;
 };
 
-void bind_server(const size_t port);
+struct stream_buffer
+{
+    char             *data;
+    size_t            length;
+    size_t            capacity;
+};
+
+/* a response body written piece by piece. Writers fill pending while the
+ * event loop sends the other buffer, the two are swapped once it is sent */
+struct netc_stream
+{
+    netc_reactor        *reactor;
+    netc_connection     *connection;
+    http_request        *request;
+    pthread_mutex_t      mutex;
+    pthread_cond_t       drained;
+    struct stream_buffer pending;
+    struct stream_buffer sending;
+    bool                 chunked;
+    bool                 discard_body;
+    bool                 waiting;
+    bool                 ended;
+    bool                 failed;
+};
+
+/* what answers a Range header: the parts following the head and the
+ * headers describing them */
+struct range_reply
+{
+    netc_write_part  *parts;
+    size_t            part_count;
+    size_t            length;
+    const char       *content_type;
+    char              content_range[72];
+    char              multipart_type[64];
+};
+
+/* the handler running on this thread, for netc_defer and netc_stream_begin */
+struct handler_call
+{
+    netc_reactor     *reactor;
+    netc_connection  *connection;
+    http_request     *request;
+    http_response    *response;
+    netc_deferred    *deferred;
+    netc_stream      *stream;
+    bool              cacheable;
+    netc_flight      *flight;
+};
+
+_Thread_local struct handler_call *current_call = NULL;
+/* set on event loop threads, which must never wait for themselves */
+_Thread_local netc_reactor *current_reactor = NULL;
+
+int create_listening_socket(const uint16_t port, const bool reuse_port);
+void *reactor_thread(void *reactor);
+void pin_current_thread(size_t index);
 void netc_shutdown_signal_handler(int sig);
-char *read_client_socket(int client_sfd);
-int accept_client();
+void dispatch_request(netc_reactor *reactor, netc_connection *connection);
+bool route_headers(netc_reactor *reactor, netc_connection *connection);
+void dispatch_body(netc_reactor *reactor, netc_connection *connection);
+void set_keep_alive(netc_connection *connection, const http_request *request);
+size_t connection_affinity(const netc_reactor *reactor, const netc_connection *connection);
+void send_status(netc_reactor *reactor, netc_connection *connection, const uint16_t status_code);
+void send_method_not_allowed(netc_reactor *reactor, netc_connection *connection, uint16_t allowed_methods);
+void send_response(netc_reactor *reactor, netc_connection *connection, http_response *response);
+void serve_file(netc_reactor *reactor, netc_connection *connection, http_request *request, netc_file_cache *files);
+bool serve_cached(netc_reactor *reactor, netc_connection *connection, http_request *request);
+bool queue_entry(netc_connection *connection, http_request *request, netc_cache_entry *entry, const char **status_line);
+bool build_range_reply(netc_arena *arena, http_range_result range, const http_range *ranges, size_t count,
+                       const char *body, size_t size, const char *content_type, struct range_reply *reply);
+void add_range_headers(http_response *response, const struct range_reply *reply);
+bool join_flight(struct context *call);
+void land_flight(netc_flight *flight, netc_cache_entry *shared);
+bool serve_shared(struct context *ctx, netc_cache_entry *shared);
+void resubmit(struct context *ctx);
+uint16_t frame_error_status(netc_frame_result result);
+bool wants_keep_alive(const http_request *request);
+void add_connection_headers(http_response *response, const netc_connection *connection);
+bool run_handler(struct context *ctx);
+void queue_response(netc_connection *connection, http_request *request, http_response *response, bool cacheable,
+                    netc_flight *flight);
+bool append_chunk(netc_stream *stream, const void *data, size_t length);
+bool stream_written(netc_reactor *reactor, netc_connection *connection, bool failed);
 void *endpoint_default_middleware(void *context);
+void *stream_middleware(void *context);
+void run_stream_step(struct context *ctx, bool on_event_loop);
 
 netc server;
 
+netc_config netc_default_config(void)
+{
+    netc_config config = {
+        .port = 8080,
+        .log_filename = NULL,
+        .thread_num = 4,
+        .reactor_num = 1,
+        .pin_reactors = false,
+        .io_backend = NETC_IO_BACKEND_EPOLL,
+        .keepalive_timeout_ms = 5000,
+        .max_keepalive_requests = 100,
+        .max_header_size = NETC_DEFAULT_MAX_HEADER_SIZE,
+        .max_body_size = NETC_DEFAULT_MAX_BODY_SIZE,
+        .max_connections = NETC_DEFAULT_MAX_CONNECTIONS,
+        .response_cache_size = NETC_RESPONSE_CACHE_DEFAULT_SIZE,
+        .response_cache_ttl_ms = NETC_RESPONSE_CACHE_DEFAULT_TTL,
+        .log_async = false,
+        .log_overflow_policy = CTSL_OVERFLOW_DROP,
+        .log_format = CTSL_FORMAT_TEXT
+    };
+    return config;
+}
+
 void netc_setup(const uint16_t port, const char *log_filename, const size_t thread_num)
 {
-    if (ctsl_init(&server.logger, log_filename) == false)
+    netc_config config = netc_default_config();
+    config.port = port;
+    config.log_filename = log_filename;
+    config.thread_num = thread_num;
+
+    netc_setup_with_config(&config);
+}
+
+void netc_setup_with_config(const netc_config *config)
+{
+    ctsl_config log_config = ctsl_default_config();
+    log_config.async = config->log_async;
+    log_config.overflow_policy = config->log_overflow_policy;
+    log_config.format = config->log_format;
+    if (ctsl_init_with_config(&server.logger, config->log_filename, &log_config) == false)
     {
         fprintf(stderr, "Error initializing logger, won't be able to print any log...\n");
         return;
     }
 
-    /* create and setup socket */
-    server.linstening_socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server.linstening_socket_fd < 0)
+    /* one event loop per listening socket, the kernel balances between them */
+    server.reactor_count = config->reactor_num;
+    if (server.reactor_count == 0)
     {
-        char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error creating socket: %s", err_msg);
-        ctsl_destroy(&server.logger);
-        exit(EXIT_FAILURE);
+        long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        server.reactor_count = online_cpus > 0 ? (size_t)online_cpus : 1;
     }
 
-    const int opt = 1;
-    if (setsockopt(server.linstening_socket_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+    server.reactors = calloc(server.reactor_count, sizeof(netc_reactor));
+    if (server.reactors == NULL)
     {
         char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error setting up socket: %s", err_msg);
+        ctsl_print(&server.logger, CTSL_ERROR, "Error allocating event loops: %s", err_msg);
         ctsl_destroy(&server.logger);
         exit(EXIT_FAILURE);
     }
 
-    bind_server(port);
+    for (size_t i = 0; i < server.reactor_count; i++)
+        server.reactors[i].listening_socket_fd = create_listening_socket(config->port, server.reactor_count > 1);
 
     /* NetC configuration */
-    server.listening_port = port;
+    server.listening_port = config->port;
     server.backlog_number = 5;
-    server.endpoint_map = hashtable_create(hash_string, compare_string);
-    if (server.endpoint_map == NULL)
-    {
-        char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error creating endpoint hashtable: %s", err_msg);
-        ctsl_destroy(&server.logger);
-        exit(EXIT_FAILURE);
-    }
-    server.threadpool = threadpool_create(thread_num);
-    if (server.threadpool == NULL)
+    server.pin_reactors = config->pin_reactors;
+    server.io_backend = config->io_backend;
+    server.keepalive_timeout_ms = config->keepalive_timeout_ms;
+    server.max_keepalive_requests = config->max_keepalive_requests;
+    server.max_header_size = config->max_header_size;
+    server.max_body_size = config->max_body_size;
+    server.max_connections = config->max_connections;
+    server.stream_bodies = false;
+    server.file_caches = NULL;
+    server.response_cache = (netc_response_cache){ 0 };
+    server.response_cache_size = config->response_cache_size;
+    server.response_cache_ttl_ms = config->response_cache_ttl_ms;
+    netc_flight_table_init(&server.flights);
+    netc_router_init(&server.router);
+    if (netc_scheduler_init(&server.scheduler, config->thread_num, config->pin_reactors) == false)
     {
         char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error creating server threadpool: %s", err_msg);
+        ctsl_print(&server.logger, CTSL_ERROR, "Error creating server workers: %s", err_msg);
         ctsl_destroy(&server.logger);
-        hashtable_destroy(server.endpoint_map);
         exit(EXIT_FAILURE);
     }
 
+    if (netc_clock_start() == false)
+        ctsl_print(&server.logger, CTSL_WARNING, "Could not start the clock thread, timestamps are refreshed on demand");
+
     ctsl_print(&server.logger, CTSL_INFO, "Server setted up successfully!");
 }
 
 bool netc_add_endpoint(const char *method, const char *path,
                        void *(*endpoint_handler)(http_request*, http_response*))
 {
-    if (method == NULL || path == NULL || endpoint_handler == NULL)
+    return netc_add_endpoint_ex(method, path, endpoint_handler, NETC_ENDPOINT_BLOCKING);
+}
+
+bool netc_add_endpoint_ex(const char *method, const char *path,
+                          void *(*endpoint_handler)(http_request*, http_response*), uint32_t flags)
+{
+    if (method == NULL || path == NULL || endpoint_handler == NULL ||
+        (flags & ~(NETC_ENDPOINT_INLINE | NETC_ENDPOINT_STREAM_BODY | NETC_ENDPOINT_CACHE |
+                   NETC_ENDPOINT_COALESCE)) != 0)
     {
         ctsl_print(&server.logger, CTSL_WARNING, "Invalid endpoint or handler function");
         return false;
     }
 
-    /* concatenate method and path */
-    size_t size = strlen(method) + strlen(path) + 1;
-    char *key;
-    if ((key = malloc(size)) == NULL)
+    /* requests are coalesced by method and path alone, so two requests with
+     * different bodies would share one handler run */
+    if ((flags & NETC_ENDPOINT_COALESCE) &&
+        ((flags & NETC_ENDPOINT_STREAM_BODY) || (strcmp(method, GET) != 0 && strcmp(method, HEAD) != 0)))
     {
-        char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_WARNING, "Failed to allocate memory for |%s %s| endpoint: %s", method, path, err_msg);
+        ctsl_print(&server.logger, CTSL_WARNING, "Cannot coalesce requests to |%s %s|", method, path);
         return false;
     }
-    snprintf(key, size, "%s%s", method, path);
 
-    /* insert endpoint and respective handler function to hashtable */
-    if (hashtable_put(server.endpoint_map, key, strlen(key) + 1, &endpoint_handler, sizeof(endpoint_handler)) == false)
+    /* the cache is only set up once an endpoint opts in */
+    if ((flags & NETC_ENDPOINT_CACHE) && server.response_cache.shards == NULL &&
+        netc_response_cache_init(&server.response_cache, server.response_cache_size, server.response_cache_ttl_ms) == false)
+    {
+        ctsl_print(&server.logger, CTSL_WARNING, "Failed to set up the response cache for |%s %s|", method, path);
+        return false;
+    }
+
+    struct endpoint endpoint = {
+        .handler_function = endpoint_handler,
+        .flags = flags
+    };
+    if (netc_router_add(&server.router, method, path, &endpoint, sizeof(endpoint)) == false)
     {
         ctsl_print(&server.logger, CTSL_WARNING, "Failed to add |%s %s| endpoint", method, path);
         return false;
     }
-    free(key);
+
+    if (flags & NETC_ENDPOINT_STREAM_BODY)
+        server.stream_bodies = true;
 
     return true;
 }
 
-void netc_run(void)
+bool netc_add_static(const char *prefix, const char *directory)
 {
-    if (listen(server.linstening_socket_fd, server.backlog_number) < 0)
+    size_t prefix_length = prefix != NULL ? strlen(prefix) : 0;
+    while (prefix_length > 0 && prefix[prefix_length - 1] == '/')
+        prefix_length--;
+
+    char route[256];
+    if (prefix == NULL || prefix[0] != '/' || directory == NULL ||
+        snprintf(route, sizeof(route), "%.*s/*path", (int)prefix_length, prefix) >= (int)sizeof(route))
     {
-        char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error while starting listening for new collection: %s", err_msg);
-        netc_destroy();
-        exit(EXIT_FAILURE);
+        ctsl_print(&server.logger, CTSL_WARNING, "Invalid static prefix or directory");
+        return false;
     }
 
-    struct sigaction act = { 0 };
-    act.sa_handler = netc_shutdown_signal_handler;
-    if (sigaction(SIGINT, &act, NULL) == -1)
+    netc_file_cache *files = malloc(sizeof(netc_file_cache));
+    if (files == NULL || netc_file_cache_init(files, directory, NETC_FILE_CACHE_CAPACITY) == false)
     {
         char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error while setting up new SIGINT handler: %s", err_msg);
-        netc_destroy();
-        exit(EXIT_FAILURE);
+        ctsl_print(&server.logger, CTSL_WARNING, "Failed to open static directory %s: %s", directory, err_msg);
+        free(files);
+        return false;
     }
 
-    ctsl_print(&server.logger, CTSL_INFO, "Listening for new connections at %d\n", server.listening_port);
-    while(true)
+    /* files are looked up and sent from the event loop, no worker is needed */
+    struct endpoint endpoint = {
+        .handler_function = NULL,
+        .flags = NETC_ENDPOINT_INLINE,
+        .files = files
+    };
+    if (netc_router_add(&server.router, GET, route, &endpoint, sizeof(endpoint)) == false ||
+        netc_router_add(&server.router, HEAD, route, &endpoint, sizeof(endpoint)) == false)
     {
-        int client_sfd = accept_client();
-        if (client_sfd < 0)
-            continue;
+        ctsl_print(&server.logger, CTSL_WARNING, "Failed to add |%s| static route", route);
+        netc_file_cache_destroy(files);
+        free(files);
+        return false;
+    }
 
-        char *request_string = read_client_socket(client_sfd);
+    files->next = server.file_caches;
+    server.file_caches = files;
+    return true;
+}
 
-        http_request *request = http_request_parse(request_string);
-        if (request == NULL)
+void netc_run(void)
+{
+    for (size_t i = 0; i < server.reactor_count; i++)
+    {
+        netc_reactor *reactor = &server.reactors[i];
+        if (listen(reactor->listening_socket_fd, server.backlog_number) < 0)
         {
-            ctsl_print(&server.logger, CTSL_ERROR, "Error while parsing request string: %s", request_string);
-            free(request_string);
-            continue;
+            char *err_msg = strerror(errno);
+            ctsl_print(&server.logger, CTSL_ERROR, "Error while starting listening for new collection: %s", err_msg);
+            netc_destroy();
+            exit(EXIT_FAILURE);
         }
-        free(request_string);
 
-        size_t endpoint_len = strlen(request->method) + strlen(request->path) + 1;
-        char *endpoint = malloc(endpoint_len);
-        if (endpoint == NULL)
+        if (netc_reactor_init(reactor, reactor->listening_socket_fd, server.io_backend, &server.logger, dispatch_request) == false)
         {
             char *err_msg = strerror(errno);
-            ctsl_print(&server.logger, CTSL_ERROR, "Error while fetching endpoint: %s", err_msg);
-            continue;
+            ctsl_print(&server.logger, CTSL_ERROR, "Error while setting up the event loop: %s", err_msg);
+            netc_destroy();
+            exit(EXIT_FAILURE);
         }
-        snprintf(endpoint, endpoint_len, "%s%s", request->method, request->path);
+        reactor->idle_timeout_ms = server.keepalive_timeout_ms;
+        reactor->max_header_size = server.max_header_size;
+        reactor->max_body_size = server.max_body_size;
+        reactor->connection_pool.capacity = (server.max_connections + server.reactor_count - 1) / server.reactor_count;
 
-        struct context *ctx = malloc(sizeof(struct context));
-        if (ctx == NULL)
+        /* requests are only routed before their body arrives once an
+         * endpoint needs it */
+        if (server.stream_bodies)
         {
-            char *err_msg = strerror(errno);
-            ctsl_print(&server.logger, CTSL_ERROR, "Error allocating memory for context: %s", err_msg);
-            free(endpoint);
-            http_request_free(request);
-            close(ctx->client_sfd);
-            continue;
+            reactor->on_headers = route_headers;
+            reactor->on_body = dispatch_body;
         }
-        ctx->client_sfd = client_sfd;
-        ctx->request = request;
-        ctx->handler_function = hashtable_get(server.endpoint_map, endpoint);
+        reactor->on_written = stream_written;
+    }
+
+    struct sigaction act = { 0 };
+    act.sa_handler = netc_shutdown_signal_handler;
+    if (sigaction(SIGINT, &act, NULL) == -1)
+    {
+        char *err_msg = strerror(errno);
+        ctsl_print(&server.logger, CTSL_ERROR, "Error while setting up new SIGINT handler: %s", err_msg);
+        netc_destroy();
+        exit(EXIT_FAILURE);
+    }
+
+    /* the calling thread drives the first event loop, the others get their own thread */
+    pthread_t *threads = calloc(server.reactor_count, sizeof(pthread_t));
+    if (threads == NULL)
+    {
+        char *err_msg = strerror(errno);
+        ctsl_print(&server.logger, CTSL_ERROR, "Error allocating event loop threads: %s", err_msg);
+        netc_destroy();
+        exit(EXIT_FAILURE);
+    }
 
-        if (ctx->handler_function == NULL)
+    for (size_t i = 1; i < server.reactor_count; i++)
+    {
+        if (pthread_create(&threads[i], NULL, reactor_thread, &server.reactors[i]) != 0)
         {
-            ctsl_print(&server.logger, CTSL_INFO, "%s %s => 404 Not found", request->method, request->path);
-            free(endpoint);
-            close(ctx->client_sfd);
-            http_request_free(request);
-            free(ctx);
-            continue;
+            ctsl_print(&server.logger, CTSL_ERROR, "Error starting event loop thread %zu", i);
+            netc_destroy();
+            exit(EXIT_FAILURE);
         }
 
-        struct task task = {
-            .function = endpoint_default_middleware,
-            .argp = ctx
-        };
-
-        threadpool_add(server.threadpool, &task);
-        free(endpoint);
     }
+    if (server.pin_reactors)
+        pin_current_thread(0);
+
+    ctsl_print(&server.logger, CTSL_INFO, "Listening for new connections at %d with %zu event loops\n", server.listening_port, server.reactor_count);
+    current_reactor = &server.reactors[0];
+    netc_reactor_run(&server.reactors[0]);
+    current_reactor = NULL;
+
+    for (size_t i = 1; i < server.reactor_count; i++)
+        pthread_join(threads[i], NULL);
+    free(threads);
+
+    /* workers may still hand connections back until the pool is drained */
+    netc_destroy();
 }
 
 void netc_destroy(void)
 {
-    close(server.linstening_socket_fd);
-    threadpool_destroy(server.threadpool, true);
-    hashtable_destroy(server.endpoint_map);
+    for (size_t i = 0; i < server.reactor_count; i++)
+        close(server.reactors[i].listening_socket_fd);
+    netc_scheduler_destroy(&server.scheduler);
+    netc_router_destroy(&server.router);
+    netc_clock_stop();
+    for (size_t i = 0; i < server.reactor_count; i++)
+        netc_reactor_destroy(&server.reactors[i]);
+    /* closed connections gave their files back with the event loops */
+    while (server.file_caches != NULL)
+    {
+        netc_file_cache *next = server.file_caches->next;
+        netc_file_cache_destroy(server.file_caches);
+        free(server.file_caches);
+        server.file_caches = next;
+    }
+    netc_response_cache_destroy(&server.response_cache);
+    netc_flight_table_destroy(&server.flights);
+    free(server.reactors);
+    server.reactors = NULL;
+    server.reactor_count = 0;
     ctsl_print(&server.logger, CTSL_WARNING, "Closing server...");
     ctsl_destroy(&server.logger);
 }
 
-void bind_server(const size_t port)
+int create_listening_socket(const uint16_t port, const bool reuse_port)
 {
+    int socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (socket_fd < 0)
+    {
+        char *err_msg = strerror(errno);
+        ctsl_print(&server.logger, CTSL_ERROR, "Error creating socket: %s", err_msg);
+        ctsl_destroy(&server.logger);
+        exit(EXIT_FAILURE);
+    }
+
+    const int opt = 1;
+    if (setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        (reuse_port && setsockopt(socket_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0))
+    {
+        char *err_msg = strerror(errno);
+        ctsl_print(&server.logger, CTSL_ERROR, "Error setting up socket: %s", err_msg);
+        ctsl_destroy(&server.logger);
+        exit(EXIT_FAILURE);
+    }
+
     struct sockaddr_in server_info = { 0 };
     server_info.sin_family = AF_INET;
     server_info.sin_addr.s_addr = htonl(INADDR_ANY);
     server_info.sin_port = htons(port);
-    if (bind(server.linstening_socket_fd, (const struct sockaddr*)&server_info, sizeof(server_info)) < 0)
+    if (bind(socket_fd, (const struct sockaddr*)&server_info, sizeof(server_info)) < 0)
     {
         char *err_message = strerror(errno);
         ctsl_print(&server.logger, CTSL_ERROR, "Error binding socket: %s", err_message);
         ctsl_destroy(&server.logger);
         exit(EXIT_FAILURE);
     }
+
+    return socket_fd;
 }
 
-int accept_client()
+void *reactor_thread(void *reactor)
 {
-    struct sockaddr_in client_info;
-    socklen_t client_info_len = sizeof(client_info);
-    int client_sfd = accept(server.linstening_socket_fd, (struct sockaddr*)&client_info, &client_info_len);
-    if (client_sfd < 0)
+    if (server.pin_reactors)
+        pin_current_thread((netc_reactor*)reactor - server.reactors);
+
+    current_reactor = reactor;
+    netc_reactor_run(reactor);
+    return NULL;
+}
+
+void pin_current_thread(size_t index)
+{
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online_cpus <= 0)
+        return;
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(index % online_cpus, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0)
+        ctsl_print(&server.logger, CTSL_WARNING, "Could not pin event loop %zu to a core", index);
+}
+
+void dispatch_request(netc_reactor *reactor, netc_connection *connection)
+{
+    /* rejected requests are answered and the connection closed, the rest of
+     * the stream cannot be framed reliably */
+    if (connection->frame_result != NETC_FRAME_COMPLETE)
+    {
+        connection->keep_alive = false;
+        send_status(reactor, connection, frame_error_status(connection->frame_result));
+        return;
+    }
+
+    http_request *request = http_request_from_parser(&connection->parser, connection->read_buffer, connection->body_length,
+                                                     &connection->arena);
+    if (request == NULL)
+    {
+        ctsl_print(&server.logger, CTSL_ERROR, "Error while building request for %s %s",
+                   connection->read_buffer + connection->parser.method.offset,
+                   connection->read_buffer + connection->parser.path.offset);
+        connection->keep_alive = false;
+        send_status(reactor, connection, HTTP_STATUS_BAD_REQUEST);
+        return;
+    }
+
+    set_keep_alive(connection, request);
+
+    netc_route_match match;
+    netc_route_result route = netc_router_match(&server.router, request->method, request->path, &match);
+    if (route != NETC_ROUTE_FOUND)
+    {
+        if (route == NETC_ROUTE_METHOD_NOT_ALLOWED)
+        {
+            ctsl_print(&server.logger, CTSL_INFO, "%s %s => 405 Method not allowed", request->method, request->path);
+            send_method_not_allowed(reactor, connection, match.allowed_methods);
+        }
+        else
+        {
+            ctsl_print(&server.logger, CTSL_INFO, "%s %s => 404 Not found", request->method, request->path);
+            send_status(reactor, connection, HTTP_STATUS_NOT_FOUND);
+        }
+        http_request_free(request);
+        return;
+    }
+
+    memcpy(request->params, match.params, match.param_count * sizeof(http_path_param));
+    request->param_count = match.param_count;
+
+    const struct endpoint *endpoint = match.value;
+    if (endpoint->files != NULL)
+    {
+        serve_file(reactor, connection, request, endpoint->files);
+        return;
+    }
+
+    /* a stored response is sent from the event loop, the handler never runs */
+    if ((endpoint->flags & NETC_ENDPOINT_CACHE) && serve_cached(reactor, connection, request))
+        return;
+
+    struct context call = {
+        .reactor = reactor,
+        .connection = connection,
+        .request = request,
+        .handler_function = endpoint->handler_function,
+        .flags = endpoint->flags,
+        .flight = NULL,
+        .flight_key = NULL,
+        .flight_key_length = 0
+    };
+
+    /* the request waits for an identical one already being answered */
+    if ((endpoint->flags & NETC_ENDPOINT_COALESCE) && join_flight(&call))
+        return;
+
+    if (endpoint->flags & NETC_ENDPOINT_INLINE)
+    {
+        /* no handoff: the response is queued and sent from this thread */
+        if (run_handler(&call))
+        {
+            http_request_free(request);
+            netc_reactor_send(reactor, connection);
+        }
+        return;
+    }
+
+    /* like the request, the context lives until the connection is reset */
+    struct context *ctx = netc_arena_alloc(&connection->arena, sizeof(struct context));
+    if (ctx == NULL)
     {
         char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error accepting new connection: %s", err_msg);
-        return -1;
+        ctsl_print(&server.logger, CTSL_ERROR, "Error allocating memory for context: %s", err_msg);
+        land_flight(call.flight, NULL);
+        http_request_free(request);
+        netc_reactor_close(reactor, connection);
+        return;
     }
+    *ctx = call;
+
+    netc_task task = {
+        .function = endpoint_default_middleware,
+        .argp = ctx
+    };
 
-    return client_sfd;
+    if (netc_scheduler_submit(&server.scheduler, &task, connection_affinity(reactor, connection)) == false)
+    {
+        ctsl_print(&server.logger, CTSL_ERROR, "Error queueing %s %s", request->method, request->path);
+        land_flight(ctx->flight, NULL);
+        http_request_free(request);
+        netc_reactor_close(reactor, connection);
+    }
 }
 
-char *read_client_socket(int client_sfd)
+bool route_headers(netc_reactor *reactor, netc_connection *connection)
 {
-    char buffer[DEFAULT_SOCKET_BUFFER_SIZE];
-    char *read_msg = malloc(1);
-    if (read_msg == NULL)
-        return NULL;
+    (void)reactor;
+    http_request *request = http_request_from_parser(&connection->parser, connection->read_buffer, 0, &connection->arena);
+    if (request == NULL)
+        return false;
 
-    int bytes_read, total_length = 0;
-    while ((bytes_read = recv(client_sfd, buffer, DEFAULT_SOCKET_BUFFER_SIZE, 0)) > 0)
+    /* every other request is routed again once its body is buffered */
+    netc_route_match match;
+    if (netc_router_match(&server.router, request->method, request->path, &match) != NETC_ROUTE_FOUND ||
+        (((const struct endpoint*)match.value)->flags & NETC_ENDPOINT_STREAM_BODY) == 0)
     {
-        total_length += bytes_read;
-        char *temp = realloc(read_msg, total_length + 1);
-        if (temp == NULL)
+        http_request_free(request);
+        return false;
+    }
+
+    /* the request points into the read buffer, which may move once while it
+     * is sized for streaming, so it is built again over the final buffer */
+    http_request_free(request);
+    if (netc_connection_begin_stream(connection) == false)
+        return false;
+
+    request = http_request_from_parser(&connection->parser, connection->read_buffer, 0, &connection->arena);
+    struct context *ctx = netc_arena_alloc(&connection->arena, sizeof(struct context));
+    if (request == NULL || ctx == NULL ||
+        netc_router_match(&server.router, request->method, request->path, &match) != NETC_ROUTE_FOUND)
+    {
+        connection->streaming = false;
+        http_request_free(request);
+        return false;
+    }
+
+    const struct endpoint *endpoint = match.value;
+    memcpy(request->params, match.params, match.param_count * sizeof(http_path_param));
+    request->param_count = match.param_count;
+    set_keep_alive(connection, request);
+
+    ctx->reactor = reactor;
+    ctx->connection = connection;
+    ctx->request = request;
+    ctx->handler_function = endpoint->handler_function;
+    ctx->flags = endpoint->flags;
+    ctx->flight = NULL;
+    connection->request_context = ctx;
+    return true;
+}
+
+void dispatch_body(netc_reactor *reactor, netc_connection *connection)
+{
+    struct context *ctx = connection->request_context;
+    http_request *request = ctx->request;
+
+    /* the piece sits right after the headers until it is handed back */
+    request->body = connection->stream_length > 0 ? connection->read_buffer + connection->headers_length : NULL;
+    request->body_length = connection->stream_length;
+    switch (connection->frame_result)
+    {
+    case NETC_FRAME_COMPLETE:
+        request->body_state = HTTP_BODY_COMPLETE;
+        break;
+    case NETC_FRAME_INCOMPLETE:
+        request->body_state = HTTP_BODY_PARTIAL;
+        break;
+    default:
+        request->body_state = HTTP_BODY_ABORTED;
+        break;
+    }
+
+    if (ctx->flags & NETC_ENDPOINT_INLINE)
+    {
+        run_stream_step(ctx, true);
+        return;
+    }
+
+    netc_task task = {
+        .function = stream_middleware,
+        .argp = ctx
+    };
+    if (netc_scheduler_submit(&server.scheduler, &task, connection_affinity(reactor, connection)) == false)
+    {
+        ctsl_print(&server.logger, CTSL_ERROR, "Error queueing %s %s", request->method, request->path);
+        http_request_free(request);
+        netc_reactor_close(reactor, connection);
+    }
+}
+
+void set_keep_alive(netc_connection *connection, const http_request *request)
+{
+    connection->keep_alive = server.keepalive_timeout_ms > 0 &&
+                             connection->requests_served + 1 < server.max_keepalive_requests &&
+                             wants_keep_alive(request);
+}
+
+size_t connection_affinity(const netc_reactor *reactor, const netc_connection *connection)
+{
+    /* requests of a connection go to the worker next to the event loop that
+     * accepted it; connections of one event loop are spread over the workers
+     * that share its index modulo the event loop count */
+    return (size_t)(reactor - server.reactors) + server.reactor_count * (size_t)connection->fd;
+}
+
+void send_status(netc_reactor *reactor, netc_connection *connection, const uint16_t status_code)
+{
+    http_response res = { 0 };
+    http_response_default_with_arena(&res, &connection->arena);
+    http_response_set_status(&res, status_code);
+    send_response(reactor, connection, &res);
+}
+
+void send_method_not_allowed(netc_reactor *reactor, netc_connection *connection, uint16_t allowed_methods)
+{
+    char allow[128];
+    netc_router_format_allowed(allowed_methods, allow, sizeof(allow));
+
+    http_response res = { 0 };
+    http_response_default_with_arena(&res, &connection->arena);
+    http_response_set_status(&res, HTTP_STATUS_METHOD_NOT_ALLOWED);
+    http_response_add_header(&res, "Allow", allow);
+    send_response(reactor, connection, &res);
+}
+
+void send_response(netc_reactor *reactor, netc_connection *connection, http_response *response)
+{
+    add_connection_headers(response, connection);
+
+    bool queued = netc_connection_set_response(connection, response);
+    http_response_free(response);
+    if (queued == false)
+    {
+        netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    netc_reactor_send(reactor, connection);
+}
+
+void serve_file(netc_reactor *reactor, netc_connection *connection, http_request *request, netc_file_cache *files)
+{
+    size_t length = 0;
+    const char *path = http_request_get_param(request, "path", &length);
+    /* the query string does not name the file */
+    const char *query = path != NULL ? memchr(path, '?', length) : NULL;
+    if (query != NULL)
+        length = query - path;
+
+    netc_file_entry *entry = path != NULL ? netc_file_cache_acquire(files, path, length) : NULL;
+    if (entry == NULL)
+    {
+        ctsl_print(&server.logger, CTSL_INFO, "%s %s => 404 Not found", request->method, request->path);
+        send_status(reactor, connection, HTTP_STATUS_NOT_FOUND);
+        http_request_free(request);
+        return;
+    }
+
+    char content_length[24];
+    snprintf(content_length, sizeof(content_length), "%zu", entry->size);
+
+    http_response res = { 0 };
+    http_response_default_with_arena(&res, &connection->arena);
+    http_response_add_header(&res, "Content-Type", entry->content_type);
+    http_response_add_header(&res, "Content-Length", content_length);
+    http_response_add_header(&res, "Last-Modified", entry->last_modified);
+    http_response_add_header(&res, "ETag", entry->etag);
+    http_response_add_header(&res, "Accept-Ranges", "bytes");
+
+    /* a resumed download only gets the bytes it misses, read at their offset */
+    http_range ranges[HTTP_MAX_RANGES];
+    size_t range_count = 0;
+    http_range_result range = HTTP_RANGE_NONE;
+    struct range_reply reply;
+    bool not_modified = http_request_not_modified(request, entry->etag, entry->last_modified);
+    if (not_modified)
+        http_response_set_status(&res, HTTP_STATUS_NOT_MODIFIED);
+    else
+        range = http_request_ranges(request, entry->size, entry->etag, entry->last_modified, ranges, &range_count);
+    if (range != HTTP_RANGE_NONE &&
+        build_range_reply(&connection->arena, range, ranges, range_count, NULL, entry->size, entry->content_type, &reply))
+    {
+        http_response_set_status(&res, range == HTTP_RANGE_SATISFIABLE ? HTTP_STATUS_PARTIAL_CONTENT
+                                                                      : HTTP_STATUS_RANGE_NOT_SATISFIABLE);
+        add_range_headers(&res, &reply);
+    }
+    queue_response(connection, request, &res, false, NULL);
+
+    /* the body of a HEAD response is only announced */
+    if (connection->head_length > 0 && res.status_code == HTTP_STATUS_PARTIAL_CONTENT)
+        netc_connection_set_parts(connection, entry, reply.parts, reply.part_count);
+    else if (connection->head_length > 0 && entry->size > 0 && res.status_code == HTTP_STATUS_OK &&
+             strcmp(request->method, HEAD) != 0)
+        netc_connection_set_file(connection, entry, 0, entry->size);
+    else
+        netc_file_cache_release(entry);
+
+    http_request_free(request);
+    netc_reactor_send(reactor, connection);
+}
+
+bool serve_cached(netc_reactor *reactor, netc_connection *connection, http_request *request)
+{
+    netc_cache_entry *entry = netc_response_cache_lookup(&server.response_cache, request);
+    if (entry == NULL)
+        return false;
+
+    const char *status_line;
+    if (queue_entry(connection, request, entry, &status_line) == false)
+    {
+        netc_response_cache_release(entry);
+        return false;
+    }
+
+    /* the status line without the version, e.g. 200 OK */
+    const char *status = status_line + 9;
+    ctsl_print(&server.logger, CTSL_INFO, "%s %s => Status %.*s (cached)", request->method, request->path,
+               (int)strcspn(status, "\r"), status);
+    http_request_free(request);
+    netc_reactor_send(reactor, connection);
+    return true;
+}
+
+bool queue_entry(netc_connection *connection, http_request *request, netc_cache_entry *entry, const char **status_line)
+{
+    const char *connection_header = connection->keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    const char *extra_headers = connection->keep_alive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+    /* a client holding the same version only gets the headers */
+    if (http_request_not_modified(request, entry->etag, entry->last_modified))
+    {
+        *status_line = NOT_MODIFIED_STATUS_LINE;
+        return netc_connection_set_cached_response(connection, entry, NOT_MODIFIED_STATUS_LINE, extra_headers, false);
+    }
+
+    http_range ranges[HTTP_MAX_RANGES];
+    size_t range_count;
+    struct range_reply reply;
+    http_range_result range = http_request_ranges(request, entry->body_length, entry->etag, entry->last_modified,
+                                                  ranges, &range_count);
+    if (range == HTTP_RANGE_NONE || build_range_reply(&connection->arena, range, ranges, range_count, entry->body,
+                                                      entry->body_length, entry->content_type, &reply) == false)
+    {
+        *status_line = entry->head;
+        return netc_connection_set_cached_response(connection, entry, NULL, extra_headers,
+                                                   strcmp(request->method, HEAD) != 0);
+    }
+
+    /* the ranges are sliced out of the stored body, only their headers are new */
+    size_t capacity = (reply.content_type != NULL ? strlen(reply.content_type) : 0) + sizeof(reply.content_range) + 96;
+    char *headers = netc_arena_alloc(&connection->arena, capacity);
+    if (headers == NULL)
+        return false;
+    snprintf(headers, capacity, "%s%s%s%s%s%sContent-Length: %zu\r\n%s\r\n",
+             reply.content_type != NULL ? "Content-Type: " : "", reply.content_type != NULL ? reply.content_type : "",
+             reply.content_type != NULL ? "\r\n" : "", reply.content_range[0] != '\0' ? "Content-Range: " : "",
+             reply.content_range, reply.content_range[0] != '\0' ? "\r\n" : "", reply.length, connection_header);
+
+    *status_line = range == HTTP_RANGE_SATISFIABLE ? PARTIAL_CONTENT_STATUS_LINE : RANGE_NOT_SATISFIABLE_STATUS_LINE;
+    return netc_connection_set_cached_parts(connection, entry, *status_line, headers, reply.parts, reply.part_count);
+}
+
+bool build_range_reply(netc_arena *arena, http_range_result range, const http_range *ranges, size_t count,
+                       const char *body, size_t size, const char *content_type, struct range_reply *reply)
+{
+    reply->parts = NULL;
+    reply->part_count = 0;
+    reply->length = 0;
+    reply->content_type = content_type;
+    reply->content_range[0] = '\0';
+    reply->multipart_type[0] = '\0';
+
+    if (range == HTTP_RANGE_NOT_SATISFIABLE)
+    {
+        reply->content_type = NULL;
+        snprintf(reply->content_range, sizeof(reply->content_range), "bytes */%zu", size);
+        return true;
+    }
+
+    /* each range is preceded by a boundary and its own headers, the last
+     * boundary closes the body */
+    size_t part_count = count == 1 ? 1 : 2 * count + 1;
+    netc_write_part *parts = netc_arena_alloc(arena, part_count * sizeof(netc_write_part));
+    if (parts == NULL)
+        return false;
+
+    char boundary[17] = "";
+    if (count > 1)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t seed = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        snprintf(boundary, sizeof(boundary), "%016llx",
+                 (unsigned long long)netc_hash64(ranges, count * sizeof(http_range), seed));
+        snprintf(reply->multipart_type, sizeof(reply->multipart_type), "multipart/byteranges; boundary=%s", boundary);
+        reply->content_type = reply->multipart_type;
+    }
+
+    size_t part = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t first = ranges[i].offset, last = ranges[i].offset + ranges[i].length - 1;
+        if (count > 1)
+        {
+            size_t capacity = (content_type != NULL ? strlen(content_type) : 0) + 128;
+            char *header = netc_arena_alloc(arena, capacity);
+            if (header == NULL)
+                return false;
+            int length = snprintf(header, capacity, "\r\n--%s\r\n%s%s%sContent-Range: bytes %zu-%zu/%zu\r\n\r\n",
+                                  boundary, content_type != NULL ? "Content-Type: " : "",
+                                  content_type != NULL ? content_type : "", content_type != NULL ? "\r\n" : "",
+                                  first, last, size);
+            parts[part++] = (netc_write_part){ .data = header, .length = length, .offset = 0 };
+            reply->length += length;
+        }
+        else
+        {
+            snprintf(reply->content_range, sizeof(reply->content_range), "bytes %zu-%zu/%zu", first, last, size);
+        }
+
+        /* slices of the body in memory, offsets into the file otherwise */
+        parts[part++] = (netc_write_part){
+            .data = body != NULL ? body + ranges[i].offset : NULL,
+            .length = ranges[i].length,
+            .offset = (off_t)ranges[i].offset
+        };
+        reply->length += ranges[i].length;
+    }
+
+    if (count > 1)
+    {
+        char *closing = netc_arena_alloc(arena, sizeof(boundary) + 8);
+        if (closing == NULL)
+            return false;
+        int length = snprintf(closing, sizeof(boundary) + 8, "\r\n--%s--\r\n", boundary);
+        parts[part++] = (netc_write_part){ .data = closing, .length = length, .offset = 0 };
+        reply->length += length;
+    }
+
+    reply->parts = parts;
+    reply->part_count = part;
+    return true;
+}
+
+void add_range_headers(http_response *response, const struct range_reply *reply)
+{
+    char content_length[24];
+    snprintf(content_length, sizeof(content_length), "%zu", reply->length);
+    if (reply->content_range[0] != '\0')
+        http_response_add_header(response, "Content-Range", reply->content_range);
+    if (reply->content_type != NULL)
+        http_response_add_header(response, "Content-Type", reply->content_type);
+    http_response_add_header(response, "Content-Length", content_length);
+}
+
+bool join_flight(struct context *call)
+{
+    /* who is asking may change the answer, even without a Vary header */
+    const http_request *request = call->request;
+    if (http_request_get_header(request, "Authorization") != NULL || http_request_get_header(request, "Cookie") != NULL)
+        return false;
+
+    netc_connection *connection = call->connection;
+    size_t method_length = strlen(request->method);
+    size_t path_length = strlen(request->path);
+    char *key = netc_arena_alloc(&connection->arena, method_length + 1 + path_length);
+    struct context *ctx = netc_arena_alloc(&connection->arena, sizeof(struct context));
+    if (key == NULL || ctx == NULL)
+        return false;
+
+    memcpy(key, request->method, method_length);
+    key[method_length] = ' ';
+    memcpy(key + method_length + 1, request->path, path_length);
+    call->flight_key = key;
+    call->flight_key_length = method_length + 1 + path_length;
+
+    /* a waiter keeps the connection in processing until the flight lands */
+    *ctx = *call;
+    ctx->waiter.data = ctx;
+    return netc_flight_join(&server.flights, key, call->flight_key_length, &ctx->waiter, &call->flight);
+}
+
+void land_flight(netc_flight *flight, netc_cache_entry *shared)
+{
+    netc_flight_waiter *waiter = netc_flight_land(flight);
+    while (waiter != NULL)
+    {
+        /* the waiter lives in its connection arena, which is reset once the
+         * connection is handed back */
+        netc_flight_waiter *next = waiter->next;
+        struct context *ctx = waiter->data;
+        if (serve_shared(ctx, shared) == false)
         {
-            free(read_msg);
-            return NULL;
+            /* those varying from the answer wait for the first of them,
+             * those it may not be shared with run on their own */
+            if (shared == NULL ||
+                netc_flight_join(&server.flights, ctx->flight_key, ctx->flight_key_length, &ctx->waiter, &ctx->flight) == false)
+                resubmit(ctx);
         }
-        read_msg = temp;
-        memcpy(read_msg + (total_length - bytes_read), buffer, bytes_read);
-        read_msg[total_length] = '\0';
+        waiter = next;
+    }
+}
+
+bool serve_shared(struct context *ctx, netc_cache_entry *shared)
+{
+    if (shared == NULL || netc_response_cache_matches(shared, ctx->request) == false)
+        return false;
 
-        if ((size_t)bytes_read < DEFAULT_SOCKET_BUFFER_SIZE)
-            break;
+    netc_connection *connection = ctx->connection;
+    http_request *request = ctx->request;
+    const char *status_line;
+    netc_response_cache_retain(shared);
+    if (queue_entry(connection, request, shared, &status_line) == false)
+    {
+        netc_response_cache_release(shared);
+        return false;
     }
 
-    read_msg[total_length] = '\0';
-    return read_msg;
+    const char *status = status_line + 9;
+    ctsl_print(&server.logger, CTSL_INFO, "%s %s => Status %.*s (coalesced)", request->method, request->path,
+               (int)strcspn(status, "\r"), status);
+    http_request_free(request);
+    netc_reactor_complete(ctx->reactor, connection);
+    return true;
 }
 
-void *endpoint_default_middleware(void *context)
+void resubmit(struct context *ctx)
 {
-    struct context *ctx = (struct context*)context;
+    netc_task task = {
+        .function = endpoint_default_middleware,
+        .argp = ctx
+    };
+    if (netc_scheduler_submit(&server.scheduler, &task, connection_affinity(ctx->reactor, ctx->connection)))
+        return;
 
+    /* the connection belongs to its event loop, it is answered and closed there */
+    netc_connection *connection = ctx->connection;
+    ctsl_print(&server.logger, CTSL_ERROR, "Error queueing %s %s", ctx->request->method, ctx->request->path);
+    connection->keep_alive = false;
     http_response res = { 0 };
-    http_response_default(&res);
+    http_response_default_with_arena(&res, &connection->arena);
+    http_response_set_status(&res, HTTP_STATUS_INTERNAL_SERVER_ERROR);
+    queue_response(connection, ctx->request, &res, false, ctx->flight);
+    http_request_free(ctx->request);
+    netc_reactor_complete(ctx->reactor, connection);
+}
+
+uint16_t frame_error_status(netc_frame_result result)
+{
+    switch (result)
+    {
+    case NETC_FRAME_HEADERS_TOO_LARGE:
+        return HTTP_STATUS_HEADERS_TOO_LARGE;
+    case NETC_FRAME_BODY_TOO_LARGE:
+        return HTTP_STATUS_PAYLOAD_TOO_LARGE;
+    default:
+        return HTTP_STATUS_BAD_REQUEST;
+    }
+}
+
+bool run_handler(struct context *ctx)
+{
+    netc_connection *connection = ctx->connection;
+    http_request *request = ctx->request;
+    http_response res = { 0 };
+    http_response_default_with_arena(&res, &connection->arena);
+
+    struct handler_call call = {
+        .reactor = ctx->reactor,
+        .connection = connection,
+        .request = request,
+        .response = &res,
+        .deferred = NULL,
+        .stream = NULL,
+        .cacheable = (ctx->flags & NETC_ENDPOINT_CACHE) != 0,
+        .flight = ctx->flight
+    };
+    current_call = &call;
+    ctx->handler_function(request, &res);
+    current_call = NULL;
+
+    /* the handle may already be completed, nothing of it can be touched */
+    if (call.deferred != NULL || call.stream != NULL)
+        return false;
+
+    queue_response(connection, request, &res, call.cacheable, call.flight);
+    return true;
+}
+
+void queue_response(netc_connection *connection, http_request *request, http_response *response, bool cacheable,
+                    netc_flight *flight)
+{
+    /* the ETag is hashed once, before the response is stored or shared,
+     * and copies of it are revalidated against the one kept with them */
+    bool validated = connection->response_streaming == false && response->status_code == HTTP_STATUS_OK &&
+                     (strcmp(request->method, GET) == 0 || strcmp(request->method, HEAD) == 0) &&
+                     http_response_add_etag(response);
+    if (validated)
+        http_response_add_header(response, "Accept-Ranges", "bytes");
+    add_connection_headers(response, connection);
+
+    /* stored before the body moves to the connection. A streamed body is
+     * not known yet, the requests waiting for it run their own handler */
+    netc_cache_entry *shared = NULL;
+    if (connection->response_streaming == false)
+    {
+        if (cacheable)
+            netc_response_cache_store(&server.response_cache, request, response);
+        if (flight != NULL)
+            shared = netc_response_cache_share(request, response);
+    }
 
-    (*ctx->handler_function)(ctx->request, &res);
-    free(ctx->handler_function);
+    /* static files are ranged by serve_file, their body is not in memory */
+    const char *etag = http_response_get_header(response, "ETag");
+    const char *last_modified = http_response_get_header(response, "Last-Modified");
+    http_range ranges[HTTP_MAX_RANGES];
+    size_t range_count = 0;
+    http_range_result range = HTTP_RANGE_NONE;
+    struct range_reply reply;
+    if (validated && http_request_not_modified(request, etag, last_modified))
+        http_response_set_not_modified(response);
+    else if (validated && response->body_length > 0)
+        range = http_request_ranges(request, response->body_length, etag, last_modified, ranges, &range_count);
 
-    char *response_string = http_response_to_string(&res);
-    if (send(ctx->client_sfd, response_string, strlen(response_string), 0) <= 0)
+    /* the ranges point into the body, which the connection keeps until sent */
+    bool ranged = range != HTTP_RANGE_NONE &&
+                  build_range_reply(&connection->arena, range, ranges, range_count, response->body, response->body_length,
+                                    http_response_get_header(response, "Content-Type"), &reply);
+    if (ranged)
+    {
+        http_response_set_status(response, range == HTTP_RANGE_SATISFIABLE ? HTTP_STATUS_PARTIAL_CONTENT
+                                                                          : HTTP_STATUS_RANGE_NOT_SATISFIABLE);
+        add_range_headers(response, &reply);
+    }
+
+    if (netc_connection_set_response(connection, response) == false)
     {
         char *err_msg = strerror(errno);
-        ctsl_print(&server.logger, CTSL_ERROR, "Error sending data to client: %s", err_msg);
-        free(response_string);
+        ctsl_print(&server.logger, CTSL_ERROR, "Error building response: %s", err_msg);
+        connection->keep_alive = false;
+    }
+    else
+    {
+        if (ranged)
+            netc_connection_set_parts(connection, NULL, reply.parts, reply.part_count);
+        ctsl_print(&server.logger, CTSL_INFO, "%s %s => Status %d %s", request->method, request->path, response->status_code, response->status_text);
+    }
+
+    http_response_free(response);
+
+    if (flight != NULL)
+        land_flight(flight, shared);
+    netc_response_cache_release(shared);
+}
+
+netc_deferred *netc_defer(http_request *request)
+{
+    if (request == NULL || current_call == NULL || current_call->request != request ||
+        current_call->stream != NULL)
+        return NULL;
+
+    if (current_call->deferred != NULL)
+        return current_call->deferred;
+
+    netc_deferred *deferred = netc_arena_alloc(&current_call->connection->arena, sizeof(netc_deferred));
+    if (deferred == NULL) return NULL;
+
+    /* the response moves into the handle, so it can be completed from
+     * another thread even before the handler returns */
+    deferred->reactor = current_call->reactor;
+    deferred->connection = current_call->connection;
+    deferred->request = request;
+    deferred->response = *current_call->response;
+    deferred->cacheable = current_call->cacheable;
+    deferred->flight = current_call->flight;
+    current_call->deferred = deferred;
+    return deferred;
+}
+
+http_response *netc_deferred_response(netc_deferred *deferred)
+{
+    return deferred != NULL ? &deferred->response : NULL;
+}
+
+http_request *netc_deferred_request(netc_deferred *deferred)
+{
+    return deferred != NULL ? deferred->request : NULL;
+}
+
+void netc_complete(netc_deferred *deferred)
+{
+    if (deferred == NULL) return;
+
+    /* the handle lives in the connection arena, read it before handing the
+     * connection back */
+    netc_reactor *reactor = deferred->reactor;
+    netc_connection *connection = deferred->connection;
+
+    queue_response(connection, deferred->request, &deferred->response, deferred->cacheable, deferred->flight);
+    http_request_free(deferred->request);
+    netc_reactor_complete(reactor, connection);
+}
+
+netc_stream *netc_stream_begin(http_request *request)
+{
+    if (request == NULL || current_call == NULL || current_call->request != request ||
+        current_call->deferred != NULL || current_call->stream != NULL || current_call->response->body != NULL)
         return NULL;
+
+    netc_connection *connection = current_call->connection;
+    netc_stream *stream = netc_arena_alloc(&connection->arena, sizeof(netc_stream));
+    if (stream == NULL) return NULL;
+
+    /* HTTP/1.0 clients know no chunks, the body ends with the connection */
+    stream->chunked = strcmp(request->version, "HTTP/1.0") != 0;
+    if (stream->chunked && http_response_add_header(current_call->response, "Transfer-Encoding", "chunked") == false)
+        return NULL;
+    if (stream->chunked == false)
+        connection->keep_alive = false;
+
+    stream->reactor = current_call->reactor;
+    stream->connection = connection;
+    stream->request = request;
+    pthread_mutex_init(&stream->mutex, NULL);
+    pthread_cond_init(&stream->drained, NULL);
+    stream->pending = (struct stream_buffer){ 0 };
+    stream->sending = (struct stream_buffer){ 0 };
+    stream->discard_body = strcmp(request->method, HEAD) == 0;
+    stream->waiting = false;
+    stream->ended = false;
+    stream->failed = false;
+    current_call->stream = stream;
+
+    /* the head goes out now, the event loop asks for the body once it is sent */
+    connection->response_streaming = true;
+    connection->response_context = stream;
+    queue_response(connection, request, current_call->response, false, current_call->flight);
+    netc_reactor_complete(stream->reactor, connection);
+    return stream;
+}
+
+bool netc_stream_write(netc_stream *stream, const void *data, size_t length)
+{
+    if (stream == NULL || (data == NULL && length > 0))
+        return false;
+
+    pthread_mutex_lock(&stream->mutex);
+    while (current_reactor == NULL && stream->failed == false && stream->pending.length >= NETC_STREAM_CHUNK_SIZE)
+        pthread_cond_wait(&stream->drained, &stream->mutex);
+
+    /* an empty chunk would end the body */
+    bool written = stream->failed == false && stream->ended == false &&
+                   (length == 0 || stream->discard_body || append_chunk(stream, data, length));
+    bool wake = stream->waiting && stream->pending.length > 0;
+    if (wake)
+        stream->waiting = false;
+    pthread_mutex_unlock(&stream->mutex);
+
+    if (wake)
+        netc_reactor_complete(stream->reactor, stream->connection);
+    return written;
+}
+
+bool netc_stream_end(netc_stream *stream)
+{
+    if (stream == NULL) return false;
+
+    pthread_mutex_lock(&stream->mutex);
+    if (stream->chunked && stream->discard_body == false && stream->failed == false)
+        append_chunk(stream, NULL, 0);
+    stream->ended = true;
+
+    /* the event loop may release the handle as soon as it is unlocked */
+    netc_reactor *reactor = stream->reactor;
+    netc_connection *connection = stream->connection;
+    bool accepted = stream->failed == false;
+    bool wake = stream->waiting;
+    stream->waiting = false;
+    pthread_mutex_unlock(&stream->mutex);
+
+    if (wake)
+        netc_reactor_complete(reactor, connection);
+    return accepted;
+}
+
+bool append_chunk(netc_stream *stream, const void *data, size_t length)
+{
+    struct stream_buffer *buffer = &stream->pending;
+    char size_line[24];
+    int size_length = 0;
+    if (stream->chunked)
+        size_length = snprintf(size_line, sizeof(size_line), "%zx\r\n", length);
+
+    /* the last chunk is followed by the empty trailer */
+    size_t needed = buffer->length + size_length + length + (stream->chunked ? 2 : 0);
+    if (needed > buffer->capacity)
+    {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : NETC_STREAM_CHUNK_SIZE;
+        while (capacity < needed) capacity *= 2;
+
+        char *temp = realloc(buffer->data, capacity);
+        if (temp == NULL)
+            return false;
+        buffer->data = temp;
+        buffer->capacity = capacity;
     }
-    free(response_string);
 
-    ctsl_print(&server.logger, CTSL_INFO, "%s %s => Status %d %s", ctx->request->method, ctx->request->path, res.status_code, res.status_text);
+    memcpy(buffer->data + buffer->length, size_line, size_length);
+    if (length > 0)
+        memcpy(buffer->data + buffer->length + size_length, data, length);
+    if (stream->chunked)
+        memcpy(buffer->data + buffer->length + size_length + length, "\r\n", 2);
+    buffer->length = needed;
+    return true;
+}
+
+bool stream_written(netc_reactor *reactor, netc_connection *connection, bool failed)
+{
+    (void)reactor;
+    netc_stream *stream = connection->response_context;
+
+    pthread_mutex_lock(&stream->mutex);
+    if (failed)
+    {
+        stream->failed = true;
+        stream->pending.length = 0;
+        connection->keep_alive = false;
+    }
 
-    close(ctx->client_sfd);
+    /* what was just sent is dropped, what was queued meanwhile takes its place */
+    stream->sending.length = 0;
+    if (stream->pending.length > 0)
+    {
+        struct stream_buffer sent = stream->sending;
+        stream->sending = stream->pending;
+        stream->pending = sent;
+        pthread_cond_broadcast(&stream->drained);
+        pthread_mutex_unlock(&stream->mutex);
+
+        connection->head_length = 0;
+        connection->response_body = stream->sending.data;
+        connection->response_body_length = stream->sending.length;
+        connection->response_body_borrowed = true;
+        connection->body_parts[0].data = stream->sending.data;
+        connection->body_parts[0].length = stream->sending.length;
+        connection->write_parts = connection->body_parts;
+        connection->write_part_count = 1;
+        connection->write_length = stream->sending.length;
+        connection->write_offset = 0;
+        return true;
+    }
+
+    pthread_cond_broadcast(&stream->drained);
+    if (stream->ended == false)
+    {
+        /* the next write or the end hands the connection back */
+        stream->waiting = true;
+        connection->state = NETC_CONNECTION_PROCESSING;
+        pthread_mutex_unlock(&stream->mutex);
+        return false;
+    }
+    pthread_mutex_unlock(&stream->mutex);
+
+    pthread_mutex_destroy(&stream->mutex);
+    pthread_cond_destroy(&stream->drained);
+    free(stream->pending.data);
+    free(stream->sending.data);
+    http_request_free(stream->request);
+
+    connection->response_body = NULL;
+    connection->response_body_length = 0;
+    connection->write_part_count = 0;
+    connection->response_streaming = false;
+    connection->response_context = NULL;
+    return true;
+}
+
+void *endpoint_default_middleware(void *context)
+{
+    struct context *ctx = (struct context*)context;
+    netc_reactor *reactor = ctx->reactor;
+    netc_connection *connection = ctx->connection;
+
+    if (run_handler(ctx) == false)
+        return NULL;
     http_request_free(ctx->request);
-    http_response_free(&res);
-    free(ctx);
+
+    /* the event loop owns the socket, it sends the response and either
+     * closes it or waits for the next request. Resetting the connection
+     * releases its arena, so nothing taken from it may be touched past here */
+    netc_reactor_complete(reactor, connection);
     return NULL;
 }
 
+void *stream_middleware(void *context)
+{
+    run_stream_step(context, false);
+    return NULL;
+}
+
+void run_stream_step(struct context *ctx, bool on_event_loop)
+{
+    netc_reactor *reactor = ctx->reactor;
+    netc_connection *connection = ctx->connection;
+    http_request *request = ctx->request;
+
+    if (request->body_state == HTTP_BODY_COMPLETE)
+    {
+        if (run_handler(ctx) == false)
+            return;
+    }
+    else
+    {
+        /* only the last piece comes with a response to fill */
+        ctx->handler_function(request, NULL);
+        if (request->body_state == HTTP_BODY_PARTIAL)
+        {
+            if (on_event_loop)
+                netc_reactor_resume(reactor, connection);
+            else
+                netc_reactor_complete(reactor, connection);
+            return;
+        }
+
+        connection->keep_alive = false;
+        http_response res = { 0 };
+        http_response_default_with_arena(&res, &connection->arena);
+        http_response_set_status(&res, frame_error_status(connection->frame_result));
+        queue_response(connection, request, &res, false, NULL);
+    }
+
+    http_request_free(request);
+    if (on_event_loop)
+        netc_reactor_send(reactor, connection);
+    else
+        netc_reactor_complete(reactor, connection);
+}
+
+bool wants_keep_alive(const http_request *request)
+{
+    /* HTTP/1.1 connections are persistent unless the client opts out */
+    bool keep_alive = strcmp(request->version, "HTTP/1.1") == 0;
+
+    const char *connection_header = http_request_get_known_header(request, HTTP_HEADER_CONNECTION);
+    if (connection_header != NULL)
+    {
+        if (strcasecmp(connection_header, "close") == 0)
+            keep_alive = false;
+        else if (strcasecmp(connection_header, "keep-alive") == 0)
+            keep_alive = true;
+    }
+
+    return keep_alive;
+}
+
+void add_connection_headers(http_response *response, const netc_connection *connection)
+{
+    /* the client can only find the end of a persistent response by its
+     * length, unless the body is streamed after the head */
+    if (connection->response_streaming == false && http_response_get_header(response, "Content-Length") == NULL)
+        http_response_add_header(response, "Content-Length", "0");
+
+    http_response_add_header(response, "Connection", connection->keep_alive ? "keep-alive" : "close");
+}
+
 void netc_shutdown_signal_handler(int sig)
 {
     (void)sig;
-    puts("");
-    netc_destroy();
-    exit(EXIT_SUCCESS);
+    for (size_t i = 0; i < server.reactor_count; i++)
+        netc_reactor_stop(&server.reactors[i]);
 }
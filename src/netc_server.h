@@ -4,27 +4,276 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "ctsl.h"
-#include <hashtable.h>
-#include <threadpool.h>
 #include "netc_http.h"
+#include "netc_reactor.h"
+#include "netc_router.h"
+#include "netc_scheduler.h"
+#include "netc_file_cache.h"
+#include "netc_response_cache.h"
+#include "netc_flight.h"
 
-#define DEFAULT_SOCKET_BUFFER_SIZE ((size_t)4096)
+typedef enum
+{
+    NETC_ENDPOINT_BLOCKING    = 0,
+    NETC_ENDPOINT_INLINE      = 1 << 0,
+    NETC_ENDPOINT_STREAM_BODY = 1 << 1,
+    NETC_ENDPOINT_CACHE       = 1 << 2,
+    NETC_ENDPOINT_COALESCE    = 1 << 3
+} netc_endpoint_flags;
+
+typedef struct netc_deferred netc_deferred;
+typedef struct netc_stream netc_stream;
 
 typedef struct
 {
-    int         linstening_socket_fd;
-    uint16_t    listening_port;
-    size_t      backlog_number;
-    ctsl        logger;
-    hashtable  *endpoint_map;
-    threadpool *threadpool;
+    uint16_t         listening_port;
+    size_t           backlog_number;
+    ctsl             logger;
+    netc_router      router;
+    netc_scheduler   scheduler;
+    netc_reactor    *reactors;
+    size_t           reactor_count;
+    bool             pin_reactors;
+    netc_io_backend  io_backend;
+    uint32_t         keepalive_timeout_ms;
+    size_t           max_keepalive_requests;
+    size_t           max_header_size;
+    size_t           max_body_size;
+    size_t           max_connections;
+    bool             stream_bodies;
+    netc_file_cache *file_caches;
+    netc_response_cache response_cache;
+    size_t           response_cache_size;
+    uint32_t         response_cache_ttl_ms;
+    netc_flight_table flights;
 } netc;
 
+typedef struct
+{
+    uint16_t         port;
+    const char      *log_filename;
+    size_t           thread_num;
+    size_t           reactor_num;
+    bool             pin_reactors;
+    netc_io_backend  io_backend;
+    uint32_t         keepalive_timeout_ms;
+    size_t           max_keepalive_requests;
+    size_t           max_header_size;
+    size_t           max_body_size;
+    size_t           max_connections;
+    size_t           response_cache_size;
+    uint32_t         response_cache_ttl_ms;
+    bool             log_async;
+    ctsl_overflow_policy log_overflow_policy;
+    ctsl_format      log_format;
+} netc_config;
+
+/**
+ * @brief returns the configuration used by netc_setup: a single epoll event
+ * loop on port 8080 logging to stdout, keeping connections alive for 5
+ * seconds and up to 100 requests, accepting 8 KiB of headers and 1 MiB
+ * of body per request and at most 10000 open connections, with up to 64
+ * MiB of cached responses kept for 1 second
+ *
+ * @return netc_config the default configuration
+ */
+netc_config netc_default_config(void);
+
 void netc_setup(const uint16_t port, const char *log_filename, const size_t thread_num);
 
+/**
+ * @brief sets up the server from a full configuration. With reactor_num
+ * greater than 1 every event loop gets its own SO_REUSEPORT listening socket
+ * and thread, so the kernel spreads new connections across them; 0 means one
+ * event loop per online CPU. thread_num workers run the handlers: the
+ * requests of a connection go to one worker, and idle workers steal from
+ * workers that fall behind. pin_reactors pins event loop i and worker i to
+ * core i.
+ * io_backend selects epoll or io_uring; io_uring falls back to epoll when
+ * the kernel does not support it. Connections are kept alive for
+ * keepalive_timeout_ms of inactivity (0 disables keep-alive) and for at most
+ * max_keepalive_requests requests. Requests whose headers exceed
+ * max_header_size or whose body exceeds max_body_size are answered with
+ * 431 or 413 and the connection is closed. At most max_connections
+ * connections are open at once, split evenly between the event loops (0
+ * means no limit); connections beyond it are closed as soon as they are
+ * accepted. Connection memory is recycled, so max_connections also bounds
+ * what the server holds under a connection flood. Endpoints registered with
+ * NETC_ENDPOINT_CACHE share a response cache of response_cache_size bytes,
+ * whose responses live response_cache_ttl_ms unless they carry a
+ * Cache-Control max-age. log_async moves log writes off
+ * the event loops and workers to a flusher thread, log_overflow_policy
+ * chooses whether lines are dropped or callers wait when it falls behind,
+ * and log_format can defer formatting to that thread or write binary
+ * records for tools/ctsl_decode
+ *
+ * @param config pointer to the configuration to apply
+ */
+void netc_setup_with_config(const netc_config *config);
+
+/**
+ * @brief registers the handler of a route. Segments of path starting with
+ * ':' match any single segment and '*' matches the rest of the path; the
+ * captured values are available to the handler through
+ * http_request_get_param. Requests matching a route only under another
+ * method are answered with 405
+ *
+ * @param method http method of the route
+ * @param path route pattern, e.g. /users/:id, or /static/ followed by *
+ * @param endpoint_handler function called for matching requests
+ * @return true on success
+ * @return false on an invalid pattern or allocation failure
+ */
 bool netc_add_endpoint(const char *method, const char *path,
                        void *(*endpoint_handler)(http_request*, http_response*));
 
+/**
+ * @brief registers the handler of a route like netc_add_endpoint. With
+ * NETC_ENDPOINT_INLINE the handler runs on the event loop that parsed the
+ * request and the response is sent right away, skipping the hop to a
+ * worker. Inline handlers must not block: every other connection of that
+ * event loop waits for them. With NETC_ENDPOINT_STREAM_BODY the handler is
+ * called for every piece of the body as it arrives, up to
+ * NETC_STREAM_CHUNK_SIZE bytes in request->body, and the socket is not read
+ * again until it returns; max_body_size does not apply. request->body_state
+ * is HTTP_BODY_PARTIAL and the response NULL for every piece but the last,
+ * which comes with HTTP_BODY_COMPLETE and the response to fill. When the
+ * body turns out malformed the handler is called a last time with
+ * HTTP_BODY_ABORTED and a NULL response, and the request is answered with
+ * an error status. request->user_data is free for the handler to keep its
+ * state across the calls. With NETC_ENDPOINT_CACHE the serialized 200
+ * responses to GET requests are stored, keyed by the path with its query
+ * and by the request headers named in the response Vary header; until they
+ * expire, GET and HEAD requests for the same key are answered from the
+ * event loop with a single send, without running the handler. Responses
+ * setting cookies or marked no-store, no-cache or private are not stored.
+ * With NETC_ENDPOINT_COALESCE a request arriving while an identical one,
+ * same method and path with its query, is being answered waits for it
+ * instead of running the handler again, and is sent a copy of its
+ * response. Requests carrying credentials or cookies are never coalesced,
+ * and a waiter runs the handler itself when the response is streamed, sets
+ * cookies, is marked no-store or private, or differs in the request
+ * headers it varies on. Combined with NETC_ENDPOINT_CACHE, a response that
+ * expires is produced once however many requests miss at the same moment.
+ * Only GET and HEAD endpoints without NETC_ENDPOINT_STREAM_BODY can be
+ * coalesced, the key does not cover a request body
+ *
+ * @param method http method of the route
+ * @param path route pattern, e.g. /users/:id, or /static/ followed by *
+ * @param endpoint_handler function called for matching requests
+ * @param flags NETC_ENDPOINT_BLOCKING, or NETC_ENDPOINT_INLINE,
+ * NETC_ENDPOINT_STREAM_BODY, NETC_ENDPOINT_CACHE and NETC_ENDPOINT_COALESCE
+ * combined
+ * @return true on success
+ * @return false on an invalid pattern, unknown flags, NETC_ENDPOINT_COALESCE
+ * on another method or allocation failure
+ */
+bool netc_add_endpoint_ex(const char *method, const char *path,
+                          void *(*endpoint_handler)(http_request*, http_response*), uint32_t flags);
+
+/**
+ * @brief serves the files of directory under prefix for GET and HEAD, e.g.
+ * /assets/app.js from ./public/app.js for the prefix /assets. Files are
+ * answered on the event loop and their content sent with sendfile, without
+ * being copied through user space; up to NETC_FILE_CACHE_CAPACITY of them
+ * are kept open along with their metadata, stated again at most once a
+ * second. Content-Type follows the extension and Last-Modified the
+ * modification time. A path ending with '/' is served its index.html; "."
+ * and ".." segments, files outside of directory and anything but regular
+ * files are answered with 404
+ *
+ * @param prefix path the files are served under, "/" for the root
+ * @param directory directory holding the files
+ * @return true on success
+ * @return false if the directory cannot be opened, on an invalid prefix or
+ * on allocation failure
+ */
+bool netc_add_static(const char *prefix, const char *directory);
+
+/**
+ * @brief lets the running handler return without answering the request.
+ * The response passed to the handler must not be touched after this call;
+ * it is filled through netc_deferred_response instead, and sent once
+ * netc_complete is called. The connection waits meanwhile, so neither the
+ * worker nor the event loop is held. Calling it again returns the same
+ * handle
+ *
+ * @param request the request the handler was called with
+ * @return netc_deferred* handle of the request, NULL when called outside
+ * of a handler or with another request, or on allocation failure
+ */
+netc_deferred *netc_defer(http_request *request);
+
+/**
+ * @brief returns the response of a deferred request, already holding what
+ * the handler set before deferring
+ *
+ * @param deferred handle returned by netc_defer
+ * @return http_response* the response to fill, owned by the handle
+ */
+http_response *netc_deferred_response(netc_deferred *deferred);
+
+/**
+ * @brief returns the request of a deferred request, valid until
+ * netc_complete
+ *
+ * @param deferred handle returned by netc_defer
+ * @return http_request* the request
+ */
+http_request *netc_deferred_request(netc_deferred *deferred);
+
+/**
+ * @brief sends the response of a deferred request and releases the handle.
+ * Can be called from any thread, once per handle and before netc_destroy.
+ * Only one thread may use a handle at a time
+ *
+ * @param deferred handle returned by netc_defer
+ */
+void netc_complete(netc_deferred *deferred);
+
+/**
+ * @brief lets the running handler send its response body piece by piece
+ * with netc_stream_write as it is produced, instead of setting it whole.
+ * The status and headers set on the response so far are sent right away
+ * with Transfer-Encoding: chunked, or for HTTP/1.0 clients with the end of
+ * the body marked by closing the connection. The response must not be
+ * touched after this call, nor have a body yet. Like a deferred request,
+ * the stream may be written and ended from any thread, during the handler
+ * or after it returned
+ *
+ * @param request the request the handler was called with
+ * @return netc_stream* handle of the response body, NULL when called
+ * outside of a handler, with another request, after netc_defer, when the
+ * response already has a body or on allocation failure
+ */
+netc_stream *netc_stream_begin(http_request *request);
+
+/**
+ * @brief queues length bytes of the body, sent as one chunk. Once
+ * NETC_STREAM_CHUNK_SIZE bytes wait to be sent the call blocks until the
+ * event loop took them, so a fast producer is held to the pace of the
+ * client; on the event loop itself, from inline handlers, it never blocks
+ *
+ * @param stream handle returned by netc_stream_begin
+ * @param data bytes to send, may contain NUL
+ * @param length number of bytes, 0 sends nothing
+ * @return true on success
+ * @return false once the client went away or the stream ended, or on
+ * allocation failure
+ */
+bool netc_stream_write(netc_stream *stream, const void *data, size_t length);
+
+/**
+ * @brief ends the body and releases the handle once the rest is sent. Must
+ * be called exactly once, even after a failed write, and the handle must
+ * not be used afterwards. Only one thread may use a handle at a time
+ *
+ * @param stream handle returned by netc_stream_begin
+ * @return true if every byte written so far was accepted for sending
+ * @return false if the client went away first
+ */
+bool netc_stream_end(netc_stream *stream);
+
 void netc_run(void);
 
 void netc_destroy(void);
@@ -0,0 +1,537 @@
+#include "netc_uring.h"
+#include "netc_reactor.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+/* user_data carries the connection pointer, the low bits tell the operation */
+#define URING_OP_ACCEPT   ((uint64_t)1)
+#define URING_OP_WAKEUP   ((uint64_t)2)
+#define URING_OP_RECV     ((uint64_t)3)
+#define URING_OP_SEND     ((uint64_t)4)
+#define URING_OP_CLOSE    ((uint64_t)5)
+#define URING_OP_SWEEP    ((uint64_t)6)
+#define URING_OP_WRITABLE ((uint64_t)7)
+#define URING_OP_MASK     ((uint64_t)7)
+
+bool map_rings(netc_uring *uring, const struct io_uring_params *params);
+bool register_buffer_ring(netc_uring *uring);
+void recycle_buffer(netc_uring *uring, uint16_t buffer_id);
+bool arm_accept(netc_reactor *reactor);
+bool arm_wakeup(netc_reactor *reactor);
+bool arm_recv(netc_reactor *reactor, netc_connection *connection);
+bool arm_sweep(netc_reactor *reactor);
+void arm_writable(netc_reactor *reactor, netc_connection *connection);
+bool close_linked(const netc_connection *connection);
+void handle_completion(netc_reactor *reactor, const struct io_uring_cqe *cqe);
+void handle_recv(netc_reactor *reactor, netc_connection *connection, const struct io_uring_cqe *cqe);
+void handle_send(netc_reactor *reactor, netc_connection *connection, int result);
+void handle_close(netc_reactor *reactor, netc_connection *connection, int result);
+
+bool netc_uring_init(netc_uring *uring)
+{
+    if (uring == NULL) return false;
+
+    memset(uring, 0, sizeof(netc_uring));
+
+    struct io_uring_params params = { 0 };
+    uring->ring_fd = syscall(__NR_io_uring_setup, NETC_URING_ENTRIES, &params);
+    if (uring->ring_fd < 0)
+        return false;
+
+    if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0 || map_rings(uring, &params) == false)
+    {
+        close(uring->ring_fd);
+        errno = ENOTSUP;
+        return false;
+    }
+
+    if (register_buffer_ring(uring) == false)
+    {
+        int saved_errno = errno;
+        munmap(uring->sqes, uring->sqes_size);
+        munmap(uring->sq_ring, uring->sq_ring_size);
+        close(uring->ring_fd);
+        errno = saved_errno;
+        return false;
+    }
+
+    return true;
+}
+
+struct io_uring_sqe *netc_uring_get_sqe(netc_uring *uring)
+{
+    unsigned tail = *uring->sq_tail;
+    unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= uring->sq_entries)
+    {
+        /* queue full: hand the pending entries to the kernel first */
+        if (syscall(__NR_io_uring_enter, uring->ring_fd, tail - head, 0, 0, NULL, 0) < 0)
+            return NULL;
+
+        head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= uring->sq_entries)
+            return NULL;
+    }
+
+    /* without SQPOLL the kernel only reads entries inside io_uring_enter */
+    unsigned index = tail & uring->sq_mask;
+    struct io_uring_sqe *sqe = &uring->sqes[index];
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    uring->sq_array[index] = index;
+    __atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return sqe;
+}
+
+int netc_uring_submit_and_wait(netc_uring *uring)
+{
+    unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+    unsigned to_submit = *uring->sq_tail - head;
+
+    int submitted = syscall(__NR_io_uring_enter, uring->ring_fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted < 0)
+        return -errno;
+
+    return submitted;
+}
+
+void netc_uring_destroy(netc_uring *uring)
+{
+    if (uring == NULL) return;
+
+    munmap(uring->buffer_ring, uring->buffer_ring_size);
+    free(uring->buffers);
+    munmap(uring->sqes, uring->sqes_size);
+    munmap(uring->sq_ring, uring->sq_ring_size);
+    close(uring->ring_fd);
+}
+
+void netc_uring_reactor_run(netc_reactor *reactor)
+{
+    netc_uring *uring = &reactor->uring;
+
+    if (arm_accept(reactor) == false || arm_wakeup(reactor) == false ||
+        (reactor->idle_timeout_ms > 0 && arm_sweep(reactor) == false))
+    {
+        ctsl_print(reactor->logger, CTSL_ERROR, "Error arming io_uring event loop");
+        return;
+    }
+
+    reactor->running = true;
+    while (reactor->running)
+    {
+        int result = netc_uring_submit_and_wait(uring);
+        atomic_fetch_add_explicit(&reactor->stats.syscalls, 1, memory_order_relaxed);
+        if (result < 0 && result != -EINTR && result != -EBUSY)
+        {
+            ctsl_print(reactor->logger, CTSL_ERROR, "Error waiting for io_uring completions: %s", strerror(-result));
+            break;
+        }
+
+        unsigned head = *uring->cq_head;
+        unsigned tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            handle_completion(reactor, &uring->cqes[head & uring->cq_mask]);
+            head++;
+        }
+        __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+        netc_reactor_run_ready(reactor);
+    }
+}
+
+void netc_uring_reactor_send(netc_reactor *reactor, netc_connection *connection)
+{
+    netc_uring *uring = &reactor->uring;
+
+    /* send and close must reach the kernel in the same batch to stay linked,
+     * so both slots are freed before the send is queued */
+    unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+    if (*uring->sq_tail - head + 2 > uring->sq_entries)
+    {
+        int submitted = syscall(__NR_io_uring_enter, uring->ring_fd, *uring->sq_tail - head, 0, 0, NULL, 0);
+        head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+        if (submitted < 0 || *uring->sq_tail - head + 2 > uring->sq_entries)
+        {
+            ctsl_print(reactor->logger, CTSL_ERROR, "Error flushing io_uring submissions: %s",
+                       submitted < 0 ? strerror(errno) : "submission queue full");
+            netc_reactor_close(reactor, connection);
+            return;
+        }
+    }
+
+    /* a response produced piece by piece goes on with the next piece */
+    if (connection->write_offset >= connection->write_length && connection->response_streaming &&
+        reactor->on_written(reactor, connection, false) == false)
+        return;
+
+    /* files go out with sendfile from the loop, the page cache is not
+     * copied through user space; a full socket is waited for with a poll */
+    if (netc_connection_file_pending(connection))
+    {
+        netc_io_result result = netc_connection_send_file(connection);
+        if (result == NETC_IO_AGAIN)
+        {
+            arm_writable(reactor, connection);
+            return;
+        }
+        if (result == NETC_IO_ERROR)
+        {
+            ctsl_print(reactor->logger, CTSL_ERROR, "Error sending file to client: %s", strerror(errno));
+            netc_reactor_close(reactor, connection);
+            return;
+        }
+    }
+
+    /* the close is only linked once the last bytes of the response are sent */
+    bool linked = close_linked(connection);
+    if (connection->write_offset < connection->write_length)
+    {
+        struct io_uring_sqe *send_sqe = netc_uring_get_sqe(uring);
+        if (send_sqe == NULL)
+        {
+            netc_reactor_close(reactor, connection);
+            return;
+        }
+
+        send_sqe->opcode = IORING_OP_SENDMSG;
+        send_sqe->fd = connection->fd;
+        send_sqe->addr = (uint64_t)(uintptr_t)netc_connection_pending_write(connection);
+        send_sqe->len = 1;
+        send_sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL | (connection->write_more ? MSG_MORE : 0);
+        send_sqe->flags = linked ? IOSQE_IO_LINK : 0;
+        send_sqe->user_data = (uint64_t)(uintptr_t)connection | URING_OP_SEND;
+    }
+    else if (linked == false)
+    {
+        netc_reactor_finish(reactor, connection);
+        return;
+    }
+
+    /* keep-alive connections stay open, the send completion resumes reading */
+    if (linked == false)
+        return;
+
+    struct io_uring_sqe *close_sqe = netc_uring_get_sqe(uring);
+    if (close_sqe == NULL)
+    {
+        netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    close_sqe->opcode = IORING_OP_CLOSE;
+    close_sqe->fd = connection->fd;
+    close_sqe->user_data = (uint64_t)(uintptr_t)connection | URING_OP_CLOSE;
+}
+
+void netc_uring_reactor_resume(netc_reactor *reactor, netc_connection *connection)
+{
+    if (arm_recv(reactor, connection) == false)
+        netc_reactor_close(reactor, connection);
+}
+
+bool map_rings(netc_uring *uring, const struct io_uring_params *params)
+{
+    uring->sq_ring_size = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+    uring->cq_ring_size = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    if (uring->cq_ring_size > uring->sq_ring_size)
+        uring->sq_ring_size = uring->cq_ring_size;
+
+    uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQ_RING);
+    if (uring->sq_ring == MAP_FAILED)
+        return false;
+    uring->cq_ring = uring->sq_ring;
+
+    uring->sqes_size = params->sq_entries * sizeof(struct io_uring_sqe);
+    uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, uring->ring_fd, IORING_OFF_SQES);
+    if (uring->sqes == MAP_FAILED)
+    {
+        munmap(uring->sq_ring, uring->sq_ring_size);
+        return false;
+    }
+
+    char *sq = uring->sq_ring;
+    uring->sq_head = (unsigned*)(sq + params->sq_off.head);
+    uring->sq_tail = (unsigned*)(sq + params->sq_off.tail);
+    uring->sq_array = (unsigned*)(sq + params->sq_off.array);
+    uring->sq_mask = *(unsigned*)(sq + params->sq_off.ring_mask);
+    uring->sq_entries = params->sq_entries;
+
+    char *cq = uring->cq_ring;
+    uring->cq_head = (unsigned*)(cq + params->cq_off.head);
+    uring->cq_tail = (unsigned*)(cq + params->cq_off.tail);
+    uring->cqes = (struct io_uring_cqe*)(cq + params->cq_off.cqes);
+    uring->cq_mask = *(unsigned*)(cq + params->cq_off.ring_mask);
+
+    return true;
+}
+
+bool register_buffer_ring(netc_uring *uring)
+{
+    uring->buffer_ring_size = NETC_URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+    uring->buffer_ring = mmap(NULL, uring->buffer_ring_size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (uring->buffer_ring == MAP_FAILED)
+        return false;
+
+    uring->buffers = malloc(NETC_URING_BUFFER_COUNT * DEFAULT_SOCKET_BUFFER_SIZE);
+    if (uring->buffers == NULL)
+    {
+        munmap(uring->buffer_ring, uring->buffer_ring_size);
+        return false;
+    }
+
+    struct io_uring_buf_reg registration = {
+        .ring_addr = (uint64_t)(uintptr_t)uring->buffer_ring,
+        .ring_entries = NETC_URING_BUFFER_COUNT,
+        .bgid = NETC_URING_BUFFER_GROUP
+    };
+    if (syscall(__NR_io_uring_register, uring->ring_fd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+    {
+        int saved_errno = errno;
+        free(uring->buffers);
+        munmap(uring->buffer_ring, uring->buffer_ring_size);
+        errno = saved_errno;
+        return false;
+    }
+
+    uring->buffer_ring->tail = 0;
+    for (uint16_t i = 0; i < NETC_URING_BUFFER_COUNT; i++)
+        recycle_buffer(uring, i);
+
+    return true;
+}
+
+void recycle_buffer(netc_uring *uring, uint16_t buffer_id)
+{
+    uint16_t tail = uring->buffer_ring->tail;
+    struct io_uring_buf *buffer = &uring->buffer_ring->bufs[tail & (NETC_URING_BUFFER_COUNT - 1)];
+    buffer->addr = (uint64_t)(uintptr_t)(uring->buffers + (size_t)buffer_id * DEFAULT_SOCKET_BUFFER_SIZE);
+    buffer->len = DEFAULT_SOCKET_BUFFER_SIZE;
+    buffer->bid = buffer_id;
+    __atomic_store_n(&uring->buffer_ring->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+bool arm_accept(netc_reactor *reactor)
+{
+    struct io_uring_sqe *sqe = netc_uring_get_sqe(&reactor->uring);
+    if (sqe == NULL) return false;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = reactor->listening_socket_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = URING_OP_ACCEPT;
+    return true;
+}
+
+bool arm_wakeup(netc_reactor *reactor)
+{
+    struct io_uring_sqe *sqe = netc_uring_get_sqe(&reactor->uring);
+    if (sqe == NULL) return false;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = reactor->wakeup_fd;
+    sqe->addr = (uint64_t)(uintptr_t)&reactor->uring.wakeup_value;
+    sqe->len = sizeof(reactor->uring.wakeup_value);
+    sqe->user_data = URING_OP_WAKEUP;
+    return true;
+}
+
+bool arm_recv(netc_reactor *reactor, netc_connection *connection)
+{
+    struct io_uring_sqe *sqe = netc_uring_get_sqe(&reactor->uring);
+    if (sqe == NULL) return false;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = connection->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = NETC_URING_BUFFER_GROUP;
+    sqe->user_data = (uint64_t)(uintptr_t)connection | URING_OP_RECV;
+    return true;
+}
+
+bool arm_sweep(netc_reactor *reactor)
+{
+    struct io_uring_sqe *sqe = netc_uring_get_sqe(&reactor->uring);
+    if (sqe == NULL) return false;
+
+    reactor->uring.sweep_interval.tv_sec = NETC_REACTOR_SWEEP_INTERVAL_MS / 1000;
+    reactor->uring.sweep_interval.tv_nsec = (NETC_REACTOR_SWEEP_INTERVAL_MS % 1000) * 1000000L;
+
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)&reactor->uring.sweep_interval;
+    sqe->len = 1;
+    sqe->user_data = URING_OP_SWEEP;
+    return true;
+}
+
+void arm_writable(netc_reactor *reactor, netc_connection *connection)
+{
+    struct io_uring_sqe *sqe = netc_uring_get_sqe(&reactor->uring);
+    if (sqe == NULL)
+    {
+        netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = connection->fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = (uint64_t)(uintptr_t)connection | URING_OP_WRITABLE;
+}
+
+bool close_linked(const netc_connection *connection)
+{
+    /* a file body is finished from the loop, its connection closed by hand */
+    return connection->keep_alive == false && connection->response_streaming == false &&
+           connection->response_file == NULL;
+}
+
+void handle_completion(netc_reactor *reactor, const struct io_uring_cqe *cqe)
+{
+    netc_connection *connection = (netc_connection*)(uintptr_t)(cqe->user_data & ~URING_OP_MASK);
+
+    switch (cqe->user_data & URING_OP_MASK)
+    {
+        case URING_OP_ACCEPT:
+            if (cqe->res >= 0)
+            {
+                netc_connection *accepted = netc_reactor_adopt(reactor, cqe->res);
+                if (accepted != NULL)
+                    netc_uring_reactor_resume(reactor, accepted);
+            }
+            else if (cqe->res != -ECANCELED)
+            {
+                ctsl_print(reactor->logger, CTSL_ERROR, "Error accepting new connection: %s", strerror(-cqe->res));
+            }
+
+            if ((cqe->flags & IORING_CQE_F_MORE) == 0 && reactor->running)
+                arm_accept(reactor);
+            break;
+
+        case URING_OP_WAKEUP:
+            for (netc_connection *completed = netc_reactor_take_completed(reactor); completed != NULL;)
+            {
+                netc_connection *next = completed->next_completed;
+                if (completed->streaming)
+                    netc_reactor_resume(reactor, completed);
+                else
+                    netc_reactor_send(reactor, completed);
+                completed = next;
+            }
+
+            if (reactor->running)
+                arm_wakeup(reactor);
+            break;
+
+        case URING_OP_RECV:
+            handle_recv(reactor, connection, cqe);
+            break;
+
+        case URING_OP_SEND:
+            handle_send(reactor, connection, cqe->res);
+            break;
+
+        case URING_OP_CLOSE:
+            handle_close(reactor, connection, cqe->res);
+            break;
+
+        case URING_OP_WRITABLE:
+            if (cqe->res < 0)
+                netc_reactor_close(reactor, connection);
+            else
+                netc_uring_reactor_send(reactor, connection);
+            break;
+
+        case URING_OP_SWEEP:
+            netc_reactor_sweep_idle(reactor);
+            if (reactor->running)
+                arm_sweep(reactor);
+            break;
+    }
+}
+
+void handle_recv(netc_reactor *reactor, netc_connection *connection, const struct io_uring_cqe *cqe)
+{
+    if (cqe->res == -ENOBUFS || cqe->res == -EINTR)
+    {
+        if (arm_recv(reactor, connection) == false)
+            netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    if (cqe->res <= 0)
+    {
+        netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    uint16_t buffer_id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+    const char *data = reactor->uring.buffers + (size_t)buffer_id * DEFAULT_SOCKET_BUFFER_SIZE;
+    bool appended = netc_connection_append(connection, data, cqe->res);
+    recycle_buffer(&reactor->uring, buffer_id);
+
+    if (appended == false)
+    {
+        netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    netc_reactor_touch(reactor, connection);
+    if (netc_reactor_dispatch_buffered(reactor, connection) == false)
+        netc_uring_reactor_resume(reactor, connection);
+}
+
+void handle_send(netc_reactor *reactor, netc_connection *connection, int result)
+{
+    if (result < 0)
+    {
+        ctsl_print(reactor->logger, CTSL_ERROR, "Error sending data to client: %s", strerror(-result));
+        connection->write_offset = connection->write_length;
+        if (connection->response_streaming)
+        {
+            if (reactor->on_written(reactor, connection, true))
+                netc_reactor_close(reactor, connection);
+            return;
+        }
+        if (close_linked(connection) == false)
+            netc_reactor_close(reactor, connection);
+        return;
+    }
+
+    /* a short send breaks the link, the close completion resubmits the rest */
+    connection->write_offset += result;
+    if (close_linked(connection))
+        return;
+
+    if (connection->write_offset < connection->write_length || connection->response_streaming)
+        netc_uring_reactor_send(reactor, connection);
+    else
+        netc_reactor_finish(reactor, connection);
+}
+
+void handle_close(netc_reactor *reactor, netc_connection *connection, int result)
+{
+    if (result == -ECANCELED && connection->write_offset < connection->write_length)
+    {
+        netc_uring_reactor_send(reactor, connection);
+        return;
+    }
+
+    /* a cancelled close leaves the descriptor to netc_reactor_close */
+    if (result != -ECANCELED)
+        connection->fd = -1;
+
+    netc_reactor_close(reactor, connection);
+}
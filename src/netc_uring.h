@@ -0,0 +1,106 @@
+#ifndef NETC_URING_H
+#define NETC_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <linux/io_uring.h>
+#include "netc_connection.h"
+
+#define NETC_URING_ENTRIES      256
+#define NETC_URING_BUFFER_COUNT 256
+#define NETC_URING_BUFFER_GROUP 0
+
+struct netc_reactor;
+
+typedef struct
+{
+    int                       ring_fd;
+    void                     *sq_ring;
+    size_t                    sq_ring_size;
+    void                     *cq_ring;
+    size_t                    cq_ring_size;
+    struct io_uring_sqe      *sqes;
+    size_t                    sqes_size;
+
+    unsigned                 *sq_head;
+    unsigned                 *sq_tail;
+    unsigned                 *sq_array;
+    unsigned                  sq_mask;
+    unsigned                  sq_entries;
+
+    unsigned                 *cq_head;
+    unsigned                 *cq_tail;
+    struct io_uring_cqe      *cqes;
+    unsigned                  cq_mask;
+
+    struct io_uring_buf_ring *buffer_ring;
+    size_t                    buffer_ring_size;
+    char                     *buffers;
+    uint64_t                  wakeup_value;
+    struct __kernel_timespec  sweep_interval;
+} netc_uring;
+
+/**
+ * @brief creates the ring and registers a provided buffer ring of
+ * NETC_URING_BUFFER_COUNT receive buffers. Fails on kernels without
+ * multishot accept or provided buffer rings, so callers can fall back
+ *
+ * @param uring pointer to the ring to initialize
+ * @return true on success
+ * @return false if io_uring is unavailable
+ */
+bool netc_uring_init(netc_uring *uring);
+
+/**
+ * @brief returns the next free submission entry, zeroed. When the submission
+ * queue is full the queued entries are submitted first
+ *
+ * @param uring pointer to the ring
+ * @return struct io_uring_sqe* pointer to the entry, NULL on error
+ */
+struct io_uring_sqe *netc_uring_get_sqe(netc_uring *uring);
+
+/**
+ * @brief submits every queued entry and waits for at least one completion
+ * with a single io_uring_enter call
+ *
+ * @param uring pointer to the ring
+ * @return int number of entries submitted, negative errno on failure
+ */
+int netc_uring_submit_and_wait(netc_uring *uring);
+
+/**
+ * @brief unmaps the rings and frees the receive buffers
+ *
+ * @param uring pointer to the ring to destroy
+ */
+void netc_uring_destroy(netc_uring *uring);
+
+/**
+ * @brief runs the io_uring flavour of the event loop: one multishot accept,
+ * recv into provided buffers and linked send+close for responses
+ *
+ * @param reactor pointer to the reactor to run
+ */
+void netc_uring_reactor_run(struct netc_reactor *reactor);
+
+/**
+ * @brief queues the connection response as a send linked to the close of
+ * the socket, or as a plain send for keep-alive connections. Must be called
+ * on the reactor thread
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the connection to send
+ */
+void netc_uring_reactor_send(struct netc_reactor *reactor, netc_connection *connection);
+
+/**
+ * @brief arms a recv for a connection waiting for its next request. Must be
+ * called on the reactor thread
+ *
+ * @param reactor pointer to the reactor owning the connection
+ * @param connection pointer to the connection to read from
+ */
+void netc_uring_reactor_resume(struct netc_reactor *reactor, netc_connection *connection);
+
+#endif // NETC_URING_H
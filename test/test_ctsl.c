@@ -3,8 +3,13 @@
 #include "unity.h"
 
 #include "ctsl.h"
+#include "netc_clock.h"
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <pthread.h>
 
 void setUp(void)
 {
@@ -54,4 +59,285 @@ void test_ctsl_NonNullArgumentShouldOpenFileAndWrite(void)
     fclose(file);
 }
 
+void test_ctsl_AsyncModeShouldWriteEveryLineInOrder(void)
+{
+    unlink("logs/test_async.log");
+    ctsl_config config = ctsl_default_config();
+    config.async = true;
+    config.ring_capacity = 16;
+    config.overflow_policy = CTSL_OVERFLOW_BLOCK;
+
+    ctsl logger;
+    TEST_ASSERT_TRUE(ctsl_init_with_config(&logger, "logs/test_async.log", &config));
+    TEST_ASSERT_NOT_NULL(logger.async);
+    for (int i = 0; i < 1000; i++)
+        ctsl_print(&logger, CTSL_INFO, "line %d", i);
+    ctsl_destroy(&logger);
+
+    FILE *file = fopen("logs/test_async.log", "r");
+    TEST_ASSERT_NOT_NULL(file);
+    char buffer[256], expected[32];
+    for (int i = 0; i < 1000; i++)
+    {
+        TEST_ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), file));
+        snprintf(expected, sizeof(expected), "INFO - line %d\n", i);
+        TEST_ASSERT_NOT_NULL(strstr(buffer, expected));
+    }
+    TEST_ASSERT_NULL(fgets(buffer, sizeof(buffer), file));
+    fclose(file);
+}
+
+void test_ctsl_AsyncModeShouldTruncateLongLines(void)
+{
+    unlink("logs/test_async.log");
+    ctsl_config config = ctsl_default_config();
+    config.async = true;
+
+    char message[CTSL_ENTRY_SIZE * 2];
+    memset(message, 'x', sizeof(message) - 1);
+    message[sizeof(message) - 1] = '\0';
+
+    ctsl logger;
+    TEST_ASSERT_TRUE(ctsl_init_with_config(&logger, "logs/test_async.log", &config));
+    ctsl_print(&logger, CTSL_INFO, "%s", message);
+    ctsl_print(&logger, CTSL_INFO, "after");
+    ctsl_destroy(&logger);
+
+    FILE *file = fopen("logs/test_async.log", "r");
+    TEST_ASSERT_NOT_NULL(file);
+    char buffer[CTSL_ENTRY_SIZE * 2];
+    TEST_ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), file));
+    TEST_ASSERT_EQUAL_size_t(CTSL_ENTRY_SIZE - 1, strlen(buffer));
+    TEST_ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), file));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "after"));
+    fclose(file);
+}
+
+void *drain_pipe(void *fd)
+{
+    char buffer[4096];
+    while (read(*(int*)fd, buffer, sizeof(buffer)) > 0)
+        ;
+    return NULL;
+}
+
+void test_ctsl_AsyncModeShouldCountDroppedLinesWhenFull(void)
+{
+    ctsl_config config = ctsl_default_config();
+    config.async = true;
+    config.ring_capacity = 8;
+    config.overflow_policy = CTSL_OVERFLOW_DROP;
+
+    ctsl logger;
+    TEST_ASSERT_TRUE(ctsl_init_with_config(&logger, "logs/test_async.log", &config));
+
+    /* the flusher stalls on a pipe nobody reads, so the ring fills up */
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+    fcntl(fds[1], F_SETPIPE_SZ, 4096);
+    dup2(fds[1], logger.fd);
+    close(fds[1]);
+
+    for (int i = 0; i < 500; i++)
+        ctsl_print(&logger, CTSL_INFO, "a line long enough to fill the pipe quickly %d", i);
+    TEST_ASSERT_TRUE(ctsl_dropped(&logger) > 0);
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, drain_pipe, &fds[0]);
+    ctsl_destroy(&logger);
+    pthread_join(reader, NULL);
+    close(fds[0]);
+}
+
+struct captured_pipe
+{
+    int    fd;
+    char   data[256 * 1024];
+    size_t length;
+};
+
+void *capture_pipe(void *arg)
+{
+    struct captured_pipe *pipe_data = arg;
+    ssize_t n;
+    while ((n = read(pipe_data->fd, pipe_data->data + pipe_data->length,
+                     sizeof(pipe_data->data) - pipe_data->length)) > 0)
+        pipe_data->length += n;
+    return NULL;
+}
+
+void test_ctsl_BinaryFormatShouldReportDroppedLinesAsRecord(void)
+{
+    unlink("logs/test_binary.log");
+    ctsl_config config = ctsl_default_config();
+    config.ring_capacity = 8;
+    config.overflow_policy = CTSL_OVERFLOW_DROP;
+    config.format = CTSL_FORMAT_BINARY;
+
+    ctsl logger;
+    TEST_ASSERT_TRUE(ctsl_init_with_config(&logger, "logs/test_binary.log", &config));
+
+    static struct captured_pipe captured;
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, pipe(fds));
+    fcntl(fds[1], F_SETPIPE_SZ, 4096);
+    dup2(fds[1], logger.fd);
+    close(fds[1]);
+
+    for (int i = 0; i < 500; i++)
+        ctsl_print(&logger, CTSL_INFO, "a line long enough to fill the pipe quickly %d %s", i, "padding padding");
+    TEST_ASSERT_TRUE(ctsl_dropped(&logger) > 0);
+
+    captured.fd = fds[0];
+    captured.length = 0;
+    pthread_t reader;
+    pthread_create(&reader, NULL, capture_pipe, &captured);
+    ctsl_destroy(&logger);
+    pthread_join(reader, NULL);
+    close(fds[0]);
+
+    /* every byte has to parse as a format or a record, one of them the notice */
+    char formats[4][64] = { 0 };
+    bool reported = false;
+    size_t offset = 0;
+    while (offset < captured.length)
+    {
+        char type = captured.data[offset++];
+        uint32_t id;
+        uint16_t length;
+        TEST_ASSERT_TRUE(type == CTSL_BINARY_FORMAT || type == CTSL_BINARY_RECORD);
+        memcpy(&id, captured.data + offset, sizeof(id));
+        TEST_ASSERT_TRUE(id < 4);
+        offset += sizeof(id);
+        if (type == CTSL_BINARY_FORMAT)
+        {
+            memcpy(&length, captured.data + offset, sizeof(length));
+            offset += sizeof(length);
+            TEST_ASSERT_TRUE(length < sizeof(formats[id]));
+            memcpy(formats[id], captured.data + offset, length);
+            offset += length;
+            continue;
+        }
+
+        uint8_t level = captured.data[offset];
+        offset += sizeof(level) + sizeof(uint64_t);
+        memcpy(&length, captured.data + offset, sizeof(length));
+        offset += sizeof(length);
+        TEST_ASSERT_NOT_EQUAL(0, formats[id][0]);
+
+        char message[CTSL_ENTRY_SIZE];
+        ctsl_format_record(message, sizeof(message), formats[id], (const uint8_t*)captured.data + offset, length);
+        offset += length;
+        if (strstr(message, "log lines dropped, ring full") != NULL)
+        {
+            TEST_ASSERT_EQUAL_STRING(CTSL_WARNING, ctsl_level_name(level));
+            reported = true;
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(captured.length, offset);
+    TEST_ASSERT_TRUE(reported);
+}
+
+void test_ctsl_DeferredFormatShouldMatchPrintf(void)
+{
+    unlink("logs/test_async.log");
+    ctsl_config config = ctsl_default_config();
+    config.format = CTSL_FORMAT_DEFERRED;
+
+    ctsl logger;
+    TEST_ASSERT_TRUE(ctsl_init_with_config(&logger, "logs/test_async.log", &config));
+    TEST_ASSERT_NOT_NULL(logger.async);
+
+    const char *path = "/users/42";
+    ctsl_print(&logger, CTSL_INFO, "%s %s => Status %d %s", "GET", path, 200, "OK");
+    ctsl_print(&logger, CTSL_WARNING, "%-*s|%5.2f|%zu|%#x|%c|%lld|100%%|%s", 6, "ab", 3.14159, (size_t)7, 255, 'z', -5LL, (char*)NULL);
+    ctsl_destroy(&logger);
+
+    char expected[128];
+    FILE *file = fopen("logs/test_async.log", "r");
+    TEST_ASSERT_NOT_NULL(file);
+    char buffer[256];
+    TEST_ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), file));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, " - INFO - GET /users/42 => Status 200 OK\n"));
+    TEST_ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), file));
+    snprintf(expected, sizeof(expected), " - WARNING - %-*s|%5.2f|%zu|%#x|%c|%lld|100%%|%s\n",
+             6, "ab", 3.14159, (size_t)7, 255, 'z', -5LL, "(null)");
+    TEST_ASSERT_NOT_NULL(strstr(buffer, expected));
+    fclose(file);
+}
+
+void test_ctsl_DeferredFormatShouldStopStringsAtPrecision(void)
+{
+    unlink("logs/test_async.log");
+    ctsl_config config = ctsl_default_config();
+    config.format = CTSL_FORMAT_DEFERRED;
+
+    ctsl logger;
+    TEST_ASSERT_TRUE(ctsl_init_with_config(&logger, "logs/test_async.log", &config));
+
+    /* like a status line inside a cached response head, no NUL after it */
+    char *status = malloc(6);
+    TEST_ASSERT_NOT_NULL(status);
+    memcpy(status, "200 OK", 6);
+    ctsl_print(&logger, CTSL_INFO, "Status %.*s|%.3s", 6, status, status);
+    free(status);
+    ctsl_destroy(&logger);
+
+    FILE *file = fopen("logs/test_async.log", "r");
+    TEST_ASSERT_NOT_NULL(file);
+    char buffer[256];
+    TEST_ASSERT_NOT_NULL(fgets(buffer, sizeof(buffer), file));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, " - INFO - Status 200 OK|200\n"));
+    fclose(file);
+}
+
+void test_ctsl_BinaryFormatShouldDefineEachFormatOnce(void)
+{
+    unlink("logs/test_binary.log");
+    ctsl_config config = ctsl_default_config();
+    config.format = CTSL_FORMAT_BINARY;
+
+    ctsl logger;
+    TEST_ASSERT_TRUE(ctsl_init_with_config(&logger, "logs/test_binary.log", &config));
+    for (int i = 0; i < 3; i++)
+        ctsl_print(&logger, CTSL_ERROR, "request %d failed: %s", i, "timeout");
+    ctsl_destroy(&logger);
+
+    FILE *file = fopen("logs/test_binary.log", "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    char magic[8];
+    TEST_ASSERT_EQUAL_size_t(8, fread(magic, 1, sizeof(magic), file));
+    TEST_ASSERT_EQUAL_MEMORY(CTSL_BINARY_MAGIC, magic, 8);
+
+    uint32_t id;
+    uint16_t length;
+    char format[64] = { 0 };
+    TEST_ASSERT_EQUAL_INT(CTSL_BINARY_FORMAT, fgetc(file));
+    TEST_ASSERT_EQUAL_size_t(1, fread(&id, sizeof(id), 1, file));
+    TEST_ASSERT_EQUAL_size_t(1, fread(&length, sizeof(length), 1, file));
+    TEST_ASSERT_EQUAL_size_t(length, fread(format, 1, length, file));
+    TEST_ASSERT_EQUAL_STRING("request %d failed: %s", format);
+
+    for (int i = 0; i < 3; i++)
+    {
+        uint8_t level;
+        uint64_t timestamp_ns;
+        uint8_t args[64];
+        TEST_ASSERT_EQUAL_INT(CTSL_BINARY_RECORD, fgetc(file));
+        TEST_ASSERT_EQUAL_size_t(1, fread(&id, sizeof(id), 1, file));
+        TEST_ASSERT_EQUAL_size_t(1, fread(&level, sizeof(level), 1, file));
+        TEST_ASSERT_EQUAL_size_t(1, fread(&timestamp_ns, sizeof(timestamp_ns), 1, file));
+        TEST_ASSERT_EQUAL_size_t(1, fread(&length, sizeof(length), 1, file));
+        TEST_ASSERT_EQUAL_size_t(length, fread(args, 1, length, file));
+        TEST_ASSERT_EQUAL_STRING(CTSL_ERROR, ctsl_level_name(level));
+
+        char message[64], expected[64];
+        ctsl_format_record(message, sizeof(message), format, args, length);
+        snprintf(expected, sizeof(expected), "request %d failed: timeout", i);
+        TEST_ASSERT_EQUAL_STRING(expected, message);
+    }
+    TEST_ASSERT_EQUAL_INT(EOF, fgetc(file));
+    fclose(file);
+}
+
 #endif // TEST
@@ -0,0 +1,95 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_arena.h"
+#include <stdint.h>
+#include <stdalign.h>
+#include <string.h>
+
+netc_arena arena;
+
+void setUp(void)
+{
+    netc_arena_init(&arena, 1024);
+}
+
+void tearDown(void)
+{
+    netc_arena_destroy(&arena);
+}
+
+void test_netc_arena_alloc_ShouldReturnAlignedDistinctMemory(void)
+{
+    char *a = netc_arena_alloc(&arena, 3);
+    char *b = netc_arena_alloc(&arena, 40);
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_size_t(0, (uintptr_t)a % alignof(max_align_t));
+    TEST_ASSERT_EQUAL_size_t(0, (uintptr_t)b % alignof(max_align_t));
+    TEST_ASSERT_TRUE(b >= a + 3);
+
+    memset(a, 'a', 3);
+    memset(b, 'b', 40);
+    TEST_ASSERT_EQUAL_INT('a', a[2]);
+    TEST_ASSERT_EQUAL_size_t(1, arena.malloc_calls);
+}
+
+void test_netc_arena_reset_ShouldReuseBlocksWithoutMalloc(void)
+{
+    /* two blocks' worth per round */
+    for (int i = 0; i < 6; i++)
+        TEST_ASSERT_NOT_NULL(netc_arena_alloc(&arena, 300));
+    TEST_ASSERT_EQUAL_size_t(2, arena.malloc_calls);
+
+    for (int round = 0; round < 100; round++)
+    {
+        netc_arena_reset(&arena);
+        for (int i = 0; i < 6; i++)
+            TEST_ASSERT_NOT_NULL(netc_arena_alloc(&arena, 300));
+    }
+    TEST_ASSERT_EQUAL_size_t(2, arena.malloc_calls);
+}
+
+void test_netc_arena_trim_ShouldKeepOnlyTheFirstBlock(void)
+{
+    /* three blocks' worth */
+    for (int i = 0; i < 9; i++)
+        TEST_ASSERT_NOT_NULL(netc_arena_alloc(&arena, 300));
+    TEST_ASSERT_EQUAL_size_t(3, arena.malloc_calls);
+
+    netc_arena_trim(&arena);
+    for (int i = 0; i < 3; i++)
+        TEST_ASSERT_NOT_NULL(netc_arena_alloc(&arena, 300));
+    TEST_ASSERT_EQUAL_size_t(3, arena.malloc_calls);
+
+    /* the blocks past the first were freed, growing again allocates */
+    TEST_ASSERT_NOT_NULL(netc_arena_alloc(&arena, 300));
+    TEST_ASSERT_EQUAL_size_t(4, arena.malloc_calls);
+}
+
+void test_netc_arena_alloc_ShouldGiveOversizedRequestsTheirOwnBlock(void)
+{
+    char *small = netc_arena_alloc(&arena, 16);
+    char *large = netc_arena_alloc(&arena, 4096);
+    char *next = netc_arena_alloc(&arena, 16);
+    TEST_ASSERT_NOT_NULL(large);
+    memset(large, 'x', 4096);
+
+    /* the regular block keeps being filled after an oversized allocation */
+    TEST_ASSERT_EQUAL_PTR(small + 16, next);
+    TEST_ASSERT_EQUAL_size_t(2, arena.malloc_calls);
+
+    netc_arena_reset(&arena);
+    TEST_ASSERT_NULL(arena.oversized);
+    TEST_ASSERT_EQUAL_PTR(small, netc_arena_alloc(&arena, 16));
+}
+
+void test_netc_arena_alloc_ShouldRejectInvalidArguments(void)
+{
+    TEST_ASSERT_NULL(netc_arena_alloc(NULL, 16));
+    TEST_ASSERT_NULL(netc_arena_alloc(&arena, SIZE_MAX));
+    TEST_ASSERT_EQUAL_size_t(0, arena.malloc_calls);
+}
+
+#endif // TEST
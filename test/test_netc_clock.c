@@ -0,0 +1,59 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_clock.h"
+#include <string.h>
+#include <unistd.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_netc_clock_now_ShouldFormatCurrentSecond(void)
+{
+    time_t before = time(NULL);
+    const netc_clock_snapshot *snapshot = netc_clock_now();
+    time_t after = time(NULL);
+
+    TEST_ASSERT_TRUE(snapshot->seconds >= before && snapshot->seconds <= after);
+
+    char expected[NETC_CLOCK_LOG_TIMESTAMP_SIZE];
+    struct tm local;
+    localtime_r(&snapshot->seconds, &local);
+    strftime(expected, sizeof(expected), "%Y-%m-%d %H:%M:%S", &local);
+    TEST_ASSERT_EQUAL_STRING(expected, snapshot->log_timestamp);
+}
+
+void test_netc_clock_now_ShouldFormatImfFixdate(void)
+{
+    const netc_clock_snapshot *snapshot = netc_clock_now();
+
+    char expected[NETC_CLOCK_HTTP_DATE_SIZE];
+    struct tm utc;
+    gmtime_r(&snapshot->seconds, &utc);
+    strftime(expected, sizeof(expected), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+
+    TEST_ASSERT_EQUAL_size_t(29, strlen(snapshot->http_date));
+    TEST_ASSERT_EQUAL_STRING(expected, snapshot->http_date);
+}
+
+void test_netc_clock_ShouldAdvanceWhileRunning(void)
+{
+    TEST_ASSERT_TRUE(netc_clock_start());
+    TEST_ASSERT_TRUE(netc_clock_start());
+
+    time_t start = netc_clock_now()->seconds;
+    usleep(1200000);
+    TEST_ASSERT_TRUE(netc_clock_now()->seconds > start);
+
+    netc_clock_stop();
+    netc_clock_stop();
+    netc_clock_stop();
+}
+
+#endif // TEST
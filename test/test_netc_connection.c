@@ -0,0 +1,557 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_connection.h"
+#include "netc_http.h"
+#include "netc_http_parser.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
+#include "netc_lru.h"
+#include "netc_arena.h"
+#include "netc_file_cache.h"
+#include "netc_response_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+int peer_fd;
+netc_connection *connection;
+
+void setUp(void)
+{
+    int fds[2];
+    TEST_ASSERT_EQUAL_INT(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds));
+    peer_fd = fds[0];
+    connection = netc_connection_create(fds[1]);
+    TEST_ASSERT_NOT_NULL(connection);
+}
+
+void tearDown(void)
+{
+    netc_connection_free(connection);
+    close(peer_fd);
+}
+
+void test_netc_connection_ReadShouldReturnAgainWhenSocketIsDrained(void)
+{
+    const char *raw = "GET / HTTP/1.1\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(raw), write(peer_fd, raw, strlen(raw)));
+
+    TEST_ASSERT_EQUAL_INT(NETC_IO_AGAIN, netc_connection_read(connection));
+    TEST_ASSERT_EQUAL_size_t(strlen(raw), connection->read_length);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_INCOMPLETE, netc_connection_frame_request(connection));
+}
+
+void test_netc_connection_ReadShouldReportClosedPeer(void)
+{
+    close(peer_fd);
+    peer_fd = -1;
+
+    TEST_ASSERT_EQUAL_INT(NETC_IO_CLOSED, netc_connection_read(connection));
+    TEST_ASSERT_TRUE(connection->peer_closed);
+}
+
+void test_netc_connection_FrameShouldWaitForWholeBody(void)
+{
+    const char *head = "POST /users HTTP/1.1\r\nHost: example.com\r\ncontent-length: 10\r\n\r\n01234";
+    TEST_ASSERT_EQUAL_INT(strlen(head), write(peer_fd, head, strlen(head)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_INCOMPLETE, netc_connection_frame_request(connection));
+
+    TEST_ASSERT_EQUAL_INT(5, write(peer_fd, "56789", 5));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_request(connection));
+    TEST_ASSERT_EQUAL_size_t(strlen(head) + 5, connection->request_length);
+    TEST_ASSERT_EQUAL_STRING("0123456789", connection->read_buffer + connection->headers_length);
+}
+
+void test_netc_connection_FrameShouldDecodeChunkedBodySplitAcrossReads(void)
+{
+    const char *first = "POST /users HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhel";
+    const char *second = "lo\r\n6;ext=1\r\n world\r\n0\r\nX-Trailer: 1\r\n\r\nGET / HTTP/1.1\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(first), write(peer_fd, first, strlen(first)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_INCOMPLETE, netc_connection_frame_request(connection));
+
+    TEST_ASSERT_EQUAL_INT(strlen(second), write(peer_fd, second, strlen(second)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_request(connection));
+    TEST_ASSERT_EQUAL_size_t(11, connection->body_length);
+    TEST_ASSERT_EQUAL_STRING("hello world", connection->read_buffer + connection->headers_length);
+
+    netc_connection_reset(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_request(connection));
+    TEST_ASSERT_EQUAL_STRING("/", connection->read_buffer + connection->parser.path.offset);
+}
+
+void test_netc_connection_FrameBodyShouldStreamPiecesPastBodyLimit(void)
+{
+    connection->max_body_size = 4;
+    const char *head = "POST /upload HTTP/1.1\r\nContent-Length: 10\r\n\r\n012";
+    TEST_ASSERT_EQUAL_INT(strlen(head), write(peer_fd, head, strlen(head)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_headers(connection));
+
+    connection->streaming = true;
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_INCOMPLETE, netc_connection_frame_body(connection));
+    TEST_ASSERT_EQUAL_size_t(3, connection->stream_length);
+    TEST_ASSERT_EQUAL_MEMORY("012", connection->read_buffer + connection->headers_length, 3);
+    netc_connection_consume_body(connection);
+    TEST_ASSERT_EQUAL_size_t(connection->headers_length, connection->read_length);
+
+    const char *rest = "3456789GET / HTTP/1.1\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(rest), write(peer_fd, rest, strlen(rest)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_body(connection));
+    TEST_ASSERT_FALSE(connection->streaming);
+    TEST_ASSERT_EQUAL_STRING("3456789", connection->read_buffer + connection->headers_length);
+
+    /* the pipelined request is kept */
+    netc_connection_reset(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_request(connection));
+    TEST_ASSERT_EQUAL_STRING("/", connection->read_buffer + connection->parser.path.offset);
+}
+
+void test_netc_connection_FrameBodyShouldStreamDecodedChunks(void)
+{
+    const char *first = "POST /upload HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n3\r\nab";
+    TEST_ASSERT_EQUAL_INT(strlen(first), write(peer_fd, first, strlen(first)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_headers(connection));
+
+    connection->streaming = true;
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_INCOMPLETE, netc_connection_frame_body(connection));
+    TEST_ASSERT_EQUAL_size_t(7, connection->stream_length);
+    TEST_ASSERT_EQUAL_MEMORY("helloab", connection->read_buffer + connection->headers_length, 7);
+    netc_connection_consume_body(connection);
+
+    const char *second = "c\r\n0\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(second), write(peer_fd, second, strlen(second)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_body(connection));
+    TEST_ASSERT_EQUAL_STRING("c", connection->read_buffer + connection->headers_length);
+    TEST_ASSERT_EQUAL_size_t(8, connection->body_streamed + connection->stream_length);
+}
+
+void test_netc_connection_FrameShouldRejectOversizedBody(void)
+{
+    connection->max_body_size = 8;
+
+    const char *raw = "POST / HTTP/1.1\r\nContent-Length: 9\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(raw), write(peer_fd, raw, strlen(raw)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_BODY_TOO_LARGE, netc_connection_frame_request(connection));
+}
+
+void test_netc_connection_FrameShouldRejectOversizedHeaders(void)
+{
+    connection->max_header_size = 64;
+
+    char headers[128];
+    memset(headers, 'a', sizeof(headers));
+    TEST_ASSERT_EQUAL_INT(sizeof(headers), write(peer_fd, headers, sizeof(headers)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_HEADERS_TOO_LARGE, netc_connection_frame_request(connection));
+}
+
+void test_netc_connection_FrameShouldRejectAmbiguousLength(void)
+{
+    const char *raw = "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n0\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(raw), write(peer_fd, raw, strlen(raw)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_BAD_REQUEST, netc_connection_frame_request(connection));
+}
+
+void test_netc_connection_FrameShouldRejectConflictingContentLengths(void)
+{
+    const char *raw = "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 8\r\n\r\nabcGET / HTTP/1.1\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(raw), write(peer_fd, raw, strlen(raw)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_BAD_REQUEST, netc_connection_frame_request(connection));
+}
+
+void test_netc_connection_FrameShouldAcceptRepeatedEqualContentLength(void)
+{
+    const char *raw = "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3\r\n\r\nabc";
+    TEST_ASSERT_EQUAL_INT(strlen(raw), write(peer_fd, raw, strlen(raw)));
+    netc_connection_read(connection);
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_request(connection));
+    TEST_ASSERT_EQUAL_size_t(3, connection->body_length);
+}
+
+void test_netc_connection_ReadShouldGrowBufferForLargeRequests(void)
+{
+    char raw[3 * DEFAULT_SOCKET_BUFFER_SIZE];
+    memset(raw, 'a', sizeof(raw));
+    TEST_ASSERT_EQUAL_INT(sizeof(raw), write(peer_fd, raw, sizeof(raw)));
+
+    TEST_ASSERT_EQUAL_INT(NETC_IO_AGAIN, netc_connection_read(connection));
+    TEST_ASSERT_EQUAL_size_t(sizeof(raw), connection->read_length);
+    TEST_ASSERT_GREATER_OR_EQUAL(sizeof(raw), connection->read_capacity);
+}
+
+void test_netc_connection_FlushShouldSendWholeResponse(void)
+{
+    http_response response = { 0 };
+    http_response_default(&response);
+    http_response_add_body(&response, "hello");
+    char expected[128];
+    snprintf(expected, sizeof(expected), "HTTP/1.1 200 OK\r\nServer: NetC\r\nDate: %s\r\nContent-Length: 5\r\n\r\nhello",
+             http_response_get_header(&response, "Date"));
+    TEST_ASSERT_TRUE(netc_connection_set_response(connection, &response));
+    TEST_ASSERT_NULL(response.body);
+    http_response_free(&response);
+
+    TEST_ASSERT_EQUAL_INT(NETC_IO_DONE, netc_connection_flush(connection));
+
+    char buffer[128] = { 0 };
+    TEST_ASSERT_EQUAL_INT(strlen(expected), read(peer_fd, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_STRING(expected, buffer);
+}
+
+void test_netc_connection_ResetShouldReuseArenaAcrossRequests(void)
+{
+    for (int i = 0; i < 50; i++)
+    {
+        http_response response = { 0 };
+        TEST_ASSERT_TRUE(http_response_default_with_arena(&response, &connection->arena));
+        TEST_ASSERT_TRUE(http_response_add_header(&response, "Connection", "keep-alive"));
+        TEST_ASSERT_TRUE(http_response_add_body(&response, "hello"));
+        TEST_ASSERT_TRUE(netc_connection_set_response(connection, &response));
+        http_response_free(&response);
+
+        TEST_ASSERT_EQUAL_INT(NETC_IO_DONE, netc_connection_flush(connection));
+        char buffer[256];
+        TEST_ASSERT_TRUE(read(peer_fd, buffer, sizeof(buffer)) > 0);
+        netc_connection_reset(connection);
+    }
+
+    /* the first request sized the arena, the others only reused it */
+    TEST_ASSERT_EQUAL_size_t(1, connection->arena.malloc_calls);
+}
+
+void test_netc_connection_FlushShouldResumeInsideBody(void)
+{
+    size_t length = 1024 * 1024;
+    char *body = malloc(length);
+    TEST_ASSERT_NOT_NULL(body);
+    for (size_t i = 0; i < length; i++)
+        body[i] = 'a' + i % 26;
+
+    http_response response = { 0 };
+    http_response_default(&response);
+    http_response_set_body(&response, body, length);
+    TEST_ASSERT_TRUE(netc_connection_set_response(connection, &response));
+    http_response_free(&response);
+
+    size_t head_length = connection->head_length;
+    size_t received = 0;
+    char *buffer = malloc(head_length + length);
+    TEST_ASSERT_NOT_NULL(buffer);
+
+    /* the socket pair buffer is far smaller than the body, so the response
+     * goes out over several partial sendmsg calls */
+    while (netc_connection_flush(connection) == NETC_IO_AGAIN)
+    {
+        ssize_t bytes = read(peer_fd, buffer + received, head_length + length - received);
+        TEST_ASSERT_TRUE(bytes > 0);
+        received += bytes;
+    }
+    while (received < head_length + length)
+    {
+        ssize_t bytes = read(peer_fd, buffer + received, head_length + length - received);
+        TEST_ASSERT_TRUE(bytes > 0);
+        received += bytes;
+    }
+
+    TEST_ASSERT_EQUAL_MEMORY(connection->response_body, buffer + head_length, length);
+    free(buffer);
+}
+
+void test_netc_connection_FlushShouldSendFileAfterHead(void)
+{
+    char directory[] = "/tmp/netc_connection_XXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    char path[64];
+    snprintf(path, sizeof(path), "%s/data.bin", directory);
+
+    size_t length = 256 * 1024;
+    char *content = malloc(length);
+    TEST_ASSERT_NOT_NULL(content);
+    for (size_t i = 0; i < length; i++)
+        content[i] = 'a' + i % 26;
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_ASSERT_EQUAL_INT(length, write(fd, content, length));
+    close(fd);
+
+    netc_file_cache files;
+    TEST_ASSERT_TRUE(netc_file_cache_init(&files, directory, 4));
+    netc_file_entry *entry = netc_file_cache_acquire(&files, "data.bin", 8);
+    TEST_ASSERT_NOT_NULL(entry);
+
+    http_response response = { 0 };
+    http_response_default(&response);
+    TEST_ASSERT_TRUE(netc_connection_set_response(connection, &response));
+    http_response_free(&response);
+
+    /* the first bytes of the file are skipped, like a range would */
+    size_t offset = 100;
+    netc_connection_set_file(connection, entry, offset, length - offset);
+    size_t head_length = connection->head_length;
+    size_t total = head_length + length - offset;
+    char *buffer = malloc(total);
+    TEST_ASSERT_NOT_NULL(buffer);
+
+    size_t received = 0;
+    while (netc_connection_flush(connection) == NETC_IO_AGAIN)
+    {
+        ssize_t bytes = read(peer_fd, buffer + received, total - received);
+        TEST_ASSERT_TRUE(bytes > 0);
+        received += bytes;
+    }
+    while (received < total)
+    {
+        ssize_t bytes = read(peer_fd, buffer + received, total - received);
+        TEST_ASSERT_TRUE(bytes > 0);
+        received += bytes;
+    }
+
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.1 200 OK\r\n", buffer, 17);
+    TEST_ASSERT_EQUAL_MEMORY(content + offset, buffer + head_length, length - offset);
+
+    /* the response holds the file until it is reset */
+    TEST_ASSERT_EQUAL_size_t(1, entry->references);
+    netc_connection_reset(connection);
+    TEST_ASSERT_NULL(connection->response_file);
+
+    netc_file_cache_destroy(&files);
+    unlink(path);
+    rmdir(directory);
+    free(buffer);
+    free(content);
+}
+
+void test_netc_connection_FlushShouldInterleaveMemoryAndFileParts(void)
+{
+    char directory[] = "/tmp/netc_connection_XXXXXX";
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    char path[64];
+    snprintf(path, sizeof(path), "%s/data.txt", directory);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_ASSERT_EQUAL_INT(26, write(fd, "abcdefghijklmnopqrstuvwxyz", 26));
+    close(fd);
+
+    netc_file_cache files;
+    TEST_ASSERT_TRUE(netc_file_cache_init(&files, directory, 4));
+    netc_file_entry *entry = netc_file_cache_acquire(&files, "data.txt", 8);
+    TEST_ASSERT_NOT_NULL(entry);
+
+    http_response response = { 0 };
+    http_response_default(&response);
+    TEST_ASSERT_TRUE(netc_connection_set_response(connection, &response));
+    http_response_free(&response);
+
+    /* more memory parts in a row than one sendmsg takes, then file slices */
+    netc_write_part parts[NETC_WRITE_IOV_MAX + 4];
+    size_t count = 0;
+    for (size_t i = 0; i < NETC_WRITE_IOV_MAX; i++)
+        parts[count++] = (netc_write_part){ .data = "-", .length = 1 };
+    parts[count++] = (netc_write_part){ .data = NULL, .length = 3, .offset = 0 };
+    parts[count++] = (netc_write_part){ .data = "|", .length = 1 };
+    parts[count++] = (netc_write_part){ .data = NULL, .length = 2, .offset = 24 };
+    parts[count++] = (netc_write_part){ .data = "!", .length = 1 };
+    netc_connection_set_parts(connection, entry, parts, count);
+    size_t head_length = connection->head_length;
+    TEST_ASSERT_EQUAL_size_t(head_length + NETC_WRITE_IOV_MAX + 7, connection->write_length);
+    TEST_ASSERT_EQUAL_INT(NETC_IO_DONE, netc_connection_flush(connection));
+
+    char buffer[512] = { 0 };
+    ssize_t received = read(peer_fd, buffer, sizeof(buffer) - 1);
+    TEST_ASSERT_EQUAL_INT(connection->write_length, received);
+    TEST_ASSERT_EQUAL_STRING("--------abc|yz!", buffer + head_length);
+
+    netc_connection_reset(connection);
+    TEST_ASSERT_NULL(connection->response_file);
+    TEST_ASSERT_EQUAL_size_t(0, connection->write_part_count);
+
+    netc_file_cache_destroy(&files);
+    unlink(path);
+    rmdir(directory);
+}
+
+void test_netc_connection_SetCachedPartsShouldReplaceRepresentationHeaders(void)
+{
+    netc_response_cache cache;
+    TEST_ASSERT_TRUE(netc_response_cache_init(&cache, 1024 * 1024, 60000));
+    http_request *request = http_request_parse("GET /cached HTTP/1.1\r\n\r\n");
+    http_response response = { 0 };
+    http_response_default(&response);
+    http_response_add_header(&response, "Content-Type", "text/plain");
+    http_response_add_header(&response, "ETag", "\"v1\"");
+    http_response_add_body(&response, "0123456789");
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, &response));
+    http_response_free(&response);
+
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_NOT_NULL(entry);
+    netc_write_part part = { .data = entry->body + 2, .length = 3 };
+    TEST_ASSERT_TRUE(netc_connection_set_cached_parts(connection, entry, "HTTP/1.1 206 Partial content\r\n",
+                                                      "Content-Range: bytes 2-4/10\r\nContent-Length: 3\r\n\r\n",
+                                                      &part, 1));
+    TEST_ASSERT_EQUAL_INT(NETC_IO_DONE, netc_connection_flush(connection));
+
+    char buffer[256] = { 0 };
+    ssize_t received = read(peer_fd, buffer, sizeof(buffer) - 1);
+    TEST_ASSERT_TRUE(received > 0);
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.1 206 Partial content\r\nServer: NetC\r\n", buffer, 44);
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "ETag: \"v1\"\r\n"));
+    TEST_ASSERT_NULL(strstr(buffer, "Content-Type"));
+    TEST_ASSERT_NULL(strstr(buffer, "Content-Length: 10"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "Content-Range: bytes 2-4/10\r\nContent-Length: 3\r\n\r\n234"));
+    TEST_ASSERT_EQUAL_size_t(strlen(buffer), received);
+
+    /* the entry the slices point into is held until the response is released */
+    TEST_ASSERT_EQUAL_size_t(1, entry->references);
+    netc_connection_reset(connection);
+    TEST_ASSERT_EQUAL_size_t(0, entry->references);
+
+    http_request_free(request);
+    netc_response_cache_destroy(&cache);
+}
+
+void test_netc_connection_SetCachedResponseShouldBorrowStoredBody(void)
+{
+    netc_response_cache cache;
+    TEST_ASSERT_TRUE(netc_response_cache_init(&cache, 1024 * 1024, 60000));
+    http_request *request = http_request_parse("GET /cached HTTP/1.1\r\n\r\n");
+    http_response response = { 0 };
+    http_response_default(&response);
+    http_response_add_body(&response, "stored");
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, &response));
+    http_response_free(&response);
+
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_TRUE(netc_connection_set_cached_response(connection, entry, NULL, "Connection: close\r\n\r\n", true));
+    TEST_ASSERT_EQUAL_PTR(entry->body, connection->response_body);
+    TEST_ASSERT_EQUAL_INT(NETC_IO_DONE, netc_connection_flush(connection));
+
+    char buffer[256] = { 0 };
+    ssize_t received = read(peer_fd, buffer, sizeof(buffer) - 1);
+    TEST_ASSERT_TRUE(received > 0);
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "Content-Length: 6\r\nConnection: close\r\n\r\nstored"));
+
+    /* the entry is held until the response is released */
+    TEST_ASSERT_EQUAL_size_t(1, entry->references);
+    netc_connection_reset(connection);
+    TEST_ASSERT_EQUAL_size_t(0, entry->references);
+
+    /* a revalidation gets the stored headers under another status line */
+    entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_TRUE(netc_connection_set_cached_response(connection, entry, "HTTP/1.1 304 Not modified\r\n",
+                                                         "Connection: close\r\n\r\n", false));
+    TEST_ASSERT_EQUAL_INT(NETC_IO_DONE, netc_connection_flush(connection));
+    memset(buffer, 0, sizeof(buffer));
+    received = read(peer_fd, buffer, sizeof(buffer) - 1);
+    TEST_ASSERT_TRUE(received > 0);
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.1 304 Not modified\r\nServer: NetC\r\n", buffer, 41);
+    TEST_ASSERT_NULL(strstr(buffer, "200 OK"));
+    TEST_ASSERT_NOT_NULL(strstr(buffer, "Connection: close\r\n\r\n"));
+    TEST_ASSERT_NULL(strstr(buffer, "stored"));
+    netc_connection_reset(connection);
+
+    http_request_free(request);
+    netc_response_cache_destroy(&cache);
+}
+
+void test_netc_connection_ResetShouldKeepPipelinedRequest(void)
+{
+    const char *raw = "GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(raw), write(peer_fd, raw, strlen(raw)));
+    netc_connection_read(connection);
+
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_request(connection));
+    TEST_ASSERT_EQUAL_STRING("/a", connection->read_buffer + connection->parser.path.offset);
+
+    netc_connection_reset(connection);
+    TEST_ASSERT_EQUAL_size_t(1, connection->requests_served);
+    TEST_ASSERT_EQUAL_INT(NETC_CONNECTION_READING, connection->state);
+    TEST_ASSERT_NULL(connection->response_body);
+    TEST_ASSERT_EQUAL_size_t(0, connection->write_length);
+
+    TEST_ASSERT_EQUAL_INT(NETC_FRAME_COMPLETE, netc_connection_frame_request(connection));
+    TEST_ASSERT_EQUAL_STRING("/b", connection->read_buffer + connection->parser.path.offset);
+}
+
+void test_netc_connection_PoolShouldRecycleReleasedConnections(void)
+{
+    netc_connection_pool pool;
+    netc_connection_pool_init(&pool, 0);
+
+    netc_connection *first = netc_connection_pool_get(&pool, dup(peer_fd));
+    TEST_ASSERT_NOT_NULL(first);
+    first->requests_served = 7;
+    first->keep_alive = true;
+    TEST_ASSERT_NOT_NULL(netc_arena_alloc(&first->arena, 64));
+    char *read_buffer = first->read_buffer;
+    netc_connection_pool_put(&pool, first);
+    TEST_ASSERT_EQUAL_size_t(0, pool.live_count);
+    TEST_ASSERT_EQUAL_size_t(1, pool.free_count);
+
+    netc_connection *second = netc_connection_pool_get(&pool, dup(peer_fd));
+    TEST_ASSERT_EQUAL_PTR(first, second);
+    TEST_ASSERT_EQUAL_PTR(read_buffer, second->read_buffer);
+    TEST_ASSERT_EQUAL_size_t(0, second->requests_served);
+    TEST_ASSERT_FALSE(second->keep_alive);
+    TEST_ASSERT_EQUAL_INT(NETC_CONNECTION_READING, second->state);
+    TEST_ASSERT_EQUAL_size_t(1, pool.allocations);
+    TEST_ASSERT_EQUAL_size_t(1, second->arena.malloc_calls);
+
+    netc_connection_pool_put(&pool, second);
+    netc_connection_pool_destroy(&pool);
+}
+
+void test_netc_connection_PoolShouldRefuseConnectionsOverCapacity(void)
+{
+    netc_connection_pool pool;
+    netc_connection_pool_init(&pool, 2);
+
+    netc_connection *a = netc_connection_pool_get(&pool, dup(peer_fd));
+    netc_connection *b = netc_connection_pool_get(&pool, dup(peer_fd));
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_NULL(netc_connection_pool_get(&pool, -1));
+
+    netc_connection_pool_put(&pool, a);
+    netc_connection *c = netc_connection_pool_get(&pool, dup(peer_fd));
+    TEST_ASSERT_EQUAL_PTR(a, c);
+    TEST_ASSERT_EQUAL_size_t(2, pool.allocations);
+
+    netc_connection_pool_put(&pool, b);
+    netc_connection_pool_put(&pool, c);
+    netc_connection_pool_destroy(&pool);
+}
+
+void test_netc_connection_PoolShouldShrinkGrownReadBuffers(void)
+{
+    netc_connection_pool pool;
+    netc_connection_pool_init(&pool, 0);
+
+    netc_connection *pooled = netc_connection_pool_get(&pool, dup(peer_fd));
+    TEST_ASSERT_NOT_NULL(pooled);
+    char data[3 * DEFAULT_SOCKET_BUFFER_SIZE];
+    memset(data, 'a', sizeof(data));
+    TEST_ASSERT_TRUE(netc_connection_append(pooled, data, sizeof(data)));
+    TEST_ASSERT_TRUE(pooled->read_capacity > DEFAULT_SOCKET_BUFFER_SIZE);
+
+    netc_connection_pool_put(&pool, pooled);
+    TEST_ASSERT_EQUAL_size_t(DEFAULT_SOCKET_BUFFER_SIZE, pooled->read_capacity);
+
+    netc_connection_pool_destroy(&pool);
+}
+
+#endif // TEST
@@ -0,0 +1,168 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_file_cache.h"
+#include "netc_http.h"
+#include "netc_http_parser.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
+#include "netc_lru.h"
+#include "netc_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+char directory[] = "/tmp/netc_files_XXXXXX";
+netc_file_cache files;
+
+void write_file(const char *name, const char *content)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", directory, name);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT(strlen(content), write(fd, content, strlen(content)));
+    close(fd);
+}
+
+void setUp(void)
+{
+    strcpy(directory, "/tmp/netc_files_XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+
+    char path[128];
+    snprintf(path, sizeof(path), "%s/docs", directory);
+    TEST_ASSERT_EQUAL_INT(0, mkdir(path, 0755));
+    write_file("index.html", "<h1>home</h1>");
+    write_file("app.js", "run()");
+    write_file("docs/index.html", "<h1>docs</h1>");
+    write_file("docs/a b.txt", "spaced");
+
+    TEST_ASSERT_TRUE(netc_file_cache_init(&files, directory, 2));
+}
+
+void tearDown(void)
+{
+    netc_file_cache_destroy(&files);
+
+    const char *names[] = { "docs/a b.txt", "docs/index.html", "docs", "app.js", "index.html", "passwd" };
+    char path[128];
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s", directory, names[i]);
+        remove(path);
+    }
+    TEST_ASSERT_EQUAL_INT(0, rmdir(directory));
+}
+
+void test_netc_file_cache_acquire_ShouldCacheOpenFiles(void)
+{
+    netc_file_entry *entry = netc_file_cache_acquire(&files, "app.js", 6);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_size_t(5, entry->size);
+    TEST_ASSERT_EQUAL_STRING("text/javascript; charset=utf-8", entry->content_type);
+    TEST_ASSERT_EQUAL_STRING_LEN("GMT", entry->last_modified + strlen(entry->last_modified) - 3, 3);
+
+    /* the second lookup shares the open descriptor */
+    netc_file_entry *again = netc_file_cache_acquire(&files, "/app.js", 7);
+    TEST_ASSERT_EQUAL_PTR(entry, again);
+    TEST_ASSERT_EQUAL_size_t(2, entry->references);
+    TEST_ASSERT_EQUAL_UINT64(1, files.hits);
+    TEST_ASSERT_EQUAL_UINT64(1, files.misses);
+
+    netc_file_cache_release(entry);
+    netc_file_cache_release(again);
+}
+
+void test_netc_file_cache_acquire_ShouldChangeETagWhenFileIsRewritten(void)
+{
+    netc_file_entry *entry = netc_file_cache_acquire(&files, "app.js", 6);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_size_t(HTTP_ETAG_SIZE - 1, strlen(entry->etag));
+    TEST_ASSERT_EQUAL_INT('"', entry->etag[0]);
+    char etag[HTTP_ETAG_SIZE];
+    strcpy(etag, entry->etag);
+    netc_file_cache_release(entry);
+
+    /* same size, same second: only the nanoseconds of the mtime differ */
+    write_file("app.js", "jog()");
+    entry->validated = 0;
+    netc_file_entry *rewritten = netc_file_cache_acquire(&files, "app.js", 6);
+    TEST_ASSERT_NOT_NULL(rewritten);
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(etag, rewritten->etag));
+    netc_file_cache_release(rewritten);
+}
+
+void test_netc_file_cache_acquire_ShouldServeDirectoryIndex(void)
+{
+    netc_file_entry *entry = netc_file_cache_acquire(&files, "", 0);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_STRING("index.html", entry->path);
+    netc_file_cache_release(entry);
+
+    entry = netc_file_cache_acquire(&files, "docs//", 6);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_STRING("docs/index.html", entry->path);
+    netc_file_cache_release(entry);
+
+    entry = netc_file_cache_acquire(&files, "docs/a%20b.txt", 14);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_size_t(6, entry->size);
+    netc_file_cache_release(entry);
+
+    /* a directory without its trailing slash is not a file */
+    TEST_ASSERT_NULL(netc_file_cache_acquire(&files, "docs", 4));
+    TEST_ASSERT_NULL(netc_file_cache_acquire(&files, "missing.css", 11));
+}
+
+void test_netc_file_cache_acquire_ShouldRefuseTraversal(void)
+{
+    const char *paths[] = {
+        "../etc/passwd", "docs/../../etc/passwd", "%2e%2e/etc/passwd", "docs/%2E%2E/index.html",
+        "./index.html", "index.html%00.js", "%zz", "%2"
+    };
+
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+        TEST_ASSERT_NULL(netc_file_cache_acquire(&files, paths[i], strlen(paths[i])));
+}
+
+void test_netc_file_cache_acquire_ShouldRefuseLinksOutOfDirectory(void)
+{
+    char link_path[128];
+    snprintf(link_path, sizeof(link_path), "%s/passwd", directory);
+    TEST_ASSERT_EQUAL_INT(0, symlink("/etc/passwd", link_path));
+
+    TEST_ASSERT_NULL(netc_file_cache_acquire(&files, "passwd", 6));
+}
+
+void test_netc_file_cache_acquire_ShouldEvictLeastRecentlyUsed(void)
+{
+    netc_file_entry *index = netc_file_cache_acquire(&files, "index.html", 10);
+    netc_file_entry *app = netc_file_cache_acquire(&files, "app.js", 6);
+    TEST_ASSERT_NOT_NULL(index);
+    TEST_ASSERT_NOT_NULL(app);
+    netc_file_cache_release(app);
+
+    /* index.html is still being sent, it stays open until released */
+    netc_file_entry *docs = netc_file_cache_acquire(&files, "docs/index.html", 15);
+    TEST_ASSERT_NOT_NULL(docs);
+    TEST_ASSERT_EQUAL_size_t(2, files.count);
+    TEST_ASSERT_TRUE(index->evicted);
+
+    char byte;
+    TEST_ASSERT_EQUAL_INT(1, pread(index->fd, &byte, 1, 0));
+    TEST_ASSERT_EQUAL_INT('<', byte);
+    netc_file_cache_release(index);
+
+    /* app.js is still cached */
+    netc_file_entry *again = netc_file_cache_acquire(&files, "app.js", 6);
+    TEST_ASSERT_EQUAL_PTR(app, again);
+    netc_file_cache_release(again);
+    netc_file_cache_release(docs);
+}
+
+#endif // TEST
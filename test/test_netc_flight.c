@@ -0,0 +1,107 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_flight.h"
+#include "netc_hash.h"
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+netc_flight_table table;
+
+void setUp(void)
+{
+    netc_flight_table_init(&table);
+}
+
+void tearDown(void)
+{
+    netc_flight_table_destroy(&table);
+}
+
+void test_netc_flight_join_ShouldQueueIdenticalRequestsBehindTheLeader(void)
+{
+    netc_flight_waiter first = { .data = "first" };
+    netc_flight_waiter second = { .data = "second" };
+    netc_flight_waiter third = { .data = "third" };
+    netc_flight *leading = NULL;
+
+    TEST_ASSERT_FALSE(netc_flight_join(&table, "GET /catalog", 12, &first, &leading));
+    TEST_ASSERT_NOT_NULL(leading);
+    netc_flight *flight = leading;
+
+    TEST_ASSERT_TRUE(netc_flight_join(&table, "GET /catalog", 12, &second, &leading));
+    TEST_ASSERT_NULL(leading);
+    TEST_ASSERT_TRUE(netc_flight_join(&table, "GET /catalog", 12, &third, &leading));
+    TEST_ASSERT_EQUAL_size_t(2, flight->waiter_count);
+
+    /* waiters are handed back in arrival order */
+    netc_flight_waiter *waiters = netc_flight_land(flight);
+    TEST_ASSERT_EQUAL_PTR(&second, waiters);
+    TEST_ASSERT_EQUAL_PTR(&third, waiters->next);
+    TEST_ASSERT_NULL(waiters->next->next);
+}
+
+void test_netc_flight_join_ShouldKeepDifferentKeysApart(void)
+{
+    netc_flight_waiter first = { 0 }, second = { 0 }, third = { 0 };
+    netc_flight *catalog = NULL, *page = NULL, *head = NULL;
+
+    TEST_ASSERT_FALSE(netc_flight_join(&table, "GET /catalog", 12, &first, &catalog));
+    TEST_ASSERT_FALSE(netc_flight_join(&table, "GET /catalog?page=2", 19, &second, &page));
+    TEST_ASSERT_FALSE(netc_flight_join(&table, "HEAD /catalog", 13, &third, &head));
+    TEST_ASSERT_NOT_NULL(catalog);
+    TEST_ASSERT_NOT_NULL(page);
+    TEST_ASSERT_NOT_NULL(head);
+
+    TEST_ASSERT_NULL(netc_flight_land(catalog));
+    TEST_ASSERT_NULL(netc_flight_land(page));
+    TEST_ASSERT_NULL(netc_flight_land(head));
+}
+
+void test_netc_flight_land_ShouldLetTheNextRequestLead(void)
+{
+    netc_flight_waiter first = { 0 }, second = { 0 };
+    netc_flight *leading = NULL;
+
+    TEST_ASSERT_FALSE(netc_flight_join(&table, "GET /time", 9, &first, &leading));
+    TEST_ASSERT_NULL(netc_flight_land(leading));
+
+    TEST_ASSERT_FALSE(netc_flight_join(&table, "GET /time", 9, &second, &leading));
+    TEST_ASSERT_NOT_NULL(leading);
+    netc_flight_land(leading);
+}
+
+atomic_int leaders = 0;
+atomic_int waiting = 0;
+
+void *join_concurrently(void *arg)
+{
+    netc_flight_waiter *waiter = arg;
+    netc_flight *leading = NULL;
+    if (netc_flight_join(&table, "GET /hot", 8, waiter, &leading))
+        atomic_fetch_add(&waiting, 1);
+    else if (leading != NULL)
+        atomic_fetch_add(&leaders, 1);
+    return NULL;
+}
+
+void test_netc_flight_join_ShouldElectOneLeaderAcrossThreads(void)
+{
+    atomic_store(&leaders, 0);
+    atomic_store(&waiting, 0);
+
+    pthread_t threads[16];
+    netc_flight_waiter waiters[16];
+    for (size_t i = 0; i < 16; i++)
+        pthread_create(&threads[i], NULL, join_concurrently, &waiters[i]);
+    for (size_t i = 0; i < 16; i++)
+        pthread_join(threads[i], NULL);
+
+    TEST_ASSERT_EQUAL_INT(1, atomic_load(&leaders));
+    TEST_ASSERT_EQUAL_INT(15, atomic_load(&waiting));
+    /* the flight left in the table is freed by tearDown */
+}
+
+#endif // TEST
@@ -0,0 +1,49 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_hash.h"
+#include <string.h>
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+void test_netc_hash64_ShouldMatchReferenceValues(void)
+{
+    TEST_ASSERT_EQUAL_HEX64(0xEF46DB3751D8E999ULL, netc_hash64(NULL, 0, 0));
+    TEST_ASSERT_EQUAL_HEX64(0xD24EC4F1A98C6E5BULL, netc_hash64("a", 1, 0));
+    TEST_ASSERT_EQUAL_HEX64(0x44BC2CF5AD770999ULL, netc_hash64("abc", 3, 0));
+    TEST_ASSERT_EQUAL_HEX64(0x066ED728FCEEB3BEULL, netc_hash64("message digest", 14, 0));
+    /* past 32 bytes the four lanes are used */
+    const char *digits = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+    TEST_ASSERT_EQUAL_HEX64(0xE04A477F19EE145DULL, netc_hash64(digits, strlen(digits), 0));
+}
+
+void test_netc_hash64_ShouldNotDependOnAlignment(void)
+{
+    char buffer[128];
+    const char *text = "the quick brown fox jumps over the lazy dog, twice over";
+    size_t length = strlen(text);
+    uint64_t expected = netc_hash64(text, length, 7);
+
+    for (size_t offset = 1; offset < 8; offset++)
+    {
+        memcpy(buffer + offset, text, length);
+        TEST_ASSERT_EQUAL_HEX64(expected, netc_hash64(buffer + offset, length, 7));
+    }
+    TEST_ASSERT_NOT_EQUAL_UINT64(expected, netc_hash64(text, length, 0));
+}
+
+void test_netc_hash_fnv1a_ShouldMatchReferenceValues(void)
+{
+    TEST_ASSERT_EQUAL_HEX64(0xCBF29CE484222325ULL, netc_hash_fnv1a(NULL, 0));
+    TEST_ASSERT_EQUAL_HEX64(0xAF63DC4C8601EC8CULL, netc_hash_fnv1a("a", 1));
+    TEST_ASSERT_EQUAL_HEX64(0x85944171F73967E8ULL, netc_hash_fnv1a("foobar", 6));
+}
+
+#endif // TEST
@@ -3,6 +3,10 @@
 #include "unity.h"
 
 #include "netc_http.h"
+#include "netc_http_parser.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
+#include "netc_arena.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -51,16 +55,11 @@ void test_netc_http_ValidRequestStringShouldParseCorrectly(void)
     TEST_ASSERT_EQUAL_STRING("HTTP/1.1", request->version);
 
     /* check headers */
-    TEST_ASSERT_NOT_NULL(request->headers);
-
-    char *header_value = hashtable_get(request->headers, "Host");
-    TEST_ASSERT_NOT_NULL(header_value);
-    TEST_ASSERT_EQUAL_STRING("example.com", header_value);
-    free(header_value);
-    header_value = hashtable_get(request->headers, "User-Agent");
-    TEST_ASSERT_NOT_NULL(header_value);
-    TEST_ASSERT_EQUAL_STRING("TestAgent", header_value);
-    free(header_value);
+    TEST_ASSERT_EQUAL_size_t(2, request->header_count);
+    TEST_ASSERT_EQUAL_STRING("Host", request->headers[0].name);
+    TEST_ASSERT_EQUAL_STRING("example.com", request->headers[0].value);
+    TEST_ASSERT_EQUAL_STRING("User-Agent", request->headers[1].name);
+    TEST_ASSERT_EQUAL_STRING("TestAgent", request->headers[1].value);
 
     /* check body */
     TEST_ASSERT_NOT_NULL(request->body);
@@ -88,15 +87,52 @@ void test_netc_http_request_get_header_ShouldReturnNullWithNonExistingHeader(voi
     http_request_free(request);
 }
 
-void test_netc_http_request_get_header_ShouldReturnCorrectValueCopy(void)
+void test_netc_http_request_get_header_ShouldIgnoreNameCase(void)
 {
     const char *raw_request = "GET /index.html HTTP/1.1\r\nHost: example.com\r\nUser-Agent: TestAgent\r\n\r\nThis is body";
     http_request *request = http_request_parse(raw_request);
 
-    char *header_value = http_request_get_header(request, "Host");
-    TEST_ASSERT_NOT_NULL(header_value);
-    TEST_ASSERT_EQUAL_STRING("example.com", header_value);
-    free(header_value);
+    TEST_ASSERT_EQUAL_STRING("example.com", http_request_get_header(request, "Host"));
+    TEST_ASSERT_EQUAL_STRING("example.com", http_request_get_header(request, "HOST"));
+    TEST_ASSERT_EQUAL_STRING("TestAgent", http_request_get_header(request, "user-agent"));
+
+    http_request_free(request);
+}
+
+void test_netc_http_request_get_known_header_ShouldReturnIndexedHeaders(void)
+{
+    const char *raw_request = "POST /users HTTP/1.1\r\nhost: example.com\r\ncontent-type: application/json\r\n"
+                              "Content-Length: 2\r\nConnection: close\r\n\r\n{}";
+    http_request *request = http_request_parse(raw_request);
+    TEST_ASSERT_NOT_NULL(request);
+
+    TEST_ASSERT_EQUAL_STRING("example.com", http_request_get_known_header(request, HTTP_HEADER_HOST));
+    TEST_ASSERT_EQUAL_STRING("application/json", http_request_get_known_header(request, HTTP_HEADER_CONTENT_TYPE));
+    TEST_ASSERT_EQUAL_STRING("2", http_request_get_known_header(request, HTTP_HEADER_CONTENT_LENGTH));
+    TEST_ASSERT_EQUAL_STRING("close", http_request_get_known_header(request, HTTP_HEADER_CONNECTION));
+    TEST_ASSERT_NULL(http_request_get_known_header(request, HTTP_KNOWN_HEADER_COUNT));
+
+    TEST_ASSERT_EQUAL_size_t(2, request->body_length);
+    TEST_ASSERT_EQUAL_STRING("{}", request->body);
+
+    http_request_free(request);
+}
+
+void test_netc_http_request_get_param_ShouldReturnCapturedViews(void)
+{
+    http_request *request = http_request_parse("GET /users/42/posts HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_NOT_NULL(request);
+    TEST_ASSERT_EQUAL_size_t(0, request->param_count);
+
+    request->params[0] = (http_path_param){ .name = "id", .value = request->path + 7, .length = 2 };
+    request->param_count = 1;
+
+    size_t length = 0;
+    const char *value = http_request_get_param(request, "id", &length);
+    TEST_ASSERT_EQUAL_PTR(request->path + 7, value);
+    TEST_ASSERT_EQUAL_size_t(2, length);
+    TEST_ASSERT_NULL(http_request_get_param(request, "post", &length));
+    TEST_ASSERT_NULL(http_request_get_param(request, "id", NULL));
 
     http_request_free(request);
 }
@@ -110,16 +146,14 @@ void test_netc_http_ShouldBuildValidDefaultResponse(void)
 {
     http_response response = { 0 };
     TEST_ASSERT_TRUE(http_response_default(&response));
-    char *header_value = NULL;
 
     TEST_ASSERT_EQUAL_INT(HTTP_STATUS_OK, response.status_code);
     TEST_ASSERT_EQUAL_STRING("OK", response.status_text);
 
     TEST_ASSERT_NOT_NULL(response.headers);
-    header_value = hashtable_get(response.headers, "Server");
-    TEST_ASSERT_NOT_NULL(header_value);
-    TEST_ASSERT_EQUAL_STRING("NetC", header_value);
-    free(header_value);
+    TEST_ASSERT_EQUAL_size_t(2, response.header_count);
+    TEST_ASSERT_EQUAL_STRING("NetC", http_response_get_header(&response, "Server"));
+    TEST_ASSERT_EQUAL_STRING(netc_clock_now()->http_date, http_response_get_header(&response, "Date"));
 
     TEST_ASSERT_NULL(response.body);
 
@@ -143,11 +177,9 @@ void test_netc_http_response_set_status_ShouldOnlyChangeStatus(void)
     TEST_ASSERT_EQUAL_UINT16(HTTP_STATUS_NOT_FOUND, response.status_code);
     TEST_ASSERT_EQUAL_STRING("Not found", response.status_text);
 
-    char *expected_headers[] = { "Server" };
-    char **headers = (char**) hashtable_keyset(response.headers);
-    TEST_ASSERT_EQUAL_STRING_ARRAY(expected_headers, headers, 1);
-    TEST_ASSERT_NULL(headers[1]);
-    free(headers);
+    TEST_ASSERT_EQUAL_size_t(2, response.header_count);
+    TEST_ASSERT_EQUAL_STRING("Server", response.headers[0].name);
+    TEST_ASSERT_EQUAL_STRING("Date", response.headers[1].name);
 
     http_response_free(&response);
 }
@@ -178,11 +210,11 @@ void test_netc_http_response_add_header_ShouldOnlyAddHeader(void)
     TEST_ASSERT_EQUAL_UINT16(HTTP_STATUS_OK, response.status_code);
     TEST_ASSERT_EQUAL_STRING("OK", response.status_text);
 
-    char *expected_headers[] = { "Authorization", "Server" };
-    char **headers = (char**) hashtable_keyset(response.headers);
-    TEST_ASSERT_EQUAL_STRING_ARRAY(expected_headers, headers, 2);
-    TEST_ASSERT_NULL(headers[2]);
-    free(headers);
+    TEST_ASSERT_EQUAL_size_t(3, response.header_count);
+    TEST_ASSERT_EQUAL_STRING("Server", response.headers[0].name);
+    TEST_ASSERT_EQUAL_STRING("Date", response.headers[1].name);
+    TEST_ASSERT_EQUAL_STRING("Authorization", response.headers[2].name);
+    TEST_ASSERT_EQUAL_STRING("Bearer", response.headers[2].value);
 
     TEST_ASSERT_NULL(response.body);
 
@@ -214,11 +246,11 @@ void test_netc_http_response_add_body_ShouldAddBodyAndContentLengthHeader(void)
     TEST_ASSERT_NOT_NULL(response.body);
     TEST_ASSERT_EQUAL_STRING("This is a beautiful body!", response.body);
 
-    char *expected_headers[] = { "Server", "Content-Length" };
-    char **headers = (char**) hashtable_keyset(response.headers);
-    TEST_ASSERT_EQUAL_STRING_ARRAY(expected_headers, headers, 2);
-    TEST_ASSERT_NULL(headers[2]);
-    free(headers);
+    TEST_ASSERT_EQUAL_size_t(3, response.header_count);
+    TEST_ASSERT_EQUAL_STRING("Server", response.headers[0].name);
+    TEST_ASSERT_EQUAL_STRING("Date", response.headers[1].name);
+    TEST_ASSERT_EQUAL_STRING("Content-Length", response.headers[2].name);
+    TEST_ASSERT_EQUAL_STRING("25", response.headers[2].value);
 
     http_response_free(&response);
 }
@@ -238,13 +270,15 @@ void test_netc_http_response_to_string_ShouldReturnValidHttpResponseString(void)
     char *response_string = http_response_to_string(&response);
     TEST_ASSERT_NOT_NULL(response_string);
 
-    const char *expected_response =
-        "HTTP/1.1 200 OK\r\n"
-        "X-Custom-Header: CustomValue\r\n"
-        "Server: NetC\r\n"
-        "Content-Length: 16\r\n"
-        "\r\n"
-        "This is the body";
+    char expected_response[256];
+    snprintf(expected_response, sizeof(expected_response),
+             "HTTP/1.1 200 OK\r\n"
+             "Server: NetC\r\n"
+             "Date: %s\r\n"
+             "X-Custom-Header: CustomValue\r\n"
+             "Content-Length: 16\r\n"
+             "\r\n"
+             "This is the body", http_response_get_header(&response, "Date"));
 
     TEST_ASSERT_EQUAL_MEMORY(expected_response, response_string, strlen(expected_response));
 
@@ -252,4 +286,261 @@ void test_netc_http_response_to_string_ShouldReturnValidHttpResponseString(void)
     http_response_free(&response);
 }
 
+void test_netc_http_response_add_header_ShouldReplaceExistingHeader(void)
+{
+    http_response response = { 0 };
+    http_response_default(&response);
+
+    TEST_ASSERT_TRUE(http_response_add_header(&response, "Content-Type", "text/plain"));
+    TEST_ASSERT_TRUE(http_response_add_header(&response, "content-type", "application/json"));
+
+    TEST_ASSERT_EQUAL_size_t(3, response.header_count);
+    TEST_ASSERT_EQUAL_STRING("application/json", http_response_get_header(&response, "Content-Type"));
+
+    http_response_free(&response);
+}
+
+void test_netc_http_response_set_static_body_ShouldBorrowBody(void)
+{
+    static const char body[] = "static body";
+    http_response response = { 0 };
+    http_response_default(&response);
+
+    TEST_ASSERT_TRUE(http_response_set_static_body(&response, body, sizeof(body) - 1));
+    TEST_ASSERT_EQUAL_PTR(body, response.body);
+    TEST_ASSERT_TRUE(response.body_borrowed);
+    TEST_ASSERT_EQUAL_STRING("11", http_response_get_header(&response, "Content-Length"));
+
+    http_response_free(&response);
+    TEST_ASSERT_NULL(response.body);
+}
+
+void test_netc_http_response_write_head_ShouldReportNeededLength(void)
+{
+    http_response response = { 0 };
+    http_response_default(&response);
+    http_response_add_body(&response, "body");
+
+    char expected_head[128];
+    snprintf(expected_head, sizeof(expected_head), "HTTP/1.1 200 OK\r\nServer: NetC\r\nDate: %s\r\nContent-Length: 4\r\n\r\n",
+             http_response_get_header(&response, "Date"));
+    char small[8];
+    TEST_ASSERT_EQUAL_size_t(strlen(expected_head), http_response_write_head(&response, small, sizeof(small)));
+
+    char buffer[128];
+    TEST_ASSERT_EQUAL_size_t(strlen(expected_head), http_response_write_head(&response, buffer, sizeof(buffer)));
+    TEST_ASSERT_EQUAL_MEMORY(expected_head, buffer, strlen(expected_head));
+
+    http_response_free(&response);
+}
+
+void test_netc_http_response_to_string_ShouldNotTruncateLargeBodies(void)
+{
+    size_t length = 64 * 1024;
+    char *body = malloc(length);
+    TEST_ASSERT_NOT_NULL(body);
+    memset(body, 'x', length);
+
+    http_response response = { 0 };
+    http_response_default(&response);
+    TEST_ASSERT_TRUE(http_response_set_body(&response, body, length));
+
+    char *response_string = http_response_to_string(&response);
+    TEST_ASSERT_NOT_NULL(response_string);
+
+    char *body_start = strstr(response_string, "\r\n\r\n");
+    TEST_ASSERT_NOT_NULL(body_start);
+    TEST_ASSERT_EQUAL_size_t(length, strlen(body_start + 4));
+
+    free(response_string);
+    http_response_free(&response);
+}
+
+void test_netc_http_response_default_with_arena_ShouldAllocateFromArena(void)
+{
+    netc_arena arena;
+    netc_arena_init(&arena, 0);
+
+    http_response response = { 0 };
+    TEST_ASSERT_TRUE(http_response_default_with_arena(&response, &arena));
+    TEST_ASSERT_EQUAL_PTR(&arena, response.arena);
+
+    /* enough headers to outgrow the first header array */
+    char name[16];
+    for (int i = 0; i < 12; i++)
+    {
+        snprintf(name, sizeof(name), "X-Header-%d", i);
+        TEST_ASSERT_TRUE(http_response_add_header(&response, name, "value"));
+    }
+    TEST_ASSERT_TRUE(http_response_add_header(&response, "x-header-0", "replaced"));
+    TEST_ASSERT_TRUE(http_response_add_body(&response, "arena body"));
+
+    TEST_ASSERT_EQUAL_size_t(15, response.header_count);
+    TEST_ASSERT_EQUAL_STRING("replaced", http_response_get_header(&response, "X-Header-0"));
+    TEST_ASSERT_EQUAL_STRING("10", http_response_get_header(&response, "Content-Length"));
+    TEST_ASSERT_TRUE(response.body_borrowed);
+    TEST_ASSERT_EQUAL_STRING_LEN("arena body", response.body, response.body_length);
+    TEST_ASSERT_EQUAL_size_t(1, arena.malloc_calls);
+
+    http_response_free(&response);
+    netc_arena_destroy(&arena);
+}
+
+void test_netc_http_content_type_ShouldFollowTheExtension(void)
+{
+    TEST_ASSERT_EQUAL_STRING("text/html; charset=utf-8", http_content_type("index.html"));
+    TEST_ASSERT_EQUAL_STRING("text/css; charset=utf-8", http_content_type("assets/site.CSS"));
+    TEST_ASSERT_EQUAL_STRING("image/png", http_content_type("img/logo.png"));
+    TEST_ASSERT_EQUAL_STRING("application/octet-stream", http_content_type("archive.unknown"));
+    TEST_ASSERT_EQUAL_STRING("application/octet-stream", http_content_type("v1.2/README"));
+    TEST_ASSERT_EQUAL_STRING("application/octet-stream", http_content_type(NULL));
+}
+
+void test_netc_http_response_add_etag_ShouldHashTheBodyOnce(void)
+{
+    http_response response = { 0 };
+    http_response_default(&response);
+    http_response_add_body(&response, "abc");
+    TEST_ASSERT_TRUE(http_response_add_etag(&response));
+    TEST_ASSERT_EQUAL_STRING("\"44bc2cf5ad770999\"", http_response_get_header(&response, "ETag"));
+
+    /* a tag chosen by the handler is kept */
+    http_response_add_header(&response, "ETag", "\"v2\"");
+    http_response_add_body(&response, "changed");
+    TEST_ASSERT_TRUE(http_response_add_etag(&response));
+    TEST_ASSERT_EQUAL_STRING("\"v2\"", http_response_get_header(&response, "ETag"));
+
+    http_response_set_not_modified(&response);
+    TEST_ASSERT_EQUAL_UINT16(HTTP_STATUS_NOT_MODIFIED, response.status_code);
+    TEST_ASSERT_EQUAL_STRING("Not modified", response.status_text);
+    TEST_ASSERT_NULL(response.body);
+    TEST_ASSERT_EQUAL_size_t(0, response.body_length);
+    TEST_ASSERT_EQUAL_STRING("7", http_response_get_header(&response, "Content-Length"));
+    http_response_free(&response);
+}
+
+void test_netc_http_request_not_modified_ShouldEvaluateValidators(void)
+{
+    const char *etag = "\"44bc2cf5ad770999\"";
+    const char *last_modified = "Tue, 13 Oct 2026 10:00:00 GMT";
+    struct { const char *raw; bool not_modified; } cases[] = {
+        { "GET / HTTP/1.1\r\n\r\n", false },
+        { "GET / HTTP/1.1\r\nIf-None-Match: \"44bc2cf5ad770999\"\r\n\r\n", true },
+        { "HEAD / HTTP/1.1\r\nIf-None-Match: \"1\", W/\"44bc2cf5ad770999\"\r\n\r\n", true },
+        { "GET / HTTP/1.1\r\nIf-None-Match: *\r\n\r\n", true },
+        { "GET / HTTP/1.1\r\nIf-None-Match: \"44bc2cf5ad77099\"\r\n\r\n", false },
+        { "POST / HTTP/1.1\r\nIf-None-Match: \"44bc2cf5ad770999\"\r\n\r\n", false },
+        { "GET / HTTP/1.1\r\nIf-Modified-Since: Tue, 13 Oct 2026 10:00:00 GMT\r\n\r\n", true },
+        { "GET / HTTP/1.1\r\nIf-Modified-Since: Wed, 14 Oct 2026 08:00:00 GMT\r\n\r\n", true },
+        { "GET / HTTP/1.1\r\nIf-Modified-Since: Tue, 13 Oct 2026 09:59:59 GMT\r\n\r\n", false },
+        { "GET / HTTP/1.1\r\nIf-Modified-Since: yesterday\r\n\r\n", false },
+        /* a tag that does not match wins over a date that would */
+        { "GET / HTTP/1.1\r\nIf-None-Match: \"old\"\r\nIf-Modified-Since: Wed, 14 Oct 2026 08:00:00 GMT\r\n\r\n", false }
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        http_request *request = http_request_parse(cases[i].raw);
+        TEST_ASSERT_NOT_NULL(request);
+        TEST_ASSERT_EQUAL_INT(cases[i].not_modified, http_request_not_modified(request, etag, last_modified));
+        http_request_free(request);
+    }
+
+    http_request *request = http_request_parse("GET / HTTP/1.1\r\nIf-None-Match: *\r\n\r\n");
+    TEST_ASSERT_FALSE(http_request_not_modified(request, NULL, NULL));
+    http_request_free(request);
+}
+
+void test_netc_http_request_ranges_ShouldClampRangesToTheRepresentation(void)
+{
+    struct { const char *range; http_range_result result; size_t count; size_t offset; size_t length; } cases[] = {
+        { "bytes=0-99", HTTP_RANGE_SATISFIABLE, 1, 0, 100 },
+        { "bytes=900-", HTTP_RANGE_SATISFIABLE, 1, 900, 100 },
+        { "bytes=950-2000", HTTP_RANGE_SATISFIABLE, 1, 950, 50 },
+        { "bytes=-10", HTTP_RANGE_SATISFIABLE, 1, 990, 10 },
+        { "bytes=-5000", HTTP_RANGE_SATISFIABLE, 1, 0, 1000 },
+        { "BYTES=10-10", HTTP_RANGE_SATISFIABLE, 1, 10, 1 },
+        /* ranges past the end are dropped, the others still answered */
+        { "bytes=2000-, 5-9", HTTP_RANGE_SATISFIABLE, 1, 5, 5 },
+        { "bytes=1000-", HTTP_RANGE_NOT_SATISFIABLE, 0, 0, 0 },
+        { "bytes=-0", HTTP_RANGE_NOT_SATISFIABLE, 0, 0, 0 },
+        /* anything malformed and the whole representation is sent */
+        { "bytes=9-5", HTTP_RANGE_NONE, 0, 0, 0 },
+        { "bytes=-", HTTP_RANGE_NONE, 0, 0, 0 },
+        { "bytes=1-2;", HTTP_RANGE_NONE, 0, 0, 0 },
+        { "bytes=0-1, x", HTTP_RANGE_NONE, 0, 0, 0 },
+        { "bytes=", HTTP_RANGE_NONE, 0, 0, 0 },
+        { "items=0-1", HTTP_RANGE_NONE, 0, 0, 0 },
+        { "bytes=0-99999999999999999999999", HTTP_RANGE_NONE, 0, 0, 0 },
+        /* overlapping ranges adding up to more than the whole */
+        { "bytes=0-, 0-", HTTP_RANGE_NONE, 0, 0, 0 }
+    };
+
+    http_range ranges[HTTP_MAX_RANGES];
+    size_t count;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        char raw[128];
+        snprintf(raw, sizeof(raw), "GET /file HTTP/1.1\r\nRange: %s\r\n\r\n", cases[i].range);
+        http_request *request = http_request_parse(raw);
+        TEST_ASSERT_NOT_NULL(request);
+        TEST_ASSERT_EQUAL_INT(cases[i].result, http_request_ranges(request, 1000, NULL, NULL, ranges, &count));
+        TEST_ASSERT_EQUAL_size_t(cases[i].count, count);
+        if (count > 0)
+        {
+            TEST_ASSERT_EQUAL_size_t(cases[i].offset, ranges[0].offset);
+            TEST_ASSERT_EQUAL_size_t(cases[i].length, ranges[0].length);
+        }
+        http_request_free(request);
+    }
+
+    /* several ranges are kept in the order asked */
+    http_request *request = http_request_parse("GET /file HTTP/1.1\r\nRange: bytes=500-599,0-9 ,-1\r\n\r\n");
+    TEST_ASSERT_EQUAL_INT(HTTP_RANGE_SATISFIABLE, http_request_ranges(request, 1000, NULL, NULL, ranges, &count));
+    TEST_ASSERT_EQUAL_size_t(3, count);
+    TEST_ASSERT_EQUAL_size_t(500, ranges[0].offset);
+    TEST_ASSERT_EQUAL_size_t(0, ranges[1].offset);
+    TEST_ASSERT_EQUAL_size_t(999, ranges[2].offset);
+    http_request_free(request);
+
+    /* an empty representation has no byte to send */
+    request = http_request_parse("GET /file HTTP/1.1\r\nRange: bytes=0-\r\n\r\n");
+    TEST_ASSERT_EQUAL_INT(HTTP_RANGE_NOT_SATISFIABLE, http_request_ranges(request, 0, NULL, NULL, ranges, &count));
+    http_request_free(request);
+}
+
+void test_netc_http_request_ranges_ShouldHonourIfRangeAndMethod(void)
+{
+    const char *etag = "\"44bc2cf5ad770999\"";
+    const char *last_modified = "Tue, 13 Oct 2026 10:00:00 GMT";
+    struct { const char *raw; http_range_result result; } cases[] = {
+        { "GET / HTTP/1.1\r\n\r\n", HTTP_RANGE_NONE },
+        { "HEAD / HTTP/1.1\r\nRange: bytes=0-1\r\n\r\n", HTTP_RANGE_NONE },
+        { "GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: \"44bc2cf5ad770999\"\r\n\r\n", HTTP_RANGE_SATISFIABLE },
+        { "GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: \"0000000000000000\"\r\n\r\n", HTTP_RANGE_NONE },
+        { "GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: W/\"44bc2cf5ad770999\"\r\n\r\n", HTTP_RANGE_NONE },
+        { "GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: Tue, 13 Oct 2026 10:00:00 GMT\r\n\r\n", HTTP_RANGE_SATISFIABLE },
+        { "GET / HTTP/1.1\r\nRange: bytes=0-1\r\nIf-Range: Wed, 14 Oct 2026 08:00:00 GMT\r\n\r\n", HTTP_RANGE_NONE }
+    };
+
+    http_range ranges[HTTP_MAX_RANGES];
+    size_t count;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        http_request *request = http_request_parse(cases[i].raw);
+        TEST_ASSERT_NOT_NULL(request);
+        TEST_ASSERT_EQUAL_INT(cases[i].result, http_request_ranges(request, 100, etag, last_modified, ranges, &count));
+        http_request_free(request);
+    }
+
+    /* more ranges than a response is worth building for */
+    char raw[256] = "GET / HTTP/1.1\r\nRange: bytes=0-0";
+    for (size_t i = 1; i <= HTTP_MAX_RANGES; i++)
+        snprintf(raw + strlen(raw), sizeof(raw) - strlen(raw), ",%zu-%zu", i, i);
+    strcat(raw, "\r\n\r\n");
+    http_request *request = http_request_parse(raw);
+    TEST_ASSERT_EQUAL_INT(HTTP_RANGE_NONE, http_request_ranges(request, 100, etag, last_modified, ranges, &count));
+    http_request_free(request);
+}
+
 #endif // TEST
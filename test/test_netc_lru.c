@@ -0,0 +1,62 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_lru.h"
+
+typedef struct
+{
+    int           id;
+    netc_lru_node lru;
+} lru_item;
+
+netc_lru_list list;
+lru_item items[3];
+
+void setUp(void)
+{
+    list = (netc_lru_list){0};
+    for (int i = 0; i < 3; i++)
+        items[i] = (lru_item){.id = i};
+}
+
+void tearDown(void)
+{
+}
+
+void test_netc_lru_push_front_ShouldKeepMostRecentAtHead(void)
+{
+    for (int i = 0; i < 3; i++)
+        netc_lru_push_front(&list, &items[i].lru);
+
+    TEST_ASSERT_EQUAL_INT(2, NETC_LRU_ENTRY(list.head, lru_item, lru)->id);
+    TEST_ASSERT_EQUAL_INT(0, NETC_LRU_ENTRY(list.tail, lru_item, lru)->id);
+    TEST_ASSERT_EQUAL_PTR(&items[1].lru, list.head->next);
+    TEST_ASSERT_EQUAL_PTR(&items[1].lru, list.tail->prev);
+}
+
+void test_netc_lru_remove_ShouldRelinkNeighboursAndEnds(void)
+{
+    for (int i = 0; i < 3; i++)
+        netc_lru_push_front(&list, &items[i].lru);
+
+    netc_lru_remove(&list, &items[1].lru);
+    TEST_ASSERT_EQUAL_PTR(&items[0].lru, items[2].lru.next);
+    TEST_ASSERT_EQUAL_PTR(&items[2].lru, items[0].lru.prev);
+    TEST_ASSERT_NULL(items[1].lru.prev);
+    TEST_ASSERT_NULL(items[1].lru.next);
+
+    /* touching the tail moves it to the head */
+    netc_lru_remove(&list, &items[0].lru);
+    netc_lru_push_front(&list, &items[0].lru);
+    TEST_ASSERT_EQUAL_PTR(&items[0].lru, list.head);
+    TEST_ASSERT_EQUAL_PTR(&items[2].lru, list.tail);
+
+    netc_lru_remove(&list, &items[0].lru);
+    netc_lru_remove(&list, &items[2].lru);
+    TEST_ASSERT_NULL(list.head);
+    TEST_ASSERT_NULL(list.tail);
+    TEST_ASSERT_NULL(NETC_LRU_ENTRY(list.tail, lru_item, lru));
+}
+
+#endif // TEST
@@ -0,0 +1,271 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_response_cache.h"
+#include "netc_http.h"
+#include "netc_http_parser.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
+#include "netc_lru.h"
+#include "netc_arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+netc_response_cache cache;
+
+http_response *build_response(const char *body)
+{
+    static http_response response;
+    http_response_free(&response);
+    http_response_default(&response);
+    http_response_add_header(&response, "Connection", "keep-alive");
+    http_response_add_body(&response, body);
+    return &response;
+}
+
+void setUp(void)
+{
+    TEST_ASSERT_TRUE(netc_response_cache_init(&cache, 1024 * 1024, 60000));
+}
+
+void tearDown(void)
+{
+    http_response_free(build_response(""));
+    netc_response_cache_destroy(&cache);
+}
+
+void test_netc_response_cache_lookup_ShouldReturnStoredResponse(void)
+{
+    http_request *request = http_request_parse("GET /users?page=2 HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    TEST_ASSERT_NULL(netc_response_cache_lookup(&cache, request));
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, build_response("[1,2]")));
+
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_STRING_LEN("[1,2]", entry->body, entry->body_length);
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.1 200 OK\r\n", entry->head, 17);
+    TEST_ASSERT_EQUAL_MEMORY("Content-Length: 5\r\n", entry->head + entry->head_length - 19, 19);
+    /* the connection state is added per client */
+    TEST_ASSERT_NULL(memmem(entry->head, entry->head_length, "Connection", 10));
+    netc_response_cache_release(entry);
+
+    /* the query is part of the key */
+    http_request *other = http_request_parse("GET /users?page=3 HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_NULL(netc_response_cache_lookup(&cache, other));
+
+    /* HEAD is answered from the GET response */
+    http_request *head = http_request_parse("HEAD /users?page=2 HTTP/1.1\r\n\r\n");
+    entry = netc_response_cache_lookup(&cache, head);
+    TEST_ASSERT_NOT_NULL(entry);
+    netc_response_cache_release(entry);
+
+    http_request_free(request);
+    http_request_free(other);
+    http_request_free(head);
+}
+
+void test_netc_response_cache_store_ShouldRefuseUncacheableResponses(void)
+{
+    http_request *post = http_request_parse("POST /users HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_FALSE(netc_response_cache_store(&cache, post, build_response("created")));
+
+    http_request *request = http_request_parse("GET /users HTTP/1.1\r\n\r\n");
+    http_response *response = build_response("missing");
+    http_response_set_status(response, HTTP_STATUS_NOT_FOUND);
+    TEST_ASSERT_FALSE(netc_response_cache_store(&cache, request, response));
+
+    const char *refusing[][2] = {
+        { "Set-Cookie", "session=1" }, { "Cache-Control", "no-store" }, { "Cache-Control", "private, max-age=60" },
+        { "Cache-Control", "max-age=0" }, { "Vary", "*" }
+    };
+    for (size_t i = 0; i < sizeof(refusing) / sizeof(refusing[0]); i++)
+    {
+        response = build_response("users");
+        http_response_add_header(response, refusing[i][0], refusing[i][1]);
+        TEST_ASSERT_FALSE(netc_response_cache_store(&cache, request, response));
+    }
+
+    TEST_ASSERT_NULL(netc_response_cache_lookup(&cache, request));
+    http_request_free(post);
+    http_request_free(request);
+}
+
+void test_netc_response_cache_lookup_ShouldDropExpiredResponses(void)
+{
+    netc_response_cache_destroy(&cache);
+    TEST_ASSERT_TRUE(netc_response_cache_init(&cache, 1024 * 1024, 1));
+
+    http_request *request = http_request_parse("GET /time HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, build_response("now")));
+    usleep(20000);
+    TEST_ASSERT_NULL(netc_response_cache_lookup(&cache, request));
+
+    /* max-age overrides the default lifetime */
+    http_response *response = build_response("later");
+    http_response_add_header(response, "Cache-Control", "public, max-age=60");
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, response));
+    usleep(20000);
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_NOT_NULL(entry);
+    netc_response_cache_release(entry);
+
+    http_request_free(request);
+}
+
+void test_netc_response_cache_lookup_ShouldMatchVaryHeaders(void)
+{
+    http_request *english = http_request_parse("GET /home HTTP/1.1\r\nAccept-Language: en\r\n\r\n");
+    http_request *italian = http_request_parse("GET /home HTTP/1.1\r\naccept-language: it\r\n\r\n");
+
+    http_response *response = build_response("hello");
+    http_response_add_header(response, "Vary", "Accept-Encoding, Accept-Language");
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, english, response));
+    TEST_ASSERT_NULL(netc_response_cache_lookup(&cache, italian));
+
+    response = build_response("ciao");
+    http_response_add_header(response, "Vary", "Accept-Encoding, Accept-Language");
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, italian, response));
+
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, english);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_STRING_LEN("hello", entry->body, entry->body_length);
+    netc_response_cache_release(entry);
+
+    entry = netc_response_cache_lookup(&cache, italian);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_STRING_LEN("ciao", entry->body, entry->body_length);
+    netc_response_cache_release(entry);
+
+    http_request_free(english);
+    http_request_free(italian);
+}
+
+void test_netc_response_cache_store_ShouldStayWithinBudget(void)
+{
+    netc_response_cache_destroy(&cache);
+    TEST_ASSERT_TRUE(netc_response_cache_init(&cache, NETC_RESPONSE_CACHE_SHARDS * 4096, 60000));
+
+    char body[1024];
+    memset(body, 'x', sizeof(body) - 1);
+    body[sizeof(body) - 1] = '\0';
+
+    char raw[64];
+    for (int i = 0; i < 200; i++)
+    {
+        snprintf(raw, sizeof(raw), "GET /item/%d HTTP/1.1\r\n\r\n", i);
+        http_request *request = http_request_parse(raw);
+        TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, build_response(body)));
+        http_request_free(request);
+    }
+
+    for (size_t i = 0; i < NETC_RESPONSE_CACHE_SHARDS; i++)
+        TEST_ASSERT_TRUE(cache.shards[i].size <= cache.shards[i].budget);
+
+    /* the most recent response survived, the oldest were evicted */
+    http_request *request = http_request_parse("GET /item/199 HTTP/1.1\r\n\r\n");
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_NOT_NULL(entry);
+    netc_response_cache_release(entry);
+    http_request_free(request);
+
+    /* a response larger than a shard is never stored */
+    char *large = malloc(8192);
+    memset(large, 'y', 8191);
+    large[8191] = '\0';
+    request = http_request_parse("GET /large HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_FALSE(netc_response_cache_store(&cache, request, build_response(large)));
+    http_request_free(request);
+    free(large);
+}
+
+void test_netc_response_cache_store_ShouldKeepReplacedEntryUntilReleased(void)
+{
+    http_request *request = http_request_parse("GET /config HTTP/1.1\r\n\r\n");
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, build_response("v1")));
+    netc_cache_entry *old = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_NOT_NULL(old);
+
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, build_response("v2")));
+    TEST_ASSERT_TRUE(old->evicted);
+    TEST_ASSERT_EQUAL_STRING_LEN("v1", old->body, old->body_length);
+
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_EQUAL_STRING_LEN("v2", entry->body, entry->body_length);
+    netc_response_cache_release(entry);
+    netc_response_cache_release(old);
+
+    http_request_free(request);
+}
+
+void test_netc_response_cache_share_ShouldServeEveryHolderWithoutStoring(void)
+{
+    http_request *request = http_request_parse("GET /report HTTP/1.1\r\nAccept-Language: it\r\n\r\n");
+    http_response *response = build_response("slow");
+    http_response_set_status(response, HTTP_STATUS_NOT_FOUND);
+    http_response_add_header(response, "Vary", "Accept-Language");
+
+    /* any status is shared, nothing lands in a cache */
+    netc_cache_entry *entry = netc_response_cache_share(request, response);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_NULL(entry->shard);
+    TEST_ASSERT_EQUAL_MEMORY("HTTP/1.1 404 Not found\r\n", entry->head, 24);
+    TEST_ASSERT_EQUAL_STRING_LEN("slow", entry->body, entry->body_length);
+    TEST_ASSERT_NULL(memmem(entry->head, entry->head_length, "Connection", 10));
+    TEST_ASSERT_NULL(entry->etag);
+
+    http_request *same = http_request_parse("GET /report HTTP/1.1\r\nAccept-Language: it\r\n\r\n");
+    http_request *other = http_request_parse("GET /report HTTP/1.1\r\nAccept-Language: en\r\n\r\n");
+    TEST_ASSERT_TRUE(netc_response_cache_matches(entry, same));
+    TEST_ASSERT_FALSE(netc_response_cache_matches(entry, other));
+
+    /* the last of the holders frees it */
+    netc_response_cache_retain(entry);
+    TEST_ASSERT_EQUAL_size_t(2, atomic_load(&entry->references));
+    netc_response_cache_release(entry);
+    TEST_ASSERT_EQUAL_size_t(1, atomic_load(&entry->references));
+    netc_response_cache_release(entry);
+
+    const char *refusing[][2] = {
+        { "Set-Cookie", "session=1" }, { "Cache-Control", "no-store" }, { "Cache-Control", "private" }, { "Vary", "*" }
+    };
+    for (size_t i = 0; i < sizeof(refusing) / sizeof(refusing[0]); i++)
+    {
+        response = build_response("mine");
+        http_response_add_header(response, refusing[i][0], refusing[i][1]);
+        TEST_ASSERT_NULL(netc_response_cache_share(request, response));
+    }
+
+    http_request_free(request);
+    http_request_free(same);
+    http_request_free(other);
+}
+
+void test_netc_response_cache_store_ShouldKeepValidators(void)
+{
+    http_request *request = http_request_parse("GET /feed HTTP/1.1\r\n\r\n");
+    http_response *response = build_response("items");
+    http_response_add_header(response, "Content-Type", "application/json");
+    http_response_add_header(response, "Last-Modified", "Tue, 13 Oct 2026 10:00:00 GMT");
+    TEST_ASSERT_TRUE(http_response_add_etag(response));
+    TEST_ASSERT_TRUE(netc_response_cache_store(&cache, request, response));
+
+    netc_cache_entry *entry = netc_response_cache_lookup(&cache, request);
+    TEST_ASSERT_NOT_NULL(entry);
+    TEST_ASSERT_EQUAL_STRING(http_response_get_header(response, "ETag"), entry->etag);
+    TEST_ASSERT_EQUAL_STRING("Tue, 13 Oct 2026 10:00:00 GMT", entry->last_modified);
+    TEST_ASSERT_EQUAL_STRING("application/json", entry->content_type);
+    TEST_ASSERT_EQUAL_size_t(17, entry->status_length);
+    TEST_ASSERT_NOT_NULL(memmem(entry->head, entry->head_length, "ETag: \"", 7));
+
+    http_request *revalidation = http_request_parse("GET /feed HTTP/1.1\r\nIf-Modified-Since: Tue, 13 Oct 2026 10:00:00 GMT\r\n\r\n");
+    TEST_ASSERT_TRUE(http_request_not_modified(revalidation, entry->etag, entry->last_modified));
+    netc_response_cache_release(entry);
+
+    http_request_free(request);
+    http_request_free(revalidation);
+}
+
+#endif // TEST
@@ -0,0 +1,155 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_router.h"
+#include "netc_http.h"
+#include "netc_http_parser.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
+#include "netc_arena.h"
+#include <string.h>
+
+netc_router router;
+netc_route_match match;
+
+void setUp(void)
+{
+    netc_router_init(&router);
+}
+
+void tearDown(void)
+{
+    netc_router_destroy(&router);
+}
+
+void add_route(const char *method, const char *path, int value)
+{
+    TEST_ASSERT_TRUE(netc_router_add(&router, method, path, &value, sizeof(value)));
+}
+
+int matched_value(void)
+{
+    TEST_ASSERT_NOT_NULL(match.value);
+    return *(int*)match.value;
+}
+
+void assert_param(size_t index, const char *name, const char *value)
+{
+    TEST_ASSERT_TRUE(index < match.param_count);
+    TEST_ASSERT_EQUAL_STRING(name, match.params[index].name);
+    TEST_ASSERT_EQUAL_size_t(strlen(value), match.params[index].length);
+    TEST_ASSERT_EQUAL_MEMORY(value, match.params[index].value, strlen(value));
+}
+
+void test_netc_router_add_ShouldRejectInvalidPatterns(void)
+{
+    int value = 1;
+    TEST_ASSERT_FALSE(netc_router_add(&router, GET, "users", &value, sizeof(value)));
+    TEST_ASSERT_FALSE(netc_router_add(&router, GET, "/users/:", &value, sizeof(value)));
+    TEST_ASSERT_FALSE(netc_router_add(&router, GET, "/users/a:id", &value, sizeof(value)));
+    TEST_ASSERT_FALSE(netc_router_add(&router, GET, "/files/*path/more", &value, sizeof(value)));
+    TEST_ASSERT_FALSE(netc_router_add(&router, "BREW", "/pot", &value, sizeof(value)));
+    TEST_ASSERT_FALSE(netc_router_add(&router, GET, "/a/:b/:c/:d/:e/:f/:g/:h/:i/:j", &value, sizeof(value)));
+
+    /* the same position cannot be captured under two names */
+    add_route(GET, "/users/:id", 1);
+    TEST_ASSERT_FALSE(netc_router_add(&router, GET, "/users/:name/posts", &value, sizeof(value)));
+}
+
+void test_netc_router_match_ShouldFindStaticRoutesSharingPrefixes(void)
+{
+    add_route(GET, "/", 1);
+    add_route(GET, "/users", 2);
+    add_route(GET, "/user", 3);
+    add_route(GET, "/users/admins", 4);
+    add_route(GET, "/uploads", 5);
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/", &match));
+    TEST_ASSERT_EQUAL_INT(1, matched_value());
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/users", &match));
+    TEST_ASSERT_EQUAL_INT(2, matched_value());
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/user", &match));
+    TEST_ASSERT_EQUAL_INT(3, matched_value());
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/users/admins?page=2", &match));
+    TEST_ASSERT_EQUAL_INT(4, matched_value());
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/uploads", &match));
+    TEST_ASSERT_EQUAL_INT(5, matched_value());
+    TEST_ASSERT_EQUAL_size_t(0, match.param_count);
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_NOT_FOUND, netc_router_match(&router, GET, "/use", &match));
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_NOT_FOUND, netc_router_match(&router, GET, "/users/", &match));
+}
+
+void test_netc_router_match_ShouldCaptureParameters(void)
+{
+    add_route(GET, "/users/:id", 1);
+    add_route(GET, "/users/:id/posts/:post", 2);
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/users/42", &match));
+    TEST_ASSERT_EQUAL_INT(1, matched_value());
+    TEST_ASSERT_EQUAL_size_t(1, match.param_count);
+    assert_param(0, "id", "42");
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/users/42/posts/7?full=1", &match));
+    TEST_ASSERT_EQUAL_INT(2, matched_value());
+    TEST_ASSERT_EQUAL_size_t(2, match.param_count);
+    assert_param(0, "id", "42");
+    assert_param(1, "post", "7");
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_NOT_FOUND, netc_router_match(&router, GET, "/users/", &match));
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_NOT_FOUND, netc_router_match(&router, GET, "/users/42/posts", &match));
+}
+
+void test_netc_router_match_ShouldPreferStaticThenParameterThenWildcard(void)
+{
+    add_route(GET, "/files/readme", 1);
+    add_route(GET, "/files/:name/raw", 2);
+    add_route(GET, "/files/*path", 3);
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/files/readme", &match));
+    TEST_ASSERT_EQUAL_INT(1, matched_value());
+
+    /* the static branch matches a prefix but not the rest, so the lookup
+     * backtracks into the parameter */
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/files/readme/raw", &match));
+    TEST_ASSERT_EQUAL_INT(2, matched_value());
+    TEST_ASSERT_EQUAL_size_t(1, match.param_count);
+    assert_param(0, "name", "readme");
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/files/css/site.css", &match));
+    TEST_ASSERT_EQUAL_INT(3, matched_value());
+    TEST_ASSERT_EQUAL_size_t(1, match.param_count);
+    assert_param(0, "path", "css/site.css");
+}
+
+void test_netc_router_match_ShouldTellMethodNotAllowedFromNotFound(void)
+{
+    add_route(GET, "/users/:id", 1);
+    add_route(DELETE, "/users/:id", 2);
+    add_route(POST, "/users", 3);
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_METHOD_NOT_ALLOWED, netc_router_match(&router, PUT, "/users/42", &match));
+    TEST_ASSERT_NULL(match.value);
+    TEST_ASSERT_EQUAL_size_t(0, match.param_count);
+
+    char allow[64];
+    TEST_ASSERT_EQUAL_size_t(strlen("GET, DELETE"), netc_router_format_allowed(match.allowed_methods, allow, sizeof(allow)));
+    TEST_ASSERT_EQUAL_STRING("GET, DELETE", allow);
+    TEST_ASSERT_EQUAL_size_t(0, netc_router_format_allowed(match.allowed_methods, allow, 4));
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_METHOD_NOT_ALLOWED, netc_router_match(&router, "BREW", "/users", &match));
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_NOT_FOUND, netc_router_match(&router, GET, "/posts", &match));
+    TEST_ASSERT_EQUAL_UINT16(0, match.allowed_methods);
+}
+
+void test_netc_router_add_ShouldReplaceExistingRoute(void)
+{
+    add_route(GET, "/users/:id", 1);
+    add_route(GET, "/users/:id", 2);
+
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&router, GET, "/users/42", &match));
+    TEST_ASSERT_EQUAL_INT(2, matched_value());
+}
+
+#endif // TEST
@@ -0,0 +1,141 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_scheduler.h"
+#include <stdatomic.h>
+#include <unistd.h>
+
+netc_scheduler scheduler;
+atomic_size_t executed;
+atomic_size_t blockers_started;
+atomic_bool release_blocker;
+
+void *count_task(void *arg)
+{
+    (void)arg;
+    atomic_fetch_add(&executed, 1);
+    return NULL;
+}
+
+void *blocking_task(void *arg)
+{
+    (void)arg;
+    atomic_fetch_add(&blockers_started, 1);
+    while (atomic_load(&release_blocker) == false)
+        usleep(1000);
+    atomic_fetch_add(&executed, 1);
+    return NULL;
+}
+
+void block_worker(size_t affinity)
+{
+    size_t started = atomic_load(&blockers_started);
+    netc_task task = { .function = blocking_task, .argp = NULL };
+    TEST_ASSERT_TRUE(netc_scheduler_submit(&scheduler, &task, affinity));
+    while (atomic_load(&blockers_started) == started)
+        usleep(1000);
+}
+
+void setUp(void)
+{
+    atomic_store(&executed, 0);
+    atomic_store(&blockers_started, 0);
+    atomic_store(&release_blocker, false);
+}
+
+void tearDown(void)
+{
+}
+
+void test_netc_scheduler_destroy_ShouldRunEverySubmittedTask(void)
+{
+    TEST_ASSERT_TRUE(netc_scheduler_init(&scheduler, 4, false));
+
+    netc_task task = { .function = count_task, .argp = NULL };
+    /* more tasks than the queues hold, so some submissions wait for room */
+    for (size_t i = 0; i < 10000; i++)
+    {
+        while (netc_scheduler_submit(&scheduler, &task, i) == false)
+            usleep(100);
+    }
+
+    netc_scheduler_destroy(&scheduler);
+
+    TEST_ASSERT_EQUAL_size_t(10000, atomic_load(&executed));
+}
+
+void test_netc_scheduler_submit_ShouldLetIdleWorkersStealFromBusyOne(void)
+{
+    TEST_ASSERT_TRUE(netc_scheduler_init(&scheduler, 2, false));
+    block_worker(0);
+
+    netc_task task = { .function = count_task, .argp = NULL };
+    for (size_t i = 0; i < 10; i++)
+        TEST_ASSERT_TRUE(netc_scheduler_submit(&scheduler, &task, 0));
+    while (atomic_load(&executed) < 10)
+        usleep(1000);
+
+    netc_scheduler_stats stats = netc_scheduler_get_stats(&scheduler, 1);
+    TEST_ASSERT_EQUAL_UINT64(10, stats.stolen);
+    TEST_ASSERT_EQUAL_UINT64(10, stats.executed);
+
+    atomic_store(&release_blocker, true);
+    netc_scheduler_destroy(&scheduler);
+    TEST_ASSERT_EQUAL_size_t(11, atomic_load(&executed));
+}
+
+void test_netc_scheduler_queue_depth_ShouldCountWaitingTasks(void)
+{
+    TEST_ASSERT_TRUE(netc_scheduler_init(&scheduler, 1, false));
+    block_worker(0);
+
+    netc_task task = { .function = count_task, .argp = NULL };
+    for (size_t i = 0; i < 5; i++)
+        TEST_ASSERT_TRUE(netc_scheduler_submit(&scheduler, &task, 0));
+
+    TEST_ASSERT_EQUAL_size_t(5, netc_scheduler_queue_depth(&scheduler, 0));
+    TEST_ASSERT_EQUAL_size_t(0, netc_scheduler_queue_depth(&scheduler, 1));
+
+    atomic_store(&release_blocker, true);
+    netc_scheduler_destroy(&scheduler);
+    TEST_ASSERT_EQUAL_size_t(6, atomic_load(&executed));
+}
+
+void test_netc_scheduler_submit_ShouldSpillFullQueueIntoPeerQueue(void)
+{
+    TEST_ASSERT_TRUE(netc_scheduler_init(&scheduler, 2, false));
+    block_worker(0);
+    block_worker(1);
+
+    netc_task task = { .function = count_task, .argp = NULL };
+    for (size_t i = 0; i < NETC_SCHEDULER_QUEUE_CAPACITY + 10; i++)
+        TEST_ASSERT_TRUE(netc_scheduler_submit(&scheduler, &task, 0));
+
+    netc_scheduler_stats stats = netc_scheduler_get_stats(&scheduler, 0);
+    TEST_ASSERT_EQUAL_UINT64(10, stats.overflowed);
+    TEST_ASSERT_EQUAL_size_t(NETC_SCHEDULER_QUEUE_CAPACITY, stats.queue_depth);
+    TEST_ASSERT_EQUAL_size_t(10, netc_scheduler_queue_depth(&scheduler, 1));
+
+    atomic_store(&release_blocker, true);
+    netc_scheduler_destroy(&scheduler);
+    TEST_ASSERT_EQUAL_size_t(NETC_SCHEDULER_QUEUE_CAPACITY + 12, atomic_load(&executed));
+}
+
+void test_netc_scheduler_submit_ShouldRejectTasksWhenEveryQueueIsFull(void)
+{
+    TEST_ASSERT_TRUE(netc_scheduler_init(&scheduler, 1, false));
+    block_worker(0);
+
+    netc_task task = { .function = count_task, .argp = NULL };
+    for (size_t i = 0; i < NETC_SCHEDULER_QUEUE_CAPACITY; i++)
+        TEST_ASSERT_TRUE(netc_scheduler_submit(&scheduler, &task, 0));
+    TEST_ASSERT_FALSE(netc_scheduler_submit(&scheduler, &task, 0));
+    TEST_ASSERT_EQUAL_size_t(NETC_SCHEDULER_QUEUE_CAPACITY, netc_scheduler_queue_depth(&scheduler, 0));
+
+    atomic_store(&release_blocker, true);
+    netc_scheduler_destroy(&scheduler);
+    TEST_ASSERT_EQUAL_size_t(NETC_SCHEDULER_QUEUE_CAPACITY + 1, atomic_load(&executed));
+}
+
+#endif // TEST
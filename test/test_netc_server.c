@@ -5,12 +5,32 @@
 #include "netc_server.h"
 #include "ctsl.h"
 #include "netc_http.h"
+#include "netc_reactor.h"
+#include "netc_connection.h"
+#include "netc_http_parser.h"
+#include "netc_uring.h"
+#include "netc_router.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
+#include "netc_lru.h"
+#include "netc_arena.h"
+#include "netc_scheduler.h"
+#include "netc_file_cache.h"
+#include "netc_response_cache.h"
+#include "netc_flight.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
-#include <hashtable.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
 
 extern netc server;
+void netc_shutdown_signal_handler(int sig);
 
 void *test_handler(http_request *req, http_response *res)
 {
@@ -19,6 +39,27 @@ void *test_handler(http_request *req, http_response *res)
     return NULL;
 }
 
+/* more than NETC_STREAM_CHUNK_SIZE, written from the event loop */
+void *inline_stream_handler(http_request *req, http_response *res)
+{
+    (void)res;
+    char piece[32 * 1024];
+    memset(piece, 'z', sizeof(piece));
+
+    netc_stream *stream = netc_stream_begin(req);
+    for (size_t i = 0; i < 8; i++)
+        netc_stream_write(stream, piece, sizeof(piece));
+    netc_stream_end(stream);
+    return NULL;
+}
+
+void *run_server(void *arg)
+{
+    (void)arg;
+    netc_run();
+    return NULL;
+}
+
 void setUp(void)
 {
 }
@@ -29,20 +70,44 @@ void tearDown(void)
 
 void test_netc_server_setup_ShouldSetupCorrectly(void)
 {
-    netc_setup(8080, "logs/test.log");
+    netc_setup(8080, "logs/test.log", 4);
 
     TEST_ASSERT_EQUAL_UINT16(8080, server.listening_port);
     TEST_ASSERT_EQUAL_size_t(5, server.backlog_number);
     TEST_ASSERT_FALSE(server.logger.is_terminal);
-    TEST_ASSERT_NOT_NULL(server.endpoint_map);
-    TEST_ASSERT_NOT_NULL(server.threadpool);
+    TEST_ASSERT_EQUAL_size_t(4, server.scheduler.worker_count);
+    TEST_ASSERT_EQUAL_size_t(1, server.reactor_count);
+    TEST_ASSERT_EQUAL_UINT32(5000, server.keepalive_timeout_ms);
+    TEST_ASSERT_EQUAL_size_t(100, server.max_keepalive_requests);
+    TEST_ASSERT_EQUAL_size_t(NETC_DEFAULT_MAX_HEADER_SIZE, server.max_header_size);
+    TEST_ASSERT_EQUAL_size_t(NETC_DEFAULT_MAX_BODY_SIZE, server.max_body_size);
+    TEST_ASSERT_NOT_NULL(server.reactors);
+
+    netc_destroy();
+}
+
+void test_netc_server_setup_with_config_ShouldCreateListenerPerReactor(void)
+{
+    netc_config config = netc_default_config();
+    config.log_filename = "logs/test.log";
+    config.reactor_num = 3;
+    netc_setup_with_config(&config);
+
+    TEST_ASSERT_EQUAL_size_t(3, server.reactor_count);
+    for (size_t i = 0; i < server.reactor_count; i++)
+    {
+        TEST_ASSERT_GREATER_OR_EQUAL(0, server.reactors[i].listening_socket_fd);
+        for (size_t j = 0; j < i; j++)
+            TEST_ASSERT_NOT_EQUAL(server.reactors[j].listening_socket_fd, server.reactors[i].listening_socket_fd);
+    }
 
     netc_destroy();
+    TEST_ASSERT_NULL(server.reactors);
 }
 
 void test_netc_server_add_endpoint_ShouldFailToAddHandlerWithInvalidArguments(void)
 {
-    netc_setup(8080, "logs/test.txt");
+    netc_setup(8080, "logs/test.txt", 4);
 
     TEST_ASSERT_FALSE(netc_add_endpoint(NULL, NULL, NULL));
     TEST_ASSERT_FALSE(netc_add_endpoint(NULL, NULL, test_handler));
@@ -57,22 +122,155 @@ void test_netc_server_add_endpoint_ShouldFailToAddHandlerWithInvalidArguments(vo
 
 void test_netc_server_add_endpoint_ShouldAddHandlerWithValidArguments(void)
 {
-    netc_setup(8080, "logs/test.txt");
+    netc_setup(8080, "logs/test.txt", 4);
 
+    netc_route_match match;
     TEST_ASSERT_TRUE(netc_add_endpoint(GET, "/", test_handler));
-    void *(**got_function)(http_request *, http_response*)
-        = hashtable_get(server.endpoint_map, "GET/");
-    TEST_ASSERT_NOT_NULL(*got_function);
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&server.router, GET, "/", &match));
+    void *(**got_function)(http_request *, http_response*) = match.value;
     TEST_ASSERT_EQUAL_PTR(test_handler, *got_function);
-    free(got_function);
 
-    TEST_ASSERT_TRUE(netc_add_endpoint(POST, "/users", test_handler));
-    got_function = hashtable_get(server.endpoint_map, "POST/users");
-    TEST_ASSERT_NOT_NULL(*got_function);
+    TEST_ASSERT_TRUE(netc_add_endpoint(POST, "/users/:id", test_handler));
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&server.router, POST, "/users/42", &match));
+    got_function = match.value;
     TEST_ASSERT_EQUAL_PTR(test_handler, *got_function);
-    free(got_function);
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_METHOD_NOT_ALLOWED, netc_router_match(&server.router, GET, "/users/42", &match));
 
     netc_destroy();
 }
 
+void test_netc_server_add_endpoint_ex_ShouldRegisterInlineHandler(void)
+{
+    netc_setup(8080, "logs/test.txt", 4);
+
+    TEST_ASSERT_FALSE(netc_add_endpoint_ex(GET, "/health", test_handler, 1 << 7));
+    TEST_ASSERT_TRUE(netc_add_endpoint_ex(GET, "/health", test_handler, NETC_ENDPOINT_INLINE));
+
+    netc_route_match match;
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&server.router, GET, "/health", &match));
+    void *(**got_function)(http_request *, http_response*) = match.value;
+    TEST_ASSERT_EQUAL_PTR(test_handler, *got_function);
+
+    netc_destroy();
+}
+
+void test_netc_server_defer_ShouldFailOutsideOfHandler(void)
+{
+    http_request *request = http_request_parse("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    TEST_ASSERT_NOT_NULL(request);
+
+    TEST_ASSERT_NULL(netc_defer(NULL));
+    TEST_ASSERT_NULL(netc_defer(request));
+    TEST_ASSERT_NULL(netc_deferred_response(NULL));
+    TEST_ASSERT_NULL(netc_deferred_request(NULL));
+
+    http_request_free(request);
+}
+
+void test_netc_server_stream_begin_ShouldFailOutsideOfHandler(void)
+{
+    http_request *request = http_request_parse("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    TEST_ASSERT_NOT_NULL(request);
+
+    TEST_ASSERT_NULL(netc_stream_begin(NULL));
+    TEST_ASSERT_NULL(netc_stream_begin(request));
+    TEST_ASSERT_FALSE(netc_stream_write(NULL, "data", 4));
+    TEST_ASSERT_FALSE(netc_stream_end(NULL));
+
+    http_request_free(request);
+}
+
+void test_netc_server_add_static_ShouldRouteGetAndHead(void)
+{
+    netc_setup(8080, "logs/test.txt", 4);
+
+    TEST_ASSERT_FALSE(netc_add_static(NULL, "."));
+    TEST_ASSERT_FALSE(netc_add_static("assets", "."));
+    TEST_ASSERT_FALSE(netc_add_static("/assets", "/nonexistent/netc"));
+    TEST_ASSERT_TRUE(netc_add_static("/assets/", "."));
+    TEST_ASSERT_NOT_NULL(server.file_caches);
+
+    netc_route_match match;
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&server.router, GET, "/assets/css/site.css", &match));
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_FOUND, netc_router_match(&server.router, HEAD, "/assets/index.html", &match));
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_METHOD_NOT_ALLOWED, netc_router_match(&server.router, POST, "/assets/a", &match));
+
+    netc_destroy();
+    TEST_ASSERT_NULL(server.file_caches);
+}
+
+void test_netc_server_add_endpoint_ex_ShouldSetUpResponseCacheOnDemand(void)
+{
+    netc_setup(8080, "logs/test.txt", 4);
+
+    TEST_ASSERT_TRUE(netc_add_endpoint(GET, "/live", test_handler));
+    TEST_ASSERT_TRUE(netc_add_endpoint_ex(GET, "/report", test_handler, NETC_ENDPOINT_COALESCE));
+    TEST_ASSERT_NULL(server.response_cache.shards);
+    TEST_ASSERT_TRUE(netc_add_endpoint_ex(GET, "/catalog", test_handler, NETC_ENDPOINT_CACHE | NETC_ENDPOINT_INLINE));
+    TEST_ASSERT_NOT_NULL(server.response_cache.shards);
+    TEST_ASSERT_EQUAL_UINT32(NETC_RESPONSE_CACHE_DEFAULT_TTL, server.response_cache.default_ttl_ms);
+
+    netc_destroy();
+    TEST_ASSERT_NULL(server.response_cache.shards);
+}
+
+void test_netc_server_add_endpoint_ex_ShouldOnlyCoalesceGetAndHead(void)
+{
+    netc_setup(8080, "logs/test.txt", 4);
+
+    TEST_ASSERT_FALSE(netc_add_endpoint_ex(POST, "/orders", test_handler, NETC_ENDPOINT_COALESCE));
+    TEST_ASSERT_FALSE(netc_add_endpoint_ex(PUT, "/orders", test_handler, NETC_ENDPOINT_COALESCE));
+    TEST_ASSERT_FALSE(netc_add_endpoint_ex(GET, "/upload", test_handler,
+                                           NETC_ENDPOINT_COALESCE | NETC_ENDPOINT_STREAM_BODY));
+    TEST_ASSERT_TRUE(netc_add_endpoint_ex(GET, "/report", test_handler, NETC_ENDPOINT_COALESCE));
+    TEST_ASSERT_TRUE(netc_add_endpoint_ex(HEAD, "/report", test_handler, NETC_ENDPOINT_COALESCE));
+
+    netc_route_match match;
+    TEST_ASSERT_EQUAL_INT(NETC_ROUTE_NOT_FOUND, netc_router_match(&server.router, POST, "/orders", &match));
+
+    netc_destroy();
+}
+
+void test_netc_server_stream_write_ShouldNotBlockInlineHandlerOnFirstEventLoop(void)
+{
+    netc_config config = netc_default_config();
+    config.port = 8185;
+    config.log_filename = "logs/test.txt";
+    netc_setup_with_config(&config);
+    TEST_ASSERT_TRUE(netc_add_endpoint_ex(GET, "/stream", inline_stream_handler, NETC_ENDPOINT_INLINE));
+
+    /* the first event loop runs on the thread calling netc_run */
+    pthread_t server_thread;
+    TEST_ASSERT_EQUAL_INT(0, pthread_create(&server_thread, NULL, run_server, NULL));
+    usleep(100000);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(8185) };
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct timeval timeout = { .tv_sec = 5 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    TEST_ASSERT_EQUAL_INT(0, connect(fd, (struct sockaddr*)&address, sizeof(address)));
+    const char *request = "GET /stream HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    TEST_ASSERT_EQUAL_INT(strlen(request), send(fd, request, strlen(request), 0));
+
+    size_t capacity = 512 * 1024, received = 0;
+    char *buffer = malloc(capacity);
+    TEST_ASSERT_NOT_NULL(buffer);
+    ssize_t bytes;
+    while (received < capacity && (bytes = recv(fd, buffer + received, capacity - received, 0)) > 0)
+        received += bytes;
+    close(fd);
+
+    size_t payload = 0;
+    for (size_t i = 0; i < received; i++)
+        payload += buffer[i] == 'z';
+    TEST_ASSERT_EQUAL_size_t(8 * 32 * 1024, payload);
+    TEST_ASSERT_TRUE(received >= 5);
+    TEST_ASSERT_EQUAL_MEMORY("0\r\n\r\n", buffer + received - 5, 5);
+    free(buffer);
+
+    netc_shutdown_signal_handler(SIGINT);
+    pthread_join(server_thread, NULL);
+}
+
 #endif // TEST
@@ -0,0 +1,59 @@
+#ifdef TEST
+
+#include "unity.h"
+
+#include "netc_uring.h"
+#include "netc_reactor.h"
+#include "netc_connection.h"
+#include "netc_http.h"
+#include "netc_http_parser.h"
+#include "ctsl.h"
+#include "netc_clock.h"
+#include "netc_hash.h"
+#include "netc_arena.h"
+
+netc_uring uring;
+bool uring_available;
+
+void setUp(void)
+{
+    uring_available = netc_uring_init(&uring);
+}
+
+void tearDown(void)
+{
+    if (uring_available)
+        netc_uring_destroy(&uring);
+}
+
+void test_netc_uring_NopShouldComplete(void)
+{
+    if (!uring_available) TEST_IGNORE();
+
+    struct io_uring_sqe *sqe = netc_uring_get_sqe(&uring);
+    TEST_ASSERT_NOT_NULL(sqe);
+    sqe->opcode = IORING_OP_NOP;
+    sqe->user_data = 42;
+
+    TEST_ASSERT_EQUAL_INT(1, netc_uring_submit_and_wait(&uring));
+
+    unsigned head = *uring.cq_head;
+    TEST_ASSERT_NOT_EQUAL(head, __atomic_load_n(uring.cq_tail, __ATOMIC_ACQUIRE));
+    TEST_ASSERT_EQUAL_UINT64(42, uring.cqes[head & uring.cq_mask].user_data);
+    TEST_ASSERT_EQUAL_INT(0, uring.cqes[head & uring.cq_mask].res);
+    __atomic_store_n(uring.cq_head, head + 1, __ATOMIC_RELEASE);
+}
+
+void test_netc_uring_GetSqeShouldFlushFullQueue(void)
+{
+    if (!uring_available) TEST_IGNORE();
+
+    for (unsigned i = 0; i < uring.sq_entries + 1; i++)
+    {
+        struct io_uring_sqe *sqe = netc_uring_get_sqe(&uring);
+        TEST_ASSERT_NOT_NULL(sqe);
+        sqe->opcode = IORING_OP_NOP;
+    }
+}
+
+#endif // TEST
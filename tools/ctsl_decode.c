@@ -0,0 +1,128 @@
+/*
+ * Turns a log written with the CTSL_FORMAT_BINARY format back into the text
+ * ctsl writes to files: "YYYY-mm-dd HH:MM:SS - LEVEL - message".
+ *
+ * usage: ctsl_decode [binary_log]   (reads stdin without arguments)
+ */
+#include "ctsl.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct
+{
+    char   **formats;
+    size_t   capacity;
+} format_table;
+
+bool read_exact(FILE *input, void *buffer, size_t length)
+{
+    return fread(buffer, 1, length, input) == length;
+}
+
+bool define_format(format_table *table, FILE *input)
+{
+    uint32_t id;
+    uint16_t length;
+    if (read_exact(input, &id, sizeof(id)) == false || read_exact(input, &length, sizeof(length)) == false)
+        return false;
+
+    if (id >= table->capacity)
+    {
+        size_t capacity = table->capacity ? table->capacity : 64;
+        while (capacity <= id) capacity *= 2;
+
+        char **formats = realloc(table->formats, capacity * sizeof(char*));
+        if (formats == NULL) return false;
+        memset(formats + table->capacity, 0, (capacity - table->capacity) * sizeof(char*));
+        table->formats = formats;
+        table->capacity = capacity;
+    }
+
+    char *format = malloc(length + 1);
+    if (format == NULL || read_exact(input, format, length) == false)
+    {
+        free(format);
+        return false;
+    }
+    format[length] = '\0';
+
+    /* ids restart when another process appends to the log */
+    free(table->formats[id]);
+    table->formats[id] = format;
+    return true;
+}
+
+bool print_record(const format_table *table, FILE *input)
+{
+    uint32_t id;
+    uint8_t level;
+    uint64_t timestamp_ns;
+    uint16_t args_length;
+    uint8_t args[CTSL_ENTRY_SIZE];
+    if (read_exact(input, &id, sizeof(id)) == false ||
+        read_exact(input, &level, sizeof(level)) == false ||
+        read_exact(input, &timestamp_ns, sizeof(timestamp_ns)) == false ||
+        read_exact(input, &args_length, sizeof(args_length)) == false ||
+        args_length > sizeof(args) || read_exact(input, args, args_length) == false)
+        return false;
+
+    if (id >= table->capacity || table->formats[id] == NULL || ctsl_level_name(level) == NULL)
+    {
+        fprintf(stderr, "record references unknown format %u\n", id);
+        return false;
+    }
+
+    time_t seconds = timestamp_ns / 1000000000ull;
+    struct tm t;
+    localtime_r(&seconds, &t);
+    char timestamp[64];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &t);
+
+    char message[CTSL_ENTRY_SIZE * 2];
+    ctsl_format_record(message, sizeof(message), table->formats[id], args, args_length);
+    printf("%s - %s - %s\n", timestamp, ctsl_level_name(level), message);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *input = argc > 1 ? fopen(argv[1], "rb") : stdin;
+    if (input == NULL)
+    {
+        perror("Error opening log");
+        return EXIT_FAILURE;
+    }
+
+    char magic[sizeof(CTSL_BINARY_MAGIC) - 1];
+    if (read_exact(input, magic, sizeof(magic)) == false || memcmp(magic, CTSL_BINARY_MAGIC, sizeof(magic)) != 0)
+    {
+        fprintf(stderr, "not a binary ctsl log\n");
+        return EXIT_FAILURE;
+    }
+
+    format_table table = { 0 };
+    int status = EXIT_SUCCESS;
+    int type;
+    while ((type = fgetc(input)) != EOF)
+    {
+        bool ok = type == CTSL_BINARY_FORMAT ? define_format(&table, input)
+                : type == CTSL_BINARY_RECORD ? print_record(&table, input)
+                : false;
+        if (ok == false)
+        {
+            fprintf(stderr, "corrupted or truncated log at offset %ld\n", ftell(input));
+            status = EXIT_FAILURE;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < table.capacity; i++)
+        free(table.formats[i]);
+    free(table.formats);
+    if (input != stdin)
+        fclose(input);
+    return status;
+}